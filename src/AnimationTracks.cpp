@@ -0,0 +1,425 @@
+#include "AnimationTracks.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+
+AnimationTracks::AnimationTracks()
+{
+	m_Quantized = false;
+}
+
+// drops every track, the new ones are stored quantized or not
+VOID AnimationTracks::Initialize(bool quantized)
+{
+	m_Quantized = quantized;
+
+	m_FirstKeys.clear();
+	m_KeyCounts.clear();
+	m_Cursors.clear();
+	m_Times.clear();
+
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		m_Rotations[k].clear();
+		m_QuantizedRotations[k].clear();
+	}
+
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		m_TranslationScales[k].clear();
+		m_TranslationBiases[k].clear();
+		m_Translations[k].clear();
+		m_QuantizedTranslations[k].clear();
+	}
+
+	for (unsigned int c = 0; c < SEGMENT_COMPONENTS; c++)
+	{
+		m_Segments[c].clear();
+	}
+}
+
+/*
+* appends a track of keyCount keys: increasing times, unit quaternions { x, y, z, w } and translations { x, y, z }.
+* consecutive rotations are interpolated along the shorter arc.
+*/
+INT AnimationTracks::AddTrack(const float* pTimes, const float* pRotations, const float* pTranslations, size_t keyCount)
+{
+	INT status = STATUS_SUCCESS;
+
+	if ((keyCount == 0) || (m_Times.size() + keyCount > UINT32_MAX))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: a track needs 1 to %u keys in all\n", status, UINT32_MAX);
+	}
+
+	for (size_t i = 1; (i < keyCount) && SUCCEEDED(status); i++)
+	{
+		if (!(pTimes[i] > pTimes[i - 1]))
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: the key times of track %zu do not increase at key %zu\n", status, m_FirstKeys.size(), i);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_FirstKeys.push_back(static_cast<uint32_t>(m_Times.size()));
+		m_KeyCounts.push_back(static_cast<uint32_t>(keyCount));
+		m_Cursors.push_back(0);
+
+		m_Times.insert(m_Times.end(), pTimes, pTimes + keyCount);
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				const float value = pRotations[i * 4 + k];
+
+				if (m_Quantized)
+				{
+					m_QuantizedRotations[k].push_back(static_cast<int16_t>(std::lround(std::min(std::max(value, -1.0f), 1.0f) * 32767.0f)));
+				}
+				else
+				{
+					m_Rotations[k].push_back(value);
+				}
+			}
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			float lo = FLT_MAX;
+			float hi = -FLT_MAX;
+
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				lo = std::min(lo, pTranslations[i * 3 + k]);
+				hi = std::max(hi, pTranslations[i * 3 + k]);
+			}
+
+			// a constant axis still needs a scale that can be inverted
+			const float scale = (hi > lo) ? hi - lo : 1.0f;
+
+			m_TranslationScales[k].push_back(scale);
+			m_TranslationBiases[k].push_back(lo);
+
+			for (size_t i = 0; i < keyCount; i++)
+			{
+				const float value = pTranslations[i * 3 + k];
+
+				if (m_Quantized)
+				{
+					m_QuantizedTranslations[k].push_back(static_cast<uint16_t>(std::lround((value - lo) / scale * 65535.0f)));
+				}
+				else
+				{
+					m_Translations[k].push_back(value);
+				}
+			}
+		}
+
+		// the cache grows a whole chunk at a time so that Evaluate always runs full chunks, the padding is zero
+		const size_t track = m_FirstKeys.size() - 1;
+
+		if (track >= m_Segments[0].size())
+		{
+			for (unsigned int c = 0; c < SEGMENT_COMPONENTS; c++)
+			{
+				m_Segments[c].resize(track + CHUNK_SIZE, 0.0f);
+			}
+		}
+
+		// an empty range, the first evaluation loads the segment
+		m_Segments[SEGMENT_BEGIN][track] = FLT_MAX;
+		m_Segments[SEGMENT_END][track] = -FLT_MAX;
+	}
+
+	return status;
+}
+
+// the next evaluation of every track searches its keys from scratch
+VOID AnimationTracks::ResetCursors()
+{
+	std::fill(m_Cursors.begin(), m_Cursors.end(), 0);
+	std::fill(m_Segments[SEGMENT_BEGIN].begin(), m_Segments[SEGMENT_BEGIN].end(), FLT_MAX);
+	std::fill(m_Segments[SEGMENT_END].begin(), m_Segments[SEGMENT_END].end(), -FLT_MAX);
+}
+
+size_t AnimationTracks::GetTrackCount()
+{
+	return m_FirstKeys.size();
+}
+
+size_t AnimationTracks::GetKeyCount()
+{
+	return m_Times.size();
+}
+
+// the bytes of one key: its time, rotation and translation
+size_t AnimationTracks::GetKeySize()
+{
+	return m_Quantized ? sizeof(float) + 4 * sizeof(int16_t) + 3 * sizeof(uint16_t) : sizeof(float) * 8;
+}
+
+// the bytes of the cursor and the cached segment of one track
+size_t AnimationTracks::GetSegmentSize()
+{
+	return sizeof(uint32_t) + sizeof(float) * SEGMENT_COMPONENTS;
+}
+
+// the key before time, the cursor is only searched from when it is at most one key behind
+uint32_t AnimationTracks::Seek(size_t track, float time)
+{
+	const float* times = &m_Times[m_FirstKeys[track]];
+	const uint32_t last = (m_KeyCounts[track] > 1) ? m_KeyCounts[track] - 2 : 0; // the first key of the last pair
+	uint32_t key = m_Cursors[track];
+
+	if ((key < last) && (time >= times[key + 1]))
+	{
+		key++;
+	}
+
+	if (((key < last) && (time >= times[key + 1])) || ((key > 0) && (time < times[key])))
+	{
+		key = static_cast<uint32_t>(std::upper_bound(times + 1, times + last + 1, time) - times) - 1;
+	}
+
+	m_Cursors[track] = key;
+
+	return key;
+}
+
+VOID AnimationTracks::LoadKey(size_t track, uint32_t key, float* rotation, float* translation)
+{
+	const size_t index = m_FirstKeys[track] + key;
+
+	if (m_Quantized)
+	{
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			rotation[k] = m_QuantizedRotations[k][index] * (1.0f / 32767.0f);
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			translation[k] = m_TranslationBiases[k][track] + m_TranslationScales[k][track] * (m_QuantizedTranslations[k][index] * (1.0f / 65535.0f));
+		}
+	}
+	else
+	{
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			rotation[k] = m_Rotations[k][index];
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			translation[k] = m_Translations[k][index];
+		}
+	}
+}
+
+// moves the cursor of the track to time and caches the pair of keys around it
+VOID AnimationTracks::LoadSegment(size_t track, float time)
+{
+	const uint32_t key = Seek(track, time);
+	const uint32_t next = std::min(key + 1, m_KeyCounts[track] - 1);
+	const uint32_t last = (m_KeyCounts[track] > 1) ? m_KeyCounts[track] - 2 : 0;
+
+	float rotation[2][4];
+	float translation[2][3];
+	LoadKey(track, key, rotation[0], translation[0]);
+	LoadKey(track, next, rotation[1], translation[1]);
+
+	float d = rotation[0][0] * rotation[1][0] + rotation[0][1] * rotation[1][1] + rotation[0][2] * rotation[1][2] + rotation[0][3] * rotation[1][3];
+	const float sign = (d < 0.0f) ? -1.0f : 1.0f;
+
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		m_Segments[SEGMENT_ROTATION0 + k][track] = rotation[0][k];
+		m_Segments[SEGMENT_ROTATION1 + k][track] = rotation[1][k] * sign;
+	}
+
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		m_Segments[SEGMENT_TRANSLATION0 + k][track] = translation[0][k];
+		m_Segments[SEGMENT_TRANSLATION1 + k][track] = translation[1][k];
+	}
+
+	const float t0 = m_Times[m_FirstKeys[track] + key];
+	const float t1 = m_Times[m_FirstKeys[track] + next];
+
+	m_Segments[SEGMENT_TIME][track] = t0;
+	m_Segments[SEGMENT_RATE][track] = (t1 > t0) ? 1.0f / (t1 - t0) : 0.0f;
+	m_Segments[SEGMENT_DOT][track] = std::min(d * sign, 1.0f);
+	m_Segments[SEGMENT_BEGIN][track] = (key > 0) ? t0 : -FLT_MAX;
+	m_Segments[SEGMENT_END][track] = (key < last) ? t1 : FLT_MAX;
+}
+
+/*
+* samples the tracks [begin, end) at time. the rotations go to the batch pRotations and the translations to the batch
+* pTranslations, both of all tracks in the Quaternion batch layout, the fourth component of a translation is 0. begin
+* has to be a multiple of Matrix::BATCH_WIDTH, ranges on different threads then never share a cursor or a batch block.
+*
+* the slerp weights are the polynomial approximation of eberly, "a fast and accurate algorithm for computing slerp",
+* which needs no trigonometry or division and has no branches. it holds for keys up to 90 degrees apart on the sphere
+* of quaternions, which the shorter arc always is.
+*/
+VOID AnimationTracks::Evaluate(float time, Interpolation interpolation, size_t begin, size_t end, float* pRotations, float* pTranslations)
+{
+	const float MU = 1.90110745351730037f;
+	const float U[8] = { 1.0f / (1 * 3), 1.0f / (2 * 5), 1.0f / (3 * 7), 1.0f / (4 * 9), 1.0f / (5 * 11), 1.0f / (6 * 13), 1.0f / (7 * 15), MU / (8 * 17) };
+	const float V[8] = { 1.0f / 3, 2.0f / 5, 3.0f / 7, 4.0f / 9, 5.0f / 11, 6.0f / 13, 7.0f / 15, MU * 8 / 17 };
+
+	// nlerp is the same sum with the corrections switched off
+	const float enable = (interpolation == INTERPOLATION_SLERP) ? 1.0f : 0.0f;
+
+	float interpolants[2][CHUNK_SIZE]; // 1 - t and t
+	float deviations[CHUNK_SIZE];      // dot - 1
+	float weights[2][CHUNK_SIZE];
+	float lengths[CHUNK_SIZE];
+	float rotations[4][CHUNK_SIZE];
+	float translations[3][CHUNK_SIZE];
+
+	for (size_t base = begin; base < end; base += CHUNK_SIZE)
+	{
+		const size_t count = std::min<size_t>(CHUNK_SIZE, end - base);
+
+		// only tracks that left their segment go back to their keys
+		for (size_t i = 0; i < count; i++)
+		{
+			if ((time < m_Segments[SEGMENT_BEGIN][base + i]) || (time >= m_Segments[SEGMENT_END][base + i]))
+			{
+				LoadSegment(base + i, time);
+			}
+		}
+
+		const float* segments[SEGMENT_COMPONENTS];
+		for (unsigned int c = 0; c < SEGMENT_COMPONENTS; c++)
+		{
+			segments[c] = &m_Segments[c][base];
+		}
+
+		/*
+		* every pass runs over the whole chunk without branches so that it vectorizes, the component loops stay outside.
+		* lanes past the last track compute on the zero padding and are not stored
+		*/
+		for (size_t i = 0; i < CHUNK_SIZE; i++)
+		{
+			const float t = (time - segments[SEGMENT_TIME][i]) * segments[SEGMENT_RATE][i];
+			interpolants[1][i] = (t < 1.0f) ? ((t > 0.0f) ? t : 0.0f) : 1.0f;
+			interpolants[0][i] = 1.0f - interpolants[1][i];
+
+			// (1 - dot) shrinks the corrections to nothing for keys that are close
+			deviations[i] = (segments[SEGMENT_DOT][i] - 1.0f) * enable;
+			weights[0][i] = 1.0f;
+			weights[1][i] = 1.0f;
+		}
+
+		for (int c = 7; c >= 0; c--)
+		{
+			for (unsigned int w = 0; w < 2; w++)
+			{
+				for (size_t i = 0; i < CHUNK_SIZE; i++)
+				{
+					weights[w][i] = 1.0f + weights[w][i] * (U[c] * interpolants[w][i] * interpolants[w][i] - V[c]) * deviations[i];
+				}
+			}
+		}
+
+		for (unsigned int w = 0; w < 2; w++)
+		{
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+			{
+				weights[w][i] *= interpolants[w][i];
+			}
+		}
+
+		for (size_t i = 0; i < CHUNK_SIZE; i++)
+		{
+			lengths[i] = 0.0f;
+		}
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+			{
+				rotations[k][i] = segments[SEGMENT_ROTATION0 + k][i] * weights[0][i] + segments[SEGMENT_ROTATION1 + k][i] * weights[1][i];
+				lengths[i] += rotations[k][i] * rotations[k][i];
+			}
+		}
+
+		/*
+		* 1 / sqrt of the squared lengths by newton steps from the tangent at 1, like Quaternion::Normalize. slerp of unit
+		* keys stays within rounding of unit, but nlerp shortens the quaternions down to a squared length of 1/2 where
+		* the tangent is 12% off, and three more steps take that below 1e-6
+		*/
+		for (size_t i = 0; i < CHUNK_SIZE; i++)
+		{
+			const float s = lengths[i];
+			float f = 0.5f * (3.0f - s);
+
+			for (unsigned int step = 0; step < 3; step++)
+			{
+				f *= 1.5f - 0.5f * s * f * f;
+			}
+
+			lengths[i] = f;
+		}
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+			{
+				rotations[k][i] *= lengths[i];
+			}
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			for (size_t i = 0; i < CHUNK_SIZE; i++)
+			{
+				translations[k][i] = segments[SEGMENT_TRANSLATION0 + k][i] * interpolants[0][i] + segments[SEGMENT_TRANSLATION1 + k][i] * interpolants[1][i];
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const size_t index = base + i;
+			float* rotation = pRotations + (index / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + (index % Matrix::BATCH_WIDTH);
+			float* translation = pTranslations + (index / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + (index % Matrix::BATCH_WIDTH);
+
+			for (unsigned int k = 0; k < 4; k++)
+			{
+				rotation[k * Matrix::BATCH_WIDTH] = rotations[k][i];
+			}
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				translation[k * Matrix::BATCH_WIDTH] = translations[k][i];
+			}
+
+			translation[3 * Matrix::BATCH_WIDTH] = 0.0f;
+		}
+	}
+}
+
+// the exact slerp along the shorter arc, the reference for Evaluate
+VOID AnimationTracks::Slerp(const float* q0, const float* q1, float t, float* q)
+{
+	double d = 0.0;
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		d += static_cast<double>(q0[k]) * q1[k];
+	}
+
+	const double sign = (d < 0.0) ? -1.0 : 1.0;
+	const double angle = std::acos(std::min(d * sign, 1.0));
+	const double w0 = (angle > 1e-9) ? std::sin((1.0 - t) * angle) / std::sin(angle) : 1.0 - t;
+	const double w1 = (angle > 1e-9) ? std::sin(t * angle) / std::sin(angle) : t;
+
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		q[k] = static_cast<float>(q0[k] * w0 + q1[k] * w1 * sign);
+	}
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Common.h"
+
+/*
+* keyframed rotation and translation tracks, one per object. the keys of all tracks share one structure of arrays,
+* each component of the keys in an array of its own, and a track is a range of them. keys may be stored quantized:
+* rotations as 16 bit snorm components, translations as 16 bit unorm steps across the range of their track. the key
+* times are always floats, they are what playback searches.
+*
+* every track keeps a cursor: the pair of keys it was last sampled between, decoded into a segment cache that is a
+* structure of arrays over the tracks. Evaluate only goes back to the keys of a track when the time leaves its segment,
+* which sequential playback does once per key, and finds the new pair in O(1) when it is the next one or by a binary
+* search after a seek. everything else is a pass over the segment cache in lanes without branches. time is clamped
+* to the keys of each track.
+*/
+class AnimationTracks
+{
+public:
+	enum Interpolation {
+		INTERPOLATION_NLERP, // normalized lerp, up to about 0.14 radians off the slerp between keys 180 degrees apart
+		INTERPOLATION_SLERP  // constant angular speed, within about 2e-5 radians of the exact slerp
+	};
+
+	enum {
+		CHUNK_SIZE = 64 // tracks evaluated together, a multiple of Matrix::BATCH_WIDTH
+	};
+
+private:
+	// the components of a cached segment, the second rotation is on the shorter arc from the first
+	enum {
+		SEGMENT_ROTATION0    = 0,
+		SEGMENT_ROTATION1    = 4,
+		SEGMENT_TRANSLATION0 = 8,
+		SEGMENT_TRANSLATION1 = 11,
+		SEGMENT_TIME         = 14, // of the first key
+		SEGMENT_RATE         = 15, // 1 / the time between the keys, 0 for a track of one key
+		SEGMENT_DOT          = 16, // of the rotations, in [0, 1]
+		SEGMENT_BEGIN        = 17, // the times the segment is used for, infinite before the first and after the last key
+		SEGMENT_END          = 18,
+		SEGMENT_COMPONENTS   = 19
+	};
+
+	bool                  m_Quantized;
+
+	// per track
+	std::vector<uint32_t> m_FirstKeys;
+	std::vector<uint32_t> m_KeyCounts;
+	std::vector<uint32_t> m_Cursors;                      // the first key of the cached segment
+	std::vector<float>    m_TranslationScales[3];         // quantized translation = bias + scale * steps / 65535
+	std::vector<float>    m_TranslationBiases[3];
+	std::vector<float>    m_Segments[SEGMENT_COMPONENTS]; // padded to a multiple of CHUNK_SIZE tracks
+
+	// per key
+	std::vector<float>    m_Times;
+	std::vector<float>    m_Rotations[4];
+	std::vector<float>    m_Translations[3];
+	std::vector<int16_t>  m_QuantizedRotations[4];
+	std::vector<uint16_t> m_QuantizedTranslations[3];
+
+public:
+	AnimationTracks();
+
+	VOID Initialize(bool quantized);
+	INT  AddTrack(const float* pTimes, const float* pRotations, const float* pTranslations, size_t keyCount);
+
+	VOID Evaluate(float time, Interpolation interpolation, size_t begin, size_t end, float* pRotations, float* pTranslations);
+	VOID ResetCursors();
+
+	size_t GetTrackCount();
+	size_t GetKeyCount();
+	size_t GetKeySize();
+	size_t GetSegmentSize();
+
+	static VOID Slerp(const float* q0, const float* q1, float t, float* q);
+
+private:
+	uint32_t Seek(size_t track, float time);
+	VOID     LoadKey(size_t track, uint32_t key, float* rotation, float* translation);
+	VOID     LoadSegment(size_t track, float time);
+};
@@ -0,0 +1,668 @@
+#include "Bvh.h"
+#include "Log.h"
+#include "Culling.h"
+#include "JobSystem.h"
+
+Bvh::Bvh()
+{
+	m_pJobs = NULL;
+	m_pTransforms = NULL;
+	ZeroMemory(&m_Bounds, sizeof(m_Bounds));
+	m_Count = 0;
+	m_ChunkCount = 0;
+	m_RadixShift = 0;
+	ZeroMemory(&m_Centers, sizeof(m_Centers));
+}
+
+// the box of the mesh bounds under a transform in the layout of the INSTANCE stream
+VOID Bvh::ComputeBounds(const float* transform, const Culling::Bounds& bounds, Aabb& aabb)
+{
+	float center[3];
+	float extent[3];
+
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		center[k] = 0.5f * (bounds.aabb_min[k] + bounds.aabb_max[k]);
+		extent[k] = 0.5f * (bounds.aabb_max[k] - bounds.aabb_min[k]);
+	}
+
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		const float* row = &transform[r * 4];
+
+		const float c = row[0] * center[0] + row[1] * center[1] + row[2] * center[2] + row[3];
+		const float e = fabsf(row[0]) * extent[0] + fabsf(row[1]) * extent[1] + fabsf(row[2]) * extent[2];
+
+		aabb.min[r] = c - e;
+		aabb.max[r] = c + e;
+	}
+}
+
+/*
+* -1 if the box is outside of a plane, 1 if it is inside of all of them and 0 otherwise. only the corners nearest
+* to and farthest from each plane are tested, which also makes a box inside of a node's box never classify worse.
+*/
+int Bvh::Classify(const Culling::Frustum& frustum, const Aabb& aabb)
+{
+	int result = 1;
+
+	for (unsigned int p = 0; p < Culling::PLANE_COUNT; p++)
+	{
+		const float* plane = frustum.planes[p];
+
+		const float far_x  = (plane[0] >= 0.0f) ? aabb.max[0] : aabb.min[0];
+		const float far_y  = (plane[1] >= 0.0f) ? aabb.max[1] : aabb.min[1];
+		const float far_z  = (plane[2] >= 0.0f) ? aabb.max[2] : aabb.min[2];
+		const float near_x = (plane[0] >= 0.0f) ? aabb.min[0] : aabb.max[0];
+		const float near_y = (plane[1] >= 0.0f) ? aabb.min[1] : aabb.max[1];
+		const float near_z = (plane[2] >= 0.0f) ? aabb.min[2] : aabb.max[2];
+
+		if (plane[0] * far_x + plane[1] * far_y + plane[2] * far_z + plane[3] < 0.0f)
+		{
+			return -1;
+		}
+
+		if (plane[0] * near_x + plane[1] * near_y + plane[2] * near_z + plane[3] < 0.0f)
+		{
+			result = 0;
+		}
+	}
+
+	return result;
+}
+
+// the slab test, the distance is where the ray enters the box or 0 if it starts inside of it
+bool Bvh::IntersectAabb(const Aabb& aabb, const float* origin, const float* inverse_direction, float limit, float* pDistance)
+{
+	float t_near = 0.0f;
+	float t_far = limit;
+
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		float t_0 = (aabb.min[k] - origin[k]) * inverse_direction[k];
+		float t_1 = (aabb.max[k] - origin[k]) * inverse_direction[k];
+
+		if (t_0 > t_1)
+		{
+			std::swap(t_0, t_1);
+		}
+
+		// written so that a nan from 0 * inf leaves the interval alone
+		t_near = (t_0 > t_near) ? t_0 : t_near;
+		t_far  = (t_1 < t_far)  ? t_1 : t_far;
+	}
+
+	*pDistance = t_near;
+
+	return t_near <= t_far;
+}
+
+// the ray against the mesh box in the space of the instance, the distance is in units of direction
+bool Bvh::IntersectInstance(const float* transform, const Culling::Bounds& bounds, const float* origin, const float* direction, float* pDistance)
+{
+	const float* m = transform;
+
+	// the inverse of the upper 3x3 from its cofactors
+	const float c_00 = m[5] * m[10] - m[6] * m[9];
+	const float c_01 = m[6] * m[8]  - m[4] * m[10];
+	const float c_02 = m[4] * m[9]  - m[5] * m[8];
+	const float determinant = m[0] * c_00 + m[1] * c_01 + m[2] * c_02;
+
+	if (determinant == 0.0f)
+	{
+		return false;
+	}
+
+	const float s = 1.0f / determinant;
+	const float inverse[9] =
+	{
+		c_00 * s, (m[2] * m[9] - m[1] * m[10]) * s, (m[1] * m[6] - m[2] * m[5]) * s,
+		c_01 * s, (m[0] * m[10] - m[2] * m[8]) * s, (m[2] * m[4] - m[0] * m[6]) * s,
+		c_02 * s, (m[1] * m[8] - m[0] * m[9]) * s,  (m[0] * m[5] - m[1] * m[4]) * s
+	};
+
+	const float offset[3] = { origin[0] - m[3], origin[1] - m[7], origin[2] - m[11] };
+
+	float local_origin[3];
+	float inverse_direction[3];
+
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		const float* row = &inverse[r * 3];
+
+		local_origin[r] = row[0] * offset[0] + row[1] * offset[1] + row[2] * offset[2];
+		inverse_direction[r] = 1.0f / (row[0] * direction[0] + row[1] * direction[1] + row[2] * direction[2]);
+	}
+
+	Aabb aabb;
+	CopyMemory(aabb.min, bounds.aabb_min, sizeof(aabb.min));
+	CopyMemory(aabb.max, bounds.aabb_max, sizeof(aabb.max));
+
+	return IntersectAabb(aabb, local_origin, inverse_direction, FLT_MAX, pDistance);
+}
+
+// spreads the low 10 bits of x to every third bit
+uint32_t Bvh::ExpandBits(uint32_t x)
+{
+	x = (x * 0x00010001u) & 0xFF0000FFu;
+	x = (x * 0x00000101u) & 0x0F00F00Fu;
+	x = (x * 0x00000011u) & 0xC30C30C3u;
+	x = (x * 0x00000005u) & 0x49249249u;
+
+	return x;
+}
+
+int Bvh::CountLeadingZeros(uint32_t x)
+{
+#if defined(_MSC_VER)
+	unsigned long index;
+
+	return _BitScanReverse(&index, x) ? 31 - static_cast<int>(index) : 32;
+#else
+	return (x != 0) ? __builtin_clz(x) : 32;
+#endif
+}
+
+// the length of the common prefix of the sorted keys i and j, equal codes are told apart by their position
+int Bvh::GetPrefix(size_t i, int64_t j)
+{
+	if ((j < 0) || (j >= static_cast<int64_t>(m_Count)))
+	{
+		return -1;
+	}
+
+	const uint32_t code_i = m_Codes[0][i];
+	const uint32_t code_j = m_Codes[0][static_cast<size_t>(j)];
+
+	if (code_i != code_j)
+	{
+		return CountLeadingZeros(code_i ^ code_j);
+	}
+
+	return 32 + CountLeadingZeros(static_cast<uint32_t>(i ^ static_cast<size_t>(j)));
+}
+
+INT Bvh::Build(const float* pTransforms, size_t count, const Culling::Bounds& bounds, JobSystem& jobs)
+{
+	INT status = STATUS_SUCCESS;
+
+	if (count >= LEAF)
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: a bvh holds at most 0x%X instances\n", status, LEAF - 1);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_pJobs = &jobs;
+		m_pTransforms = pTransforms;
+		m_Bounds = bounds;
+		m_Count = count;
+		m_ChunkCount = (count + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+		m_Nodes.resize(std::max<size_t>(count, 1) - 1);
+		m_LeafBounds.resize(count);
+		m_Slots.resize(count);
+		m_Parents.resize(m_Nodes.size() + count);
+		m_Visits.reset(new std::atomic<uint32_t>[m_Nodes.size() + 1]);
+
+		for (size_t i = 0; i < m_Nodes.size(); i++)
+		{
+			m_Visits[i].store(0, std::memory_order_relaxed);
+		}
+
+		for (unsigned int b = 0; b < 2; b++)
+		{
+			m_Codes[b].resize(count);
+			m_Indices[b].resize(count);
+		}
+
+		m_ChunkCenters.resize(m_ChunkCount);
+		m_Histograms.resize(m_ChunkCount * RADIX_SIZE);
+
+		// the codes are relative to the bounds of the box centers
+		jobs.ParallelFor("BvhCenters", CentersJob, this, m_ChunkCount, 1);
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			m_Centers.min[k] = FLT_MAX;
+			m_Centers.max[k] = -FLT_MAX;
+		}
+
+		for (size_t c = 0; c < m_ChunkCount; c++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				m_Centers.min[k] = std::min(m_Centers.min[k], m_ChunkCenters[c].min[k]);
+				m_Centers.max[k] = std::max(m_Centers.max[k], m_ChunkCenters[c].max[k]);
+			}
+		}
+
+		jobs.ParallelFor("BvhCodes", CodesJob, this, m_ChunkCount, 1);
+
+		// a stable lsd radix sort of the codes, a histogram per chunk lets every chunk scatter on its own
+		for (m_RadixShift = 0; m_RadixShift < MORTON_BITS; m_RadixShift += RADIX_BITS)
+		{
+			jobs.ParallelFor("BvhHistogram", HistogramJob, this, m_ChunkCount, 1);
+
+			size_t offset = 0;
+
+			for (size_t digit = 0; digit < RADIX_SIZE; digit++)
+			{
+				for (size_t c = 0; c < m_ChunkCount; c++)
+				{
+					const size_t histogram = m_Histograms[c * RADIX_SIZE + digit];
+
+					m_Histograms[c * RADIX_SIZE + digit] = offset;
+					offset += histogram;
+				}
+			}
+
+			jobs.ParallelFor("BvhScatter", ScatterJob, this, m_ChunkCount, 1);
+
+			std::swap(m_Codes[0], m_Codes[1]);
+			std::swap(m_Indices[0], m_Indices[1]);
+		}
+
+		m_Leaves.swap(m_Indices[0]);
+		m_Indices[0].resize(count);
+
+		jobs.ParallelFor("BvhNodes", NodesJob, this, m_Nodes.size(), NODE_GRAIN);
+		jobs.ParallelFor("BvhSlots", SlotsJob, this, count, NODE_GRAIN);
+
+		if (!m_Nodes.empty())
+		{
+			m_Parents[0] = INVALID;
+		}
+
+		Refit(pTransforms);
+	}
+
+	return status;
+}
+
+VOID Bvh::Refit(const float* pTransforms)
+{
+	m_pTransforms = pTransforms;
+
+	// the leaves are bounded in the order of the transforms, the tree is then merged in the order of the leaves
+	JobSystem::Job* pLeaves = m_pJobs->CreateParallelFor("BvhLeaves", LeavesJob, this, m_Count, NODE_GRAIN);
+	JobSystem::Job* pMerge = m_pJobs->CreateParallelFor("BvhMerge", MergeJob, this, m_Nodes.empty() ? 0 : m_Count, NODE_GRAIN);
+	m_pJobs->AddDependency(pLeaves, pMerge);
+
+	m_pJobs->Submit(pLeaves);
+	m_pJobs->Submit(pMerge);
+	m_pJobs->Wait(pMerge);
+}
+
+// the second child to finish merges the boxes of both and walks on up, the first one stops
+VOID Bvh::Merge(uint32_t node)
+{
+	while (node != INVALID)
+	{
+		if (m_Visits[node].fetch_add(1, std::memory_order_acq_rel) == 0)
+		{
+			break;
+		}
+
+		m_Visits[node].store(0, std::memory_order_relaxed);
+
+		Node& n = m_Nodes[node];
+		const Aabb& left  = (n.left & LEAF)  ? m_LeafBounds[n.left & ~LEAF]   : m_Nodes[n.left].bounds;
+		const Aabb& right = (n.right & LEAF) ? m_LeafBounds[n.right & ~LEAF] : m_Nodes[n.right].bounds;
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			n.bounds.min[k] = std::min(left.min[k], right.min[k]);
+			n.bounds.max[k] = std::max(left.max[k], right.max[k]);
+		}
+
+		node = m_Parents[node];
+	}
+}
+
+VOID Bvh::CentersJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t c = begin; c < end; c++)
+	{
+		Aabb& centers = pBvh->m_ChunkCenters[c];
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			centers.min[k] = FLT_MAX;
+			centers.max[k] = -FLT_MAX;
+		}
+
+		const size_t last = std::min((c + 1) * CHUNK_SIZE, pBvh->m_Count);
+
+		for (size_t i = c * CHUNK_SIZE; i < last; i++)
+		{
+			Aabb aabb;
+			ComputeBounds(&pBvh->m_pTransforms[i * Data::INSTANCE_SIZE], pBvh->m_Bounds, aabb);
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				const float center = 0.5f * (aabb.min[k] + aabb.max[k]);
+
+				centers.min[k] = std::min(centers.min[k], center);
+				centers.max[k] = std::max(centers.max[k], center);
+			}
+		}
+	}
+}
+
+VOID Bvh::CodesJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	float scale[3];
+
+	for (unsigned int k = 0; k < 3; k++)
+	{
+		const float size = pBvh->m_Centers.max[k] - pBvh->m_Centers.min[k];
+		scale[k] = (size > 0.0f) ? 1023.0f / size : 0.0f;
+	}
+
+	for (size_t c = begin; c < end; c++)
+	{
+		const size_t last = std::min((c + 1) * CHUNK_SIZE, pBvh->m_Count);
+
+		for (size_t i = c * CHUNK_SIZE; i < last; i++)
+		{
+			Aabb aabb;
+			ComputeBounds(&pBvh->m_pTransforms[i * Data::INSTANCE_SIZE], pBvh->m_Bounds, aabb);
+
+			uint32_t code = 0;
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				const float center = 0.5f * (aabb.min[k] + aabb.max[k]);
+				const float cell = std::min(std::max((center - pBvh->m_Centers.min[k]) * scale[k], 0.0f), 1023.0f);
+
+				code |= ExpandBits(static_cast<uint32_t>(cell)) << (2 - k);
+			}
+
+			pBvh->m_Codes[0][i] = code;
+			pBvh->m_Indices[0][i] = static_cast<uint32_t>(i);
+		}
+	}
+}
+
+VOID Bvh::HistogramJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t c = begin; c < end; c++)
+	{
+		size_t* histogram = &pBvh->m_Histograms[c * RADIX_SIZE];
+		std::fill(histogram, histogram + RADIX_SIZE, 0);
+
+		const size_t last = std::min((c + 1) * CHUNK_SIZE, pBvh->m_Count);
+
+		for (size_t i = c * CHUNK_SIZE; i < last; i++)
+		{
+			histogram[(pBvh->m_Codes[0][i] >> pBvh->m_RadixShift) & (RADIX_SIZE - 1)]++;
+		}
+	}
+}
+
+VOID Bvh::ScatterJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t c = begin; c < end; c++)
+	{
+		size_t* offsets = &pBvh->m_Histograms[c * RADIX_SIZE];
+
+		const size_t last = std::min((c + 1) * CHUNK_SIZE, pBvh->m_Count);
+
+		for (size_t i = c * CHUNK_SIZE; i < last; i++)
+		{
+			const uint32_t code = pBvh->m_Codes[0][i];
+			const size_t destination = offsets[(code >> pBvh->m_RadixShift) & (RADIX_SIZE - 1)]++;
+
+			pBvh->m_Codes[1][destination] = code;
+			pBvh->m_Indices[1][destination] = pBvh->m_Indices[0][i];
+		}
+	}
+}
+
+// finds the range of sorted leaves below internal node i and where it splits, independently of every other node
+VOID Bvh::NodesJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const int64_t direction = (pBvh->GetPrefix(i, i + 1) > pBvh->GetPrefix(i, static_cast<int64_t>(i) - 1)) ? 1 : -1;
+		const int prefix_min = pBvh->GetPrefix(i, static_cast<int64_t>(i) - direction);
+
+		// the other end of the range, first bounded by doubling and then found by a binary search
+		int64_t length_max = 2;
+		while (pBvh->GetPrefix(i, static_cast<int64_t>(i) + length_max * direction) > prefix_min)
+		{
+			length_max *= 2;
+		}
+
+		int64_t length = 0;
+		for (int64_t t = length_max / 2; t >= 1; t /= 2)
+		{
+			if (pBvh->GetPrefix(i, static_cast<int64_t>(i) + (length + t) * direction) > prefix_min)
+			{
+				length += t;
+			}
+		}
+
+		const int64_t j = static_cast<int64_t>(i) + length * direction;
+		const int prefix_node = pBvh->GetPrefix(i, j);
+
+		// the split is the last key that shares more than prefix_node bits with key i
+		int64_t split = 0;
+		int64_t t = length;
+		do
+		{
+			t = (t + 1) / 2;
+
+			if (pBvh->GetPrefix(i, static_cast<int64_t>(i) + (split + t) * direction) > prefix_node)
+			{
+				split += t;
+			}
+		}
+		while (t > 1);
+
+		const size_t gamma = static_cast<size_t>(static_cast<int64_t>(i) + split * direction + std::min<int64_t>(direction, 0));
+		const size_t first = static_cast<size_t>(std::min<int64_t>(i, j));
+		const size_t last = static_cast<size_t>(std::max<int64_t>(i, j));
+
+		Node& node = pBvh->m_Nodes[i];
+		node.first = static_cast<uint32_t>(first);
+		node.last = static_cast<uint32_t>(last);
+		node.left = (first == gamma) ? static_cast<uint32_t>(gamma) | LEAF : static_cast<uint32_t>(gamma);
+		node.right = (last == gamma + 1) ? static_cast<uint32_t>(gamma + 1) | LEAF : static_cast<uint32_t>(gamma + 1);
+
+		// the parents of the leaves follow those of the internal nodes
+		const size_t leaves = pBvh->m_Nodes.size();
+		pBvh->m_Parents[(node.left & LEAF) ? leaves + (node.left & ~LEAF) : node.left] = static_cast<uint32_t>(i);
+		pBvh->m_Parents[(node.right & LEAF) ? leaves + (node.right & ~LEAF) : node.right] = static_cast<uint32_t>(i);
+	}
+}
+
+VOID Bvh::SlotsJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		pBvh->m_Slots[pBvh->m_Leaves[i]] = static_cast<uint32_t>(i);
+	}
+}
+
+VOID Bvh::LeavesJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		ComputeBounds(&pBvh->m_pTransforms[i * Data::INSTANCE_SIZE], pBvh->m_Bounds, pBvh->m_LeafBounds[pBvh->m_Slots[i]]);
+	}
+}
+
+VOID Bvh::MergeJob(VOID* pData, size_t begin, size_t end)
+{
+	Bvh* pBvh = static_cast<Bvh*>(pData);
+
+	const size_t leaves = pBvh->m_Nodes.size();
+
+	for (size_t i = begin; i < end; i++)
+	{
+		pBvh->Merge(pBvh->m_Parents[leaves + i]);
+	}
+}
+
+// appends every instance below node
+VOID Bvh::Emit(uint32_t node, uint32_t* pVisible, size_t* pCount)
+{
+	const uint32_t first = (node & LEAF) ? (node & ~LEAF) : m_Nodes[node].first;
+	const uint32_t last  = (node & LEAF) ? (node & ~LEAF) : m_Nodes[node].last;
+
+	CopyMemory(&pVisible[*pCount], &m_Leaves[first], (last - first + 1) * sizeof(uint32_t));
+	*pCount += last - first + 1;
+}
+
+// writes the instances whose boxes are not outside of the frustum to pVisible, in tree order, and returns their count
+size_t Bvh::Query(const Culling::Frustum& frustum, uint32_t* pVisible)
+{
+	size_t count = 0;
+
+	if (m_Count == 0)
+	{
+		return count;
+	}
+
+	uint32_t stack[STACK_SIZE];
+	size_t depth = 0;
+
+	stack[depth++] = m_Nodes.empty() ? static_cast<uint32_t>(LEAF) : 0;
+
+	while (depth != 0)
+	{
+		const uint32_t node = stack[--depth];
+		const Aabb& aabb = (node & LEAF) ? m_LeafBounds[node & ~LEAF] : m_Nodes[node].bounds;
+		const int classification = Classify(frustum, aabb);
+
+		if (classification > 0)
+		{
+			Emit(node, pVisible, &count);
+		}
+		else if (classification == 0)
+		{
+			if (node & LEAF)
+			{
+				pVisible[count++] = m_Leaves[node & ~LEAF];
+			}
+			else
+			{
+				stack[depth++] = m_Nodes[node].right;
+				stack[depth++] = m_Nodes[node].left;
+			}
+		}
+	}
+
+	return count;
+}
+
+// the nearest instance hit by the ray, or INVALID. pDistance is in units of direction
+uint32_t Bvh::Pick(const float* origin, const float* direction, float* pDistance)
+{
+	uint32_t result = INVALID;
+	float nearest = FLT_MAX;
+
+	if (m_Count == 0)
+	{
+		return result;
+	}
+
+	const float inverse_direction[3] = { 1.0f / direction[0], 1.0f / direction[1], 1.0f / direction[2] };
+
+	uint32_t stack[STACK_SIZE];
+	size_t depth = 0;
+
+	stack[depth++] = m_Nodes.empty() ? static_cast<uint32_t>(LEAF) : 0;
+
+	while (depth != 0)
+	{
+		const uint32_t node = stack[--depth];
+		float distance;
+
+		if (node & LEAF)
+		{
+			const uint32_t instance = m_Leaves[node & ~LEAF];
+
+			if (IntersectAabb(m_LeafBounds[node & ~LEAF], origin, inverse_direction, nearest, &distance) &&
+				IntersectInstance(&m_pTransforms[instance * Data::INSTANCE_SIZE], m_Bounds, origin, direction, &distance) && (distance < nearest))
+			{
+				nearest = distance;
+				result = instance;
+			}
+		}
+		else if (IntersectAabb(m_Nodes[node].bounds, origin, inverse_direction, nearest, &distance))
+		{
+			// the nearer child goes on top so it is visited first and shrinks nearest for the other one
+			const uint32_t children[2] = { m_Nodes[node].left, m_Nodes[node].right };
+			float distances[2];
+
+			for (unsigned int c = 0; c < 2; c++)
+			{
+				const Aabb& aabb = (children[c] & LEAF) ? m_LeafBounds[children[c] & ~LEAF] : m_Nodes[children[c]].bounds;
+
+				if (!IntersectAabb(aabb, origin, inverse_direction, nearest, &distances[c]))
+				{
+					distances[c] = FLT_MAX;
+				}
+			}
+
+			const unsigned int near_child = (distances[0] <= distances[1]) ? 0 : 1;
+
+			if (distances[near_child ^ 1] != FLT_MAX)
+			{
+				stack[depth++] = children[near_child ^ 1];
+			}
+
+			if (distances[near_child] != FLT_MAX)
+			{
+				stack[depth++] = children[near_child];
+			}
+		}
+	}
+
+	*pDistance = nearest;
+
+	return result;
+}
+
+size_t Bvh::GetCount()
+{
+	return m_Count;
+}
+
+// the number of nodes on the longest path from the root to a leaf
+size_t Bvh::GetDepth()
+{
+	size_t depth = 0;
+
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		size_t length = 1;
+
+		for (uint32_t node = m_Nodes.empty() ? INVALID : m_Parents[m_Nodes.size() + i]; node != INVALID; node = m_Parents[node])
+		{
+			length++;
+		}
+
+		depth = std::max(depth, length);
+	}
+
+	return depth;
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include "Common.h"
+#include "Culling.h"
+#include "JobSystem.h"
+
+/*
+* a linear bounding volume hierarchy (karras, "maximizing parallelism in the construction of bvhs, octrees, and k-d
+* trees") over the world space boxes of instanced meshes. the instances are sorted along a morton curve through the
+* centers of their boxes, every internal node is then found from the sorted codes on its own, and the boxes are
+* merged bottom up. the stages run on the job system, only the prefix sums of the sort are serial.
+*
+* leaves hold one instance each. node i covers the sorted leaves [first, last], child indices with LEAF set refer to
+* a leaf. Refit keeps the tree and only recomputes the boxes, which stays tight while the instances only turn in place.
+* the transforms of the last Build or Refit are used by Pick and have to stay alive until the next one.
+*/
+class Bvh
+{
+public:
+	enum : uint32_t {
+		LEAF    = 0x80000000,
+		INVALID = 0xFFFFFFFF
+	};
+
+	struct Aabb
+	{
+		float min[3];
+		float max[3];
+	};
+
+	struct Node
+	{
+		Aabb     bounds;
+		uint32_t left;
+		uint32_t right;
+		uint32_t first;
+		uint32_t last;
+	};
+
+private:
+	enum {
+		CHUNK_SIZE  = 16384, // instances per chunk of the sort
+		RADIX_BITS  = 8,
+		RADIX_SIZE  = 1 << RADIX_BITS,
+		MORTON_BITS = 30,
+		NODE_GRAIN  = 4096,
+		STACK_SIZE  = 128    // deeper than the tree can get, 30 bits of morton code and 32 bits of index
+	};
+
+	JobSystem*                                 m_pJobs;
+	const float*                               m_pTransforms;
+	Culling::Bounds                            m_Bounds;
+	size_t                                     m_Count;
+	size_t                                     m_ChunkCount;
+	unsigned int                               m_RadixShift;
+
+	std::vector<Node>                          m_Nodes;
+	std::vector<Aabb>                          m_LeafBounds;
+	std::vector<uint32_t>                      m_Leaves;       // the instance of each sorted leaf
+	std::vector<uint32_t>                      m_Slots;        // and the sorted leaf of each instance
+	std::vector<uint32_t>                      m_Parents;      // of the internal nodes, then of the leaves
+	std::unique_ptr<std::atomic<uint32_t>[]>   m_Visits;       // children merged into each internal node so far
+
+	std::vector<uint32_t>                      m_Codes[2];
+	std::vector<uint32_t>                      m_Indices[2];
+	std::vector<Aabb>                          m_ChunkCenters; // the bounds of the box centers in each chunk
+	std::vector<size_t>                        m_Histograms;   // RADIX_SIZE counts per chunk
+	Aabb                                       m_Centers;
+
+public:
+	Bvh();
+
+	INT  Build(const float* pTransforms, size_t count, const Culling::Bounds& bounds, JobSystem& jobs);
+	VOID Refit(const float* pTransforms);
+
+	size_t   Query(const Culling::Frustum& frustum, uint32_t* pVisible);
+	uint32_t Pick(const float* origin, const float* direction, float* pDistance);
+
+	size_t GetCount();
+	size_t GetDepth();
+
+	static VOID ComputeBounds(const float* transform, const Culling::Bounds& bounds, Aabb& aabb);
+	static int  Classify(const Culling::Frustum& frustum, const Aabb& aabb);
+	static bool IntersectInstance(const float* transform, const Culling::Bounds& bounds, const float* origin, const float* direction, float* pDistance);
+
+private:
+	static bool     IntersectAabb(const Aabb& aabb, const float* origin, const float* inverse_direction, float limit, float* pDistance);
+	static uint32_t ExpandBits(uint32_t x);
+	static int      CountLeadingZeros(uint32_t x);
+	int             GetPrefix(size_t i, int64_t j);
+	VOID            Merge(uint32_t node);
+	VOID            Emit(uint32_t node, uint32_t* pVisible, size_t* pCount);
+
+	static VOID CentersJob(VOID* pData, size_t begin, size_t end);
+	static VOID CodesJob(VOID* pData, size_t begin, size_t end);
+	static VOID HistogramJob(VOID* pData, size_t begin, size_t end);
+	static VOID ScatterJob(VOID* pData, size_t begin, size_t end);
+	static VOID NodesJob(VOID* pData, size_t begin, size_t end);
+	static VOID SlotsJob(VOID* pData, size_t begin, size_t end);
+	static VOID LeavesJob(VOID* pData, size_t begin, size_t end);
+	static VOID MergeJob(VOID* pData, size_t begin, size_t end);
+};
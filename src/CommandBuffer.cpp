@@ -0,0 +1,766 @@
+#include "CommandBuffer.h"
+#include "Log.h"
+#include "Fnv.h"
+#include "RenderContext.h"
+
+CommandBuffer::CommandBuffer()
+{
+	m_Size = 0;
+	m_CommandCount = 0;
+}
+
+// keeps the memory, a buffer that records no more than before does not allocate
+VOID CommandBuffer::Clear()
+{
+	m_Size = 0;
+	m_CommandCount = 0;
+}
+
+VOID CommandBuffer::Append(const CommandBuffer& other)
+{
+	CopyMemory(Reserve(other.m_Size), other.m_Data.data(), other.m_Size);
+	m_CommandCount += other.m_CommandCount;
+}
+
+size_t CommandBuffer::GetSize() const
+{
+	return m_Size;
+}
+
+uint32_t CommandBuffer::GetCommandCount() const
+{
+	return m_CommandCount;
+}
+
+// appends size bytes to the stream and returns them, the memory at least doubles when it runs out
+BYTE* CommandBuffer::Reserve(size_t size)
+{
+	if (m_Size + size > m_Data.size())
+	{
+		m_Data.resize(std::max(m_Size + size, 2 * m_Data.size()));
+	}
+
+	BYTE* p = m_Data.data() + m_Size;
+	m_Size += size;
+
+	return p;
+}
+
+// room for a command of size bytes of arguments after its header, valid until the next command is recorded
+BYTE* CommandBuffer::Push(Type type, size_t size)
+{
+	const size_t total = (sizeof(Command) + size + 7) & ~static_cast<size_t>(7);
+
+	BYTE* pCommand = Reserve(total);
+	m_CommandCount++;
+	Command command = { type, static_cast<uint32_t>(total) };
+	CopyMemory(pCommand, &command, sizeof(Command));
+
+	return pCommand;
+}
+
+VOID CommandBuffer::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView)
+{
+	BYTE* pCommand = Push(COMMAND_RENDER_TARGETS, sizeof(RenderTargetsCommand) - sizeof(Command) + count * sizeof(uint64_t));
+
+	RenderTargetsCommand* pArguments = reinterpret_cast<RenderTargetsCommand*>(pCommand);
+	pArguments->count = count;
+	pArguments->padding = 0;
+	pArguments->depth_stencil_view = reinterpret_cast<uintptr_t>(pDepthStencilView);
+
+	uint64_t* pViews = reinterpret_cast<uint64_t*>(pArguments + 1);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		pViews[i] = reinterpret_cast<uintptr_t>(ppViews[i]);
+	}
+}
+
+VOID CommandBuffer::IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	BYTE* pCommand = Push(COMMAND_VERTEX_BUFFERS, sizeof(VertexBuffersCommand) - sizeof(Command) + count * (sizeof(uint64_t) + 2 * sizeof(uint32_t)));
+
+	VertexBuffersCommand* pArguments = reinterpret_cast<VertexBuffersCommand*>(pCommand);
+	pArguments->slot = slot;
+	pArguments->count = count;
+
+	uint64_t* pBuffers = reinterpret_cast<uint64_t*>(pArguments + 1);
+	uint32_t* pStrideArray = reinterpret_cast<uint32_t*>(pBuffers + count);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		pBuffers[i] = reinterpret_cast<uintptr_t>(ppBuffers[i]);
+		pStrideArray[i] = pStrides[i];
+		pStrideArray[count + i] = pOffsets[i];
+	}
+}
+
+VOID CommandBuffer::IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset)
+{
+	IndexBufferCommand* pArguments = reinterpret_cast<IndexBufferCommand*>(Push(COMMAND_INDEX_BUFFER, sizeof(IndexBufferCommand) - sizeof(Command)));
+	pArguments->buffer = reinterpret_cast<uintptr_t>(pBuffer);
+	pArguments->format = format;
+	pArguments->offset = offset;
+}
+
+VOID CommandBuffer::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	TopologyCommand* pArguments = reinterpret_cast<TopologyCommand*>(Push(COMMAND_TOPOLOGY, sizeof(TopologyCommand) - sizeof(Command)));
+	pArguments->topology = topology;
+	pArguments->padding = 0;
+}
+
+VOID CommandBuffer::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+	ObjectCommand* pArguments = reinterpret_cast<ObjectCommand*>(Push(COMMAND_INPUT_LAYOUT, sizeof(ObjectCommand) - sizeof(Command)));
+	pArguments->object = reinterpret_cast<uintptr_t>(pInputLayout);
+}
+
+VOID CommandBuffer::VSSetShader(ID3D11VertexShader* pShader)
+{
+	ObjectCommand* pArguments = reinterpret_cast<ObjectCommand*>(Push(COMMAND_VERTEX_SHADER, sizeof(ObjectCommand) - sizeof(Command)));
+	pArguments->object = reinterpret_cast<uintptr_t>(pShader);
+}
+
+VOID CommandBuffer::VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers)
+{
+	BYTE* pCommand = Push(COMMAND_CONSTANT_BUFFERS, sizeof(ConstantBuffersCommand) - sizeof(Command) + count * sizeof(uint64_t));
+
+	ConstantBuffersCommand* pArguments = reinterpret_cast<ConstantBuffersCommand*>(pCommand);
+	pArguments->slot = slot;
+	pArguments->count = count;
+
+	uint64_t* pBuffers = reinterpret_cast<uint64_t*>(pArguments + 1);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		pBuffers[i] = reinterpret_cast<uintptr_t>(ppBuffers[i]);
+	}
+}
+
+// a bind of whole buffers only is recorded as VSSetConstantBuffers
+VOID CommandBuffer::VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts)
+{
+	bool ranges = false;
+
+	for (UINT i = 0; (i < count) && (pConstantCounts != NULL); i++)
+	{
+		ranges = ranges || (pConstantCounts[i] != 0);
+	}
+
+	if (!ranges)
+	{
+		VSSetConstantBuffers(slot, count, ppBuffers);
+		return;
+	}
+
+	BYTE* pCommand = Push(COMMAND_CONSTANT_BUFFER_RANGES, sizeof(ConstantBufferRangesCommand) - sizeof(Command) + count * (sizeof(uint64_t) + 2 * sizeof(uint32_t)));
+
+	ConstantBufferRangesCommand* pArguments = reinterpret_cast<ConstantBufferRangesCommand*>(pCommand);
+	pArguments->slot = slot;
+	pArguments->count = count;
+
+	uint64_t* pBuffers = reinterpret_cast<uint64_t*>(pArguments + 1);
+	uint32_t* pRanges = reinterpret_cast<uint32_t*>(pBuffers + count);
+
+	for (UINT i = 0; i < count; i++)
+	{
+		pBuffers[i] = reinterpret_cast<uintptr_t>(ppBuffers[i]);
+		pRanges[i] = (pConstantCounts[i] != 0) ? pFirstConstants[i] : 0;
+		pRanges[count + i] = pConstantCounts[i];
+	}
+}
+
+VOID CommandBuffer::PSSetShader(ID3D11PixelShader* pShader)
+{
+	ObjectCommand* pArguments = reinterpret_cast<ObjectCommand*>(Push(COMMAND_PIXEL_SHADER, sizeof(ObjectCommand) - sizeof(Command)));
+	pArguments->object = reinterpret_cast<uintptr_t>(pShader);
+}
+
+INT CommandBuffer::UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size)
+{
+	CopyMemory(UpdateBuffer(pBuffer, size), pData, size);
+
+	return STATUS_SUCCESS;
+}
+
+// records an update of size bytes and returns where its data goes, which is valid until the next command is recorded
+VOID* CommandBuffer::UpdateBuffer(ID3D11Buffer* pBuffer, size_t size)
+{
+	UpdateBufferCommand* pArguments = reinterpret_cast<UpdateBufferCommand*>(Push(COMMAND_UPDATE_BUFFER, sizeof(UpdateBufferCommand) - sizeof(Command) + size));
+	pArguments->buffer = reinterpret_cast<uintptr_t>(pBuffer);
+	pArguments->size = size;
+
+	return pArguments + 1;
+}
+
+VOID CommandBuffer::ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4])
+{
+	ClearRenderTargetCommand* pArguments = reinterpret_cast<ClearRenderTargetCommand*>(Push(COMMAND_CLEAR_RENDER_TARGET, sizeof(ClearRenderTargetCommand) - sizeof(Command)));
+	pArguments->view = reinterpret_cast<uintptr_t>(pView);
+	CopyMemory(pArguments->color, color, sizeof(pArguments->color));
+}
+
+VOID CommandBuffer::ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil)
+{
+	ClearDepthStencilCommand* pArguments = reinterpret_cast<ClearDepthStencilCommand*>(Push(COMMAND_CLEAR_DEPTH_STENCIL, sizeof(ClearDepthStencilCommand) - sizeof(Command)));
+	pArguments->view = reinterpret_cast<uintptr_t>(pView);
+	pArguments->flags = flags;
+	pArguments->depth = depth;
+	pArguments->stencil = stencil;
+	pArguments->padding = 0;
+}
+
+VOID CommandBuffer::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	DrawCommand* pArguments = reinterpret_cast<DrawCommand*>(Push(COMMAND_DRAW_INDEXED_INSTANCED, sizeof(DrawCommand) - sizeof(Command)));
+	pArguments->index_count = indexCount;
+	pArguments->instance_count = instanceCount;
+	pArguments->start_index = startIndex;
+	pArguments->base_vertex = baseVertex;
+	pArguments->start_instance = startInstance;
+	pArguments->padding = 0;
+}
+
+/*
+* calls every command on context. the stream is checked as it goes since it may come from a file: a command that does
+* not fit or has counts beyond what d3d supports stops the replay with STATUS_DATA_ERROR.
+*/
+INT CommandBuffer::Replay(RenderContext& context) const
+{
+	INT status = STATUS_SUCCESS;
+
+	const BYTE* p = m_Data.data();
+	const BYTE* end = p + m_Size;
+
+	while ((p < end) && SUCCEEDED(status))
+	{
+		Command command;
+
+		if (static_cast<size_t>(end - p) < sizeof(Command))
+		{
+			status = STATUS_DATA_ERROR;
+			break;
+		}
+
+		CopyMemory(&command, p, sizeof(Command));
+
+		if ((command.size < sizeof(Command)) || (command.size % 8 != 0) || (command.size > static_cast<size_t>(end - p)))
+		{
+			status = STATUS_DATA_ERROR;
+			break;
+		}
+
+		const size_t arguments = command.size - sizeof(Command);
+
+		switch (command.type)
+		{
+		case COMMAND_RENDER_TARGETS:
+		{
+			const RenderTargetsCommand* pArguments = reinterpret_cast<const RenderTargetsCommand*>(p);
+
+			if ((arguments < sizeof(RenderTargetsCommand) - sizeof(Command)) || (pArguments->count > MAX_RENDER_TARGETS) ||
+				(arguments < sizeof(RenderTargetsCommand) - sizeof(Command) + pArguments->count * sizeof(uint64_t)))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			const uint64_t* pViews = reinterpret_cast<const uint64_t*>(pArguments + 1);
+			ID3D11RenderTargetView* views[MAX_RENDER_TARGETS];
+
+			for (uint32_t i = 0; i < pArguments->count; i++)
+			{
+				views[i] = reinterpret_cast<ID3D11RenderTargetView*>(static_cast<uintptr_t>(pViews[i]));
+			}
+
+			context.OMSetRenderTargets(pArguments->count, views, reinterpret_cast<ID3D11DepthStencilView*>(static_cast<uintptr_t>(pArguments->depth_stencil_view)));
+			break;
+		}
+
+		case COMMAND_VERTEX_BUFFERS:
+		{
+			const VertexBuffersCommand* pArguments = reinterpret_cast<const VertexBuffersCommand*>(p);
+
+			if ((arguments < sizeof(VertexBuffersCommand) - sizeof(Command)) || (pArguments->slot + static_cast<uint64_t>(pArguments->count) > MAX_VERTEX_BUFFERS) ||
+				(arguments < sizeof(VertexBuffersCommand) - sizeof(Command) + pArguments->count * (sizeof(uint64_t) + 2 * sizeof(uint32_t))))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			const uint64_t* pBuffers = reinterpret_cast<const uint64_t*>(pArguments + 1);
+			const uint32_t* pStrides = reinterpret_cast<const uint32_t*>(pBuffers + pArguments->count);
+
+			ID3D11Buffer* buffers[MAX_VERTEX_BUFFERS];
+			UINT strides[MAX_VERTEX_BUFFERS];
+			UINT offsets[MAX_VERTEX_BUFFERS];
+
+			for (uint32_t i = 0; i < pArguments->count; i++)
+			{
+				buffers[i] = reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(pBuffers[i]));
+				strides[i] = pStrides[i];
+				offsets[i] = pStrides[pArguments->count + i];
+			}
+
+			context.IASetVertexBuffers(pArguments->slot, pArguments->count, buffers, strides, offsets);
+			break;
+		}
+
+		case COMMAND_INDEX_BUFFER:
+		{
+			const IndexBufferCommand* pArguments = reinterpret_cast<const IndexBufferCommand*>(p);
+
+			if (arguments < sizeof(IndexBufferCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			context.IASetIndexBuffer(reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(pArguments->buffer)), static_cast<DXGI_FORMAT>(pArguments->format), pArguments->offset);
+			break;
+		}
+
+		case COMMAND_TOPOLOGY:
+		{
+			if (arguments < sizeof(TopologyCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			context.IASetPrimitiveTopology(static_cast<D3D11_PRIMITIVE_TOPOLOGY>(reinterpret_cast<const TopologyCommand*>(p)->topology));
+			break;
+		}
+
+		case COMMAND_INPUT_LAYOUT:
+		case COMMAND_VERTEX_SHADER:
+		case COMMAND_PIXEL_SHADER:
+		{
+			if (arguments < sizeof(ObjectCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			const uintptr_t object = static_cast<uintptr_t>(reinterpret_cast<const ObjectCommand*>(p)->object);
+
+			if (command.type == COMMAND_INPUT_LAYOUT)
+			{
+				context.IASetInputLayout(reinterpret_cast<ID3D11InputLayout*>(object));
+			}
+			else if (command.type == COMMAND_VERTEX_SHADER)
+			{
+				context.VSSetShader(reinterpret_cast<ID3D11VertexShader*>(object));
+			}
+			else
+			{
+				context.PSSetShader(reinterpret_cast<ID3D11PixelShader*>(object));
+			}
+			break;
+		}
+
+		case COMMAND_CONSTANT_BUFFERS:
+		{
+			const ConstantBuffersCommand* pArguments = reinterpret_cast<const ConstantBuffersCommand*>(p);
+
+			if ((arguments < sizeof(ConstantBuffersCommand) - sizeof(Command)) || (pArguments->slot + static_cast<uint64_t>(pArguments->count) > MAX_CONSTANT_BUFFERS) ||
+				(arguments < sizeof(ConstantBuffersCommand) - sizeof(Command) + pArguments->count * sizeof(uint64_t)))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			const uint64_t* pBuffers = reinterpret_cast<const uint64_t*>(pArguments + 1);
+			ID3D11Buffer* buffers[MAX_CONSTANT_BUFFERS];
+
+			for (uint32_t i = 0; i < pArguments->count; i++)
+			{
+				buffers[i] = reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(pBuffers[i]));
+			}
+
+			context.VSSetConstantBuffers(pArguments->slot, pArguments->count, buffers);
+			break;
+		}
+
+		case COMMAND_UPDATE_BUFFER:
+		{
+			const UpdateBufferCommand* pArguments = reinterpret_cast<const UpdateBufferCommand*>(p);
+
+			if ((arguments < sizeof(UpdateBufferCommand) - sizeof(Command)) || (pArguments->size > arguments - (sizeof(UpdateBufferCommand) - sizeof(Command))))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			status = context.UpdateBuffer(reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(pArguments->buffer)), pArguments + 1, static_cast<size_t>(pArguments->size));
+			break;
+		}
+
+		case COMMAND_CLEAR_RENDER_TARGET:
+		{
+			const ClearRenderTargetCommand* pArguments = reinterpret_cast<const ClearRenderTargetCommand*>(p);
+
+			if (arguments < sizeof(ClearRenderTargetCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			context.ClearRenderTargetView(reinterpret_cast<ID3D11RenderTargetView*>(static_cast<uintptr_t>(pArguments->view)), pArguments->color);
+			break;
+		}
+
+		case COMMAND_CLEAR_DEPTH_STENCIL:
+		{
+			const ClearDepthStencilCommand* pArguments = reinterpret_cast<const ClearDepthStencilCommand*>(p);
+
+			if (arguments < sizeof(ClearDepthStencilCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			context.ClearDepthStencilView(reinterpret_cast<ID3D11DepthStencilView*>(static_cast<uintptr_t>(pArguments->view)),
+				pArguments->flags, pArguments->depth, static_cast<UINT8>(pArguments->stencil));
+			break;
+		}
+
+		case COMMAND_DRAW_INDEXED_INSTANCED:
+		{
+			const DrawCommand* pArguments = reinterpret_cast<const DrawCommand*>(p);
+
+			if (arguments < sizeof(DrawCommand) - sizeof(Command))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			context.DrawIndexedInstanced(pArguments->index_count, pArguments->instance_count, pArguments->start_index, pArguments->base_vertex, pArguments->start_instance);
+			break;
+		}
+
+		case COMMAND_CONSTANT_BUFFER_RANGES:
+		{
+			const ConstantBufferRangesCommand* pArguments = reinterpret_cast<const ConstantBufferRangesCommand*>(p);
+
+			if ((arguments < sizeof(ConstantBufferRangesCommand) - sizeof(Command)) || (pArguments->slot + static_cast<uint64_t>(pArguments->count) > MAX_CONSTANT_BUFFERS) ||
+				(arguments < sizeof(ConstantBufferRangesCommand) - sizeof(Command) + pArguments->count * (sizeof(uint64_t) + 2 * sizeof(uint32_t))))
+			{
+				status = STATUS_DATA_ERROR;
+				break;
+			}
+
+			const uint64_t* pBuffers = reinterpret_cast<const uint64_t*>(pArguments + 1);
+			const uint32_t* pRanges = reinterpret_cast<const uint32_t*>(pBuffers + pArguments->count);
+
+			ID3D11Buffer* buffers[MAX_CONSTANT_BUFFERS];
+			UINT first_constants[MAX_CONSTANT_BUFFERS];
+			UINT constant_counts[MAX_CONSTANT_BUFFERS];
+
+			for (uint32_t i = 0; i < pArguments->count; i++)
+			{
+				buffers[i] = reinterpret_cast<ID3D11Buffer*>(static_cast<uintptr_t>(pBuffers[i]));
+				first_constants[i] = pRanges[i];
+				constant_counts[i] = pRanges[pArguments->count + i];
+			}
+
+			context.VSSetConstantBuffers1(pArguments->slot, pArguments->count, buffers, first_constants, constant_counts);
+			break;
+		}
+
+		default:
+			status = STATUS_DATA_ERROR;
+			break;
+		}
+
+		p += command.size;
+	}
+
+	if (status == STATUS_DATA_ERROR)
+	{
+		WriteToConsole("error 0x%X: the command stream is damaged at byte %zu\n", status, static_cast<size_t>(p - m_Data.data()));
+	}
+
+	return status;
+}
+
+// replays the buffers one after the other in index order
+INT CommandBuffer::Replay(const CommandBuffer* pBuffers, size_t count, RenderContext& context)
+{
+	INT status = STATUS_SUCCESS;
+
+	for (size_t i = 0; (i < count) && SUCCEEDED(status); i++)
+	{
+		status = pBuffers[i].Replay(context);
+	}
+
+	return status;
+}
+
+// runs map over every object of the stream and stores what it returns in its place
+INT CommandBuffer::MapObjects(ObjectMap map, VOID* pData)
+{
+	INT status = STATUS_SUCCESS;
+
+	BYTE* p = m_Data.data();
+	BYTE* end = p + m_Size;
+
+	while (p < end)
+	{
+		Command command;
+		CopyMemory(&command, p, sizeof(Command));
+
+		uint64_t* pObjects = NULL;
+		size_t count = 0;
+
+		switch (command.type)
+		{
+		case COMMAND_RENDER_TARGETS:
+			reinterpret_cast<RenderTargetsCommand*>(p)->depth_stencil_view = map(reinterpret_cast<RenderTargetsCommand*>(p)->depth_stencil_view, pData);
+			pObjects = reinterpret_cast<uint64_t*>(reinterpret_cast<RenderTargetsCommand*>(p) + 1);
+			count = reinterpret_cast<RenderTargetsCommand*>(p)->count;
+			break;
+
+		case COMMAND_VERTEX_BUFFERS:
+			pObjects = reinterpret_cast<uint64_t*>(reinterpret_cast<VertexBuffersCommand*>(p) + 1);
+			count = reinterpret_cast<VertexBuffersCommand*>(p)->count;
+			break;
+
+		case COMMAND_INDEX_BUFFER:
+			pObjects = &reinterpret_cast<IndexBufferCommand*>(p)->buffer;
+			count = 1;
+			break;
+
+		case COMMAND_INPUT_LAYOUT:
+		case COMMAND_VERTEX_SHADER:
+		case COMMAND_PIXEL_SHADER:
+			pObjects = &reinterpret_cast<ObjectCommand*>(p)->object;
+			count = 1;
+			break;
+
+		case COMMAND_CONSTANT_BUFFERS:
+			pObjects = reinterpret_cast<uint64_t*>(reinterpret_cast<ConstantBuffersCommand*>(p) + 1);
+			count = reinterpret_cast<ConstantBuffersCommand*>(p)->count;
+			break;
+
+		case COMMAND_CONSTANT_BUFFER_RANGES:
+			pObjects = reinterpret_cast<uint64_t*>(reinterpret_cast<ConstantBufferRangesCommand*>(p) + 1);
+			count = reinterpret_cast<ConstantBufferRangesCommand*>(p)->count;
+			break;
+
+		case COMMAND_UPDATE_BUFFER:
+			pObjects = &reinterpret_cast<UpdateBufferCommand*>(p)->buffer;
+			count = 1;
+			break;
+
+		case COMMAND_CLEAR_RENDER_TARGET:
+			pObjects = &reinterpret_cast<ClearRenderTargetCommand*>(p)->view;
+			count = 1;
+			break;
+
+		case COMMAND_CLEAR_DEPTH_STENCIL:
+			pObjects = &reinterpret_cast<ClearDepthStencilCommand*>(p)->view;
+			count = 1;
+			break;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			pObjects[i] = map(pObjects[i], pData);
+		}
+
+		p += command.size;
+	}
+
+	return status;
+}
+
+/*
+* writes the stream with its objects replaced by handles. pObjects, if given, receives the objects in handle order,
+* starting with handle 1, so that Bind can put them back.
+*/
+INT CommandBuffer::Save(const char* path, std::vector<uint64_t>* pObjects) const
+{
+	INT status = STATUS_SUCCESS;
+
+	// a replay that does not touch any context checks the stream before it is walked without checks
+	NullRenderContext null_context;
+	status = Replay(null_context);
+
+	CommandBuffer copy;
+	std::vector<uint64_t> objects;
+
+	if (SUCCEEDED(status))
+	{
+		copy = *this;
+
+		// handles follow the order in which the objects first appear
+		std::vector<std::pair<uint64_t, uint64_t>> handles;
+
+		copy.MapObjects([](uint64_t object, VOID* pData) -> uint64_t
+		{
+			std::vector<uint64_t>& objects = *static_cast<std::vector<uint64_t>*>(pData);
+
+			if ((object != 0) && (std::find(objects.begin(), objects.end(), object) == objects.end()))
+			{
+				objects.push_back(object);
+			}
+
+			return object;
+		}, &objects);
+
+		for (size_t i = 0; i < objects.size(); i++)
+		{
+			handles.push_back(std::make_pair(objects[i], static_cast<uint64_t>(i + 1)));
+		}
+
+		std::sort(handles.begin(), handles.end());
+
+		copy.MapObjects([](uint64_t object, VOID* pData) -> uint64_t
+		{
+			const std::vector<std::pair<uint64_t, uint64_t>>& handles = *static_cast<const std::vector<std::pair<uint64_t, uint64_t>>*>(pData);
+
+			std::vector<std::pair<uint64_t, uint64_t>>::const_iterator it = std::lower_bound(handles.begin(), handles.end(), std::make_pair(object, static_cast<uint64_t>(0)));
+
+			return (object != 0) ? it->second : 0;
+		}, &handles);
+	}
+
+	FILE* pFile = NULL;
+
+	if (SUCCEEDED(status))
+	{
+		pFile = OpenFileStream(path, "wb");
+		if (pFile == NULL)
+		{
+			status = GetErrnoStatus();
+			WriteToConsole("error 0x%X: could not create %s\n", status, path);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		CaptureHeader header = {};
+		header.magic = CAPTURE_MAGIC;
+		header.version = CAPTURE_VERSION;
+		header.size = copy.m_Size;
+		header.object_count = objects.size();
+		header.command_count = copy.m_CommandCount;
+		header.checksum = Fnv::Checksum(copy.m_Data.data(), copy.m_Size);
+
+		// a short write does not always set errno, it is a failure all the same
+		errno = 0;
+
+		const bool written = (fwrite(&header, sizeof(header), 1, pFile) == 1) && (fwrite(copy.m_Data.data(), 1, copy.m_Size, pFile) == copy.m_Size);
+		const bool closed = (fclose(pFile) == 0);
+		pFile = NULL;
+
+		if (!written || !closed)
+		{
+			status = (errno != 0) ? GetErrnoStatus() : STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: could not write %s\n", status, path);
+		}
+	}
+
+	if (pFile != NULL)
+	{
+		fclose(pFile);
+	}
+
+	if (SUCCEEDED(status) && (pObjects != NULL))
+	{
+		*pObjects = objects;
+	}
+
+	return status;
+}
+
+// reads a stream written by Save, its objects are the handles until Bind replaces them
+INT CommandBuffer::Load(const char* path)
+{
+	INT status = STATUS_SUCCESS;
+
+	CaptureHeader header = {};
+
+	Clear();
+
+	FILE* pFile = OpenFileStream(path, "rb");
+	if (pFile == NULL)
+	{
+		status = GetErrnoStatus();
+		WriteToConsole("error 0x%X: could not open %s\n", status, path);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		if ((fread(&header, sizeof(header), 1, pFile) != 1) ||
+			(header.magic != CAPTURE_MAGIC) || (header.version != CAPTURE_VERSION) || (header.size > 0xFFFFFFFF))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s is not a command capture of version %u\n", status, path, CAPTURE_VERSION);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		Reserve(static_cast<size_t>(header.size));
+		m_CommandCount = header.command_count;
+
+		if ((fread(m_Data.data(), 1, m_Size, pFile) != m_Size) ||
+			(Fnv::Checksum(m_Data.data(), m_Size) != header.checksum))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the commands of %s are incomplete or damaged\n", status, path);
+		}
+	}
+
+	// one checked pass, Bind and Replay can rely on the layout after this
+	if (SUCCEEDED(status))
+	{
+		NullRenderContext null_context;
+		status = Replay(null_context);
+	}
+
+	if (pFile != NULL)
+	{
+		fclose(pFile);
+	}
+
+	if (FAILED(status))
+	{
+		Clear();
+	}
+
+	return status;
+}
+
+// replaces the handles of a loaded stream with objects[handle - 1]
+INT CommandBuffer::Bind(const std::vector<uint64_t>& objects)
+{
+	INT status = STATUS_SUCCESS;
+
+	bool valid = true;
+	std::pair<const std::vector<uint64_t>*, bool*> data(&objects, &valid);
+
+	MapObjects([](uint64_t handle, VOID* pData) -> uint64_t
+	{
+		std::pair<const std::vector<uint64_t>*, bool*>& data = *static_cast<std::pair<const std::vector<uint64_t>*, bool*>*>(pData);
+
+		if (handle > data.first->size())
+		{
+			*data.second = false;
+			return 0;
+		}
+
+		return (handle != 0) ? (*data.first)[static_cast<size_t>(handle - 1)] : 0;
+	}, &data);
+
+	if (!valid)
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: the commands refer to more than the %zu objects given\n", status, objects.size());
+	}
+
+	return status;
+}
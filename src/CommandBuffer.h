@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.h"
+#include "RenderContext.h"
+
+/*
+* render context calls recorded into a flat stream of plain data so that they can be made on any thread and replayed
+* later on the device context, or on any other RenderContext. every command is a Command header followed by its
+* arguments, 8 byte aligned, with objects stored as 64 bit pointers and updates carrying their data. buffers recorded
+* in parallel are replayed, or appended into one, in the order of their index rather than the order they finished in.
+*
+* a saved stream is position independent: the objects are replaced by handles, 1 for the first object the stream
+* refers to and so on, and 0 for NULL. a loaded stream replays with the handles as its objects, which is all a
+* RecordingRenderContext needs, or Bind swaps them for real ones.
+*/
+class CommandBuffer : public RenderContext
+{
+public:
+	enum Type : uint32_t {
+		COMMAND_RENDER_TARGETS = 1,
+		COMMAND_VERTEX_BUFFERS,
+		COMMAND_INDEX_BUFFER,
+		COMMAND_TOPOLOGY,
+		COMMAND_INPUT_LAYOUT,
+		COMMAND_VERTEX_SHADER,
+		COMMAND_CONSTANT_BUFFERS,
+		COMMAND_PIXEL_SHADER,
+		COMMAND_UPDATE_BUFFER,
+		COMMAND_CLEAR_RENDER_TARGET,
+		COMMAND_CLEAR_DEPTH_STENCIL,
+		COMMAND_DRAW_INDEXED_INSTANCED,
+		COMMAND_CONSTANT_BUFFER_RANGES,
+		COMMAND_COUNT
+	};
+
+	enum {
+		CAPTURE_MAGIC        = 0x50414344, // "DCAP"
+		CAPTURE_VERSION      = 1,
+		MAX_RENDER_TARGETS   = 8,
+		MAX_VERTEX_BUFFERS   = 32,
+		MAX_CONSTANT_BUFFERS = 14
+	};
+
+	struct Command
+	{
+		uint32_t type;
+		uint32_t size; // with the header and the padding
+	};
+
+	struct CaptureHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint64_t size;         // of the stream
+		uint64_t object_count;
+		uint32_t command_count;
+		uint32_t checksum;     // of the stream
+	};
+
+	// the arguments, arrays follow the fixed part
+	struct RenderTargetsCommand   { Command command; uint32_t count; uint32_t padding; uint64_t depth_stencil_view; /* uint64_t views[count] */ };
+	struct VertexBuffersCommand   { Command command; uint32_t slot; uint32_t count; /* uint64_t buffers[count], uint32_t strides[count], offsets[count] */ };
+	struct IndexBufferCommand     { Command command; uint64_t buffer; uint32_t format; uint32_t offset; };
+	struct TopologyCommand        { Command command; uint32_t topology; uint32_t padding; };
+	struct ObjectCommand          { Command command; uint64_t object; }; // input layout and shaders
+	struct ConstantBuffersCommand { Command command; uint32_t slot; uint32_t count; /* uint64_t buffers[count] */ };
+	struct ConstantBufferRangesCommand { Command command; uint32_t slot; uint32_t count; /* uint64_t buffers[count], uint32_t first_constants[count], constant_counts[count] */ };
+	struct UpdateBufferCommand    { Command command; uint64_t buffer; uint64_t size; /* BYTE data[size] */ };
+	struct ClearRenderTargetCommand { Command command; uint64_t view; float color[4]; };
+	struct ClearDepthStencilCommand { Command command; uint64_t view; uint32_t flags; float depth; uint32_t stencil; uint32_t padding; };
+	struct DrawCommand            { Command command; uint32_t index_count; uint32_t instance_count; uint32_t start_index; int32_t base_vertex; uint32_t start_instance; uint32_t padding; };
+
+	typedef uint64_t (*ObjectMap)(uint64_t object, VOID* pData);
+
+private:
+	std::vector<BYTE> m_Data; // grown ahead of m_Size so that recording a command does not clear its memory first
+	size_t            m_Size;
+	uint32_t          m_CommandCount;
+
+public:
+	CommandBuffer();
+
+	VOID Clear();
+	VOID Append(const CommandBuffer& other);
+
+	size_t   GetSize() const;
+	uint32_t GetCommandCount() const;
+
+	VOID OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView);
+	VOID IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	VOID IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset);
+	VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	VOID IASetInputLayout(ID3D11InputLayout* pInputLayout);
+	VOID VSSetShader(ID3D11VertexShader* pShader);
+	VOID VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers);
+	VOID VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts);
+	VOID PSSetShader(ID3D11PixelShader* pShader);
+	INT  UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size);
+	VOID ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4]);
+	VOID ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil);
+	VOID DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	VOID* UpdateBuffer(ID3D11Buffer* pBuffer, size_t size);
+
+	INT Replay(RenderContext& context) const;
+	INT Save(const char* path, std::vector<uint64_t>* pObjects) const;
+	INT Load(const char* path);
+	INT Bind(const std::vector<uint64_t>& objects);
+
+	static INT Replay(const CommandBuffer* pBuffers, size_t count, RenderContext& context);
+
+private:
+	BYTE* Reserve(size_t size);
+	BYTE* Push(Type type, size_t size);
+	INT   MapObjects(ObjectMap map, VOID* pData);
+};
+
+// a RenderContext that drops every call, for timing the replay of a stream on its own
+class NullRenderContext : public RenderContext
+{
+public:
+	VOID OMSetRenderTargets(UINT, ID3D11RenderTargetView* const*, ID3D11DepthStencilView*) {}
+	VOID IASetVertexBuffers(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) {}
+	VOID IASetIndexBuffer(ID3D11Buffer*, DXGI_FORMAT, UINT) {}
+	VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY) {}
+	VOID IASetInputLayout(ID3D11InputLayout*) {}
+	VOID VSSetShader(ID3D11VertexShader*) {}
+	VOID VSSetConstantBuffers(UINT, UINT, ID3D11Buffer* const*) {}
+	VOID VSSetConstantBuffers1(UINT, UINT, ID3D11Buffer* const*, const UINT*, const UINT*) {}
+	VOID PSSetShader(ID3D11PixelShader*) {}
+	INT  UpdateBuffer(ID3D11Buffer*, const void*, size_t) { return STATUS_SUCCESS; }
+	VOID ClearRenderTargetView(ID3D11RenderTargetView*, const float[4]) {}
+	VOID ClearDepthStencilView(ID3D11DepthStencilView*, UINT, float, UINT8) {}
+	VOID DrawIndexedInstanced(UINT, UINT, UINT, INT, UINT) {}
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Platform.h"
+
+#if defined(_WIN32)
+#include <d3d11_1.h>
+#include <dxgi1_3.h>
+#include <d3dcompiler.h>
+#include <psapi.h>
+#else
+// without the sdk the cpu side only passes the d3d values it shares with the renderer around. they keep the values of
+// the sdk, so that shader cache keys and mesh packs come out the same on every platform
+#define D3DCOMPILE_ENABLE_STRICTNESS   (1 << 11)
+#define D3DCOMPILE_WARNINGS_ARE_ERRORS (1 << 18)
+
+#define D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT 4096
+
+enum DXGI_FORMAT {
+	DXGI_FORMAT_UNKNOWN            = 0,
+	DXGI_FORMAT_R32G32B32_FLOAT    = 6,
+	DXGI_FORMAT_R16G16B16A16_FLOAT = 10,
+	DXGI_FORMAT_R16G16B16A16_SNORM = 13,
+	DXGI_FORMAT_R10G10B10A2_UNORM  = 24,
+	DXGI_FORMAT_R8G8B8A8_UNORM     = 28,
+	DXGI_FORMAT_R32_UINT           = 42,
+	DXGI_FORMAT_R16_UINT           = 57
+};
+
+// the recording context and the state cache only keep and compare these, they never call into them
+struct ID3D11Buffer;
+struct ID3D11DepthStencilView;
+struct ID3D11InputLayout;
+struct ID3D11PixelShader;
+struct ID3D11RenderTargetView;
+struct ID3D11VertexShader;
+
+enum D3D11_PRIMITIVE_TOPOLOGY {
+	D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED    = 0,
+	D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST = 4
+};
+
+enum D3D11_CLEAR_FLAG {
+	D3D11_CLEAR_DEPTH   = 0x1,
+	D3D11_CLEAR_STENCIL = 0x2
+};
+#endif
+
+enum {
+	WIDTH  = 512,
+	HEIGHT = 512,
+
+	// the scene is a cube of INSTANCE_GRID^3 cubes, drawn with one instanced draw per command buffer
+	INSTANCE_GRID = 32
+};
+
+const CHAR* const CLASS_NAME  = "DxClass";
+const CHAR* const WINDOW_NAME = "DirectX";
+
+// compiled shader bytecode is cached here between runs
+const CHAR* const SHADER_CACHE_PATH = "shaders.pack";
@@ -0,0 +1,196 @@
+#include "ConstantRing.h"
+#include "Log.h"
+
+#if defined(_WIN32)
+
+D3DConstantBufferWriter::D3DConstantBufferWriter(ID3D11DeviceContext* pContext, ID3D11Buffer* pBuffer)
+{
+	m_pContext = pContext;
+	m_pBuffer = pBuffer;
+}
+
+INT D3DConstantBufferWriter::Map(bool discard, BYTE** ppData)
+{
+	INT status = STATUS_SUCCESS;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	status = m_pContext->Map(m_pBuffer, 0, discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &mapped);
+
+	if (SUCCEEDED(status))
+	{
+		*ppData = static_cast<BYTE*>(mapped.pData);
+	}
+	else
+	{
+		WriteToConsole("error 0x%X: could not map the constant buffer\n", status);
+	}
+
+	return status;
+}
+
+VOID D3DConstantBufferWriter::Unmap()
+{
+	m_pContext->Unmap(m_pBuffer, 0);
+}
+
+#endif
+
+ConstantRing::ConstantRing()
+{
+	m_Size = 0;
+	m_FrameCount = 1;
+	m_Frame = 0;
+	m_Head = 0;
+	ZeroMemory(m_FrameStarts, sizeof(m_FrameStarts));
+	ZeroMemory(&m_Statistics, sizeof(m_Statistics));
+}
+
+// size is rounded up to whole slices. a ring of one frame discards for every frame and counts on the driver to rename
+INT ConstantRing::Initialize(size_t size, unsigned int frameCount)
+{
+	INT status = STATUS_SUCCESS;
+
+	size = (size + ALIGNMENT - 1) & ~static_cast<size_t>(ALIGNMENT - 1);
+
+	if ((size == 0) || (size > UINT_MAX - ALIGNMENT) || (frameCount == 0) || (frameCount > MAX_FRAMES))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: a constant ring of %zu bytes and %u frames\n", status, size, frameCount);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_Size = size;
+		m_FrameCount = frameCount;
+		m_Frame = 0;
+		m_Head = 0;
+		ZeroMemory(m_FrameStarts, sizeof(m_FrameStarts));
+		ZeroMemory(&m_Statistics, sizeof(m_Statistics));
+	}
+
+	return status;
+}
+
+// retires the oldest frame in flight, its space is free from here on
+VOID ConstantRing::BeginFrame()
+{
+	m_Frame = (m_Frame + 1) % m_FrameCount;
+	m_FrameStarts[m_Frame] = m_Head;
+}
+
+/*
+* room for count elements of elementSize bytes each. a block that does not fit before the end of the buffer goes to
+* its start, and one that would reach into the space of a frame in flight fails with STATUS_BUFFER_TOO_SMALL and
+* leaves the ring as it was.
+*/
+INT ConstantRing::Allocate(size_t elementSize, size_t count, Block* pBlock)
+{
+	if ((elementSize == 0) || (elementSize > MAX_ELEMENT_SIZE) || (count == 0))
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	// more slices than the whole buffer, which also keeps the size of the block in range
+	if (count > m_Size / ALIGNMENT)
+	{
+		m_Statistics.failure_count++;
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	const UINT stride = GetStride(elementSize);
+	const uint64_t size = static_cast<uint64_t>(stride) * count;
+
+	uint64_t head = m_Head;
+	uint64_t offset = head % m_Size;
+
+	if (offset + size > m_Size)
+	{
+		head += m_Size - offset;
+		offset = 0;
+	}
+
+	// the oldest frame in flight, the current one in a ring of one frame
+	const uint64_t tail = m_FrameStarts[(m_Frame + 1) % m_FrameCount];
+
+	if (head + size - tail > m_Size)
+	{
+		m_Statistics.failure_count++;
+		return STATUS_BUFFER_TOO_SMALL;
+	}
+
+	m_Head = head + size;
+
+	pBlock->offset = static_cast<UINT>(offset);
+	pBlock->stride = stride;
+	pBlock->count = static_cast<UINT>(count);
+	pBlock->discard = (offset == 0);
+
+	m_Statistics.block_count++;
+	m_Statistics.byte_count += size;
+	m_Statistics.discard_count += pBlock->discard ? 1 : 0;
+	m_Statistics.high_water = std::max(m_Statistics.high_water, static_cast<size_t>(m_Head - tail));
+
+	return STATUS_SUCCESS;
+}
+
+// allocates a block and copies the elements, packed one after the other in pElements, into it with one map
+INT ConstantRing::Write(ConstantBufferWriter& buffer, const void* pElements, size_t elementSize, size_t count, Block* pBlock)
+{
+	INT status = STATUS_SUCCESS;
+	BYTE* pData = NULL;
+
+	status = Allocate(elementSize, count, pBlock);
+
+	if (SUCCEEDED(status))
+	{
+		status = buffer.Map(pBlock->discard, &pData);
+	}
+	else
+	{
+		WriteToConsole("error 0x%X: %zu constant blocks of %zu bytes do not fit into the constant ring\n", status, count, elementSize);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		const BYTE* pSource = static_cast<const BYTE*>(pElements);
+		BYTE* pDestination = pData + pBlock->offset;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			CopyMemory(pDestination, pSource, elementSize);
+
+			pSource += elementSize;
+			pDestination += pBlock->stride;
+		}
+
+		buffer.Unmap();
+	}
+
+	return status;
+}
+
+size_t ConstantRing::GetSize()
+{
+	return m_Size;
+}
+
+ConstantRing::Statistics ConstantRing::GetStatistics()
+{
+	return m_Statistics;
+}
+
+UINT ConstantRing::GetStride(size_t elementSize)
+{
+	return static_cast<UINT>((elementSize + ALIGNMENT - 1) & ~static_cast<size_t>(ALIGNMENT - 1));
+}
+
+// the range of an element of the block, as VSSetConstantBuffers1 takes it
+UINT ConstantRing::GetFirstConstant(const Block& block, size_t element)
+{
+	return static_cast<UINT>((block.offset + element * block.stride) / CONSTANT_SIZE);
+}
+
+UINT ConstantRing::GetConstantCount(const Block& block)
+{
+	return block.stride / CONSTANT_SIZE;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Common.h"
+#include "FrameArena.h"
+
+// the dynamic buffer behind a ConstantRing, so the ring can be driven without a d3d device
+class ConstantBufferWriter
+{
+public:
+	virtual ~ConstantBufferWriter() {}
+
+	// maps the whole buffer, with WRITE_DISCARD or else WRITE_NO_OVERWRITE
+	virtual INT  Map(bool discard, BYTE** ppData) = 0;
+	virtual VOID Unmap() = 0;
+};
+
+#if defined(_WIN32)
+
+class D3DConstantBufferWriter : public ConstantBufferWriter
+{
+private:
+	ID3D11DeviceContext* m_pContext;
+	ID3D11Buffer*        m_pBuffer;
+
+public:
+	D3DConstantBufferWriter(ID3D11DeviceContext* pContext, ID3D11Buffer* pBuffer);
+
+	INT  Map(bool discard, BYTE** ppData);
+	VOID Unmap();
+};
+
+#endif
+
+/*
+* hands out blocks of one large dynamic constant buffer for the constants of a frame. the blocks follow each other and
+* wrap at the end of the buffer, and the space of a frame is handed out again only frameCount frames later, the frames
+* in flight of the FrameArena, so the blocks are written with NO_OVERWRITE. a block that starts the buffer over is
+* written with DISCARD, which d3d wants before the first NO_OVERWRITE and which has the driver rename the buffer should
+* the gpu ever be further behind. a discard would take the blocks written before it in the same frame along, so a
+* frame writes all of its constants in one block.
+*
+* the elements of a block start on 256 byte boundaries and take whole 256 byte slices, which is what
+* VSSetConstantBuffers1 binds: ranges of 16 byte constants whose first constant and count are multiples of 16.
+*/
+class ConstantRing
+{
+public:
+	enum {
+		ALIGNMENT        = 256,
+		CONSTANT_SIZE    = 16,
+		MAX_FRAMES       = FrameArena::FRAME_COUNT,
+		MAX_ELEMENT_SIZE = D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT * CONSTANT_SIZE // the most a shader can see
+	};
+
+	struct Block
+	{
+		UINT offset;  // in bytes
+		UINT stride;  // from one element to the next
+		UINT count;
+		bool discard; // the block starts the buffer over
+	};
+
+	struct Statistics
+	{
+		uint64_t block_count;
+		uint64_t byte_count;    // handed out, with the padding of the elements
+		uint64_t discard_count;
+		uint64_t failure_count; // blocks that did not fit next to the frames in flight
+		size_t   high_water;    // the most the frames in flight held, with the space skipped at a wrap
+	};
+
+private:
+	size_t       m_Size;
+	unsigned int m_FrameCount;
+	unsigned int m_Frame;
+	uint64_t     m_Head;                    // bytes handed out or skipped since Initialize, the next block goes at m_Head % m_Size
+	uint64_t     m_FrameStarts[MAX_FRAMES]; // the heads of the frames in flight
+	Statistics   m_Statistics;
+
+public:
+	ConstantRing();
+
+	INT  Initialize(size_t size, unsigned int frameCount);
+	VOID BeginFrame();
+	INT  Allocate(size_t elementSize, size_t count, Block* pBlock);
+	INT  Write(ConstantBufferWriter& buffer, const void* pElements, size_t elementSize, size_t count, Block* pBlock);
+
+	size_t     GetSize();
+	Statistics GetStatistics();
+
+	static UINT GetStride(size_t elementSize);
+	static UINT GetFirstConstant(const Block& block, size_t element);
+	static UINT GetConstantCount(const Block& block);
+};
@@ -0,0 +1,195 @@
+#include "Culling.h"
+#include "Matrix.h"
+#include "Data.h"
+
+namespace Culling
+{
+	size_t GetBatchSize(size_t n)
+	{
+		return ((n + Matrix::BATCH_WIDTH - 1) / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE;
+	}
+
+	VOID ComputeBounds(const Data::Vertex* pVertices, size_t count, Bounds& bounds)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			bounds.aabb_min[k] = (count != 0) ? FLT_MAX : 0.0f;
+			bounds.aabb_max[k] = (count != 0) ? -FLT_MAX : 0.0f;
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				bounds.aabb_min[k] = std::min(bounds.aabb_min[k], pVertices[i].position[k]);
+				bounds.aabb_max[k] = std::max(bounds.aabb_max[k], pVertices[i].position[k]);
+			}
+		}
+
+		float radius_squared = 0.0f;
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			bounds.center[k] = 0.5f * (bounds.aabb_min[k] + bounds.aabb_max[k]);
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const float d_x = pVertices[i].position[0] - bounds.center[0];
+			const float d_y = pVertices[i].position[1] - bounds.center[1];
+			const float d_z = pVertices[i].position[2] - bounds.center[2];
+
+			radius_squared = std::max(radius_squared, d_x * d_x + d_y * d_y + d_z * d_z);
+		}
+
+		bounds.radius = sqrtf(radius_squared);
+	}
+
+	VOID ExtractFrustum(const float* m, Frustum& frustum)
+	{
+		const float* x = &m[0];
+		const float* y = &m[4];
+		const float* z = &m[8];
+		const float* w = &m[12];
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			frustum.planes[0][k] = w[k] + x[k];
+			frustum.planes[1][k] = w[k] - x[k];
+			frustum.planes[2][k] = w[k] + y[k];
+			frustum.planes[3][k] = w[k] - y[k];
+			frustum.planes[4][k] = z[k];
+			frustum.planes[5][k] = w[k] - z[k];
+		}
+
+		for (unsigned int p = 0; p < PLANE_COUNT; p++)
+		{
+			float* plane = frustum.planes[p];
+			const float length = sqrtf(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+
+			// a plane without a normal only depends on d, it rejects everything or nothing
+			if (length > 0.0f)
+			{
+				for (unsigned int k = 0; k < 4; k++)
+				{
+					plane[k] /= length;
+				}
+			}
+		}
+	}
+
+	VOID ExtractFrustum(const Matrix::Affine3x4& m, Frustum& frustum)
+	{
+		Matrix::Mat4 full;
+		Matrix::Expand(m, full);
+
+		ExtractFrustum(full.m, frustum);
+	}
+
+	size_t CullScalar(const Frustum& frustum, const float* pSpheres, size_t count, uint32_t* pVisible)
+	{
+		size_t visible = 0;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* sphere = pSpheres + (i / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH);
+
+			const float x = sphere[0 * Matrix::BATCH_WIDTH];
+			const float y = sphere[1 * Matrix::BATCH_WIDTH];
+			const float z = sphere[2 * Matrix::BATCH_WIDTH];
+			const float r = sphere[3 * Matrix::BATCH_WIDTH];
+
+			bool inside = true;
+
+			for (unsigned int p = 0; p < PLANE_COUNT; p++)
+			{
+				const float* plane = frustum.planes[p];
+				const float d = x * plane[0] + y * plane[1] + z * plane[2] + plane[3];
+
+				inside = inside && (d >= -r);
+			}
+
+			if (inside)
+			{
+				pVisible[visible++] = static_cast<uint32_t>(i);
+			}
+		}
+
+		return visible;
+	}
+
+	size_t Cull(const Frustum& frustum, const float* pSpheres, size_t count, uint32_t* pVisible)
+	{
+#if defined(SIMD_X86)
+		__m128 planes[PLANE_COUNT][4];
+
+		for (unsigned int p = 0; p < PLANE_COUNT; p++)
+		{
+			for (unsigned int k = 0; k < 4; k++)
+			{
+				planes[p][k] = _mm_set1_ps(frustum.planes[p][k]);
+			}
+		}
+
+		const __m128 all = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		size_t visible = 0;
+
+		for (size_t base = 0; base < count; base += 4)
+		{
+			const float* spheres = pSpheres + (base / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE + (base % Matrix::BATCH_WIDTH);
+
+			const __m128 x = _mm_loadu_ps(spheres + 0 * Matrix::BATCH_WIDTH);
+			const __m128 y = _mm_loadu_ps(spheres + 1 * Matrix::BATCH_WIDTH);
+			const __m128 z = _mm_loadu_ps(spheres + 2 * Matrix::BATCH_WIDTH);
+			const __m128 r = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(spheres + 3 * Matrix::BATCH_WIDTH));
+
+			__m128 inside = all;
+
+			for (unsigned int p = 0; p < PLANE_COUNT; p++)
+			{
+				__m128 d = _mm_add_ps(_mm_mul_ps(x, planes[p][0]), _mm_mul_ps(y, planes[p][1]));
+				d = _mm_add_ps(d, _mm_mul_ps(z, planes[p][2]));
+				d = _mm_add_ps(d, planes[p][3]);
+
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(d, r));
+			}
+
+			const int mask = _mm_movemask_ps(inside);
+			const size_t lanes = std::min<size_t>(4, count - base);
+
+			// branchless compaction, every lane is written and only the visible ones advance the output
+			for (size_t lane = 0; lane < lanes; lane++)
+			{
+				pVisible[visible] = static_cast<uint32_t>(base + lane);
+				visible += (mask >> lane) & 1;
+			}
+		}
+
+		return visible;
+#else
+		return CullScalar(frustum, pSpheres, count, pVisible);
+#endif
+	}
+
+	VOID Gather(const uint32_t* pVisible, size_t count, const float* pTransforms, float* pOut)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			CopyMemory(&pOut[i * Data::INSTANCE_SIZE], &pTransforms[pVisible[i] * Data::INSTANCE_SIZE], sizeof(float) * Data::INSTANCE_SIZE);
+		}
+	}
+
+	VOID Gather(const uint32_t* pVisible, size_t count, const float* pPrevious, const float* pTransforms, float t, float* pOut)
+	{
+		for (size_t i = 0; i < count; i++)
+		{
+			const float* p = &pPrevious[pVisible[i] * Data::INSTANCE_SIZE];
+			const float* c = &pTransforms[pVisible[i] * Data::INSTANCE_SIZE];
+
+			for (unsigned int e = 0; e < Data::INSTANCE_SIZE; e++)
+			{
+				pOut[i * Data::INSTANCE_SIZE + e] = p[e] + (c[e] - p[e]) * t;
+			}
+		}
+	}
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Common.h"
+#include "Matrix.h"
+#include "Data.h"
+
+/*
+* view frustum culling of bounding spheres. the spheres are batched like the matrices: component k (x, y, z, radius)
+* of sphere i is at [(i / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE + k * Matrix::BATCH_WIDTH + (i % Matrix::BATCH_WIDTH)]
+* so that a single load picks up one component of four neighbouring spheres.
+*/
+namespace Culling
+{
+	enum {
+		BATCH_BLOCK_SIZE = 4 * Matrix::BATCH_WIDTH,
+		PLANE_COUNT      = 6
+	};
+
+	// the bounds of a mesh in its own space, the sphere is centered on the box
+	struct Bounds
+	{
+		float aabb_min[3];
+		float aabb_max[3];
+		float center[3];
+		float radius;
+	};
+
+	// planes { a, b, c, d } with unit normals pointing inwards, a point is inside a plane if a * x + b * y + c * z + d >= 0
+	struct Frustum
+	{
+		float planes[PLANE_COUNT][4];
+	};
+
+	size_t GetBatchSize(size_t n);
+
+	VOID ComputeBounds(const Data::Vertex* pVertices, size_t count, Bounds& bounds);
+
+	// the clip volume of m, with the d3d depth range 0 <= z <= w (gribb and hartmann)
+	VOID ExtractFrustum(const float* m, Frustum& frustum);
+
+	VOID ExtractFrustum(const Matrix::Affine3x4& m, Frustum& frustum);
+
+	// writes the indices of the spheres that are not completely outside one of the planes to pVisible, returns their count
+	size_t CullScalar(const Frustum& frustum, const float* pSpheres, size_t count, uint32_t* pVisible);
+
+	// CullScalar four spheres at a time, with the same operations so the results match exactly
+	size_t Cull(const Frustum& frustum, const float* pSpheres, size_t count, uint32_t* pVisible);
+
+	// copies the transforms of the visible instances next to each other, Data::INSTANCE_SIZE floats each
+	VOID Gather(const uint32_t* pVisible, size_t count, const float* pTransforms, float* pOut);
+
+	/*
+	* Gather of the transforms blended between two ticks, pPrevious at t = 0 and pTransforms at t = 1. the elements are
+	* interpolated linearly, which shrinks a rotation of a radians between the ticks by 1 - cos(a / 2) halfway, about
+	* 1e-4 for the degree or two an instance turns in a tick.
+	*/
+	VOID Gather(const uint32_t* pVisible, size_t count, const float* pPrevious, const float* pTransforms, float t, float* pOut);
+}
@@ -0,0 +1,220 @@
+#pragma once
+
+#include "Common.h"
+#include "Matrix.h"
+
+namespace Data
+{
+	// compiled through a ShaderPermutation, which defines every feature of ShaderFeatures to 1 or 0
+	const char VERTEX_SHADER[] =
+		"														\n"
+		"	cbuffer MatrixBuffer : register(b0)					\n"
+		"	{													\n"
+		"		row_major float3x4 model_matrix;				\n"
+		"	};													\n"
+		"														\n"
+		"	#if QUANTIZED										\n"
+		"	cbuffer MeshBuffer : register(b1)					\n"
+		"	{													\n"
+		"		float4 position_scale;							\n"
+		"		float4 position_bias;							\n"
+		"	};													\n"
+		"	#endif												\n"
+		"														\n"
+		"	struct VS_INPUT										\n"
+		"	{													\n"
+		"		float3 vertex    : POSITION;					\n"
+		"		float3 color     : COLOR0;						\n"
+		"	#if INSTANCED										\n"
+		"		float4 instance0 : INSTANCE0;					\n"
+		"		float4 instance1 : INSTANCE1;					\n"
+		"		float4 instance2 : INSTANCE2;					\n"
+		"	#endif												\n"
+		"	};													\n"
+		"														\n"
+		"	struct VS_OUTPUT									\n"
+		"	{													\n"
+		"		float4 vertex : SV_POSITION;					\n"
+		"		float4 color  : COLOR0;							\n"
+		"	};													\n"
+		"														\n"
+		"	VS_OUTPUT main(VS_INPUT input)						\n"
+		"	{													\n"
+		"		VS_OUTPUT Output;								\n"
+		"														\n"
+		"	#if QUANTIZED										\n"
+		"		float3 position = position_scale.xyz *			\n"
+		"			input.vertex + position_bias.xyz;			\n"
+		"	#else												\n"
+		"		float3 position = input.vertex;					\n"
+		"	#endif												\n"
+		"		float4 vertex = float4(position, 1.0);			\n"
+		"														\n"
+		"	#if INSTANCED										\n"
+		"		float3x4 instance_matrix = float3x4(			\n"
+		"			input.instance0, input.instance1,			\n"
+		"			input.instance2);							\n"
+		"		vertex = float4(mul(instance_matrix, vertex),	\n"
+		"			1.0);										\n"
+		"	#endif												\n"
+		"		vertex = float4(mul(model_matrix, vertex),		\n"
+		"			vertex.w);									\n"
+		"														\n"
+		"		Output.vertex = vertex;							\n"
+		"		Output.color  = float4(input.color, 1.0);		\n"
+		"		return Output;									\n"
+		"	}													\n";
+
+	const char PIXEL_SHADER[] =
+		"														\n"
+		"	struct PS_INPUT										\n"
+		"	{													\n"
+		"		float4 vertex : SV_POSITION;					\n"
+		"		float4 color  : COLOR0;							\n"
+		"	};													\n"
+		"														\n"
+		"	struct PS_OUTPUT									\n"
+		"	{													\n"
+		"		float4 color  : SV_TARGET;						\n"
+		"	};													\n"
+		"														\n"
+		"	PS_OUTPUT main(PS_INPUT input)						\n"
+		"	{													\n"
+		"		PS_OUTPUT Output;								\n"
+		"														\n"
+		"	#if DEBUG_COLOR										\n"
+		"		// bands of depth								\n"
+		"		float band = frac(input.vertex.z * 64.0);		\n"
+		"		Output.color = float4(band, band, 1.0, 1.0);	\n"
+		"	#else												\n"
+		"		Output.color = input.color;						\n"
+		"	#endif												\n"
+		"		return Output;									\n"
+		"	}													\n";
+
+	struct ShaderDefine
+	{
+		const char* name;
+		const char* value;
+	};
+
+	struct ShaderSource
+	{
+		const char*         pSrcData;
+		size_t              SrcDataSize;
+		const char*         pSourceName;
+		const char*         pEntrypoint;
+		const char*         pTarget;
+		UINT                flags;
+		const ShaderDefine* pDefines; // terminated by a NULL name, or NULL for none
+	};
+
+	enum {
+		SHADER_VERTEX = 0,
+		SHADER_PIXEL  = 1
+	};
+
+	// the #if switches of the shaders, a ShaderPermutation picks a value for each one its shader has
+	enum ShaderFeature {
+		FEATURE_INSTANCED   = 1 << 0, // the per-instance transform stream is applied before the model matrix
+		FEATURE_QUANTIZED   = 1 << 1, // the positions are dequantized with the MeshBuffer
+		FEATURE_DEBUG_COLOR = 1 << 2, // bands of depth instead of the vertex colors
+		FEATURE_COUNT       = 3
+	};
+
+	const char* const ShaderFeatureNames[FEATURE_COUNT] = { "INSTANCED", "QUANTIZED", "DEBUG_COLOR" };
+
+	const ShaderSource Shaders[] =
+	{
+		{ VERTEX_SHADER, sizeof(VERTEX_SHADER), "vertex_shader", "main", "vs_5_0", D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_WARNINGS_ARE_ERRORS, NULL },
+		{ PIXEL_SHADER,  sizeof(PIXEL_SHADER),  "pixel_shader",  "main", "ps_5_0", D3DCOMPILE_ENABLE_STRICTNESS | D3DCOMPILE_WARNINGS_ARE_ERRORS, NULL }
+	};
+
+	// the features of each of Shaders
+	const UINT ShaderFeatures[ARRAYSIZE(Shaders)] =
+	{
+		FEATURE_INSTANCED | FEATURE_QUANTIZED,
+		FEATURE_DEBUG_COLOR
+	};
+
+	const float ClearColor[4] = { 1.0, 1.0, 1.0, 1.0 };
+
+	enum {
+		INSTANCE_SIZE = 12 // floats per instance in the INSTANCE stream, the three rows of a Matrix::Affine3x4
+	};
+
+	// the model matrix is affine, only its first three rows are uploaded
+	struct MatrixBuffer
+	{
+		Matrix::Affine3x4 model_matrix;
+	};
+
+	// dequantizes the packed vertex positions, position = packed position * position_scale + position_bias
+	struct MeshBuffer
+	{
+		float position_scale[4];
+		float position_bias[4];
+	};
+
+	struct Vertex
+	{
+		float position[3];
+		float color[3];
+	};
+
+	/*
+	*      2 ______________ 3
+	*       /|            /|
+	*      / |           / |
+	*   6 /__|__________/ 7|
+	*    |	 |          |  |
+	*    | 0 |__________|__| 1
+	*    |	/           |  /
+	*    | /            | /
+	*    |/_____________|/
+	*    4              5
+	*/
+
+	#define V0 { -0.5, -0.5, -0.5 }
+	#define V1 { +0.5, -0.5, -0.5 }
+	#define V2 { -0.5, +0.5, -0.5 }
+	#define V3 { +0.5, +0.5, -0.5 }
+	#define V4 { -0.5, -0.5, +0.5 }
+	#define V5 { +0.5, -0.5, +0.5 }
+	#define V6 { -0.5, +0.5, +0.5 }
+	#define V7 { +0.5, +0.5, +0.5 }
+
+	#define C0 { 1.0, 0.0, 0.0 }
+	#define C1 { 0.0, 1.0, 0.0 }
+	#define C2 { 0.0, 0.0, 1.0 }
+	#define C3 { 0.5, 0.5, 0.0 }
+	#define C4 { 0.5, 0.0, 0.5 }
+	#define C5 { 0.0, 0.5, 0.5 }
+
+	const Vertex Vertices[] =
+	{
+		// front
+		{ V6, C0 }, { V5, C0 }, { V4, C0 },
+		{ V5, C0 }, { V6, C0 }, { V7, C0 },
+
+		// back
+		{ V2, C1 }, { V1, C1 }, { V0, C1 },
+		{ V1, C1 }, { V2, C1 }, { V3, C1 },
+
+		// top
+		{ V6, C2 }, { V2, C2 }, { V7, C2 },
+		{ V2, C2 }, { V3, C2 }, { V7, C2 },
+
+		// bottom
+		{ V4, C3 }, { V0, C3 }, { V5, C3 },
+		{ V0, C3 }, { V1, C3 }, { V5, C3 },
+
+		// right
+		{ V5, C4 }, { V7, C4 }, { V1, C4 },
+		{ V1, C4 }, { V7, C4 }, { V3, C4 },
+
+		// left
+		{ V4, C5 }, { V6, C5 }, { V0, C5 },
+		{ V0, C5 }, { V6, C5 }, { V2, C5 }
+	};
+}
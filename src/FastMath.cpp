@@ -0,0 +1,106 @@
+#include "FastMath.h"
+
+namespace FastMath
+{
+	const float FOUR_OVER_PI = 1.27323954473516f;
+	const float REDUCE_1     = 0.78515625f;
+	const float REDUCE_2     = 2.4187564849853515625e-4f;
+	const float REDUCE_3     = 3.77489497744594108e-8f;
+
+	const float COS_0 = 2.443315711809948e-5f;
+	const float COS_1 = -1.388731625493765e-3f;
+	const float COS_2 = 4.166664568298827e-2f;
+	const float SIN_0 = -1.9515295891e-4f;
+	const float SIN_1 = 8.3321608736e-3f;
+	const float SIN_2 = -1.6666654611e-1f;
+
+	void SinCos(float x, float* s, float* c)
+	{
+		const bool negative = std::signbit(x);
+		float a = std::fabs(x);
+
+		// the octant, rounded up to even so that the reduced angle lies in [-pi/4, pi/4]
+		const int32_t j = (static_cast<int32_t>(a * FOUR_OVER_PI) + 1) & ~1;
+		const float y = static_cast<float>(j);
+
+		a = ((a - y * REDUCE_1) - y * REDUCE_2) - y * REDUCE_3;
+
+		const float z = a * a;
+		const float p_cos = (((COS_0 * z + COS_1) * z + COS_2) * z * z - 0.5f * z) + 1.0f;
+		const float p_sin = ((SIN_0 * z + SIN_1) * z + SIN_2) * z * a + a;
+
+		const bool swap = (j & 2) != 0;
+		float r_sin = swap ? p_cos : p_sin;
+		float r_cos = swap ? p_sin : p_cos;
+
+		if (negative != ((j & 4) != 0))
+		{
+			r_sin = -r_sin;
+		}
+
+		if (((j - 2) & 4) == 0)
+		{
+			r_cos = -r_cos;
+		}
+
+		*s = r_sin;
+		*c = r_cos;
+	}
+
+#if defined(SIMD_X86)
+	inline void SinCos4(__m128 x, __m128* s, __m128* c)
+	{
+		const __m128 sign_mask = _mm_castsi128_ps(_mm_set1_epi32(0x80000000));
+
+		__m128 sin_sign = _mm_and_ps(x, sign_mask);
+		x = _mm_andnot_ps(sign_mask, x);
+
+		__m128i j = _mm_cvttps_epi32(_mm_mul_ps(x, _mm_set1_ps(FOUR_OVER_PI)));
+		j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+		const __m128 y = _mm_cvtepi32_ps(j);
+
+		sin_sign = _mm_xor_ps(sin_sign, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+		const __m128 cos_sign = _mm_castsi128_ps(_mm_slli_epi32(_mm_andnot_si128(_mm_sub_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+		const __m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_1)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_2)));
+		x = _mm_sub_ps(x, _mm_mul_ps(y, _mm_set1_ps(REDUCE_3)));
+
+		const __m128 z = _mm_mul_ps(x, x);
+
+		__m128 p_cos = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(COS_0), z), _mm_set1_ps(COS_1));
+		p_cos = _mm_add_ps(_mm_mul_ps(p_cos, z), _mm_set1_ps(COS_2));
+		p_cos = _mm_mul_ps(_mm_mul_ps(p_cos, z), z);
+		p_cos = _mm_add_ps(_mm_sub_ps(p_cos, _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_set1_ps(1.0f));
+
+		__m128 p_sin = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(SIN_0), z), _mm_set1_ps(SIN_1));
+		p_sin = _mm_add_ps(_mm_mul_ps(p_sin, z), _mm_set1_ps(SIN_2));
+		p_sin = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p_sin, z), x), x);
+
+		*s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, p_cos), _mm_andnot_ps(swap, p_sin)), sin_sign);
+		*c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, p_sin), _mm_andnot_ps(swap, p_cos)), cos_sign);
+	}
+#endif
+
+	void SinCosBatch(const float* x, float* s, float* c, size_t n)
+	{
+		size_t i = 0;
+
+#if defined(SIMD_X86)
+		for (; i + 4 <= n; i += 4)
+		{
+			__m128 v_s, v_c;
+			SinCos4(_mm_loadu_ps(x + i), &v_s, &v_c);
+
+			_mm_storeu_ps(s + i, v_s);
+			_mm_storeu_ps(c + i, v_c);
+		}
+#endif
+
+		for (; i < n; i++)
+		{
+			SinCos(x[i], s + i, c + i);
+		}
+	}
+}
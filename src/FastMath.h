@@ -0,0 +1,19 @@
+#pragma once
+
+#include "Common.h"
+
+/*
+* sin and cos for batches of angles, using the cephes single precision polynomials after a cody-waite reduction
+* to [-pi/4, pi/4]. for |x| <= 8192 the error is at most MAX_SINCOS_ERROR (absolute), measured against double
+* precision by -benchmark-rotations. larger angles lose accuracy in the reduction. the scalar and the sse2 paths
+* perform the same float operations, so they give bit identical results.
+*/
+namespace FastMath
+{
+	const float MAX_SINCOS_ERROR = 1.0e-7f;  // 7.8e-8 measured
+	const float MAX_SINCOS_ARGUMENT = 8192.0f;
+
+	void SinCos(float x, float* s, float* c);
+
+	void SinCosBatch(const float* x, float* s, float* c, size_t n);
+}
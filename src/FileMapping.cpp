@@ -0,0 +1,166 @@
+#include "FileMapping.h"
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+FileMapping::FileMapping()
+{
+#if defined(_WIN32)
+	m_hFile = INVALID_HANDLE_VALUE;
+	m_hMapping = NULL;
+#else
+	m_File = -1;
+#endif
+	m_pView = NULL;
+	m_Size = 0;
+}
+
+FileMapping::~FileMapping()
+{
+	Close();
+}
+
+INT FileMapping::Open(const char* path)
+{
+	INT status = STATUS_SUCCESS;
+
+	Close();
+
+#if defined(_WIN32)
+	LARGE_INTEGER size = {};
+
+	m_hFile = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if ((m_hFile == INVALID_HANDLE_VALUE) || !GetFileSizeEx(m_hFile, &size))
+	{
+		status = HRESULT_FROM_WIN32(GetLastError());
+	}
+
+	m_Size = static_cast<uint64_t>(size.QuadPart);
+#else
+	struct stat info = {};
+
+	m_File = open(path, O_RDONLY | O_CLOEXEC);
+	if ((m_File == -1) || (fstat(m_File, &info) != 0))
+	{
+		status = GetErrnoStatus();
+	}
+
+	m_Size = static_cast<uint64_t>(info.st_size);
+#endif
+
+	if (FAILED(status))
+	{
+		Close();
+	}
+
+	return status;
+}
+
+INT FileMapping::Map()
+{
+	INT status = STATUS_SUCCESS;
+
+	if (m_Size == 0)
+	{
+		status = STATUS_DATA_ERROR;
+	}
+
+#if defined(_WIN32)
+	if (SUCCEEDED(status))
+	{
+		m_hMapping = CreateFileMappingA(m_hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		m_pView = (m_hMapping != NULL) ? static_cast<const BYTE*>(MapViewOfFile(m_hMapping, FILE_MAP_READ, 0, 0, 0)) : NULL;
+
+		if (m_pView == NULL)
+		{
+			status = HRESULT_FROM_WIN32(GetLastError());
+		}
+	}
+#else
+	if (SUCCEEDED(status))
+	{
+		VOID* pView = mmap(NULL, static_cast<size_t>(m_Size), PROT_READ, MAP_SHARED, m_File, 0);
+
+		if (pView == MAP_FAILED)
+		{
+			status = GetErrnoStatus();
+		}
+		else
+		{
+			m_pView = static_cast<const BYTE*>(pView);
+		}
+	}
+#endif
+
+	return status;
+}
+
+VOID FileMapping::Close()
+{
+#if defined(_WIN32)
+	if (m_pView != NULL)
+	{
+		UnmapViewOfFile(m_pView);
+	}
+
+	if (m_hMapping != NULL)
+	{
+		CloseHandle(m_hMapping);
+		m_hMapping = NULL;
+	}
+
+	if (m_hFile != INVALID_HANDLE_VALUE)
+	{
+		CloseHandle(m_hFile);
+		m_hFile = INVALID_HANDLE_VALUE;
+	}
+#else
+	if (m_pView != NULL)
+	{
+		munmap(const_cast<BYTE*>(m_pView), static_cast<size_t>(m_Size));
+	}
+
+	if (m_File != -1)
+	{
+		close(m_File);
+		m_File = -1;
+	}
+#endif
+
+	m_pView = NULL;
+	m_Size = 0;
+}
+
+// only valid between Map and Close
+const BYTE* FileMapping::GetData()
+{
+	return m_pView;
+}
+
+uint64_t FileMapping::GetSize()
+{
+	return m_Size;
+}
+
+INT MoveFileOver(const char* tempPath, const char* path)
+{
+	INT status = STATUS_SUCCESS;
+
+#if defined(_WIN32)
+	if (!MoveFileExA(tempPath, path, MOVEFILE_REPLACE_EXISTING))
+	{
+		status = HRESULT_FROM_WIN32(GetLastError());
+	}
+#else
+	// rename replaces path in one step, open descriptors and mappings of the old file stay valid
+	if (rename(tempPath, path) != 0)
+	{
+		status = GetErrnoStatus();
+	}
+#endif
+
+	return status;
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Platform.h"
+
+/*
+* a whole file mapped read only, for the packs the application reads in place. Open only opens the file so that its
+* size can be checked first, Map then maps all of it. the file may be replaced while it is mapped, the view keeps the
+* old contents until Close. empty files cannot be mapped.
+*/
+class FileMapping
+{
+private:
+#if defined(_WIN32)
+	HANDLE      m_hFile;
+	HANDLE      m_hMapping;
+#else
+	int         m_File;
+#endif
+	const BYTE* m_pView;
+	uint64_t    m_Size;
+
+public:
+	FileMapping();
+	~FileMapping();
+
+	INT  Open(const char* path);
+	INT  Map();
+	VOID Close();
+
+	const BYTE* GetData();
+	uint64_t    GetSize();
+};
+
+// moves a complete temporary file over path. readers that have the old file mapped keep their view of it
+INT MoveFileOver(const char* tempPath, const char* path);
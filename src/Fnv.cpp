@@ -0,0 +1,22 @@
+#include "Fnv.h"
+
+namespace Fnv
+{
+	uint64_t Hash(const void* pData, size_t size, uint64_t hash)
+	{
+		const BYTE* pBytes = static_cast<const BYTE*>(pData);
+
+		for (size_t i = 0; i < size; i++)
+		{
+			hash = (hash ^ pBytes[i]) * 0x100000001B3ULL;
+		}
+
+		return hash;
+	}
+
+	uint32_t Checksum(const void* pData, size_t size)
+	{
+		const uint64_t hash = Hash(pData, size, OFFSET_BASIS);
+		return static_cast<uint32_t>(hash ^ (hash >> 32));
+	}
+}
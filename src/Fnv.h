@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Common.h"
+
+// fnv-1a, for the keys and checksums of the files the application writes
+namespace Fnv
+{
+	const uint64_t OFFSET_BASIS = 0xCBF29CE484222325ULL;
+
+	// chained through the hash argument
+	uint64_t Hash(const void* pData, size_t size, uint64_t hash);
+
+	uint32_t Checksum(const void* pData, size_t size);
+}
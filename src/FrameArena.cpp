@@ -0,0 +1,172 @@
+#include "FrameArena.h"
+#include "JobSystem.h"
+
+FrameArena::FrameArena()
+{
+	for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		for (unsigned int thread = 0; thread < JobSystem::MAX_SLOTS; thread++)
+		{
+			Arena& arena = m_Arenas[frame][thread];
+
+			arena.pBase = NULL;
+			arena.capacity = 0;
+			arena.offset = 0;
+			arena.used = 0;
+			arena.overflow_count = 0;
+			arena.overflow_bytes = 0;
+			arena.heap_allocations = 0;
+		}
+	}
+
+	m_pJobs = NULL;
+	m_Frame = 0;
+	m_HighWater = 0;
+}
+
+FrameArena::~FrameArena()
+{
+	Uninitialize();
+}
+
+// capacity is for the arena of the calling thread in every frame, the arenas of the workers start empty.
+// the threads that allocate are told apart by their slots in jobs
+VOID FrameArena::Initialize(size_t capacity, JobSystem& jobs)
+{
+	Uninitialize();
+
+	m_pJobs = &jobs;
+
+	for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		Reserve(m_Arenas[frame][0], capacity);
+	}
+}
+
+VOID FrameArena::Uninitialize()
+{
+	for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		for (unsigned int thread = 0; thread < JobSystem::MAX_SLOTS; thread++)
+		{
+			Arena& arena = m_Arenas[frame][thread];
+
+			Release(arena);
+			delete[] arena.pBase;
+
+			arena.pBase = NULL;
+			arena.capacity = 0;
+			arena.overflow_count = 0;
+			arena.overflow_bytes = 0;
+			arena.heap_allocations = 0;
+		}
+	}
+
+	m_Frame = 0;
+	m_HighWater = 0;
+}
+
+// only while no job allocates, everything handed out FRAME_COUNT frames ago is reused from here on
+VOID FrameArena::BeginFrame()
+{
+	m_HighWater = std::max(m_HighWater, GetStatistics().used);
+	m_Frame = (m_Frame + 1) % FRAME_COUNT;
+
+	for (unsigned int thread = 0; thread < JobSystem::MAX_SLOTS; thread++)
+	{
+		Arena& arena = m_Arenas[m_Frame][thread];
+
+		if (arena.used > arena.capacity)
+		{
+			Reserve(arena, std::max(arena.used, 2 * arena.capacity));
+		}
+
+		Release(arena);
+	}
+}
+
+// never fails unless the heap does, memory is uninitialized
+VOID* FrameArena::Allocate(size_t size, size_t alignment)
+{
+	Arena& arena = m_Arenas[m_Frame][m_pJobs->GetWorkerIndex()];
+
+	// aligned by address, the blocks only come with the alignment of new
+	const uintptr_t base = reinterpret_cast<uintptr_t>(arena.pBase);
+	const size_t offset = ((base + arena.offset + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1)) - base;
+
+	if ((arena.pBase != NULL) && (offset + size <= arena.capacity))
+	{
+		arena.used += offset + size - arena.offset;
+		arena.offset = offset + size;
+
+		return arena.pBase + offset;
+	}
+
+	BYTE* pBlock = new (std::nothrow) BYTE[size + alignment];
+
+	if (pBlock == NULL)
+	{
+		return NULL;
+	}
+
+	arena.overflows.push_back(pBlock);
+	arena.used += size + alignment;
+	arena.overflow_count++;
+	arena.overflow_bytes += size;
+	arena.heap_allocations++;
+
+	return reinterpret_cast<VOID*>((reinterpret_cast<uintptr_t>(pBlock) + alignment - 1) & ~static_cast<uintptr_t>(alignment - 1));
+}
+
+// only while no job allocates
+FrameArena::Statistics FrameArena::GetStatistics()
+{
+	Statistics statistics = {};
+
+	statistics.high_water = m_HighWater;
+
+	for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+	{
+		for (unsigned int thread = 0; thread < JobSystem::MAX_SLOTS; thread++)
+		{
+			const Arena& arena = m_Arenas[frame][thread];
+
+			if (frame == m_Frame)
+			{
+				statistics.used += arena.used;
+				statistics.capacity += arena.capacity;
+			}
+
+			statistics.overflow_count += arena.overflow_count;
+			statistics.overflow_bytes += arena.overflow_bytes;
+			statistics.heap_allocations += arena.heap_allocations;
+		}
+	}
+
+	return statistics;
+}
+
+// replaces the block of the arena, which has to be empty, with one of at least capacity bytes
+VOID FrameArena::Reserve(Arena& arena, size_t capacity)
+{
+	capacity = (capacity + GROWTH_GRANULE - 1) / GROWTH_GRANULE * GROWTH_GRANULE;
+
+	delete[] arena.pBase;
+
+	arena.pBase = new (std::nothrow) BYTE[capacity];
+	arena.capacity = (arena.pBase != NULL) ? capacity : 0;
+	arena.heap_allocations++;
+}
+
+// empties the arena and frees its overflows
+VOID FrameArena::Release(Arena& arena)
+{
+	for (BYTE* pBlock : arena.overflows)
+	{
+		delete[] pBlock;
+	}
+
+	arena.overflows.clear();
+	arena.offset = 0;
+	arena.used = 0;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Common.h"
+#include "JobSystem.h"
+
+/*
+* scratch memory for the data of one frame. every frame in flight has its own arenas, one for each thread of the job
+* system, and an allocation bumps the offset of the arena of the calling thread, so workers never contend. BeginFrame
+* recycles the arenas of the oldest frame: memory handed out stays valid through the next FRAME_COUNT - 1 calls,
+* long enough for the gpu to be done with it.
+*
+* an arena that runs out serves the rest of its frame from the heap and counts it as an overflow. when the frame is
+* recycled the arena grows to what it was asked for, and at least to twice its size since stealing hands a worker a
+* different share of the jobs every frame. once the arenas have settled a frame no longer touches the heap. arena 0
+* belongs to the thread that initialized the job system, the one that calls BeginFrame.
+*/
+class FrameArena
+{
+public:
+	enum {
+		FRAME_COUNT       = 3,
+		DEFAULT_ALIGNMENT = 16,
+		GROWTH_GRANULE    = 64 * 1024 // arenas grow in whole granules
+	};
+
+	struct Statistics
+	{
+		size_t used;             // by the current frame, over all arenas and overflows
+		size_t capacity;         // of the arenas of the current frame
+		size_t high_water;       // the most a finished frame used
+		size_t overflow_count;   // allocations served by the heap since Initialize
+		size_t overflow_bytes;
+		size_t heap_allocations; // arena blocks and overflows since Initialize
+	};
+
+private:
+	// a cache line each, the arenas of a frame are written by different threads
+	struct alignas(64) Arena
+	{
+		BYTE*              pBase;
+		size_t             capacity;
+		size_t             offset;
+		size_t             used;       // offset plus the overflows of the frame
+		std::vector<BYTE*> overflows;
+		size_t             overflow_count;
+		size_t             overflow_bytes;
+		size_t             heap_allocations;
+	};
+
+	Arena        m_Arenas[FRAME_COUNT][JobSystem::MAX_SLOTS];
+	JobSystem*   m_pJobs;
+	unsigned int m_Frame;
+	size_t       m_HighWater;
+
+public:
+	FrameArena();
+	~FrameArena();
+
+	VOID Initialize(size_t capacity, JobSystem& jobs);
+	VOID Uninitialize();
+
+	VOID  BeginFrame();
+	VOID* Allocate(size_t size, size_t alignment = DEFAULT_ALIGNMENT);
+
+	template <typename T>
+	T* Allocate(size_t count)
+	{
+		return static_cast<T*>(Allocate(count * sizeof(T), std::max<size_t>(alignof(T), DEFAULT_ALIGNMENT)));
+	}
+
+	Statistics GetStatistics();
+
+private:
+	VOID Reserve(Arena& arena, size_t capacity);
+	VOID Release(Arena& arena);
+};
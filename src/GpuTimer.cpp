@@ -0,0 +1,118 @@
+#include "GpuTimer.h"
+#include "Log.h"
+#include "Profiler.h"
+
+GpuTimer::GpuTimer()
+{
+	ZeroMemory(m_Frames, sizeof(m_Frames));
+	m_Index = 0;
+}
+
+INT GpuTimer::Initialize(ID3D11Device* pDevice)
+{
+	INT status = STATUS_SUCCESS;
+
+	D3D11_QUERY_DESC disjointDesc = { D3D11_QUERY_TIMESTAMP_DISJOINT, 0 };
+	D3D11_QUERY_DESC timestampDesc = { D3D11_QUERY_TIMESTAMP, 0 };
+
+	for (unsigned int i = 0; (i < FRAME_LATENCY) && SUCCEEDED(status); i++)
+	{
+		status = pDevice->CreateQuery(&disjointDesc, &m_Frames[i].pDisjoint);
+
+		if (SUCCEEDED(status))
+		{
+			status = pDevice->CreateQuery(&timestampDesc, &m_Frames[i].pBegin);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = pDevice->CreateQuery(&timestampDesc, &m_Frames[i].pEnd);
+		}
+	}
+
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: could not create the timestamp queries\n", status);
+	}
+
+	return status;
+}
+
+VOID GpuTimer::Uninitialize()
+{
+	for (unsigned int i = 0; i < FRAME_LATENCY; i++)
+	{
+		ID3D11Query** queries[] = { &m_Frames[i].pDisjoint, &m_Frames[i].pBegin, &m_Frames[i].pEnd };
+
+		for (ID3D11Query** ppQuery : queries)
+		{
+			if (*ppQuery != NULL)
+			{
+				(*ppQuery)->Release();
+				*ppQuery = NULL;
+			}
+		}
+
+		m_Frames[i].pending = false;
+	}
+}
+
+VOID GpuTimer::Begin(ID3D11DeviceContext* pContext)
+{
+	Frame& frame = m_Frames[m_Index];
+
+	if (frame.pDisjoint == NULL)
+	{
+		return;
+	}
+
+	// the slot is reused, so its previous frame has to be read back first
+	if (frame.pending)
+	{
+		Collect(pContext, frame);
+	}
+
+	frame.submitted = Profiler::Now();
+
+	pContext->Begin(frame.pDisjoint);
+	pContext->End(frame.pBegin);
+}
+
+VOID GpuTimer::End(ID3D11DeviceContext* pContext)
+{
+	Frame& frame = m_Frames[m_Index];
+
+	if (frame.pDisjoint == NULL)
+	{
+		return;
+	}
+
+	pContext->End(frame.pEnd);
+	pContext->End(frame.pDisjoint);
+
+	frame.pending = true;
+	m_Index = (m_Index + 1) % FRAME_LATENCY;
+}
+
+VOID GpuTimer::Collect(ID3D11DeviceContext* pContext, Frame& frame)
+{
+	D3D11_QUERY_DATA_TIMESTAMP_DISJOINT disjoint = {};
+	UINT64 begin = 0, end = 0;
+
+	frame.pending = false;
+
+	// results that are still not available after FRAME_LATENCY frames are dropped instead of stalling
+	if ((pContext->GetData(frame.pDisjoint, &disjoint, sizeof(disjoint), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) || disjoint.Disjoint)
+	{
+		return;
+	}
+
+	if ((pContext->GetData(frame.pBegin, &begin, sizeof(begin), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK) ||
+		(pContext->GetData(frame.pEnd, &end, sizeof(end), D3D11_ASYNC_GETDATA_DONOTFLUSH) != S_OK))
+	{
+		return;
+	}
+
+	const uint64_t duration = static_cast<uint64_t>((end - begin) * 1e9 / disjoint.Frequency);
+	Profiler::Record("gpu frame", frame.submitted, frame.submitted + duration, Profiler::GPU_THREAD_ID);
+}
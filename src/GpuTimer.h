@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Common.h"
+
+/*
+* measures the gpu time of each frame with timestamp queries. the results are read back FRAME_LATENCY frames later so
+* the cpu never waits for the gpu, and they are recorded on the profiler's gpu track starting at the cpu time at which
+* the frame was submitted.
+*/
+class GpuTimer
+{
+private:
+	enum {
+		FRAME_LATENCY = 4
+	};
+
+	struct Frame
+	{
+		ID3D11Query* pDisjoint;
+		ID3D11Query* pBegin;
+		ID3D11Query* pEnd;
+		uint64_t     submitted;
+		bool         pending;
+	};
+
+	Frame        m_Frames[FRAME_LATENCY];
+	unsigned int m_Index;
+
+public:
+	GpuTimer();
+
+	INT  Initialize(ID3D11Device* pDevice);
+	VOID Uninitialize();
+
+	VOID Begin(ID3D11DeviceContext* pContext);
+	VOID End(ID3D11DeviceContext* pContext);
+
+private:
+	VOID Collect(ID3D11DeviceContext* pContext, Frame& frame);
+};
@@ -0,0 +1,64 @@
+#include "InstanceUploader.h"
+#include "Log.h"
+
+#if defined(_WIN32)
+
+D3DInstanceUploader::D3DInstanceUploader(ID3D11DeviceContext* pContext, ID3D11Buffer* pBuffer)
+{
+	m_pContext = pContext;
+	m_pBuffer = pBuffer;
+}
+
+INT D3DInstanceUploader::Upload(const void* pData, size_t size)
+{
+	INT status = STATUS_SUCCESS;
+
+	D3D11_MAPPED_SUBRESOURCE mapped = {};
+	status = m_pContext->Map(m_pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+
+	if (SUCCEEDED(status))
+	{
+		CopyMemory(mapped.pData, pData, size);
+		m_pContext->Unmap(m_pBuffer, 0);
+	}
+	else
+	{
+		WriteToConsole("error 0x%X: could not map the instance buffer\n", status);
+	}
+
+	return status;
+}
+
+#endif
+
+RecordingInstanceUploader::RecordingInstanceUploader()
+{
+	m_UploadCount = 0;
+	m_ByteCount = 0;
+}
+
+INT RecordingInstanceUploader::Upload(const void* pData, size_t size)
+{
+	const BYTE* pBytes = static_cast<const BYTE*>(pData);
+	m_LastUpload.assign(pBytes, pBytes + size);
+
+	m_UploadCount++;
+	m_ByteCount += size;
+
+	return STATUS_SUCCESS;
+}
+
+const std::vector<BYTE>& RecordingInstanceUploader::GetLastUpload()
+{
+	return m_LastUpload;
+}
+
+uint64_t RecordingInstanceUploader::GetUploadCount()
+{
+	return m_UploadCount;
+}
+
+uint64_t RecordingInstanceUploader::GetByteCount()
+{
+	return m_ByteCount;
+}
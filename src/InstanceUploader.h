@@ -0,0 +1,47 @@
+#pragma once
+
+#include "Common.h"
+
+// receives the per-frame instance stream, so the instance store can be driven without a d3d device
+class InstanceUploader
+{
+public:
+	virtual ~InstanceUploader() {}
+
+	virtual INT Upload(const void* pData, size_t size) = 0;
+};
+
+#if defined(_WIN32)
+
+// uploads into a dynamic d3d buffer, discarding its previous contents
+class D3DInstanceUploader : public InstanceUploader
+{
+private:
+	ID3D11DeviceContext* m_pContext;
+	ID3D11Buffer*        m_pBuffer;
+
+public:
+	D3DInstanceUploader(ID3D11DeviceContext* pContext, ID3D11Buffer* pBuffer);
+
+	INT Upload(const void* pData, size_t size);
+};
+
+#endif
+
+// keeps the uploaded bytes in memory instead of sending them to a device, used by the headless renderer
+class RecordingInstanceUploader : public InstanceUploader
+{
+private:
+	std::vector<BYTE> m_LastUpload;
+	uint64_t          m_UploadCount;
+	uint64_t          m_ByteCount;
+
+public:
+	RecordingInstanceUploader();
+
+	INT Upload(const void* pData, size_t size);
+
+	const std::vector<BYTE>& GetLastUpload();
+	uint64_t GetUploadCount();
+	uint64_t GetByteCount();
+};
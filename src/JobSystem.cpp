@@ -0,0 +1,536 @@
+#include "JobSystem.h"
+#include "Log.h"
+#include "Profiler.h"
+
+std::atomic<uint64_t> JobSystem::s_NextSerial(1);
+thread_local JobSystem::Slot JobSystem::s_Slot = { 0, 0 };
+std::mutex JobSystem::s_SystemsLock;
+std::vector<JobSystem*> JobSystem::s_Systems;
+
+// threads outside the pool come and go (a restarted simulation thread, the threads of a test), so their slots are
+// given back when they exit. a system that was uninitialized since is no longer listed and is skipped
+JobSystem::ThreadSlots::~ThreadSlots()
+{
+	const std::thread::id thread = std::this_thread::get_id();
+
+	std::lock_guard<std::mutex> lock(s_SystemsLock);
+
+	for (const Slot& slot : slots)
+	{
+		for (JobSystem* pSystem : s_Systems)
+		{
+			if (pSystem->m_Serial == slot.system)
+			{
+				pSystem->Release(slot.index, thread);
+			}
+		}
+	}
+}
+
+JobSystem::Queue::Queue()
+{
+	for (unsigned int i = 0; i < QUEUE_SIZE; i++)
+	{
+		m_Jobs[i] = NULL;
+	}
+
+	m_Top = 0;
+	m_Bottom = 0;
+}
+
+// owner only
+bool JobSystem::Queue::Push(Job* pJob)
+{
+	const size_t bottom = m_Bottom.load(std::memory_order_relaxed);
+	const size_t top = m_Top.load(std::memory_order_acquire);
+
+	if (bottom - top >= QUEUE_SIZE)
+	{
+		return false;
+	}
+
+	m_Jobs[bottom % QUEUE_SIZE].store(pJob, std::memory_order_relaxed);
+	m_Bottom.store(bottom + 1, std::memory_order_release);
+
+	return true;
+}
+
+// owner only, takes the most recently pushed job
+JobSystem::Job* JobSystem::Queue::Pop()
+{
+	const size_t bottom = m_Bottom.load(std::memory_order_relaxed);
+	size_t top = m_Top.load(std::memory_order_relaxed);
+
+	if (bottom == top)
+	{
+		return NULL;
+	}
+
+	m_Bottom.store(bottom - 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	top = m_Top.load(std::memory_order_relaxed);
+
+	Job* pJob = NULL;
+
+	if (top < bottom)
+	{
+		pJob = m_Jobs[(bottom - 1) % QUEUE_SIZE].load(std::memory_order_relaxed);
+
+		// the last job may be stolen at the same time, whoever moves top first gets it
+		if (top == bottom - 1)
+		{
+			if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+			{
+				pJob = NULL;
+			}
+
+			m_Bottom.store(bottom, std::memory_order_relaxed);
+		}
+	}
+	else
+	{
+		m_Bottom.store(bottom, std::memory_order_relaxed);
+	}
+
+	return pJob;
+}
+
+// any thread, takes the oldest job
+JobSystem::Job* JobSystem::Queue::Steal()
+{
+	size_t top = m_Top.load(std::memory_order_acquire);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	const size_t bottom = m_Bottom.load(std::memory_order_acquire);
+
+	if (top >= bottom)
+	{
+		return NULL;
+	}
+
+	Job* pJob = m_Jobs[top % QUEUE_SIZE].load(std::memory_order_relaxed);
+
+	if (!m_Top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+	{
+		return NULL;
+	}
+
+	return pJob;
+}
+
+JobSystem::JobSystem()
+{
+	m_Serial = 0;
+	m_ThreadCount = 0;
+	m_Running = false;
+	m_Signal = 0;
+	m_Sleeping = 0;
+}
+
+JobSystem::~JobSystem()
+{
+	Uninitialize();
+}
+
+// threadCount includes the thread that submits the jobs, 1 runs every job on that thread
+INT JobSystem::Initialize(unsigned int threadCount)
+{
+	INT status = STATUS_SUCCESS;
+
+	if ((threadCount == 0) || (threadCount > MAX_THREADS))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: the job system supports 1 to %u threads\n", status, MAX_THREADS);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		// the slots are all created up front, thieves walk them without a lock
+		for (unsigned int i = 0; i < threadCount + EXTRA_THREADS; i++)
+		{
+			std::unique_ptr<Worker> worker(new Worker());
+			worker->pool.push_back(std::unique_ptr<Job[]>(new Job[POOL_SIZE]()));
+			worker->next_job = 0;
+			worker->random = 0x9E3779B9 * (i + 1);
+
+			m_Workers.push_back(std::move(worker));
+		}
+
+		m_Serial = s_NextSerial.fetch_add(1);
+		m_ThreadCount = threadCount;
+		m_Running = true;
+
+		m_Workers[0]->thread = std::this_thread::get_id();
+		s_Slot.system = m_Serial;
+		s_Slot.index = 0;
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		for (unsigned int i = 1; i < threadCount; i++)
+		{
+			m_Threads.push_back(std::thread(&JobSystem::Run, this, i));
+			m_Workers[i]->thread = m_Threads.back().get_id();
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		std::lock_guard<std::mutex> lock(s_SystemsLock);
+		s_Systems.push_back(this);
+	}
+
+	return status;
+}
+
+VOID JobSystem::Uninitialize()
+{
+	{
+		std::lock_guard<std::mutex> lock(s_SystemsLock);
+		s_Systems.erase(std::remove(s_Systems.begin(), s_Systems.end(), this), s_Systems.end());
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Running = false;
+	}
+
+	m_WakeUp.notify_all();
+
+	for (std::thread& thread : m_Threads)
+	{
+		thread.join();
+	}
+
+	m_Threads.clear();
+	m_Workers.clear();
+	m_ThreadCount = 0;
+}
+
+unsigned int JobSystem::GetThreadCount()
+{
+	return m_ThreadCount;
+}
+
+// the slot of the calling thread, below GetThreadCount for the thread that initialized the system and the pool
+unsigned int JobSystem::GetWorkerIndex()
+{
+	if (s_Slot.system != m_Serial)
+	{
+		s_Slot.index = Attach();
+		s_Slot.system = m_Serial;
+	}
+
+	return s_Slot.index;
+}
+
+// finds the slot of the calling thread or hands it a free one
+unsigned int JobSystem::Attach()
+{
+	const std::thread::id thread = std::this_thread::get_id();
+	const unsigned int count = static_cast<unsigned int>(m_Workers.size());
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		if (m_Workers[i]->thread == thread)
+		{
+			return i;
+		}
+	}
+
+	unsigned int index = m_ThreadCount;
+	while ((index < count) && (m_Workers[index]->thread != std::thread::id()))
+	{
+		index++;
+	}
+
+	// every other slot would be out of bounds or belong to another thread
+	if (index == count)
+	{
+		WriteToConsole("error: more than %u threads outside of the pool use the job system at the same time\n", EXTRA_THREADS);
+		Log::Stop();
+		std::abort();
+	}
+
+	m_Workers[index]->thread = thread;
+
+	static thread_local ThreadSlots claimed;
+	claimed.slots.push_back(Slot{ m_Serial, index });
+
+	return index;
+}
+
+// frees the slot if thread still owns it
+VOID JobSystem::Release(unsigned int index, std::thread::id thread)
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if ((index < m_Workers.size()) && (m_Workers[index]->thread == thread))
+	{
+		m_Workers[index]->thread = std::thread::id();
+	}
+}
+
+// a job is free again once it and its pieces have finished and no Wait of the slot's owner is still looking at it. the
+// blocks are walked round robin, so a finished job is only reused after every other job of the slot, and a block is
+// added when all of them are alive
+JobSystem::Job* JobSystem::Allocate()
+{
+	Worker& worker = *m_Workers[GetWorkerIndex()];
+	const size_t capacity = worker.pool.size() * POOL_SIZE;
+
+	Job* pJob = NULL;
+
+	for (size_t i = 0; (i < capacity) && (pJob == NULL); i++)
+	{
+		const size_t index = worker.next_job++ % capacity;
+		Job* pCandidate = &worker.pool[index / POOL_SIZE][index % POOL_SIZE];
+
+		if ((pCandidate->unfinished.load(std::memory_order_acquire) == 0) &&
+			(std::find(worker.waiting.begin(), worker.waiting.end(), pCandidate) == worker.waiting.end()))
+		{
+			pJob = pCandidate;
+		}
+	}
+
+	if (pJob == NULL)
+	{
+		worker.pool.push_back(std::unique_ptr<Job[]>(new Job[POOL_SIZE]()));
+		worker.next_job = capacity + 1;
+
+		pJob = &worker.pool.back()[0];
+	}
+
+	pJob->pParent = NULL;
+	pJob->unfinished = 1;
+	pJob->dependencies = 1;
+	pJob->continuation_count = 0;
+
+	return pJob;
+}
+
+// the job runs function over [0, count) in pieces of at least grain objects, split at multiples of grain
+JobSystem::Job* JobSystem::CreateParallelFor(const char* name, JobFunction function, VOID* pData, size_t count, size_t grain)
+{
+	Job* pJob = Allocate();
+
+	pJob->name = name;
+	pJob->function = function;
+	pJob->pData = pData;
+	pJob->begin = 0;
+	pJob->end = count;
+	pJob->grain = std::max<size_t>(grain, 1);
+
+	return pJob;
+}
+
+// pAfter only starts once pBefore and all of its pieces have finished
+INT JobSystem::AddDependency(Job* pBefore, Job* pAfter)
+{
+	INT status = STATUS_SUCCESS;
+
+	if (pBefore->continuation_count == MAX_CONTINUATIONS)
+	{
+		status = STATUS_BUFFER_TOO_SMALL;
+		WriteToConsole("error 0x%X: %s already has %u dependent jobs\n", status, pBefore->name, MAX_CONTINUATIONS);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		pBefore->pContinuations[pBefore->continuation_count++] = pAfter;
+		pAfter->dependencies++;
+	}
+
+	return status;
+}
+
+VOID JobSystem::Submit(Job* pJob)
+{
+	if (pJob->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		Push(pJob);
+	}
+}
+
+// runs jobs on the calling thread until pJob has finished. the jobs it runs allocate from the slot of this thread,
+// which pJob came from, so pJob is kept from being reused under the loop
+VOID JobSystem::Wait(Job* pJob)
+{
+	std::vector<Job*>& waiting = m_Workers[GetWorkerIndex()]->waiting;
+	waiting.push_back(pJob);
+
+	while (pJob->unfinished.load(std::memory_order_acquire) > 0)
+	{
+		Job* pNext = GetJob();
+
+		if (pNext != NULL)
+		{
+			Execute(pNext);
+		}
+		else
+		{
+			std::this_thread::yield();
+		}
+	}
+
+	waiting.pop_back();
+}
+
+VOID JobSystem::ParallelFor(const char* name, JobFunction function, VOID* pData, size_t count, size_t grain)
+{
+	Job* pJob = CreateParallelFor(name, function, pData, count, grain);
+
+	Submit(pJob);
+	Wait(pJob);
+}
+
+VOID JobSystem::Push(Job* pJob)
+{
+	if (!m_Workers[GetWorkerIndex()]->queue.Push(pJob))
+	{
+		Execute(pJob);
+		return;
+	}
+
+	m_Signal.fetch_add(1);
+
+	if (m_Sleeping.load() != 0)
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_WakeUp.notify_one();
+	}
+}
+
+JobSystem::Job* JobSystem::GetJob()
+{
+	const unsigned int index = GetWorkerIndex();
+	Worker& worker = *m_Workers[index];
+
+	Job* pJob = worker.queue.Pop();
+	if (pJob != NULL)
+	{
+		return pJob;
+	}
+
+	// xorshift, starting at a random victim keeps the thieves from piling onto the same queue
+	worker.random ^= worker.random << 13;
+	worker.random ^= worker.random >> 17;
+	worker.random ^= worker.random << 5;
+
+	const size_t count = m_Workers.size();
+	for (size_t i = 0; i < count; i++)
+	{
+		const size_t victim = (worker.random + i) % count;
+
+		if (victim != index)
+		{
+			pJob = m_Workers[victim]->queue.Steal();
+
+			if (pJob != NULL)
+			{
+				return pJob;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+VOID JobSystem::Execute(Job* pJob)
+{
+	// split off the upper half until one grain is left, the halves can be stolen while this thread goes on
+	while (pJob->end - pJob->begin > pJob->grain)
+	{
+		const size_t grains = (pJob->end - pJob->begin + pJob->grain - 1) / pJob->grain;
+		const size_t middle = pJob->begin + (grains / 2) * pJob->grain;
+
+		Job* pHalf = Allocate();
+		pHalf->name = pJob->name;
+		pHalf->function = pJob->function;
+		pHalf->pData = pJob->pData;
+		pHalf->begin = middle;
+		pHalf->end = pJob->end;
+		pHalf->grain = pJob->grain;
+		pHalf->pParent = pJob;
+		pHalf->dependencies = 0;
+
+		pJob->unfinished.fetch_add(1, std::memory_order_relaxed);
+		pJob->end = middle;
+
+		Push(pHalf);
+	}
+
+	{
+		PROFILE_SCOPE(pJob->name);
+		pJob->function(pJob->pData, pJob->begin, pJob->end);
+	}
+
+	Finish(pJob);
+}
+
+VOID JobSystem::Finish(Job* pJob)
+{
+	// the job may be reused as soon as it counts as finished, so everything needed afterwards is read first
+	Job* pParent = pJob->pParent;
+	Job* pContinuations[MAX_CONTINUATIONS];
+	const unsigned int continuation_count = pJob->continuation_count;
+
+	for (unsigned int i = 0; i < continuation_count; i++)
+	{
+		pContinuations[i] = pJob->pContinuations[i];
+	}
+
+	if (pJob->unfinished.fetch_sub(1, std::memory_order_acq_rel) == 1)
+	{
+		if (pParent != NULL)
+		{
+			Finish(pParent);
+		}
+
+		for (unsigned int i = 0; i < continuation_count; i++)
+		{
+			if (pContinuations[i]->dependencies.fetch_sub(1, std::memory_order_acq_rel) == 1)
+			{
+				Push(pContinuations[i]);
+			}
+		}
+	}
+}
+
+VOID JobSystem::Run(unsigned int index)
+{
+	s_Slot.system = m_Serial;
+	s_Slot.index = index;
+
+	unsigned int spins = 0;
+
+	while (m_Running)
+	{
+		// read before looking for jobs, a push after that changes it and keeps the worker awake
+		const unsigned int signal = m_Signal.load();
+
+		Job* pJob = GetJob();
+		if (pJob != NULL)
+		{
+			Execute(pJob);
+			spins = 0;
+		}
+		else if (++spins < SPIN_COUNT)
+		{
+			std::this_thread::yield();
+		}
+		else
+		{
+			std::unique_lock<std::mutex> lock(m_Lock);
+
+			m_Sleeping++;
+			while (m_Running && (m_Signal.load() == signal))
+			{
+				m_WakeUp.wait(lock);
+			}
+			m_Sleeping--;
+
+			spins = 0;
+		}
+	}
+}
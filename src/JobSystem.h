@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Platform.h"
+
+/*
+* a work-stealing job scheduler. every thread of the pool owns a chase-lev deque, it pushes and pops jobs at the
+* bottom while idle threads steal from the top. a job covers a range of objects and splits itself in halves down to
+* its grain, the halves spread over the pool through stealing. jobs form a graph: a job runs once it has been
+* submitted and every job it depends on has finished.
+*
+* slot 0 belongs to the thread that initialized the system. other threads outside the pool that create, submit and
+* wait for jobs get one of the EXTRA_THREADS slots after the pool the first time they do, a thread that works with
+* several systems has a slot in each. the slot is given back when the thread exits, so at most EXTRA_THREADS such
+* threads may use the system at the same time. one more is a bug, which is reported and aborts.
+*
+* a graph has to be complete before the first of its jobs is submitted. a finished job is reused for a later job of
+* the same slot, so a Job pointer is dead once the job has finished. the one exception is Wait, which the thread that
+* created the job calls after submitting it, and before it creates any other job.
+*/
+class JobSystem
+{
+public:
+	typedef VOID (*JobFunction)(VOID* pData, size_t begin, size_t end);
+
+	enum {
+		MAX_THREADS       = 64,
+		EXTRA_THREADS     = 4,    // threads outside the pool besides the one that initialized it
+		MAX_SLOTS         = MAX_THREADS + EXTRA_THREADS,
+		MAX_CONTINUATIONS = 4,
+		POOL_SIZE         = 4096, // jobs per block, a slot adds a block when every job of its blocks is alive
+		QUEUE_SIZE        = 4096, // a push to a full queue runs the job right away
+		SPIN_COUNT        = 64    // failed attempts to find a job before a worker goes to sleep
+	};
+
+	struct Job
+	{
+		const char*      name;
+		JobFunction      function;
+		VOID*            pData;
+		size_t           begin;
+		size_t           end;
+		size_t           grain;
+		Job*             pParent;
+		std::atomic<int> unfinished;   // the job itself and the halves split off it
+		std::atomic<int> dependencies; // unfinished jobs it depends on, plus one until it is submitted
+		Job*             pContinuations[MAX_CONTINUATIONS];
+		unsigned int     continuation_count;
+	};
+
+private:
+	// chase-lev deque, after "correct and efficient work-stealing for weak memory models" by le et al.
+	class Queue
+	{
+	private:
+		std::atomic<Job*>   m_Jobs[QUEUE_SIZE];
+		std::atomic<size_t> m_Top;
+		std::atomic<size_t> m_Bottom;
+
+	public:
+		Queue();
+
+		bool Push(Job* pJob);
+		Job* Pop();
+		Job* Steal();
+	};
+
+	struct Worker
+	{
+		Queue                               queue;
+		std::vector<std::unique_ptr<Job[]>> pool;
+		size_t                              next_job;
+		uint32_t                            random;  // picks the queues to steal from
+		std::thread::id                     thread;  // the thread that owns the slot, none while it is free
+		std::vector<Job*>                   waiting; // the jobs the owner waits for, which Allocate must not reuse
+	};
+
+	// the slot of a thread in the system it used last, systems are told apart by a serial rather than their address
+	struct Slot
+	{
+		uint64_t     system;
+		unsigned int index;
+	};
+
+	// the spare slots a thread has claimed, given back by the destructor when the thread exits
+	struct ThreadSlots
+	{
+		std::vector<Slot> slots;
+
+		~ThreadSlots();
+	};
+
+	std::vector<std::unique_ptr<Worker>> m_Workers;
+	std::vector<std::thread>             m_Threads;
+	uint64_t                             m_Serial;
+	unsigned int                         m_ThreadCount;
+
+	std::atomic<bool>                    m_Running;
+	std::atomic<unsigned int>            m_Signal; // bumped by every push, sleeping workers wait for it to change
+	std::atomic<unsigned int>            m_Sleeping;
+	std::mutex                           m_Lock;
+	std::condition_variable              m_WakeUp;
+
+	static std::atomic<uint64_t>         s_NextSerial;
+	static thread_local Slot             s_Slot;
+	static std::mutex                    s_SystemsLock; // taken before m_Lock of a system
+	static std::vector<JobSystem*>       s_Systems;     // the initialized systems, where exiting threads give slots back
+
+public:
+	JobSystem();
+	~JobSystem();
+
+	INT  Initialize(unsigned int threadCount);
+	VOID Uninitialize();
+
+	unsigned int GetThreadCount();
+	unsigned int GetWorkerIndex();
+
+	Job* CreateParallelFor(const char* name, JobFunction function, VOID* pData, size_t count, size_t grain);
+	INT  AddDependency(Job* pBefore, Job* pAfter);
+	VOID Submit(Job* pJob);
+	VOID Wait(Job* pJob);
+
+	VOID ParallelFor(const char* name, JobFunction function, VOID* pData, size_t count, size_t grain);
+
+private:
+	unsigned int Attach();
+	VOID Release(unsigned int index, std::thread::id thread);
+	Job* Allocate();
+	VOID Push(Job* pJob);
+	Job* GetJob();
+	VOID Execute(Job* pJob);
+	VOID Finish(Job* pJob);
+	VOID Run(unsigned int index);
+};
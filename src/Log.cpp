@@ -0,0 +1,269 @@
+#include "Log.h"
+
+namespace Log
+{
+	std::atomic<bool>        g_Running(false);
+	std::thread              g_Thread;
+	FILE*                    g_File = NULL;
+	std::mutex               g_RingsLock;
+	std::vector<ThreadRing*> g_Rings;
+	std::vector<ThreadRing*> g_FreeRings;
+
+	// threads come and go, so rings are recycled on thread exit. the log thread keeps draining a recycled ring
+	struct ThreadRegistration
+	{
+		ThreadRing* ring;
+
+		ThreadRegistration()
+		{
+			std::lock_guard<std::mutex> lock(g_RingsLock);
+
+			if (!g_FreeRings.empty())
+			{
+				ring = g_FreeRings.back();
+				g_FreeRings.pop_back();
+			}
+			else
+			{
+				ring = new ThreadRing();
+				g_Rings.push_back(ring);
+			}
+		}
+
+		~ThreadRegistration()
+		{
+			std::lock_guard<std::mutex> lock(g_RingsLock);
+			g_FreeRings.push_back(ring);
+		}
+	};
+
+	size_t Align(size_t size)
+	{
+		return (size + 7) & ~static_cast<size_t>(7);
+	}
+
+	DWORD GetLength(INT length, size_t size)
+	{
+		return static_cast<DWORD>(std::min(static_cast<size_t>(std::max(length, 0)), size - 1));
+	}
+
+	// the file is unbuffered and the console flushed, so what is written is out as soon as the call returns
+	VOID WriteOutput(const CHAR* buffer, DWORD length)
+	{
+		if (g_File != NULL)
+		{
+			fwrite(buffer, 1, length, g_File);
+		}
+		else
+		{
+			fwrite(buffer, 1, length, stdout);
+			fflush(stdout);
+		}
+	}
+
+	BYTE* Reserve(size_t size, ThreadRing** ppRing)
+	{
+		static thread_local ThreadRegistration registration;
+		ThreadRing* ring = registration.ring;
+
+		const uint64_t write = ring->write.load(std::memory_order_relaxed);
+		const uint64_t remaining = RING_CAPACITY - (write % RING_CAPACITY);
+		const uint64_t skip = (size > remaining) ? remaining : 0;
+
+		if ((size > MAX_RECORD_SIZE) || (write + skip + size - ring->read.load(std::memory_order_acquire) > RING_CAPACITY))
+		{
+			ring->dropped.store(ring->dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+			return NULL;
+		}
+
+		// the log thread skips a tail too short for a record by itself
+		if (skip >= sizeof(Record))
+		{
+			Record* padding = reinterpret_cast<Record*>(&ring->data[write % RING_CAPACITY]);
+			padding->format = NULL;
+			padding->size = static_cast<uint32_t>(skip);
+		}
+
+		ring->pending = write + skip + size;
+		*ppRing = ring;
+
+		return &ring->data[(write + skip) % RING_CAPACITY];
+	}
+
+	VOID Commit(ThreadRing* ring)
+	{
+		// publish the record after it is fully written
+		ring->write.store(ring->pending, std::memory_order_release);
+	}
+
+	/*
+	* formats the records of every ring into output and writes it, returns the number of records. rings are never
+	* freed, so they are drained outside of the lock, and rings and output keep their capacity between calls.
+	*/
+	size_t Drain(std::vector<ThreadRing*>& rings, std::string& output)
+	{
+		size_t count = 0;
+
+		{
+			std::lock_guard<std::mutex> lock(g_RingsLock);
+			rings.assign(g_Rings.begin(), g_Rings.end());
+		}
+
+		for (ThreadRing* ring : rings)
+		{
+			const uint64_t write = ring->write.load(std::memory_order_acquire);
+			uint64_t read = ring->read.load(std::memory_order_relaxed);
+
+			while (read < write)
+			{
+				const uint64_t remaining = RING_CAPACITY - (read % RING_CAPACITY);
+
+				if (remaining < sizeof(Record))
+				{
+					read += remaining;
+					continue;
+				}
+
+				const Record* record = reinterpret_cast<const Record*>(&ring->data[read % RING_CAPACITY]);
+
+				if (record->format != NULL)
+				{
+					CHAR buffer[BUFFER_SIZE];
+					const INT length = record->format(record->fmt, reinterpret_cast<const BYTE*>(record + 1), buffer, BUFFER_SIZE);
+
+					output.append(buffer, GetLength(length, BUFFER_SIZE));
+					count++;
+				}
+
+				read += record->size;
+
+				if (output.size() >= OUTPUT_SIZE)
+				{
+					WriteOutput(output.data(), static_cast<DWORD>(output.size()));
+					output.clear();
+				}
+			}
+
+			// the space of the records goes back to the producer once they are formatted
+			ring->read.store(read, std::memory_order_release);
+
+			const uint64_t dropped = ring->dropped.load(std::memory_order_relaxed);
+
+			if (dropped != ring->reported)
+			{
+				CHAR buffer[128];
+				const INT length = std::snprintf(buffer, sizeof(buffer), "log: %llu records dropped, the ring of a thread was full\n",
+					static_cast<unsigned long long>(dropped - ring->reported));
+
+				output.append(buffer, GetLength(length, sizeof(buffer)));
+				ring->reported = dropped;
+			}
+		}
+
+		if (!output.empty())
+		{
+			WriteOutput(output.data(), static_cast<DWORD>(output.size()));
+			output.clear();
+		}
+
+		return count;
+	}
+
+	VOID Run()
+	{
+		std::vector<ThreadRing*> rings;
+		std::string output;
+		output.reserve(OUTPUT_SIZE + BUFFER_SIZE);
+
+		while (g_Running.load(std::memory_order_acquire))
+		{
+			if (Drain(rings, output) == 0)
+			{
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+		}
+
+		// the records written before Stop
+		Drain(rings, output);
+	}
+
+	INT Start(const CHAR* path)
+	{
+		INT status = STATUS_SUCCESS;
+
+		if (path != NULL)
+		{
+			g_File = OpenFileStream(path, "wb");
+			if (g_File == NULL)
+			{
+				status = GetErrnoStatus();
+				Write("error 0x%X: could not create %s\n", status, path);
+			}
+			else
+			{
+				setvbuf(g_File, NULL, _IONBF, 0);
+			}
+		}
+
+		if (SUCCEEDED(status))
+		{
+			g_Running.store(true, std::memory_order_release);
+			g_Thread = std::thread(Run);
+		}
+
+		return status;
+	}
+
+	VOID Stop()
+	{
+		if (g_Running.load(std::memory_order_relaxed))
+		{
+			g_Running.store(false, std::memory_order_release);
+			g_Thread.join();
+		}
+
+		if (g_File != NULL)
+		{
+			fclose(g_File);
+			g_File = NULL;
+		}
+	}
+
+	VOID Flush()
+	{
+		bool empty = false;
+
+		while (!empty && g_Running.load(std::memory_order_acquire))
+		{
+			empty = true;
+
+			{
+				std::lock_guard<std::mutex> lock(g_RingsLock);
+
+				for (ThreadRing* ring : g_Rings)
+				{
+					empty = empty && (ring->read.load(std::memory_order_acquire) == ring->write.load(std::memory_order_acquire));
+				}
+			}
+
+			if (!empty)
+			{
+				std::this_thread::yield();
+			}
+		}
+	}
+
+	uint64_t GetDroppedCount()
+	{
+		uint64_t dropped = 0;
+
+		std::lock_guard<std::mutex> lock(g_RingsLock);
+
+		for (ThreadRing* ring : g_Rings)
+		{
+			dropped += ring->dropped.load(std::memory_order_relaxed);
+		}
+
+		return dropped;
+	}
+}
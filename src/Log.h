@@ -0,0 +1,233 @@
+#pragma once
+
+#include "Platform.h"
+
+/*
+* an asynchronous logger. Write copies the format string pointer and the arguments into a ring buffer of the calling
+* thread, which only that thread writes, and a log thread formats the records and writes them to the console or a
+* file. the format string has to outlive the record, strings passed for %s are copied. when a ring is full the new
+* record is dropped and counted, and the log thread reports the count. records of one thread keep their order, those
+* of different threads may be interleaved differently than they were written. while the log thread is not running,
+* Write formats and writes on the calling thread.
+*/
+namespace Log
+{
+	enum {
+		RING_CAPACITY     = 1 << 16,           // bytes per thread, a power of two
+		MAX_RECORD_SIZE   = RING_CAPACITY / 4,
+		MAX_STRING_LENGTH = 1023,
+		BUFFER_SIZE       = 4096,              // longest formatted record
+		OUTPUT_SIZE       = 1 << 16            // formatted bytes written at once
+	};
+
+	typedef INT (*FormatFunction)(const CHAR* fmt, const BYTE* payload, CHAR* buffer, size_t size);
+
+	// followed by the arguments, each aligned to 8 bytes. a record without format pads the ring up to its end
+	struct Record
+	{
+		FormatFunction format;
+		const CHAR*    fmt;
+		uint32_t       size;
+		uint32_t       reserved;
+	};
+
+	struct ThreadRing
+	{
+		BYTE                  data[RING_CAPACITY];
+		std::atomic<uint64_t> write;
+		uint64_t              pending;   // producer only, the write position of the record being stored
+		std::atomic<uint64_t> dropped;   // written by the producer only
+		BYTE                  padding[64];
+		std::atomic<uint64_t> read;
+		uint64_t              reported;  // log thread only, the dropped records already reported
+	};
+
+	extern std::atomic<bool> g_Running;
+
+	size_t Align(size_t size);
+
+	// how an argument is stored in a record and passed back to snprintf. anything but a string is copied as it is
+	template <typename T>
+	struct Argument
+	{
+		static_assert(std::is_trivially_copyable<T>::value, "log arguments have to be trivially copyable");
+
+		// only the pointer would be stored, and what it points to may be gone by the time the record is formatted
+		static_assert(!std::is_pointer<T>::value, "pass strings as CHAR* so that they are copied, and no other pointers");
+
+		static size_t Store(BYTE* p, T value)
+		{
+			CopyMemory(p, &value, sizeof(T));
+			return Align(sizeof(T));
+		}
+
+		static size_t GetSize(T)
+		{
+			return Align(sizeof(T));
+		}
+
+		static size_t GetStoredSize(const BYTE*)
+		{
+			return Align(sizeof(T));
+		}
+
+		static T Load(const BYTE* p)
+		{
+			T value;
+			CopyMemory(&value, p, sizeof(T));
+			return value;
+		}
+	};
+
+	// a string is copied with its length in front, as it may not outlive the call
+	template <>
+	struct Argument<const CHAR*>
+	{
+		static uint32_t GetLength(const CHAR* value)
+		{
+			return static_cast<uint32_t>(strnlen((value != NULL) ? value : "(null)", MAX_STRING_LENGTH));
+		}
+
+		static size_t Store(BYTE* p, const CHAR* value)
+		{
+			const uint32_t length = GetLength(value);
+
+			CopyMemory(p, &length, sizeof(length));
+			CopyMemory(p + sizeof(length), (value != NULL) ? value : "(null)", length);
+			p[sizeof(length) + length] = 0;
+
+			return Align(sizeof(length) + length + 1);
+		}
+
+		static size_t GetSize(const CHAR* value)
+		{
+			return Align(sizeof(uint32_t) + GetLength(value) + 1);
+		}
+
+		static size_t GetStoredSize(const BYTE* p)
+		{
+			uint32_t length = 0;
+			CopyMemory(&length, p, sizeof(length));
+
+			return Align(sizeof(length) + length + 1);
+		}
+
+		static const CHAR* Load(const BYTE* p)
+		{
+			return reinterpret_cast<const CHAR*>(p + sizeof(uint32_t));
+		}
+	};
+
+	template <>
+	struct Argument<CHAR*> : Argument<const CHAR*>
+	{
+	};
+
+	inline size_t GetPayloadSize()
+	{
+		return 0;
+	}
+
+	template <typename T, typename... Rest>
+	size_t GetPayloadSize(T value, Rest... rest)
+	{
+		return Argument<T>::GetSize(value) + GetPayloadSize(rest...);
+	}
+
+	inline VOID StorePayload(BYTE*)
+	{
+	}
+
+	template <typename T, typename... Rest>
+	VOID StorePayload(BYTE* p, T value, Rest... rest)
+	{
+		StorePayload(p + Argument<T>::Store(p, value), rest...);
+	}
+
+	template <typename T>
+	const BYTE* Next(const BYTE*& cursor)
+	{
+		const BYTE* p = cursor;
+		cursor += Argument<T>::GetStoredSize(p);
+
+		return p;
+	}
+
+	template <typename... Args, size_t... I>
+	INT Format(const CHAR* fmt, const BYTE* payload, CHAR* buffer, size_t size, std::index_sequence<I...>)
+	{
+		// a braced list is evaluated in order, so every argument is found after the one before it
+		const BYTE* arguments[sizeof...(Args) + 1] = { Next<Args>(payload)..., NULL };
+		(VOID)arguments;
+		(VOID)payload;
+
+		return std::snprintf(buffer, size, fmt, Argument<Args>::Load(arguments[I])...);
+	}
+
+	// the log thread calls this through the record, with the types the record was written with
+	template <typename... Args>
+	INT FormatRecord(const CHAR* fmt, const BYTE* payload, CHAR* buffer, size_t size)
+	{
+		return Format<Args...>(fmt, payload, buffer, size, std::index_sequence_for<Args...>());
+	}
+
+	DWORD GetLength(INT length, size_t size);
+
+	// writes to the log file, or to the console while there is none
+	VOID WriteOutput(const CHAR* buffer, DWORD length);
+
+	/*
+	* returns where a record of size bytes goes in the ring of this thread, or NULL when it does not fit and is
+	* dropped. a record that would cross the end of the ring starts at its beginning instead.
+	*/
+	BYTE* Reserve(size_t size, ThreadRing** ppRing);
+
+	VOID Commit(ThreadRing* ring);
+
+	template <typename... Args>
+	VOID Write(const CHAR* fmt, Args... args)
+	{
+		if (!g_Running.load(std::memory_order_acquire))
+		{
+			CHAR buffer[BUFFER_SIZE];
+			const INT length = std::snprintf(buffer, BUFFER_SIZE, fmt, args...);
+
+			WriteOutput(buffer, GetLength(length, BUFFER_SIZE));
+
+			return;
+		}
+
+		const size_t size = sizeof(Record) + GetPayloadSize(args...);
+
+		ThreadRing* ring = NULL;
+		BYTE* p = Reserve(size, &ring);
+
+		if (p != NULL)
+		{
+			Record* record = reinterpret_cast<Record*>(p);
+			record->format = FormatRecord<Args...>;
+			record->fmt = fmt;
+			record->size = static_cast<uint32_t>(size);
+
+			StorePayload(p + sizeof(Record), args...);
+			Commit(ring);
+		}
+	}
+
+	// starts the log thread, writing to path or to the console when path is NULL
+	INT Start(const CHAR* path);
+
+	// writes what is left and stops the log thread, Write is synchronous again afterwards
+	VOID Stop();
+
+	// waits until the log thread has taken every record written so far
+	VOID Flush();
+
+	uint64_t GetDroppedCount();
+}
+
+template <typename... Args>
+VOID WriteToConsole(const CHAR* fmt, Args... args)
+{
+	Log::Write(fmt, args...);
+}
@@ -0,0 +1,744 @@
+#include "Matrix.h"
+#include "FastMath.h"
+
+namespace Matrix
+{
+	size_t GetBatchSize(size_t n)
+	{
+		return ((n + BATCH_WIDTH - 1) / BATCH_WIDTH) * BATCH_BLOCK_SIZE;
+	}
+
+	void StoreBatch(float* batch, size_t i, const float* m)
+	{
+		float* dst = batch + (i / BATCH_WIDTH) * BATCH_BLOCK_SIZE + (i % BATCH_WIDTH);
+
+		for (unsigned int e = 0; e < 16; e++)
+		{
+			dst[e * BATCH_WIDTH] = m[e];
+		}
+	}
+
+	void LoadBatch(const float* batch, size_t i, float* m)
+	{
+		const float* src = batch + (i / BATCH_WIDTH) * BATCH_BLOCK_SIZE + (i % BATCH_WIDTH);
+
+		for (unsigned int e = 0; e < 16; e++)
+		{
+			m[e] = src[e * BATCH_WIDTH];
+		}
+	}
+
+	void LoadAffineBatch(const float* batch, size_t i, float* m)
+	{
+		const float* src = batch + (i / BATCH_WIDTH) * BATCH_BLOCK_SIZE + (i % BATCH_WIDTH);
+
+		for (unsigned int e = 0; e < 12; e++)
+		{
+			m[e] = src[e * BATCH_WIDTH];
+		}
+	}
+
+	namespace Scalar
+	{
+		void ToIdentity(float* m)
+		{
+			ZeroMemory(m, sizeof(float) * 16);
+
+			float(*_m)[4] = reinterpret_cast<float(*)[4]>(m);
+			_m[0][0] = 1.0f;
+			_m[1][1] = 1.0f;
+			_m[2][2] = 1.0f;
+			_m[3][3] = 1.0f;
+		}
+
+		void Copy(float* m0, const float* m1)
+		{
+			CopyMemory(m0, m1, sizeof(float) * 16);
+		}
+
+		void Multiply(const float* m0, const float* m1, float* m2)
+		{
+			const float(*_m0)[4] = reinterpret_cast<const float(*)[4]>(m0);
+			const float(*_m1)[4] = reinterpret_cast<const float(*)[4]>(m1);
+			float(*_m2)[4] = reinterpret_cast<float(*)[4]>(m2);
+
+		#define _DOT4(x0, y0, z0, w0, x1, y1, z1, w1) ((x0) * (x1) + (y0) * (y1) + (z0) * (z1) + (w0) * (w1))
+		#define _DOT(m, m0, m1, r, c) (m)[c][r] = _DOT4((m0)[0][r], (m0)[1][r], (m0)[2][r], (m0)[3][r], (m1)[c][0], (m1)[c][1], (m1)[c][2], (m1)[c][3])
+
+			_DOT(_m2, _m0, _m1, 0, 0);
+			_DOT(_m2, _m0, _m1, 0, 1);
+			_DOT(_m2, _m0, _m1, 0, 2);
+			_DOT(_m2, _m0, _m1, 0, 3);
+
+			_DOT(_m2, _m0, _m1, 1, 0);
+			_DOT(_m2, _m0, _m1, 1, 1);
+			_DOT(_m2, _m0, _m1, 1, 2);
+			_DOT(_m2, _m0, _m1, 1, 3);
+
+			_DOT(_m2, _m0, _m1, 2, 0);
+			_DOT(_m2, _m0, _m1, 2, 1);
+			_DOT(_m2, _m0, _m1, 2, 2);
+			_DOT(_m2, _m0, _m1, 2, 3);
+
+			_DOT(_m2, _m0, _m1, 3, 0);
+			_DOT(_m2, _m0, _m1, 3, 1);
+			_DOT(_m2, _m0, _m1, 3, 2);
+			_DOT(_m2, _m0, _m1, 3, 3);
+
+		#undef _DOT
+		#undef _DOT4
+		}
+
+		void MultiplyAffine(const float* m0, const float* m1, float* m2)
+		{
+			MultiplyShaped<3, 3>(m0, m1, m2);
+		}
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				const float* a = m0 + block * BATCH_BLOCK_SIZE;
+				const float* b = m1 + block * BATCH_BLOCK_SIZE;
+				float*       m = m2 + block * BATCH_BLOCK_SIZE;
+
+				for (unsigned int r = 0; r < 4; r++)
+				{
+					for (unsigned int l = 0; l < BATCH_WIDTH; l++)
+					{
+						const float a0 = a[(0 * 4 + r) * BATCH_WIDTH + l];
+						const float a1 = a[(1 * 4 + r) * BATCH_WIDTH + l];
+						const float a2 = a[(2 * 4 + r) * BATCH_WIDTH + l];
+						const float a3 = a[(3 * 4 + r) * BATCH_WIDTH + l];
+
+						for (unsigned int c = 0; c < 4; c++)
+						{
+							m[(c * 4 + r) * BATCH_WIDTH + l] =
+								b[(c * 4 + 0) * BATCH_WIDTH + l] * a0 +
+								b[(c * 4 + 1) * BATCH_WIDTH + l] * a1 +
+								b[(c * 4 + 2) * BATCH_WIDTH + l] * a2 +
+								b[(c * 4 + 3) * BATCH_WIDTH + l] * a3;
+						}
+					}
+				}
+			}
+		}
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				const float* a = m0 + block * BATCH_BLOCK_SIZE;
+				const float* b = m1 + block * BATCH_BLOCK_SIZE;
+				float*       m = m2 + block * BATCH_BLOCK_SIZE;
+
+				for (unsigned int r = 0; r < 4; r++)
+				{
+					for (unsigned int l = 0; l < BATCH_WIDTH; l++)
+					{
+						const float a0 = a[(0 * 4 + r) * BATCH_WIDTH + l];
+						const float a1 = a[(1 * 4 + r) * BATCH_WIDTH + l];
+						const float a2 = a[(2 * 4 + r) * BATCH_WIDTH + l];
+
+						for (unsigned int c = 0; c < 3; c++)
+						{
+							float x =
+								b[(c * 4 + 0) * BATCH_WIDTH + l] * a0 +
+								b[(c * 4 + 1) * BATCH_WIDTH + l] * a1 +
+								b[(c * 4 + 2) * BATCH_WIDTH + l] * a2;
+
+							if (r == 3)
+							{
+								x += b[(c * 4 + 3) * BATCH_WIDTH + l];
+							}
+
+							m[(c * 4 + r) * BATCH_WIDTH + l] = x;
+						}
+
+						m[(3 * 4 + r) * BATCH_WIDTH + l] = (r == 3) ? 1.0f : 0.0f;
+					}
+				}
+			}
+		}
+	}
+
+	/*
+	* the simd kernels compute each row of m2 as a linear combination of the rows of m0:
+	*   m2[c] = m1[c][0] * m0[0] + m1[c][1] * m0[1] + m1[c][2] * m0[2] + m1[c][3] * m0[3]
+	* which is the same sum, in the same order, as the scalar _DOT4 above.
+	* all of m0 and each row of m1 are read before the row of m2 is written, so m2 may alias m0 or m1.
+	* the batch kernels evaluate the same sum for one element of every matrix in a block at once. they
+	* read a column of m0 before writing the same column of m2, so m2 may alias m0 but not m1.
+	* the affine batch kernels take matrices whose last row is 0 0 0 1. they drop the terms of that row, which are
+	* exact zeros or a multiply by one, and give the same result as the full kernel of their set.
+	*/
+
+#if defined(SIMD_X86)
+
+	namespace SSE2
+	{
+		void ToIdentity(float* m)
+		{
+			_mm_storeu_ps(m + 0,  _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f));
+			_mm_storeu_ps(m + 4,  _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f));
+			_mm_storeu_ps(m + 8,  _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f));
+			_mm_storeu_ps(m + 12, _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+		}
+
+		void Copy(float* m0, const float* m1)
+		{
+			__m128 r0 = _mm_loadu_ps(m1 + 0);
+			__m128 r1 = _mm_loadu_ps(m1 + 4);
+			__m128 r2 = _mm_loadu_ps(m1 + 8);
+			__m128 r3 = _mm_loadu_ps(m1 + 12);
+
+			_mm_storeu_ps(m0 + 0,  r0);
+			_mm_storeu_ps(m0 + 4,  r1);
+			_mm_storeu_ps(m0 + 8,  r2);
+			_mm_storeu_ps(m0 + 12, r3);
+		}
+
+		void Multiply(const float* m0, const float* m1, float* m2)
+		{
+			__m128 a0 = _mm_loadu_ps(m0 + 0);
+			__m128 a1 = _mm_loadu_ps(m0 + 4);
+			__m128 a2 = _mm_loadu_ps(m0 + 8);
+			__m128 a3 = _mm_loadu_ps(m0 + 12);
+
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				__m128 b = _mm_loadu_ps(m1 + c * 4);
+
+				__m128 r = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)), a1));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), a2));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), a3));
+
+				_mm_storeu_ps(m2 + c * 4, r);
+			}
+		}
+
+		// Multiply with the last rows 0 0 0 1: m0's is a constant and m1's is not computed
+		void MultiplyAffine(const float* m0, const float* m1, float* m2)
+		{
+			__m128 a0 = _mm_loadu_ps(m0 + 0);
+			__m128 a1 = _mm_loadu_ps(m0 + 4);
+			__m128 a2 = _mm_loadu_ps(m0 + 8);
+			__m128 a3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				__m128 b = _mm_loadu_ps(m1 + c * 4);
+
+				__m128 r = _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)), a1));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)), a2));
+				r = _mm_add_ps(r, _mm_mul_ps(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)), a3));
+
+				_mm_storeu_ps(m2 + c * 4, r);
+			}
+		}
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				for (unsigned int h = 0; h < BATCH_WIDTH; h += 4)
+				{
+					const float* a = m0 + block * BATCH_BLOCK_SIZE + h;
+					const float* b = m1 + block * BATCH_BLOCK_SIZE + h;
+					float*       m = m2 + block * BATCH_BLOCK_SIZE + h;
+
+					for (unsigned int r = 0; r < 4; r++)
+					{
+						__m128 a0 = _mm_loadu_ps(a + (0 * 4 + r) * BATCH_WIDTH);
+						__m128 a1 = _mm_loadu_ps(a + (1 * 4 + r) * BATCH_WIDTH);
+						__m128 a2 = _mm_loadu_ps(a + (2 * 4 + r) * BATCH_WIDTH);
+						__m128 a3 = _mm_loadu_ps(a + (3 * 4 + r) * BATCH_WIDTH);
+
+						for (unsigned int c = 0; c < 4; c++)
+						{
+							__m128 x = _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+							x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 1) * BATCH_WIDTH), a1));
+							x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 2) * BATCH_WIDTH), a2));
+							x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 3) * BATCH_WIDTH), a3));
+
+							_mm_storeu_ps(m + (c * 4 + r) * BATCH_WIDTH, x);
+						}
+					}
+				}
+			}
+		}
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				for (unsigned int h = 0; h < BATCH_WIDTH; h += 4)
+				{
+					const float* a = m0 + block * BATCH_BLOCK_SIZE + h;
+					const float* b = m1 + block * BATCH_BLOCK_SIZE + h;
+					float*       m = m2 + block * BATCH_BLOCK_SIZE + h;
+
+					for (unsigned int r = 0; r < 4; r++)
+					{
+						__m128 a0 = _mm_loadu_ps(a + (0 * 4 + r) * BATCH_WIDTH);
+						__m128 a1 = _mm_loadu_ps(a + (1 * 4 + r) * BATCH_WIDTH);
+						__m128 a2 = _mm_loadu_ps(a + (2 * 4 + r) * BATCH_WIDTH);
+
+						for (unsigned int c = 0; c < 3; c++)
+						{
+							__m128 x = _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+							x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 1) * BATCH_WIDTH), a1));
+							x = _mm_add_ps(x, _mm_mul_ps(_mm_loadu_ps(b + (c * 4 + 2) * BATCH_WIDTH), a2));
+
+							if (r == 3)
+							{
+								x = _mm_add_ps(x, _mm_loadu_ps(b + (c * 4 + 3) * BATCH_WIDTH));
+							}
+
+							_mm_storeu_ps(m + (c * 4 + r) * BATCH_WIDTH, x);
+						}
+
+						_mm_storeu_ps(m + (3 * 4 + r) * BATCH_WIDTH, _mm_set1_ps((r == 3) ? 1.0f : 0.0f));
+					}
+				}
+			}
+		}
+	}
+
+	// msvc emits avx for the intrinsics wherever they are used, gcc only inside functions built for the target
+#if defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx,fma")
+#endif
+
+	namespace AVX
+	{
+		void Copy(float* m0, const float* m1)
+		{
+			__m256 r01 = _mm256_loadu_ps(m1 + 0);
+			__m256 r23 = _mm256_loadu_ps(m1 + 8);
+
+			_mm256_storeu_ps(m0 + 0, r01);
+			_mm256_storeu_ps(m0 + 8, r23);
+		}
+
+		void Multiply(const float* m0, const float* m1, float* m2)
+		{
+			__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 0));
+			__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 4));
+			__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 8));
+			__m256 a3 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 12));
+
+			__m256 b01 = _mm256_loadu_ps(m1 + 0);
+			__m256 b23 = _mm256_loadu_ps(m1 + 8);
+
+			__m256 r01 = _mm256_mul_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+			__m256 r23 = _mm256_mul_ps(_mm256_permute_ps(b23, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), a1, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(b23, _MM_SHUFFLE(1, 1, 1, 1)), a1, r23);
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), a2, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(b23, _MM_SHUFFLE(2, 2, 2, 2)), a2, r23);
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), a3, r01);
+			r23 = _mm256_fmadd_ps(_mm256_permute_ps(b23, _MM_SHUFFLE(3, 3, 3, 3)), a3, r23);
+
+			_mm256_storeu_ps(m2 + 0, r01);
+			_mm256_storeu_ps(m2 + 8, r23);
+		}
+
+		// rows 0 and 1 of m2 in one register and row 2 in half of one
+		void MultiplyAffine(const float* m0, const float* m1, float* m2)
+		{
+			__m256 a0 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 0));
+			__m256 a1 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 4));
+			__m256 a2 = _mm256_broadcast_ps(reinterpret_cast<const __m128*>(m0 + 8));
+			__m256 a3 = _mm256_setr_ps(0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 1.0f);
+
+			__m256 b01 = _mm256_loadu_ps(m1 + 0);
+			__m128 b2 = _mm_loadu_ps(m1 + 8);
+
+			__m256 r01 = _mm256_mul_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(0, 0, 0, 0)), a0);
+			__m128 r2 = _mm_mul_ps(_mm_permute_ps(b2, _MM_SHUFFLE(0, 0, 0, 0)), _mm256_castps256_ps128(a0));
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(1, 1, 1, 1)), a1, r01);
+			r2 = _mm_fmadd_ps(_mm_permute_ps(b2, _MM_SHUFFLE(1, 1, 1, 1)), _mm256_castps256_ps128(a1), r2);
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(2, 2, 2, 2)), a2, r01);
+			r2 = _mm_fmadd_ps(_mm_permute_ps(b2, _MM_SHUFFLE(2, 2, 2, 2)), _mm256_castps256_ps128(a2), r2);
+
+			r01 = _mm256_fmadd_ps(_mm256_permute_ps(b01, _MM_SHUFFLE(3, 3, 3, 3)), a3, r01);
+			r2 = _mm_fmadd_ps(_mm_permute_ps(b2, _MM_SHUFFLE(3, 3, 3, 3)), _mm256_castps256_ps128(a3), r2);
+
+			_mm256_storeu_ps(m2 + 0, r01);
+			_mm_storeu_ps(m2 + 8, r2);
+		}
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				const float* a = m0 + block * BATCH_BLOCK_SIZE;
+				const float* b = m1 + block * BATCH_BLOCK_SIZE;
+				float*       m = m2 + block * BATCH_BLOCK_SIZE;
+
+				for (unsigned int r = 0; r < 4; r++)
+				{
+					__m256 a0 = _mm256_loadu_ps(a + (0 * 4 + r) * BATCH_WIDTH);
+					__m256 a1 = _mm256_loadu_ps(a + (1 * 4 + r) * BATCH_WIDTH);
+					__m256 a2 = _mm256_loadu_ps(a + (2 * 4 + r) * BATCH_WIDTH);
+					__m256 a3 = _mm256_loadu_ps(a + (3 * 4 + r) * BATCH_WIDTH);
+
+					for (unsigned int c = 0; c < 4; c++)
+					{
+						__m256 x = _mm256_mul_ps(_mm256_loadu_ps(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+						x = _mm256_fmadd_ps(_mm256_loadu_ps(b + (c * 4 + 1) * BATCH_WIDTH), a1, x);
+						x = _mm256_fmadd_ps(_mm256_loadu_ps(b + (c * 4 + 2) * BATCH_WIDTH), a2, x);
+						x = _mm256_fmadd_ps(_mm256_loadu_ps(b + (c * 4 + 3) * BATCH_WIDTH), a3, x);
+
+						_mm256_storeu_ps(m + (c * 4 + r) * BATCH_WIDTH, x);
+					}
+				}
+			}
+		}
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				const float* a = m0 + block * BATCH_BLOCK_SIZE;
+				const float* b = m1 + block * BATCH_BLOCK_SIZE;
+				float*       m = m2 + block * BATCH_BLOCK_SIZE;
+
+				for (unsigned int r = 0; r < 4; r++)
+				{
+					__m256 a0 = _mm256_loadu_ps(a + (0 * 4 + r) * BATCH_WIDTH);
+					__m256 a1 = _mm256_loadu_ps(a + (1 * 4 + r) * BATCH_WIDTH);
+					__m256 a2 = _mm256_loadu_ps(a + (2 * 4 + r) * BATCH_WIDTH);
+
+					for (unsigned int c = 0; c < 3; c++)
+					{
+						__m256 x = _mm256_mul_ps(_mm256_loadu_ps(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+						x = _mm256_fmadd_ps(_mm256_loadu_ps(b + (c * 4 + 1) * BATCH_WIDTH), a1, x);
+						x = _mm256_fmadd_ps(_mm256_loadu_ps(b + (c * 4 + 2) * BATCH_WIDTH), a2, x);
+
+						if (r == 3)
+						{
+							x = _mm256_add_ps(x, _mm256_loadu_ps(b + (c * 4 + 3) * BATCH_WIDTH));
+						}
+
+						_mm256_storeu_ps(m + (c * 4 + r) * BATCH_WIDTH, x);
+					}
+
+					_mm256_storeu_ps(m + (3 * 4 + r) * BATCH_WIDTH, _mm256_set1_ps((r == 3) ? 1.0f : 0.0f));
+				}
+			}
+		}
+	}
+
+#if defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#elif defined(SIMD_NEON)
+
+	namespace NEON
+	{
+		void ToIdentity(float* m)
+		{
+			const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+			vst1q_f32(m + 0,  vld1q_f32(identity + 0));
+			vst1q_f32(m + 4,  vld1q_f32(identity + 4));
+			vst1q_f32(m + 8,  vld1q_f32(identity + 8));
+			vst1q_f32(m + 12, vld1q_f32(identity + 12));
+		}
+
+		void Copy(float* m0, const float* m1)
+		{
+			float32x4_t r0 = vld1q_f32(m1 + 0);
+			float32x4_t r1 = vld1q_f32(m1 + 4);
+			float32x4_t r2 = vld1q_f32(m1 + 8);
+			float32x4_t r3 = vld1q_f32(m1 + 12);
+
+			vst1q_f32(m0 + 0,  r0);
+			vst1q_f32(m0 + 4,  r1);
+			vst1q_f32(m0 + 8,  r2);
+			vst1q_f32(m0 + 12, r3);
+		}
+
+		void Multiply(const float* m0, const float* m1, float* m2)
+		{
+			float32x4_t a0 = vld1q_f32(m0 + 0);
+			float32x4_t a1 = vld1q_f32(m0 + 4);
+			float32x4_t a2 = vld1q_f32(m0 + 8);
+			float32x4_t a3 = vld1q_f32(m0 + 12);
+
+			for (unsigned int c = 0; c < 4; c++)
+			{
+				float32x4_t b = vld1q_f32(m1 + c * 4);
+
+				float32x4_t r = vmulq_n_f32(a0, vgetq_lane_f32(b, 0));
+				r = vaddq_f32(r, vmulq_n_f32(a1, vgetq_lane_f32(b, 1)));
+				r = vaddq_f32(r, vmulq_n_f32(a2, vgetq_lane_f32(b, 2)));
+				r = vaddq_f32(r, vmulq_n_f32(a3, vgetq_lane_f32(b, 3)));
+
+				vst1q_f32(m2 + c * 4, r);
+			}
+		}
+
+		void MultiplyAffine(const float* m0, const float* m1, float* m2)
+		{
+			const float last_row[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+			float32x4_t a0 = vld1q_f32(m0 + 0);
+			float32x4_t a1 = vld1q_f32(m0 + 4);
+			float32x4_t a2 = vld1q_f32(m0 + 8);
+			float32x4_t a3 = vld1q_f32(last_row);
+
+			for (unsigned int c = 0; c < 3; c++)
+			{
+				float32x4_t b = vld1q_f32(m1 + c * 4);
+
+				float32x4_t r = vmulq_n_f32(a0, vgetq_lane_f32(b, 0));
+				r = vaddq_f32(r, vmulq_n_f32(a1, vgetq_lane_f32(b, 1)));
+				r = vaddq_f32(r, vmulq_n_f32(a2, vgetq_lane_f32(b, 2)));
+				r = vaddq_f32(r, vmulq_n_f32(a3, vgetq_lane_f32(b, 3)));
+
+				vst1q_f32(m2 + c * 4, r);
+			}
+		}
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				for (unsigned int h = 0; h < BATCH_WIDTH; h += 4)
+				{
+					const float* a = m0 + block * BATCH_BLOCK_SIZE + h;
+					const float* b = m1 + block * BATCH_BLOCK_SIZE + h;
+					float*       m = m2 + block * BATCH_BLOCK_SIZE + h;
+
+					for (unsigned int r = 0; r < 4; r++)
+					{
+						float32x4_t a0 = vld1q_f32(a + (0 * 4 + r) * BATCH_WIDTH);
+						float32x4_t a1 = vld1q_f32(a + (1 * 4 + r) * BATCH_WIDTH);
+						float32x4_t a2 = vld1q_f32(a + (2 * 4 + r) * BATCH_WIDTH);
+						float32x4_t a3 = vld1q_f32(a + (3 * 4 + r) * BATCH_WIDTH);
+
+						for (unsigned int c = 0; c < 4; c++)
+						{
+							float32x4_t x = vmulq_f32(vld1q_f32(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+							x = vaddq_f32(x, vmulq_f32(vld1q_f32(b + (c * 4 + 1) * BATCH_WIDTH), a1));
+							x = vaddq_f32(x, vmulq_f32(vld1q_f32(b + (c * 4 + 2) * BATCH_WIDTH), a2));
+							x = vaddq_f32(x, vmulq_f32(vld1q_f32(b + (c * 4 + 3) * BATCH_WIDTH), a3));
+
+							vst1q_f32(m + (c * 4 + r) * BATCH_WIDTH, x);
+						}
+					}
+				}
+			}
+		}
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n)
+		{
+			const size_t blocks = (n + BATCH_WIDTH - 1) / BATCH_WIDTH;
+
+			for (size_t block = 0; block < blocks; block++)
+			{
+				for (unsigned int h = 0; h < BATCH_WIDTH; h += 4)
+				{
+					const float* a = m0 + block * BATCH_BLOCK_SIZE + h;
+					const float* b = m1 + block * BATCH_BLOCK_SIZE + h;
+					float*       m = m2 + block * BATCH_BLOCK_SIZE + h;
+
+					for (unsigned int r = 0; r < 4; r++)
+					{
+						float32x4_t a0 = vld1q_f32(a + (0 * 4 + r) * BATCH_WIDTH);
+						float32x4_t a1 = vld1q_f32(a + (1 * 4 + r) * BATCH_WIDTH);
+						float32x4_t a2 = vld1q_f32(a + (2 * 4 + r) * BATCH_WIDTH);
+
+						for (unsigned int c = 0; c < 3; c++)
+						{
+							float32x4_t x = vmulq_f32(vld1q_f32(b + (c * 4 + 0) * BATCH_WIDTH), a0);
+							x = vaddq_f32(x, vmulq_f32(vld1q_f32(b + (c * 4 + 1) * BATCH_WIDTH), a1));
+							x = vaddq_f32(x, vmulq_f32(vld1q_f32(b + (c * 4 + 2) * BATCH_WIDTH), a2));
+
+							if (r == 3)
+							{
+								x = vaddq_f32(x, vld1q_f32(b + (c * 4 + 3) * BATCH_WIDTH));
+							}
+
+							vst1q_f32(m + (c * 4 + r) * BATCH_WIDTH, x);
+						}
+
+						vst1q_f32(m + (3 * 4 + r) * BATCH_WIDTH, vdupq_n_f32((r == 3) ? 1.0f : 0.0f));
+					}
+				}
+			}
+		}
+	}
+#endif
+
+	const Kernels SCALAR_KERNELS = { "scalar", Scalar::ToIdentity, Scalar::Copy, Scalar::Multiply, Scalar::MultiplyAffine, Scalar::MultiplyBatch, Scalar::MultiplyAffineBatch };
+
+#if defined(SIMD_X86)
+	const Kernels SSE2_KERNELS = { "sse2", SSE2::ToIdentity, SSE2::Copy, SSE2::Multiply, SSE2::MultiplyAffine, SSE2::MultiplyBatch, SSE2::MultiplyAffineBatch };
+	const Kernels AVX_KERNELS  = { "avx/fma", SSE2::ToIdentity, AVX::Copy, AVX::Multiply, AVX::MultiplyAffine, AVX::MultiplyBatch, AVX::MultiplyAffineBatch };
+#elif defined(SIMD_NEON)
+	const Kernels NEON_KERNELS = { "neon", NEON::ToIdentity, NEON::Copy, NEON::Multiply, NEON::MultiplyAffine, NEON::MultiplyBatch, NEON::MultiplyAffineBatch };
+#endif
+
+	// the scalar kernels are used until Initialize picks the best variant for the cpu
+	Kernels g_Kernels = SCALAR_KERNELS;
+
+	size_t GetSupportedKernels(const Kernels* kernels[MAX_KERNEL_SETS])
+	{
+		size_t count = 0;
+		kernels[count++] = &SCALAR_KERNELS;
+
+#if defined(SIMD_X86)
+		INT info[4] = {};
+		ReadCpuid(info, 1);
+
+		const bool sse2    = (info[3] & (1 << 26)) != 0;
+		const bool fma     = (info[2] & (1 << 12)) != 0;
+		const bool osxsave = (info[2] & (1 << 27)) != 0;
+		const bool avx     = (info[2] & (1 << 28)) != 0;
+
+		if (sse2)
+		{
+			kernels[count++] = &SSE2_KERNELS;
+		}
+
+		// the os must also save the ymm registers on a context switch
+		if (sse2 && avx && fma && osxsave && ((ReadXcr0() & 0x6) == 0x6))
+		{
+			kernels[count++] = &AVX_KERNELS;
+		}
+#elif defined(SIMD_NEON)
+		kernels[count++] = &NEON_KERNELS;
+#endif
+
+		return count;
+	}
+
+	void Initialize()
+	{
+		const Kernels* kernels[MAX_KERNEL_SETS];
+		g_Kernels = *kernels[GetSupportedKernels(kernels) - 1];
+	}
+
+	const char* GetKernelName()
+	{
+		return g_Kernels.name;
+	}
+
+	void ToIdentity(float* m)
+	{
+		g_Kernels.ToIdentity(m);
+	}
+
+	void Copy(float* m0, const float* m1)
+	{
+		g_Kernels.Copy(m0, m1);
+	}
+
+	void Multiply(const float* m0, const float* m1, float* m2)
+	{
+		g_Kernels.Multiply(m0, m1, m2);
+	}
+
+	void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n)
+	{
+		g_Kernels.MultiplyBatch(m0, m1, m2, n);
+	}
+
+	void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n)
+	{
+		g_Kernels.MultiplyAffineBatch(m0, m1, m2, n);
+	}
+
+	void ToIdentity(Affine3x4& m)
+	{
+		const float identity[12] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f };
+		CopyMemory(m.m, identity, sizeof(identity));
+	}
+
+	void Expand(const Affine3x4& a, Mat4& m)
+	{
+		const float last_row[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+		CopyMemory(m.m, a.m, sizeof(a.m));
+		CopyMemory(m.m + 12, last_row, sizeof(last_row));
+	}
+
+	template <>
+	void Multiply<Affine3x4, Affine3x4>(const Affine3x4& m0, const Affine3x4& m1, Affine3x4& m2)
+	{
+		g_Kernels.MultiplyAffine(m0.m, m1.m, m2.m);
+	}
+
+	void FromEulerBatch(const float* r_x, const float* r_y, const float* r_z, float* m, size_t n)
+	{
+		const size_t CHUNK_SIZE = 64;
+
+		float s[3][CHUNK_SIZE];
+		float c[3][CHUNK_SIZE];
+
+		for (size_t base = 0; base < n; base += CHUNK_SIZE)
+		{
+			const size_t count = std::min(CHUNK_SIZE, n - base);
+
+			FastMath::SinCosBatch(r_x + base, s[0], c[0], count);
+			FastMath::SinCosBatch(r_y + base, s[1], c[1], count);
+			FastMath::SinCosBatch(r_z + base, s[2], c[2], count);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const size_t index = base + i;
+				float* dst = m + (index / BATCH_WIDTH) * BATCH_BLOCK_SIZE + (index % BATCH_WIDTH);
+
+				const float s_a = s[0][i], c_a = c[0][i];
+				const float s_b = s[1][i], c_b = c[1][i];
+				const float s_c = s[2][i], c_c = c[2][i];
+
+				dst[0  * BATCH_WIDTH] = c_a * c_b;
+				dst[1  * BATCH_WIDTH] = c_a * s_b * s_c - s_a * c_c;
+				dst[2  * BATCH_WIDTH] = c_a * s_b * c_c + s_a * s_c;
+				dst[3  * BATCH_WIDTH] = 0.0f;
+
+				dst[4  * BATCH_WIDTH] = s_a * c_b;
+				dst[5  * BATCH_WIDTH] = s_a * s_b * s_c + c_a * c_c;
+				dst[6  * BATCH_WIDTH] = s_a * s_b * c_c - c_a * s_c;
+				dst[7  * BATCH_WIDTH] = 0.0f;
+
+				dst[8  * BATCH_WIDTH] = -s_b;
+				dst[9  * BATCH_WIDTH] = c_b * s_c;
+				dst[10 * BATCH_WIDTH] = c_b * c_c;
+				dst[11 * BATCH_WIDTH] = 0.0f;
+
+				dst[12 * BATCH_WIDTH] = 0.0f;
+				dst[13 * BATCH_WIDTH] = 0.0f;
+				dst[14 * BATCH_WIDTH] = 0.0f;
+				dst[15 * BATCH_WIDTH] = 1.0f;
+			}
+		}
+	}
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "Common.h"
+
+namespace Matrix
+{
+	/*
+	* batched matrices are stored as an array of structures of arrays: each block holds BATCH_WIDTH matrices
+	* with their elements interleaved, so element e of matrix i is at
+	*   [(i / BATCH_WIDTH) * BATCH_BLOCK_SIZE + e * BATCH_WIDTH + (i % BATCH_WIDTH)]
+	* and a single simd load fetches the same element of 4 or 8 matrices.
+	* batch buffers must always be sized to a whole number of blocks.
+	*/
+	enum {
+		BATCH_WIDTH      = 8,
+		BATCH_BLOCK_SIZE = 16 * BATCH_WIDTH
+	};
+
+	// number of floats needed to hold n matrices in the batch layout
+	size_t GetBatchSize(size_t n);
+
+	// scatters a single 16 float matrix into slot i of a batch
+	void StoreBatch(float* batch, size_t i, const float* m);
+
+	// gathers slot i of a batch into a single 16 float matrix
+	void LoadBatch(const float* batch, size_t i, float* m);
+
+	// gathers the first three rows of slot i of a batch into 12 floats, for matrices whose last row is 0 0 0 1
+	void LoadAffineBatch(const float* batch, size_t i, float* m);
+
+	// scalar reference kernels, also used as the fallback on targets without simd support
+	namespace Scalar
+	{
+		void ToIdentity(float* m);
+
+		void Copy(float* m0, const float* m1);
+
+		void Multiply(const float* m0, const float* m1, float* m2);
+
+		/*
+		* Multiply on the first ROWS0 rows of m0 and ROWS1 rows of m1, the others are 0 0 0 1. the terms of those rows
+		* are dropped at compile time and the sums keep the order of _DOT4. all of m0 is read before m2 is written and
+		* each row of m1 before the same row of m2, so m2 may alias m0 or m1. m2 gets 4 rows unless both are 3.
+		*/
+		template <unsigned int ROWS0, unsigned int ROWS1>
+		void MultiplyShaped(const float* m0, const float* m1, float* m2)
+		{
+			const unsigned int rows = ((ROWS0 == 3) && (ROWS1 == 3)) ? 3 : 4;
+
+			float a[4][4];
+			CopyMemory(a, m0, sizeof(float) * 4 * ROWS0);
+
+			for (unsigned int r = 0; r < rows; r++)
+			{
+				float row[4];
+
+				for (unsigned int c = 0; c < 4; c++)
+				{
+					if (r < ROWS1)
+					{
+						const float* b = &m1[r * 4];
+						float x = a[0][c] * b[0] + a[1][c] * b[1] + a[2][c] * b[2];
+
+						if (ROWS0 == 4)
+						{
+							x += a[3][c] * b[3];
+						}
+						else if (c == 3)
+						{
+							x += b[3];
+						}
+
+						row[c] = x;
+					}
+					else
+					{
+						// the last row of m1 is 0 0 0 1 and picks the last row of m0
+						row[c] = (ROWS0 == 4) ? a[3][c] : ((c == 3) ? 1.0f : 0.0f);
+					}
+				}
+
+				CopyMemory(&m2[r * 4], row, sizeof(row));
+			}
+		}
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n);
+	}
+
+	/*
+	* the simd kernels compute each row of m2 as a linear combination of the rows of m0:
+	*   m2[c] = m1[c][0] * m0[0] + m1[c][1] * m0[1] + m1[c][2] * m0[2] + m1[c][3] * m0[3]
+	* which is the same sum, in the same order, as the scalar _DOT4 above.
+	* all of m0 and each row of m1 are read before the row of m2 is written, so m2 may alias m0 or m1.
+	* the batch kernels evaluate the same sum for one element of every matrix in a block at once. they
+	* read a column of m0 before writing the same column of m2, so m2 may alias m0 but not m1.
+	* the affine batch kernels take matrices whose last row is 0 0 0 1. they drop the terms of that row, which are
+	* exact zeros or a multiply by one, and give the same result as the full kernel of their set.
+	*/
+
+#if defined(SIMD_X86)
+
+	namespace SSE2
+	{
+		void ToIdentity(float* m);
+
+		void Copy(float* m0, const float* m1);
+
+		void Multiply(const float* m0, const float* m1, float* m2);
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n);
+	}
+
+	// avx + fma, two rows of m2 per 256 bit register
+	namespace AVX
+	{
+		void Copy(float* m0, const float* m1);
+
+		void Multiply(const float* m0, const float* m1, float* m2);
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n);
+	}
+#elif defined(SIMD_NEON)
+
+	namespace NEON
+	{
+		void ToIdentity(float* m);
+
+		void Copy(float* m0, const float* m1);
+
+		void Multiply(const float* m0, const float* m1, float* m2);
+
+		void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+		void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n);
+	}
+#endif
+
+	// one implementation of the kernels below, on one instruction set
+	struct Kernels
+	{
+		const char* name;
+		void (*ToIdentity)(float* m);
+		void (*Copy)(float* m0, const float* m1);
+		void (*Multiply)(const float* m0, const float* m1, float* m2);
+		void (*MultiplyAffine)(const float* m0, const float* m1, float* m2);
+		void (*MultiplyBatch)(const float* m0, const float* m1, float* m2, size_t n);
+		void (*MultiplyAffineBatch)(const float* m0, const float* m1, float* m2, size_t n);
+	};
+
+	enum {
+		MAX_KERNEL_SETS = 3
+	};
+
+	// the kernel sets this cpu can run, the scalar reference first and the fastest last. returns their count
+	size_t GetSupportedKernels(const Kernels* kernels[MAX_KERNEL_SETS]);
+
+	// picks the fastest kernel set once at startup based on cpuid
+	void Initialize();
+
+	const char* GetKernelName();
+
+	void ToIdentity(float* m);
+
+	void Copy(float* m0, const float* m1);
+
+	void Multiply(const float* m0, const float* m1, float* m2);
+
+	// m2[i] = m1[i] * m0[i] for the first n matrices of the batches, see Multiply
+	void MultiplyBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+	// MultiplyBatch for batches of matrices whose last row is 0 0 0 1, which the last row of m2 is set to
+	void MultiplyAffineBatch(const float* m0, const float* m1, float* m2, size_t n);
+
+	/*
+	* matrices that carry their shape in their type. Mat4 is any 16 float matrix. Affine3x4 holds the first three rows
+	* of a matrix whose last row is 0 0 0 1, in 48 bytes instead of 64, which is also the layout of a row_major
+	* float3x4 in a constant buffer. Multiply is specialized on the shapes of its operands at compile time: the terms
+	* of a known last row are dropped, so the product of two affine matrices takes 36 multiplies instead of 64, and
+	* its result is affine again. the result is the one of the full product in the same kernel set.
+	*/
+	struct Mat4
+	{
+		enum { ROWS = 4 };
+		float m[16];
+	};
+
+	struct Affine3x4
+	{
+		enum { ROWS = 3 };
+		float m[12];
+	};
+
+	template <typename A, typename B>
+	struct Product
+	{
+		typedef Mat4 Type;
+	};
+
+	template <>
+	struct Product<Affine3x4, Affine3x4>
+	{
+		typedef Affine3x4 Type;
+	};
+
+	void ToIdentity(Affine3x4& m);
+
+	// the full matrix of an affine one
+	void Expand(const Affine3x4& a, Mat4& m);
+
+	// m2 = m1 * m0 on any shapes, in place as well. the product of two affine matrices goes to the kernels of the cpu
+	template <typename A, typename B>
+	void Multiply(const A& m0, const B& m1, typename Product<A, B>::Type& m2)
+	{
+		Scalar::MultiplyShaped<A::ROWS, B::ROWS>(m0.m, m1.m, m2.m);
+	}
+
+	template <>
+	void Multiply<Affine3x4, Affine3x4>(const Affine3x4& m0, const Affine3x4& m1, Affine3x4& m2);
+
+	// builds n rotation matrices rz(r_x[i]) * ry(r_y[i]) * rx(r_z[i]) into the batch m
+	void FromEulerBatch(const float* r_x, const float* r_y, const float* r_z, float* m, size_t n);
+}
@@ -0,0 +1,294 @@
+#include "Mesh.h"
+#include "Log.h"
+#include "Data.h"
+
+namespace Mesh
+{
+	// the post-transform cache size the optimizer plans for, and the fifo size used to measure the result
+	enum {
+		OPTIMIZER_CACHE_SIZE = 32,
+		ANALYSIS_CACHE_SIZE  = 16
+	};
+
+	const uint32_t INVALID_INDEX = 0xFFFFFFFF;
+
+	uint32_t HashVertex(const Data::Vertex& vertex)
+	{
+		uint32_t words[sizeof(Data::Vertex) / sizeof(uint32_t)];
+		CopyMemory(words, &vertex, sizeof(Data::Vertex));
+
+		uint32_t hash = 0x811C9DC5;
+		for (uint32_t word : words)
+		{
+			hash = (hash ^ word) * 0x01000193;
+			hash ^= hash >> 15;
+		}
+
+		return hash;
+	}
+
+	// merges bitwise identical {position, color} vertices of a triangle list into a unique vertex array and an index list
+	VOID Weld(const Data::Vertex* pVertices, size_t count, IndexedMesh& mesh)
+	{
+		size_t table_size = 1;
+		while (table_size < count * 2)
+		{
+			table_size <<= 1;
+		}
+
+		std::vector<uint32_t> table(table_size, INVALID_INDEX);
+
+		mesh.vertices.clear();
+		mesh.indices.resize(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			size_t slot = HashVertex(pVertices[i]) & (table_size - 1);
+
+			// open addressing with linear probing
+			while ((table[slot] != INVALID_INDEX) && (memcmp(&mesh.vertices[table[slot]], &pVertices[i], sizeof(Data::Vertex)) != 0))
+			{
+				slot = (slot + 1) & (table_size - 1);
+			}
+
+			if (table[slot] == INVALID_INDEX)
+			{
+				table[slot] = static_cast<uint32_t>(mesh.vertices.size());
+				mesh.vertices.push_back(pVertices[i]);
+			}
+
+			mesh.indices[i] = table[slot];
+		}
+	}
+
+	// simulates a fifo post-transform cache of ANALYSIS_CACHE_SIZE entries
+	CacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count)
+	{
+		std::vector<uint32_t> timestamps(vertex_count, 0);
+		uint32_t misses = 0;
+
+		for (uint32_t index : indices)
+		{
+			// a vertex is still cached if fewer than ANALYSIS_CACHE_SIZE misses happened since it was loaded
+			if ((timestamps[index] == 0) || ((misses + 1) - timestamps[index] > ANALYSIS_CACHE_SIZE))
+			{
+				misses++;
+				timestamps[index] = misses;
+			}
+		}
+
+		CacheStatistics statistics = {};
+		statistics.acmr = (indices.size() >= 3) ? static_cast<float>(misses) / (indices.size() / 3) : 0.0f;
+		statistics.atvr = (vertex_count > 0) ? static_cast<float>(misses) / vertex_count : 0.0f;
+
+		return statistics;
+	}
+
+	/*
+	* reorders triangles for post-transform cache locality with tom forsyth's linear-speed vertex cache optimisation.
+	* every vertex is scored by its position in a simulated lru cache and by how many triangles still use it, and the
+	* next triangle is always the best scored one among the triangles touching the cache. only the triangles of cached
+	* vertices are rescored after each emit, so the cost is linear in the triangle count.
+	*/
+	VOID OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count)
+	{
+		const size_t triangle_count = indices.size() / 3;
+		const unsigned int MAX_VALENCE_SCORE = 32;
+
+		if (triangle_count == 0)
+		{
+			return;
+		}
+
+		float cache_scores[OPTIMIZER_CACHE_SIZE];
+		for (unsigned int i = 0; i < OPTIMIZER_CACHE_SIZE; i++)
+		{
+			// the vertices of the last triangle get a fixed score so the next triangle does not simply reuse them
+			cache_scores[i] = (i < 3) ? 0.75f : std::pow(1.0f - static_cast<float>(i - 3) / (OPTIMIZER_CACHE_SIZE - 3), 1.5f);
+		}
+
+		float valence_scores[MAX_VALENCE_SCORE];
+		for (unsigned int i = 1; i < MAX_VALENCE_SCORE; i++)
+		{
+			// vertices with few remaining triangles are preferred so they can leave the working set
+			valence_scores[i] = 2.0f / std::sqrt(static_cast<float>(i));
+		}
+		valence_scores[0] = 0.0f;
+
+		// per-vertex triangle adjacency in compressed rows
+		std::vector<uint32_t> live(vertex_count, 0);
+		for (uint32_t index : indices)
+		{
+			live[index]++;
+		}
+
+		std::vector<uint32_t> offsets(vertex_count + 1, 0);
+		for (size_t v = 0; v < vertex_count; v++)
+		{
+			offsets[v + 1] = offsets[v] + live[v];
+		}
+
+		std::vector<uint32_t> adjacency(indices.size());
+		std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+		for (size_t t = 0; t < triangle_count; t++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				adjacency[fill[indices[t * 3 + k]]++] = static_cast<uint32_t>(t);
+			}
+		}
+
+		std::vector<int>   cache_position(vertex_count, -1);
+		std::vector<float> vertex_score(vertex_count, 0.0f);
+		std::vector<float> triangle_score(triangle_count, 0.0f);
+		std::vector<bool>  emitted(triangle_count, false);
+
+		auto score = [&](uint32_t v) -> float
+		{
+			if (live[v] == 0)
+			{
+				return -1.0f;
+			}
+
+			float s = (cache_position[v] >= 0) ? cache_scores[cache_position[v]] : 0.0f;
+			return s + valence_scores[std::min(live[v], MAX_VALENCE_SCORE - 1)];
+		};
+
+		for (size_t v = 0; v < vertex_count; v++)
+		{
+			vertex_score[v] = score(static_cast<uint32_t>(v));
+		}
+
+		for (size_t t = 0; t < triangle_count; t++)
+		{
+			triangle_score[t] = vertex_score[indices[t * 3]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+		}
+
+		std::vector<uint32_t> output;
+		output.reserve(indices.size());
+
+		uint32_t cache[OPTIMIZER_CACHE_SIZE + 3];
+		unsigned int cache_count = 0;
+
+		size_t cursor = 0;
+		uint32_t best = INVALID_INDEX;
+
+		for (size_t n = 0; n < triangle_count; n++)
+		{
+			// nothing useful in the cache, continue with the next unemitted triangle in input order
+			if (best == INVALID_INDEX)
+			{
+				while (emitted[cursor])
+				{
+					cursor++;
+				}
+
+				best = static_cast<uint32_t>(cursor);
+			}
+
+			const uint32_t* triangle = &indices[best * 3];
+			emitted[best] = true;
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				const uint32_t v = triangle[k];
+				output.push_back(v);
+
+				// remove the triangle from the vertex's live adjacency
+				uint32_t* begin = &adjacency[offsets[v]];
+				uint32_t* end   = begin + live[v];
+				*std::find(begin, end, best) = *(end - 1);
+				live[v]--;
+			}
+
+			// move the triangle's vertices to the front of the lru cache
+			uint32_t next_cache[OPTIMIZER_CACHE_SIZE + 3];
+			unsigned int next_count = 0;
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				if (std::find(next_cache, next_cache + next_count, triangle[k]) == next_cache + next_count)
+				{
+					next_cache[next_count++] = triangle[k];
+				}
+			}
+
+			for (unsigned int i = 0; i < cache_count; i++)
+			{
+				const uint32_t v = cache[i];
+				if ((v != triangle[0]) && (v != triangle[1]) && (v != triangle[2]))
+				{
+					next_cache[next_count++] = v;
+				}
+			}
+
+			// rescore the cached vertices and the live triangles around them
+			float best_score = -1.0f;
+			best = INVALID_INDEX;
+
+			for (unsigned int i = 0; i < next_count; i++)
+			{
+				const uint32_t v = next_cache[i];
+				cache_position[v] = (i < OPTIMIZER_CACHE_SIZE) ? static_cast<int>(i) : -1;
+
+				const float s = score(v);
+				const float delta = s - vertex_score[v];
+				vertex_score[v] = s;
+
+				for (uint32_t j = offsets[v]; j < offsets[v] + live[v]; j++)
+				{
+					const uint32_t t = adjacency[j];
+					triangle_score[t] += delta;
+
+					if ((i < OPTIMIZER_CACHE_SIZE) && (triangle_score[t] > best_score))
+					{
+						best_score = triangle_score[t];
+						best = t;
+					}
+				}
+			}
+
+			cache_count = std::min(next_count, static_cast<unsigned int>(OPTIMIZER_CACHE_SIZE));
+			std::copy(next_cache, next_cache + cache_count, cache);
+		}
+
+		indices.swap(output);
+	}
+
+	// renumbers vertices in order of first use so vertex fetch walks the vertex buffer mostly linearly
+	VOID OptimizeVertexFetch(IndexedMesh& mesh)
+	{
+		std::vector<uint32_t> remap(mesh.vertices.size(), INVALID_INDEX);
+		std::vector<Data::Vertex> vertices;
+		vertices.reserve(mesh.vertices.size());
+
+		for (uint32_t& index : mesh.indices)
+		{
+			if (remap[index] == INVALID_INDEX)
+			{
+				remap[index] = static_cast<uint32_t>(vertices.size());
+				vertices.push_back(mesh.vertices[index]);
+			}
+
+			index = remap[index];
+		}
+
+		// unreferenced vertices are dropped
+		mesh.vertices.swap(vertices);
+	}
+
+	VOID Build(const Data::Vertex* pVertices, size_t count, IndexedMesh& mesh)
+	{
+		Weld(pVertices, count, mesh);
+
+		CacheStatistics before = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+		OptimizeVertexFetch(mesh);
+
+		CacheStatistics after = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		WriteToConsole("mesh: %zu vertices welded to %zu, acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+			count, mesh.vertices.size(), before.acmr, after.acmr, before.atvr, after.atvr);
+	}
+}
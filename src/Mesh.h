@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+
+namespace Mesh
+{
+	struct IndexedMesh
+	{
+		std::vector<Data::Vertex> vertices;
+		std::vector<uint32_t>     indices;
+	};
+
+	struct CacheStatistics
+	{
+		float acmr; // average cache miss ratio: transformed vertices per triangle, 0.5 is the best possible for a regular grid
+		float atvr; // average transformed vertex ratio: transformed vertices per unique vertex, 1.0 is the best possible
+	};
+
+	// welds a triangle list and optimizes it for the post-transform cache and for vertex fetch
+	VOID Build(const Data::Vertex* pVertices, size_t count, IndexedMesh& mesh);
+
+	// the steps of Build
+	VOID Weld(const Data::Vertex* pVertices, size_t count, IndexedMesh& mesh);
+	VOID OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertex_count);
+	VOID OptimizeVertexFetch(IndexedMesh& mesh);
+
+	CacheStatistics AnalyzeVertexCache(const std::vector<uint32_t>& indices, size_t vertex_count);
+}
@@ -0,0 +1,631 @@
+#include "MeshGenerator.h"
+#include "Log.h"
+#include "FastMath.h"
+#include "Data.h"
+#include "VertexPacking.h"
+#include "Culling.h"
+#include "MeshPack.h"
+#include "JobSystem.h"
+
+namespace MeshGenerator
+{
+	enum {
+		CHUNK_SIZE      = 16384, // vertices or indices per job
+		TERRAIN_OCTAVES = 6
+	};
+
+	const char* const ShapeNames[SHAPE_COUNT] = { "cube", "uvsphere", "icosphere", "grid", "terrain" };
+
+	// the terrain stays within +-TERRAIN_HEIGHT, its coarsest octave has TERRAIN_FREQUENCY cells along an edge
+	const float TERRAIN_HEIGHT = 0.15f;
+	const float TERRAIN_FREQUENCY = 4.0f;
+
+	// a square face of detail x detail quads, from origin along u and v, with u x v pointing out
+	struct Patch
+	{
+		float origin[3];
+		float u[3];
+		float v[3];
+		float color[3];
+	};
+
+	// the faces of the cube, colored like the ones of Data::Vertices
+	const Patch CubePatches[6] =
+	{
+		{ { -0.5f, -0.5f, +0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f } }, // front
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f } }, // back
+		{ { -0.5f, +0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } }, // top
+		{ { -0.5f, -0.5f, -0.5f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.5f, 0.0f } }, // bottom
+		{ { +0.5f, -0.5f, -0.5f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.5f, 0.0f, 0.5f } }, // right
+		{ { -0.5f, -0.5f, -0.5f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.5f, 0.5f } }  // left
+	};
+
+	// grids and terrains face up
+	const Patch GroundPatch = { { -0.5f, 0.0f, -0.5f }, { 0.0f, 0.0f, 1.0f }, { 1.0f, 0.0f, 0.0f }, { 0.5f, 0.5f, 0.5f } };
+
+	// the corners of the icosahedron, on a sphere of radius sqrt(1 + golden ratio^2), and its faces
+	const float IcosahedronVertices[12][3] =
+	{
+		{ -1.0f, +1.618034f, 0.0f }, { +1.0f, +1.618034f, 0.0f }, { -1.0f, -1.618034f, 0.0f }, { +1.0f, -1.618034f, 0.0f },
+		{ 0.0f, -1.0f, +1.618034f }, { 0.0f, +1.0f, +1.618034f }, { 0.0f, -1.0f, -1.618034f }, { 0.0f, +1.0f, -1.618034f },
+		{ +1.618034f, 0.0f, -1.0f }, { +1.618034f, 0.0f, +1.0f }, { -1.618034f, 0.0f, -1.0f }, { -1.618034f, 0.0f, +1.0f }
+	};
+
+	const uint8_t IcosahedronFaces[20][3] =
+	{
+		{ 0, 11, 5 }, { 0, 5, 1 },  { 0, 1, 7 },   { 0, 7, 10 }, { 0, 10, 11 },
+		{ 1, 5, 9 },  { 5, 11, 4 }, { 11, 10, 2 }, { 10, 7, 6 }, { 7, 1, 8 },
+		{ 3, 9, 4 },  { 3, 4, 2 },  { 3, 2, 6 },   { 3, 6, 8 },  { 3, 8, 9 },
+		{ 4, 9, 5 },  { 2, 4, 11 }, { 6, 2, 10 },  { 8, 6, 7 },  { 9, 8, 1 }
+	};
+
+	// the corners of a quad as steps along u and v, two clockwise triangles
+	const uint32_t QuadCorners[6][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+
+	struct GenerateJob
+	{
+		const Desc*   pDesc;
+		uint64_t      first;
+		uint64_t      count;
+		Data::Vertex* pVertices;
+		uint32_t*     pIndices;
+	};
+
+	bool FindShape(const char* name, Shape* pShape)
+	{
+		for (unsigned int i = 0; i < SHAPE_COUNT; i++)
+		{
+			if (strcmp(name, ShapeNames[i]) == 0)
+			{
+				*pShape = static_cast<Shape>(i);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	uint64_t GetFaceCount(const Desc& desc)
+	{
+		const uint64_t faces[SHAPE_COUNT] = { 6, 1, 20, 1, 1 };
+		return faces[desc.shape];
+	}
+
+	uint64_t GetVertexCount(const Desc& desc)
+	{
+		const uint64_t n = desc.detail;
+
+		switch (desc.shape)
+		{
+		case SHAPE_UV_SPHERE:
+			return (n + 1) * (2 * n + 1);
+		case SHAPE_ICOSPHERE:
+			return 20 * ((n + 1) * (n + 2) / 2);
+		default:
+			return GetFaceCount(desc) * (n + 1) * (n + 1);
+		}
+	}
+
+	uint64_t GetTriangleCount(const Desc& desc)
+	{
+		const uint64_t n = desc.detail;
+
+		switch (desc.shape)
+		{
+		case SHAPE_UV_SPHERE:
+			return 4 * n * n;
+		case SHAPE_ICOSPHERE:
+			return 20 * n * n;
+		default:
+			return GetFaceCount(desc) * 2 * n * n;
+		}
+	}
+
+	uint64_t GetIndexCount(const Desc& desc)
+	{
+		return GetTriangleCount(desc) * 3;
+	}
+
+	uint32_t GetDetail(Shape shape, uint64_t triangles)
+	{
+		Desc desc = { shape, 1, 0 };
+
+		while (GetTriangleCount(desc) < triangles)
+		{
+			desc.detail++;
+		}
+
+		return desc.detail;
+	}
+
+	INT Check(const Desc& desc)
+	{
+		INT status = STATUS_SUCCESS;
+
+		if ((desc.shape >= SHAPE_COUNT) || (desc.detail == 0) || (desc.detail > 0xFFFF) || (GetVertexCount(desc) > 0xFFFFFFFF))
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: a %s of detail %u has too many vertices for 32 bit indices\n", status,
+				(desc.shape < SHAPE_COUNT) ? ShapeNames[desc.shape] : "mesh", desc.detail);
+		}
+
+		return status;
+	}
+
+	VOID GetExtent(const Desc& desc, Data::Vertex corners[2])
+	{
+		ZeroMemory(corners, sizeof(Data::Vertex) * 2);
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			corners[0].position[k] = -0.5f;
+			corners[1].position[k] = 0.5f;
+		}
+
+		if ((desc.shape == SHAPE_GRID) || (desc.shape == SHAPE_TERRAIN))
+		{
+			corners[0].position[1] = (desc.shape == SHAPE_TERRAIN) ? -TERRAIN_HEIGHT : 0.0f;
+			corners[1].position[1] = (desc.shape == SHAPE_TERRAIN) ? TERRAIN_HEIGHT : 0.0f;
+		}
+	}
+
+	// a value in [-1, 1] for every lattice point of an octave
+	float Lattice(uint32_t seed, uint32_t octave, uint32_t x, uint32_t z)
+	{
+		uint32_t h = seed * 0x9E3779B9u ^ octave * 0x85EBCA6Bu ^ x * 0xC2B2AE35u ^ z * 0x27D4EB2Fu;
+		h ^= h >> 16;
+		h *= 0x7FEB352Du;
+		h ^= h >> 15;
+		h *= 0x846CA68Bu;
+		h ^= h >> 16;
+
+		return static_cast<float>(h >> 8) * (2.0f / 16777215.0f) - 1.0f;
+	}
+
+	// fractal value noise over [0, 1]^2, octaves of twice the frequency and half the amplitude
+	float GetTerrainHeight(uint32_t seed, float x, float z)
+	{
+		float height = 0.0f;
+		float amplitude = 1.0f;
+		float total = 0.0f;
+		float frequency = TERRAIN_FREQUENCY;
+
+		for (uint32_t octave = 0; octave < TERRAIN_OCTAVES; octave++)
+		{
+			const float fx = x * frequency;
+			const float fz = z * frequency;
+			const uint32_t ix = static_cast<uint32_t>(fx);
+			const uint32_t iz = static_cast<uint32_t>(fz);
+
+			// smoothstep between the lattice points
+			float tx = fx - static_cast<float>(ix);
+			float tz = fz - static_cast<float>(iz);
+			tx = tx * tx * (3.0f - 2.0f * tx);
+			tz = tz * tz * (3.0f - 2.0f * tz);
+
+			const float h0 = Lattice(seed, octave, ix, iz) + (Lattice(seed, octave, ix + 1, iz) - Lattice(seed, octave, ix, iz)) * tx;
+			const float h1 = Lattice(seed, octave, ix, iz + 1) + (Lattice(seed, octave, ix + 1, iz + 1) - Lattice(seed, octave, ix, iz + 1)) * tx;
+
+			height += (h0 + (h1 - h0) * tz) * amplitude;
+			total += amplitude;
+			amplitude *= 0.5f;
+			frequency *= 2.0f;
+		}
+
+		return height / total * TERRAIN_HEIGHT;
+	}
+
+	VOID GetPatchVertex(const Patch& patch, uint32_t detail, uint64_t k, Data::Vertex& vertex)
+	{
+		const float s = static_cast<float>(k / (detail + 1)) / detail;
+		const float t = static_cast<float>(k % (detail + 1)) / detail;
+
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			vertex.position[c] = patch.origin[c] + patch.u[c] * s + patch.v[c] * t;
+			vertex.color[c] = patch.color[c];
+		}
+	}
+
+	VOID GetVertex(const Desc& desc, uint64_t i, Data::Vertex& vertex)
+	{
+		const uint32_t n = desc.detail;
+
+		if (desc.shape == SHAPE_CUBE)
+		{
+			const uint64_t face_vertices = static_cast<uint64_t>(n + 1) * (n + 1);
+			GetPatchVertex(CubePatches[i / face_vertices], n, i % face_vertices, vertex);
+		}
+		else if ((desc.shape == SHAPE_GRID) || (desc.shape == SHAPE_TERRAIN))
+		{
+			GetPatchVertex(GroundPatch, n, i, vertex);
+
+			const float x = vertex.position[0] + 0.5f;
+			const float z = vertex.position[2] + 0.5f;
+
+			if (desc.shape == SHAPE_TERRAIN)
+			{
+				// from green valleys to white peaks
+				vertex.position[1] = GetTerrainHeight(desc.seed, x, z);
+
+				const float h = (vertex.position[1] / TERRAIN_HEIGHT + 1.0f) * 0.5f;
+				vertex.color[0] = 0.2f + 0.8f * h * h;
+				vertex.color[1] = 0.5f + 0.5f * h;
+				vertex.color[2] = 0.2f + 0.8f * h * h;
+			}
+			else
+			{
+				vertex.color[0] = x;
+				vertex.color[1] = z;
+			}
+		}
+		else
+		{
+			float p[3];
+
+			if (desc.shape == SHAPE_UV_SPHERE)
+			{
+				// stacks from the top down, slices around y. the poles and the seam are exact, so that the triangles
+				// at the poles are degenerate and the last slice meets the first one
+				const uint32_t stack = static_cast<uint32_t>(i / (2 * n + 1));
+				const uint32_t slice = static_cast<uint32_t>(i % (2 * n + 1)) % (2 * n);
+
+				float sin_theta, cos_theta, sin_phi, cos_phi;
+				FastMath::SinCos(static_cast<float>(M_PI) * stack / n, &sin_theta, &cos_theta);
+				FastMath::SinCos(static_cast<float>(M_PI) * slice / n, &sin_phi, &cos_phi);
+
+				if ((stack == 0) || (stack == n))
+				{
+					sin_theta = 0.0f;
+					cos_theta = (stack == 0) ? 1.0f : -1.0f;
+				}
+
+				p[0] = sin_theta * cos_phi;
+				p[1] = cos_theta;
+				p[2] = sin_theta * sin_phi;
+			}
+			else
+			{
+				// row r of face f holds r + 1 vertices from the edge ab to the edge ac, counted from a
+				const uint64_t face_vertices = static_cast<uint64_t>(n + 1) * (n + 2) / 2;
+				const uint8_t* face = IcosahedronFaces[i / face_vertices];
+				const uint64_t k = i % face_vertices;
+
+				uint64_t r = static_cast<uint64_t>((std::sqrt(8.0 * k + 1.0) - 1.0) * 0.5);
+				r -= (r * (r + 1) / 2 > k) ? 1 : 0;
+				r += ((r + 1) * (r + 2) / 2 <= k) ? 1 : 0;
+
+				const float s = static_cast<float>(r) / n;
+				const float t = static_cast<float>(k - r * (r + 1) / 2) / n;
+
+				const float* a = IcosahedronVertices[face[0]];
+				const float* b = IcosahedronVertices[face[1]];
+				const float* c = IcosahedronVertices[face[2]];
+
+				float length = 0.0f;
+
+				for (unsigned int j = 0; j < 3; j++)
+				{
+					p[j] = a[j] + (b[j] - a[j]) * s + (c[j] - b[j]) * t;
+					length += p[j] * p[j];
+				}
+
+				const float scale = 1.0f / std::sqrt(length);
+
+				for (unsigned int j = 0; j < 3; j++)
+				{
+					p[j] *= scale;
+				}
+			}
+
+			for (unsigned int j = 0; j < 3; j++)
+			{
+				vertex.position[j] = p[j] * 0.5f;
+				vertex.color[j] = p[j] * 0.5f + 0.5f;
+			}
+		}
+	}
+
+	uint32_t GetIndex(const Desc& desc, uint64_t k)
+	{
+		const uint64_t n = desc.detail;
+		const uint64_t triangle = k / 3;
+		const unsigned int corner = static_cast<unsigned int>(k % 3);
+
+		if (desc.shape == SHAPE_UV_SPHERE)
+		{
+			// quad (stack, slice) as the triangles a c b and c d b, where b is a stack further down and c a slice further
+			const unsigned int UV_CORNERS[6][2] = { { 0, 0 }, { 0, 1 }, { 1, 0 }, { 0, 1 }, { 1, 1 }, { 1, 0 } };
+			const uint64_t quad = triangle / 2;
+			const unsigned int* step = UV_CORNERS[(triangle % 2) * 3 + corner];
+
+			return static_cast<uint32_t>((quad / (2 * n) + step[0]) * (2 * n + 1) + quad % (2 * n) + step[1]);
+		}
+		else if (desc.shape == SHAPE_ICOSPHERE)
+		{
+			// row r of a face holds 2 r + 1 triangles, alternately pointing away from a and toward it
+			const uint64_t face = triangle / (n * n);
+			const uint64_t t = triangle % (n * n);
+
+			uint64_t r = static_cast<uint64_t>(std::sqrt(static_cast<double>(t)));
+			r -= (r * r > t) ? 1 : 0;
+			r += ((r + 1) * (r + 1) <= t) ? 1 : 0;
+
+			const uint64_t u = t - r * r;
+			const uint64_t c = u / 2;
+
+			const uint64_t UP[3][2] = { { 0, 0 }, { 1, 0 }, { 1, 1 } };
+			const uint64_t DOWN[3][2] = { { 0, 0 }, { 1, 1 }, { 0, 1 } };
+			const uint64_t* step = (u % 2 == 0) ? UP[corner] : DOWN[corner];
+
+			const uint64_t row = r + step[0];
+			return static_cast<uint32_t>(face * ((n + 1) * (n + 2) / 2) + row * (row + 1) / 2 + c + step[1]);
+		}
+		else
+		{
+			const uint64_t face = triangle / (2 * n * n);
+			const uint64_t quad = (triangle / 2) % (n * n);
+			const uint32_t* step = QuadCorners[(triangle % 2) * 3 + corner];
+
+			return static_cast<uint32_t>(face * (n + 1) * (n + 1) + (quad / n + step[0]) * (n + 1) + quad % n + step[1]);
+		}
+	}
+
+	/*
+	* the indices [begin, end) of the mesh, the same as GetIndex. whole quads, or triangles of the icosphere, are written
+	* while stepping through the rows, without the divisions of GetIndex, and only the ends of the range go through it.
+	*/
+	VOID GetIndices(const Desc& desc, uint64_t begin, uint64_t end, uint32_t* pIndices)
+	{
+		const uint64_t n = desc.detail;
+		const uint64_t unit = (desc.shape == SHAPE_ICOSPHERE) ? 3 : 6;
+
+		uint64_t k = begin;
+
+		for (; (k < end) && (k % unit != 0); k++)
+		{
+			*pIndices++ = GetIndex(desc, k);
+		}
+
+		const uint64_t whole_end = (k < end) ? end - (end - k) % unit : k;
+
+		if ((desc.shape == SHAPE_ICOSPHERE) && (k < whole_end))
+		{
+			const uint64_t face_vertices = (n + 1) * (n + 2) / 2;
+			const uint64_t triangle = k / 3;
+
+			uint64_t face = triangle / (n * n);
+			uint64_t r = static_cast<uint64_t>(std::sqrt(static_cast<double>(triangle % (n * n))));
+			r -= (r * r > triangle % (n * n)) ? 1 : 0;
+			r += ((r + 1) * (r + 1) <= triangle % (n * n)) ? 1 : 0;
+			uint64_t u = triangle % (n * n) - r * r;
+
+			for (; k < whole_end; k += 3, pIndices += 3)
+			{
+				const uint32_t row = static_cast<uint32_t>(face * face_vertices + r * (r + 1) / 2 + u / 2);
+				const uint32_t next = row + static_cast<uint32_t>(r + 1);
+
+				pIndices[0] = row;
+				pIndices[1] = (u % 2 == 0) ? next : next + 1;
+				pIndices[2] = (u % 2 == 0) ? next + 1 : row + 1;
+
+				if (++u == 2 * r + 1)
+				{
+					u = 0;
+
+					if (++r == n)
+					{
+						r = 0;
+						face++;
+					}
+				}
+			}
+		}
+		else if (k < whole_end)
+		{
+			// a uv sphere is a single face of n rows of 2 n quads
+			const bool sphere = (desc.shape == SHAPE_UV_SPHERE);
+			const uint64_t columns = sphere ? 2 * n : n;
+			const uint32_t stride = static_cast<uint32_t>(columns + 1);
+			const uint64_t face_vertices = (n + 1) * stride;
+
+			const uint32_t PATCH_OFFSETS[6] = { 0, stride, 1, 1, stride, stride + 1 };
+			const uint32_t SPHERE_OFFSETS[6] = { 0, 1, stride, 1, stride + 1, stride };
+			const uint32_t* offsets = sphere ? SPHERE_OFFSETS : PATCH_OFFSETS;
+
+			const uint64_t quad = k / 6;
+			uint64_t face = quad / (n * columns);
+			uint64_t row = quad % (n * columns) / columns;
+			uint64_t column = quad % columns;
+
+			for (; k < whole_end; k += 6, pIndices += 6)
+			{
+				const uint32_t base = static_cast<uint32_t>(face * face_vertices + row * stride + column);
+
+				for (unsigned int j = 0; j < 6; j++)
+				{
+					pIndices[j] = base + offsets[j];
+				}
+
+				if (++column == columns)
+				{
+					column = 0;
+
+					if (++row == n)
+					{
+						row = 0;
+						face++;
+					}
+				}
+			}
+		}
+
+		for (; k < end; k++)
+		{
+			*pIndices++ = GetIndex(desc, k);
+		}
+	}
+
+	VOID VertexJob(VOID* pData, size_t begin, size_t end)
+	{
+		const GenerateJob& job = *static_cast<const GenerateJob*>(pData);
+
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			const uint64_t first = chunk * static_cast<uint64_t>(CHUNK_SIZE);
+			const uint64_t last = std::min<uint64_t>(first + CHUNK_SIZE, job.count);
+
+			for (uint64_t i = first; i < last; i++)
+			{
+				GetVertex(*job.pDesc, job.first + i, job.pVertices[i]);
+			}
+		}
+	}
+
+	VOID IndexJob(VOID* pData, size_t begin, size_t end)
+	{
+		const GenerateJob& job = *static_cast<const GenerateJob*>(pData);
+
+		for (size_t chunk = begin; chunk < end; chunk++)
+		{
+			const uint64_t first = chunk * static_cast<uint64_t>(CHUNK_SIZE);
+			const uint64_t last = std::min<uint64_t>(first + CHUNK_SIZE, job.count);
+
+			GetIndices(*job.pDesc, job.first + first, job.first + last, &job.pIndices[first]);
+		}
+	}
+
+	VOID GenerateVertices(const Desc& desc, uint64_t first, uint64_t count, Data::Vertex* pVertices, JobSystem& jobs)
+	{
+		GenerateJob job = { &desc, first, count, pVertices, NULL };
+		jobs.ParallelFor("GenerateVertices", VertexJob, &job, static_cast<size_t>((count + CHUNK_SIZE - 1) / CHUNK_SIZE), 1);
+	}
+
+	VOID GenerateIndices(const Desc& desc, uint64_t first, uint64_t count, uint32_t* pIndices, JobSystem& jobs)
+	{
+		GenerateJob job = { &desc, first, count, NULL, pIndices };
+		jobs.ParallelFor("GenerateIndices", IndexJob, &job, static_cast<size_t>((count + CHUNK_SIZE - 1) / CHUNK_SIZE), 1);
+	}
+
+	struct PackJob
+	{
+		VertexPacking::Format   format;
+		const Data::MeshBuffer* pDequantization;
+		const Data::Vertex*     pVertices;
+		BYTE*                   pPacked;
+		size_t                  count;
+	};
+
+	VOID PackVerticesJob(VOID* pData, size_t begin, size_t end)
+	{
+		const PackJob& job = *static_cast<const PackJob*>(pData);
+
+		const size_t first = begin * CHUNK_SIZE;
+		const size_t last = std::min<size_t>(end * CHUNK_SIZE, job.count);
+
+		VertexPacking::Pack(job.format, job.pVertices + first, last - first, *job.pDequantization, job.pPacked + first * VertexPacking::Layouts[job.format].stride);
+	}
+
+	INT WritePack(const char* path, const Desc& desc, VertexPacking::Format format, JobSystem& jobs)
+	{
+		const size_t BLOCK_SIZE = 1 << 22;
+
+		INT status = Check(desc);
+
+		MeshPack::Header header = {};
+		const bool short_indices = (GetVertexCount(desc) <= 0xFFFF);
+
+		if (SUCCEEDED(status))
+		{
+			Data::Vertex corners[2];
+			GetExtent(desc, corners);
+
+			header.magic = MeshPack::PACK_MAGIC;
+			header.version = MeshPack::PACK_VERSION;
+			header.stream_count = MeshPack::STREAM_COUNT;
+			header.vertex_count = GetVertexCount(desc);
+			header.index_count = GetIndexCount(desc);
+			VertexPacking::ComputeDequantization(format, corners, 2, header.dequantization);
+			Culling::ComputeBounds(corners, 2, header.bounds);
+
+			header.streams[MeshPack::STREAM_VERTICES].size = header.vertex_count * VertexPacking::Layouts[format].stride;
+			header.streams[MeshPack::STREAM_VERTICES].stride = VertexPacking::Layouts[format].stride;
+			header.streams[MeshPack::STREAM_VERTICES].format = format;
+
+			header.streams[MeshPack::STREAM_INDICES].stride = short_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+			header.streams[MeshPack::STREAM_INDICES].size = header.index_count * header.streams[MeshPack::STREAM_INDICES].stride;
+			header.streams[MeshPack::STREAM_INDICES].format = short_indices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+		}
+
+		MeshPackWriter writer;
+
+		if (SUCCEEDED(status))
+		{
+			status = writer.Begin(path, header);
+
+			std::vector<Data::Vertex> vertices(static_cast<size_t>(std::min<uint64_t>(BLOCK_SIZE, header.vertex_count)));
+			std::vector<BYTE> packed(vertices.size() * VertexPacking::Layouts[format].stride);
+
+			for (uint64_t first = 0; (first < header.vertex_count) && SUCCEEDED(status); first += BLOCK_SIZE)
+			{
+				const size_t count = static_cast<size_t>(std::min<uint64_t>(BLOCK_SIZE, header.vertex_count - first));
+
+				GenerateVertices(desc, first, count, vertices.data(), jobs);
+
+				PackJob job = { format, &header.dequantization, vertices.data(), packed.data(), count };
+				jobs.ParallelFor("PackVertices", PackVerticesJob, &job, (count + CHUNK_SIZE - 1) / CHUNK_SIZE, 1);
+
+				status = writer.Write(packed.data(), count * VertexPacking::Layouts[format].stride);
+			}
+
+			std::vector<uint32_t> indices(static_cast<size_t>(std::min<uint64_t>(BLOCK_SIZE, header.index_count)));
+			std::vector<uint16_t> indices16;
+
+			for (uint64_t first = 0; (first < header.index_count) && SUCCEEDED(status); first += BLOCK_SIZE)
+			{
+				const size_t count = static_cast<size_t>(std::min<uint64_t>(BLOCK_SIZE, header.index_count - first));
+
+				GenerateIndices(desc, first, count, indices.data(), jobs);
+
+				if (short_indices)
+				{
+					indices16.assign(indices.begin(), indices.begin() + count);
+					status = writer.Write(indices16.data(), count * sizeof(uint16_t));
+				}
+				else
+				{
+					status = writer.Write(indices.data(), count * sizeof(uint32_t));
+				}
+			}
+
+			if (SUCCEEDED(status))
+			{
+				status = writer.End();
+			}
+			else
+			{
+				writer.Abort();
+			}
+		}
+
+		return status;
+	}
+}
+
+INT GenerateMesh(const char* packPath, const MeshGenerator::Desc& desc, VertexPacking::Format format, JobSystem& jobs)
+{
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	INT status = MeshGenerator::WritePack(packPath, desc, format, jobs);
+
+	if (SUCCEEDED(status))
+	{
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		WriteToConsole("generated %s: a %s of detail %u, %llu triangles, %llu vertices in %s, %.2f s\n", packPath, MeshGenerator::ShapeNames[desc.shape], desc.detail,
+			static_cast<unsigned long long>(MeshGenerator::GetTriangleCount(desc)), static_cast<unsigned long long>(MeshGenerator::GetVertexCount(desc)),
+			VertexPacking::Layouts[format].name, seconds);
+	}
+
+	return status;
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "VertexPacking.h"
+#include "JobSystem.h"
+
+/*
+* procedural meshes for scale tests, in the Data::Vertex layout with 32 bit indices: subdivided cubes, uv spheres,
+* icospheres, flat grids and heightfield terrains. every vertex and index is a function of its position in its stream,
+* so any range of either can be generated on its own, in parallel chunks and straight into the memory of the caller,
+* a mapped buffer or a block of a pack that is streamed to disk. the result depends only on the Desc, not on the
+* chunks or the threads that made it. outward faces are clockwise on screen like every other mesh of the application,
+* their (b - a) x (c - a) points out of the surface.
+*
+* detail subdivides the edges: grids and terrains have 2 detail^2 triangles, cubes 12 detail^2, uv spheres 4 detail^2
+* (detail stacks of 2 detail slices, the triangles at the poles are degenerate) and icospheres 20 detail^2. vertices on
+* the edges of faces are not shared, so that every face keeps to a simple grid.
+*/
+namespace MeshGenerator
+{
+	enum Shape {
+		SHAPE_CUBE      = 0,
+		SHAPE_UV_SPHERE = 1,
+		SHAPE_ICOSPHERE = 2,
+		SHAPE_GRID      = 3,
+		SHAPE_TERRAIN   = 4,
+		SHAPE_COUNT     = 5
+	};
+
+	extern const char* const ShapeNames[SHAPE_COUNT];
+
+	struct Desc
+	{
+		Shape    shape;
+		uint32_t detail;
+		uint32_t seed;   // only the terrain is random
+	};
+
+	bool FindShape(const char* name, Shape* pShape);
+
+	uint64_t GetVertexCount(const Desc& desc);
+
+	uint64_t GetTriangleCount(const Desc& desc);
+
+	uint64_t GetIndexCount(const Desc& desc);
+
+	// the smallest detail that gives the shape at least triangles triangles
+	uint32_t GetDetail(Shape shape, uint64_t triangles);
+
+	// 32 bit indices have to reach every vertex
+	INT Check(const Desc& desc);
+
+	// a box around every vertex the shape can have
+	VOID GetExtent(const Desc& desc, Data::Vertex corners[2]);
+
+	uint32_t GetIndex(const Desc& desc, uint64_t k);
+
+	// the vertices [first, first + count) of the mesh into pVertices
+	VOID GenerateVertices(const Desc& desc, uint64_t first, uint64_t count, Data::Vertex* pVertices, JobSystem& jobs);
+
+	// the indices [first, first + count) of the mesh into pIndices
+	VOID GenerateIndices(const Desc& desc, uint64_t first, uint64_t count, uint32_t* pIndices, JobSystem& jobs);
+
+	/*
+	* generates the mesh into a pack at path, a block at a time so that the mesh can be larger than memory. the block is
+	* generated and packed in parallel, then written while the file is the only thing the pack waits for. the positions
+	* are quantized against GetExtent, 16 bit indices are used whenever the vertex count allows them.
+	*/
+	INT WritePack(const char* path, const Desc& desc, VertexPacking::Format format, JobSystem& jobs);
+}
+
+// generates a mesh into a pack for -mesh, see MeshGenerator
+INT GenerateMesh(const char* packPath, const MeshGenerator::Desc& desc, VertexPacking::Format format, JobSystem& jobs);
@@ -0,0 +1,581 @@
+#include "MeshPack.h"
+#include "Log.h"
+#include "Data.h"
+#include "Fnv.h"
+#include "Mesh.h"
+#include "VertexPacking.h"
+#include "Culling.h"
+#include "FileMapping.h"
+
+MeshPack::MeshPack()
+{
+	m_pView = NULL;
+}
+
+INT MeshPack::Open(const char* path)
+{
+	INT status = STATUS_SUCCESS;
+
+	m_Path = path;
+
+	status = m_File.Open(path);
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: could not open the mesh %s\n", status, path);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		if (m_File.GetSize() < sizeof(Header))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the mesh %s is too small for its header\n", status, path);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = m_File.Map();
+		m_pView = m_File.GetData();
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not map the mesh %s\n", status, path);
+		}
+	}
+
+	// everything the renderer relies on is checked here, the streams only have to lie inside of the file
+	if (SUCCEEDED(status))
+	{
+		Header header;
+		CopyMemory(&header, m_pView, sizeof(Header));
+
+		const uint32_t checksum = header.checksum;
+		header.checksum = 0;
+
+		bool valid = (header.magic == PACK_MAGIC) && (header.version == PACK_VERSION) && (header.file_size == m_File.GetSize()) &&
+			(Fnv::Checksum(&header, sizeof(Header)) == checksum) && (header.stream_count == STREAM_COUNT) && (header.streams[STREAM_VERTICES].format < VertexPacking::FORMAT_COUNT);
+
+		if (valid)
+		{
+			const Stream& vertices = header.streams[STREAM_VERTICES];
+			const Stream& indices = header.streams[STREAM_INDICES];
+
+			valid = (vertices.stride == VertexPacking::Layouts[vertices.format].stride) &&
+				(((indices.stride == sizeof(uint16_t)) && (indices.format == DXGI_FORMAT_R16_UINT)) || ((indices.stride == sizeof(uint32_t)) && (indices.format == DXGI_FORMAT_R32_UINT))) &&
+				(vertices.size / vertices.stride == header.vertex_count) && (vertices.size % vertices.stride == 0) &&
+				(indices.size / indices.stride == header.index_count) && (indices.size % indices.stride == 0);
+		}
+
+		for (unsigned int i = 0; valid && (i < STREAM_COUNT); i++)
+		{
+			const Stream& stream = header.streams[i];
+
+			valid = (stream.offset % STREAM_ALIGNMENT == 0) && (stream.offset >= sizeof(Header)) && (stream.offset <= header.file_size) && (stream.size <= header.file_size - stream.offset);
+		}
+
+		if (!valid)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the mesh %s is damaged or from another version\n", status, path);
+		}
+	}
+
+	if (FAILED(status))
+	{
+		Close();
+	}
+
+	return status;
+}
+
+VOID MeshPack::Close()
+{
+	m_File.Close();
+	m_pView = NULL;
+}
+
+// only valid while the pack is open
+const MeshPack::Header& MeshPack::GetHeader()
+{
+	return *reinterpret_cast<const Header*>(m_pView);
+}
+
+const void* MeshPack::GetStream(unsigned int stream)
+{
+	return m_pView + GetHeader().streams[stream].offset;
+}
+
+// copies the mesh out of the pack as floats for the cpu, this reads every page of the streams
+INT MeshPack::Unpack(Mesh::IndexedMesh& mesh)
+{
+	INT status = STATUS_SUCCESS;
+
+	const Header& header = GetHeader();
+	const Stream& indices = header.streams[STREAM_INDICES];
+
+	VertexPacking::Unpack(static_cast<VertexPacking::Format>(header.streams[STREAM_VERTICES].format), static_cast<const BYTE*>(GetStream(STREAM_VERTICES)),
+		static_cast<size_t>(header.vertex_count), header.dequantization, mesh.vertices);
+
+	mesh.indices.resize(static_cast<size_t>(header.index_count));
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		const BYTE* pIndex = static_cast<const BYTE*>(GetStream(STREAM_INDICES)) + i * indices.stride;
+		mesh.indices[i] = (indices.stride == sizeof(uint16_t)) ? *reinterpret_cast<const uint16_t*>(pIndex) : *reinterpret_cast<const uint32_t*>(pIndex);
+
+		// unlike the gpu the cpu does not forgive indices out of range
+		if (mesh.indices[i] >= header.vertex_count)
+		{
+			status = STATUS_DATA_ERROR;
+		}
+	}
+
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: the mesh %s has indices past its vertices\n", status, m_Path.c_str());
+	}
+
+	return status;
+}
+
+// places the streams after the header, each on the next page, and sets the file size
+VOID MeshPack::Layout(Header& header)
+{
+	uint64_t offset = sizeof(Header);
+
+	for (unsigned int i = 0; i < STREAM_COUNT; i++)
+	{
+		offset = (offset + STREAM_ALIGNMENT - 1) & ~static_cast<uint64_t>(STREAM_ALIGNMENT - 1);
+
+		header.streams[i].offset = offset;
+		offset += header.streams[i].size;
+	}
+
+	header.file_size = offset;
+}
+
+// packs the mesh into format, with 16 bit indices whenever the vertex count allows it
+INT MeshPack::Write(const char* path, VertexPacking::Format format, const Mesh::IndexedMesh& mesh)
+{
+	INT status = STATUS_SUCCESS;
+
+	Header header = {};
+	std::vector<BYTE> vertices;
+	std::vector<uint16_t> indices16;
+
+	VertexPacking::ComputeDequantization(format, mesh.vertices.data(), mesh.vertices.size(), header.dequantization);
+	status = VertexPacking::PackChecked(format, mesh.vertices.data(), mesh.vertices.size(), header.dequantization, vertices);
+
+	const bool short_indices = (mesh.vertices.size() <= 0xFFFF);
+	if (short_indices)
+	{
+		indices16.assign(mesh.indices.begin(), mesh.indices.end());
+	}
+
+	if (SUCCEEDED(status))
+	{
+		header.magic = PACK_MAGIC;
+		header.version = PACK_VERSION;
+		header.stream_count = STREAM_COUNT;
+		header.vertex_count = mesh.vertices.size();
+		header.index_count = mesh.indices.size();
+		Culling::ComputeBounds(mesh.vertices.data(), mesh.vertices.size(), header.bounds);
+
+		header.streams[STREAM_VERTICES].size = vertices.size();
+		header.streams[STREAM_VERTICES].stride = VertexPacking::Layouts[format].stride;
+		header.streams[STREAM_VERTICES].format = format;
+
+		header.streams[STREAM_INDICES].stride = short_indices ? sizeof(uint16_t) : sizeof(uint32_t);
+		header.streams[STREAM_INDICES].size = header.index_count * header.streams[STREAM_INDICES].stride;
+		header.streams[STREAM_INDICES].format = short_indices ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+
+		MeshPackWriter writer;
+
+		status = writer.Begin(path, header);
+
+		if (SUCCEEDED(status))
+		{
+			status = writer.Write(vertices.data(), vertices.size());
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = short_indices ? writer.Write(indices16.data(), indices16.size() * sizeof(uint16_t)) : writer.Write(mesh.indices.data(), mesh.indices.size() * sizeof(uint32_t));
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = writer.End();
+		}
+		else
+		{
+			writer.Abort();
+		}
+	}
+
+	return status;
+}
+
+MeshPackWriter::MeshPackWriter()
+{
+	m_pFile = NULL;
+	ZeroMemory(&m_Header, sizeof(m_Header));
+	m_Stream = 0;
+	m_Written = 0;
+}
+
+INT MeshPackWriter::Begin(const char* path, const MeshPack::Header& header)
+{
+	INT status = STATUS_SUCCESS;
+
+	m_Path = path;
+	m_TempPath = m_Path + ".tmp";
+	m_Header = header;
+	m_Stream = 0;
+	m_Written = 0;
+
+	MeshPack::Layout(m_Header);
+	m_Header.checksum = 0;
+	m_Header.checksum = Fnv::Checksum(&m_Header, sizeof(m_Header));
+
+	m_pFile = OpenFileStream(m_TempPath.c_str(), "wb");
+	if (m_pFile == NULL)
+	{
+		status = GetErrnoStatus();
+		WriteToConsole("error 0x%X: could not create %s\n", status, m_TempPath.c_str());
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = WriteFileData(&m_Header, sizeof(m_Header));
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = Pad(m_Header.streams[0].offset - sizeof(m_Header));
+	}
+
+	return status;
+}
+
+INT MeshPackWriter::Write(const void* pData, size_t size)
+{
+	INT status = Advance();
+
+	const BYTE* pBytes = static_cast<const BYTE*>(pData);
+
+	while ((size != 0) && SUCCEEDED(status))
+	{
+		if (m_Stream == MeshPack::STREAM_COUNT)
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: more data than the streams of %s hold\n", status, m_Path.c_str());
+			break;
+		}
+
+		const uint64_t part = std::min<uint64_t>(size, m_Header.streams[m_Stream].size - m_Written);
+
+		status = WriteFileData(pBytes, part);
+
+		pBytes += part;
+		size -= static_cast<size_t>(part);
+		m_Written += part;
+
+		if (SUCCEEDED(status))
+		{
+			status = Advance();
+		}
+	}
+
+	return status;
+}
+
+INT MeshPackWriter::End()
+{
+	INT status = Advance();
+
+	if (SUCCEEDED(status) && (m_Stream != MeshPack::STREAM_COUNT))
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: the streams of %s were not written completely\n", status, m_Path.c_str());
+	}
+
+	// fclose writes out what is still buffered, so it can fail the same way a write does
+	if (SUCCEEDED(status))
+	{
+		errno = 0;
+
+		const bool closed = (fclose(m_pFile) == 0);
+		m_pFile = NULL;
+
+		if (!closed)
+		{
+			status = (errno != 0) ? GetErrnoStatus() : STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: could not write %s\n", status, m_TempPath.c_str());
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = MoveFileOver(m_TempPath.c_str(), m_Path.c_str());
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not replace %s\n", status, m_Path.c_str());
+		}
+	}
+
+	if (FAILED(status))
+	{
+		Abort();
+	}
+
+	return status;
+}
+
+VOID MeshPackWriter::Abort()
+{
+	if (m_pFile != NULL)
+	{
+		fclose(m_pFile);
+		m_pFile = NULL;
+	}
+
+	remove(m_TempPath.c_str());
+}
+
+// pads up to the next stream for every stream that is complete, empty ones included
+INT MeshPackWriter::Advance()
+{
+	INT status = STATUS_SUCCESS;
+
+	while ((m_Stream < MeshPack::STREAM_COUNT) && (m_Written == m_Header.streams[m_Stream].size) && SUCCEEDED(status))
+	{
+		const uint64_t end = m_Header.streams[m_Stream].offset + m_Header.streams[m_Stream].size;
+		const uint64_t next = (m_Stream + 1 < MeshPack::STREAM_COUNT) ? m_Header.streams[m_Stream + 1].offset : m_Header.file_size;
+
+		status = Pad(next - end);
+
+		m_Stream++;
+		m_Written = 0;
+	}
+
+	return status;
+}
+
+// in parts that fit a 32 bit size_t. a full disk can cut a write short without setting errno, which is still a failure
+INT MeshPackWriter::WriteFileData(const void* pData, uint64_t size)
+{
+	INT status = STATUS_SUCCESS;
+
+	const BYTE* pBytes = static_cast<const BYTE*>(pData);
+
+	while ((size != 0) && SUCCEEDED(status))
+	{
+		const size_t part = static_cast<size_t>(std::min<uint64_t>(size, 1 << 30));
+
+		errno = 0;
+
+		if (fwrite(pBytes, 1, part, m_pFile) != part)
+		{
+			status = (errno != 0) ? GetErrnoStatus() : STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: could not write %s\n", status, m_TempPath.c_str());
+		}
+
+		pBytes += part;
+		size -= part;
+	}
+
+	return status;
+}
+
+INT MeshPackWriter::Pad(uint64_t size)
+{
+	const BYTE zeros[MeshPack::STREAM_ALIGNMENT] = {};
+
+	return WriteFileData(zeros, size);
+}
+
+INT ConvertObj(const char* objPath, const char* packPath, VertexPacking::Format format)
+{
+	INT status = STATUS_SUCCESS;
+
+	FileMapping file;
+	const char* pView = NULL;
+
+	status = file.Open(objPath);
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: could not open %s\n", status, objPath);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		if (file.GetSize() == 0)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s is empty\n", status, objPath);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = file.Map();
+		pView = reinterpret_cast<const char*>(file.GetData());
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not map %s\n", status, objPath);
+		}
+	}
+
+	std::vector<Data::Vertex> positions;
+	std::vector<bool> colored;
+	std::vector<uint32_t> triangles;
+
+	if (SUCCEEDED(status))
+	{
+		const char* p = pView;
+		const char* end = pView + file.GetSize();
+
+		std::string line;
+		std::vector<uint32_t> polygon;
+		size_t line_number = 0;
+
+		while ((p < end) && SUCCEEDED(status))
+		{
+			const char* line_end = static_cast<const char*>(memchr(p, '\n', end - p));
+			line_end = (line_end != NULL) ? line_end : end;
+
+			// copied so that the number parsers stop at the end of the line
+			line.assign(p, line_end);
+			p = (line_end < end) ? line_end + 1 : end;
+			line_number++;
+
+			const char* c = line.c_str();
+			while ((*c == ' ') || (*c == '\t'))
+			{
+				c++;
+			}
+
+			if ((c[0] == 'v') && ((c[1] == ' ') || (c[1] == '\t')))
+			{
+				float values[6];
+				unsigned int count = 0;
+				char* next = const_cast<char*>(c + 1);
+
+				for (; count < 6; count++)
+				{
+					char* number_end;
+					values[count] = strtof(next, &number_end);
+
+					if (number_end == next)
+					{
+						break;
+					}
+
+					next = number_end;
+				}
+
+				if (count < 3)
+				{
+					status = STATUS_DATA_ERROR;
+					WriteToConsole("error 0x%X: %s(%zu): a vertex needs three coordinates\n", status, objPath, line_number);
+				}
+
+				Data::Vertex vertex = {};
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					vertex.position[k] = values[k];
+					vertex.color[k] = (count == 6) ? std::min(std::max(values[3 + k], 0.0f), 1.0f) : 0.0f;
+				}
+
+				positions.push_back(vertex);
+				colored.push_back(count == 6);
+			}
+			else if ((c[0] == 'f') && ((c[1] == ' ') || (c[1] == '\t')))
+			{
+				polygon.clear();
+
+				// v, v/vt, v/vt/vn or v//vn, only the position is used
+				char* next = const_cast<char*>(c + 1);
+
+				while (SUCCEEDED(status))
+				{
+					char* number_end;
+					const long index = strtol(next, &number_end, 10);
+
+					if (number_end == next)
+					{
+						break;
+					}
+
+					const long resolved = (index < 0) ? static_cast<long>(positions.size()) + index : index - 1;
+
+					if ((resolved < 0) || (static_cast<size_t>(resolved) >= positions.size()))
+					{
+						status = STATUS_DATA_ERROR;
+						WriteToConsole("error 0x%X: %s(%zu): the vertex %ld does not exist\n", status, objPath, line_number, index);
+					}
+
+					polygon.push_back(static_cast<uint32_t>(resolved));
+
+					next = number_end;
+					while ((*next != '\0') && (*next != ' ') && (*next != '\t'))
+					{
+						next++;
+					}
+				}
+
+				for (size_t i = 1; (i + 1 < polygon.size()) && SUCCEEDED(status); i++)
+				{
+					triangles.push_back(polygon[0]);
+					triangles.push_back(polygon[i]);
+					triangles.push_back(polygon[i + 1]);
+				}
+			}
+		}
+
+		if (SUCCEEDED(status) && triangles.empty())
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s has no faces\n", status, objPath);
+		}
+	}
+
+	file.Close();
+
+	if (SUCCEEDED(status))
+	{
+		Culling::Bounds bounds;
+		Culling::ComputeBounds(positions.data(), positions.size(), bounds);
+
+		for (size_t i = 0; i < positions.size(); i++)
+		{
+			for (unsigned int k = 0; (k < 3) && !colored[i]; k++)
+			{
+				const float extent = bounds.aabb_max[k] - bounds.aabb_min[k];
+				positions[i].color[k] = (extent > 0.0f) ? (positions[i].position[k] - bounds.aabb_min[k]) / extent : 0.5f;
+			}
+		}
+
+		std::vector<Data::Vertex> vertices(triangles.size());
+		for (size_t i = 0; i < triangles.size(); i++)
+		{
+			vertices[i] = positions[triangles[i]];
+		}
+
+		Mesh::IndexedMesh mesh;
+		Mesh::Build(vertices.data(), vertices.size(), mesh);
+
+		status = MeshPack::Write(packPath, format, mesh);
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("converted %s to %s: %zu triangles, %zu vertices in %s\n",
+				objPath, packPath, mesh.indices.size() / 3, mesh.vertices.size(), VertexPacking::Layouts[format].name);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "Mesh.h"
+#include "VertexPacking.h"
+#include "Culling.h"
+#include "FileMapping.h"
+
+/*
+* a mesh in a file that is used straight from a read only mapping. the streams hold the vertices in the layout of
+* their VertexPacking format and the indices in their DXGI_FORMAT, so their bytes go to the gpu as they are.
+*
+* file layout: Header, then every stream on a page boundary. only the header is read when the pack is opened, the
+* pages of the streams are faulted in when they are first touched. the header has a checksum, the streams do not,
+* which would mean reading all of them.
+*/
+class MeshPack
+{
+public:
+	enum {
+		PACK_MAGIC       = 0x4853454D, // "MESH"
+		PACK_VERSION     = 1,
+		STREAM_ALIGNMENT = 4096,
+		STREAM_VERTICES  = 0,
+		STREAM_INDICES   = 1,
+		STREAM_COUNT     = 2
+	};
+
+	struct Stream
+	{
+		uint64_t offset;
+		uint64_t size;
+		uint32_t stride;
+		uint32_t format; // VertexPacking::Format for the vertices, DXGI_FORMAT for the indices
+	};
+
+	struct Header
+	{
+		uint32_t         magic;
+		uint32_t         version;
+		uint64_t         file_size;
+		uint32_t         checksum;     // of the header with this field set to 0
+		uint32_t         stream_count;
+		uint64_t         vertex_count;
+		uint64_t         index_count;
+		Data::MeshBuffer dequantization;
+		Culling::Bounds  bounds;
+		Stream           streams[STREAM_COUNT];
+	};
+
+private:
+	std::string  m_Path;
+	FileMapping  m_File;
+	const BYTE*  m_pView;
+
+public:
+	MeshPack();
+
+	INT  Open(const char* path);
+	VOID Close();
+
+	const Header& GetHeader();
+	const void*   GetStream(unsigned int stream);
+	INT           Unpack(Mesh::IndexedMesh& mesh);
+
+	static VOID Layout(Header& header);
+	static INT  Write(const char* path, VertexPacking::Format format, const Mesh::IndexedMesh& mesh);
+};
+
+/*
+* writes a pack front to back so that streams larger than memory can be produced piece by piece. Begin takes the
+* header with everything but the stream offsets and the file size filled in, Write then appends the bytes of the
+* streams in order. the pack is written to a temporary file that replaces path in End.
+*/
+class MeshPackWriter
+{
+private:
+	std::string      m_Path;
+	std::string      m_TempPath;
+	FILE*            m_pFile;
+	MeshPack::Header m_Header;
+	unsigned int     m_Stream;
+	uint64_t         m_Written; // of the current stream
+
+public:
+	MeshPackWriter();
+
+	INT  Begin(const char* path, const MeshPack::Header& header);
+	INT  Write(const void* pData, size_t size);
+	INT  End();
+	VOID Abort();
+
+private:
+	INT Advance();
+	INT WriteFileData(const void* pData, uint64_t size);
+	INT Pad(uint64_t size);
+};
+
+/*
+* converts a wavefront obj file into a mesh pack. only the v and f lines are used, polygons are split into fans of
+* triangles. vertex colors after the position (v x y z r g b) are kept, other vertices are colored by where they lie
+* in the bounds of the model so that its shape stays readable without lighting.
+*/
+INT ConvertObj(const char* objPath, const char* packPath, VertexPacking::Format format);
@@ -0,0 +1,161 @@
+#pragma once
+
+/*
+* the types, status codes and compiler differences the cpu side is written against. on windows they come from the
+* windows headers, elsewhere the few that are used are defined here, so that the layers that do not talk to d3d or
+* the window build and run on linux as well. nothing in here includes d3d, that is left to Common.h.
+*/
+
+#if defined(_WIN32)
+
+// prevent redefinition of NTSTATUS messages
+#define UMDF_USING_NTSTATUS
+
+// prevent minwindef from defining min/max
+#define NOMINMAX
+
+#include <Windows.h>
+
+#include <ntstatus.h>
+
+#include <share.h>
+
+#endif
+
+#if defined(_M_IX86) || defined(_M_X64)
+#define SIMD_X86
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#define SIMD_X86
+#include <immintrin.h>
+#include <cpuid.h>
+#elif defined(_M_ARM64) || defined(__aarch64__)
+#define SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#define _USE_MATH_DEFINES
+#include <cctype>
+#include <cerrno>
+#include <cfloat>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <new>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#if !defined(_WIN32)
+
+#include <sys/syscall.h>
+#include <unistd.h>
+
+typedef void          VOID;
+typedef char          CHAR;
+typedef int           INT;
+typedef unsigned int  UINT;
+typedef uint8_t       BYTE;
+typedef uint8_t       UINT8;
+typedef uint32_t      UINT32;
+typedef uint64_t      UINT64;
+typedef uint32_t      DWORD;
+typedef int32_t       HRESULT;
+
+#define SUCCEEDED(hr) (static_cast<HRESULT>(hr) >= 0)
+#define FAILED(hr)    (static_cast<HRESULT>(hr) < 0)
+
+#define S_OK                     static_cast<INT>(0x00000000)
+#define STATUS_SUCCESS           static_cast<INT>(0x00000000)
+#define STATUS_UNSUCCESSFUL      static_cast<INT>(0xC0000001)
+#define STATUS_INVALID_PARAMETER static_cast<INT>(0xC000000D)
+#define STATUS_NO_MEMORY         static_cast<INT>(0xC0000017)
+#define STATUS_BUFFER_TOO_SMALL  static_cast<INT>(0xC0000023)
+#define STATUS_DATA_ERROR        static_cast<INT>(0xC000003E)
+#define STATUS_NOT_SUPPORTED     static_cast<INT>(0xC00000BB)
+#define STATUS_NOT_FOUND         static_cast<INT>(0xC0000225)
+
+// an errno as a failure status, the way windows wraps its error codes
+#define HRESULT_FROM_WIN32(error) (((error) <= 0) ? static_cast<HRESULT>(error) : static_cast<HRESULT>((static_cast<uint32_t>(error) & 0xFFFF) | 0x80070000))
+
+#define ARRAYSIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+#define CopyMemory(destination, source, length) memcpy((destination), (source), (length))
+#define ZeroMemory(destination, length)         memset((destination), 0, (length))
+
+// a system call, so it is made once per thread
+inline DWORD GetCurrentThreadId()
+{
+	static thread_local const DWORD id = static_cast<DWORD>(syscall(SYS_gettid));
+	return id;
+}
+
+#endif
+
+#if defined(SIMD_X86)
+
+// the cpuid leaf in eax, ebx, ecx, edx order, as msvc's __cpuid gives it. gcc and clang name theirs the same but take registers
+inline VOID ReadCpuid(INT info[4], INT leaf)
+{
+#if defined(_MSC_VER)
+	__cpuid(info, leaf);
+#else
+	unsigned int eax = 0, ebx = 0, ecx = 0, edx = 0;
+	__cpuid(leaf, eax, ebx, ecx, edx);
+
+	info[0] = static_cast<INT>(eax);
+	info[1] = static_cast<INT>(ebx);
+	info[2] = static_cast<INT>(ecx);
+	info[3] = static_cast<INT>(edx);
+#endif
+}
+
+// the register state the os saves on a context switch. only valid when cpuid reports osxsave
+inline UINT64 ReadXcr0()
+{
+#if defined(_MSC_VER)
+	return _xgetbv(0);
+#else
+	// the _xgetbv intrinsic needs -mxsave on gcc, so the instruction is written out
+	unsigned int eax = 0, edx = 0;
+	__asm__ __volatile__("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+
+	return (static_cast<UINT64>(edx) << 32) | eax;
+#endif
+}
+
+#endif
+
+/*
+* the errno of a c runtime call that just failed as a failure status, wrapped the way windows wraps its error codes.
+* a call can fail without setting errno, a short fwrite for example, which gives STATUS_UNSUCCESSFUL and not success.
+*/
+inline INT GetErrnoStatus()
+{
+	const int error = errno;
+
+	return (error > 0) ? static_cast<INT>(HRESULT_FROM_WIN32(error)) : STATUS_UNSUCCESSFUL;
+}
+
+// fopen, which msvc deprecates. other processes can read the file while it is open, as with FILE_SHARE_READ
+inline FILE* OpenFileStream(const CHAR* path, const CHAR* mode)
+{
+#if defined(_MSC_VER)
+	return _fsopen(path, mode, _SH_DENYWR);
+#else
+	return fopen(path, mode);
+#endif
+}
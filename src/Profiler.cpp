@@ -0,0 +1,141 @@
+#include "Profiler.h"
+#include "Log.h"
+
+namespace Profiler
+{
+	struct Event
+	{
+		const char* name;
+		uint64_t    begin; // nanoseconds
+		uint64_t    end;
+		uint32_t    thread_id;
+	};
+
+	struct ThreadBuffer
+	{
+		Event                 events[RING_CAPACITY];
+		std::atomic<uint64_t> head;
+	};
+
+	std::atomic<bool>          g_Enabled(false);
+	std::mutex                 g_BuffersLock;
+	std::vector<ThreadBuffer*> g_Buffers;
+	std::vector<ThreadBuffer*> g_FreeBuffers;
+
+	// threads come and go (the benchmarks start their own), so buffers are recycled on thread exit
+	struct ThreadRegistration
+	{
+		ThreadBuffer* buffer;
+
+		ThreadRegistration()
+		{
+			std::lock_guard<std::mutex> lock(g_BuffersLock);
+
+			if (!g_FreeBuffers.empty())
+			{
+				buffer = g_FreeBuffers.back();
+				g_FreeBuffers.pop_back();
+			}
+			else
+			{
+				buffer = new ThreadBuffer();
+				buffer->head = 0;
+				g_Buffers.push_back(buffer);
+			}
+		}
+
+		~ThreadRegistration()
+		{
+			std::lock_guard<std::mutex> lock(g_BuffersLock);
+			g_FreeBuffers.push_back(buffer);
+		}
+	};
+
+	uint64_t Now()
+	{
+		return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	VOID Enable(bool enabled)
+	{
+		g_Enabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool IsEnabled()
+	{
+		return g_Enabled.load(std::memory_order_relaxed);
+	}
+
+	VOID Record(const char* name, uint64_t begin, uint64_t end, uint32_t thread_id)
+	{
+		static thread_local ThreadRegistration registration;
+		ThreadBuffer* buffer = registration.buffer;
+
+		const uint64_t head = buffer->head.load(std::memory_order_relaxed);
+
+		Event& event = buffer->events[head % RING_CAPACITY];
+		event.name = name;
+		event.begin = begin;
+		event.end = end;
+		event.thread_id = thread_id;
+
+		// publish the event after it is fully written
+		buffer->head.store(head + 1, std::memory_order_release);
+	}
+
+	INT WriteChromeTrace(const char* path)
+	{
+		INT status = STATUS_SUCCESS;
+
+		std::string json = "{\"traceEvents\":[\n";
+		bool first = true;
+
+		{
+			std::lock_guard<std::mutex> lock(g_BuffersLock);
+
+			for (ThreadBuffer* buffer : g_Buffers)
+			{
+				const uint64_t head = buffer->head.load(std::memory_order_acquire);
+				const uint64_t count = std::min<uint64_t>(head, RING_CAPACITY);
+
+				for (uint64_t i = head - count; i < head; i++)
+				{
+					const Event& event = buffer->events[i % RING_CAPACITY];
+
+					CHAR line[256];
+					std::snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+						first ? "" : ",\n", event.name, event.thread_id, event.begin * 1e-3, (event.end - event.begin) * 1e-3);
+
+					json += line;
+					first = false;
+				}
+			}
+		}
+
+		json += "\n]}\n";
+
+		FILE* file = OpenFileStream(path, "wb");
+		if (file == NULL)
+		{
+			status = GetErrnoStatus();
+			WriteToConsole("error 0x%X: could not create %s\n", status, path);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			if (fwrite(json.data(), 1, json.size(), file) != json.size())
+			{
+				status = GetErrnoStatus();
+				WriteToConsole("error 0x%X: could not write %s\n", status, path);
+			}
+
+			if ((fclose(file) != 0) && SUCCEEDED(status))
+			{
+				status = GetErrnoStatus();
+				WriteToConsole("error 0x%X: could not write %s\n", status, path);
+			}
+		}
+
+		return status;
+	}
+}
@@ -0,0 +1,207 @@
+#include "Quaternion.h"
+#include "FastMath.h"
+#include "Matrix.h"
+
+namespace Quaternion
+{
+	size_t GetBatchSize(size_t n)
+	{
+		return ((n + Matrix::BATCH_WIDTH - 1) / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE;
+	}
+
+	void StoreBatch(float* batch, size_t i, const float* q)
+	{
+		float* dst = batch + (i / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH);
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			dst[k * Matrix::BATCH_WIDTH] = q[k];
+		}
+	}
+
+	void ToIdentity(float* q)
+	{
+		q[0] = 0.0f;
+		q[1] = 0.0f;
+		q[2] = 0.0f;
+		q[3] = 1.0f;
+	}
+
+	void FromEuler(float r_x, float r_y, float r_z, float* q)
+	{
+		const float c_x = std::cos(r_x * 0.5f), s_x = std::sin(r_x * 0.5f);
+		const float c_y = std::cos(r_y * 0.5f), s_y = std::sin(r_y * 0.5f);
+		const float c_z = std::cos(r_z * 0.5f), s_z = std::sin(r_z * 0.5f);
+
+		q[0] = c_x * c_y * s_z - s_x * s_y * c_z;
+		q[1] = c_x * s_y * c_z + s_x * c_y * s_z;
+		q[2] = s_x * c_y * c_z - c_x * s_y * s_z;
+		q[3] = c_x * c_y * c_z + s_x * s_y * s_z;
+	}
+
+	void FromEulerBatch(const float* r_x, const float* r_y, const float* r_z, float* q, size_t n)
+	{
+		const size_t CHUNK_SIZE = 64;
+
+		float h[3][CHUNK_SIZE];
+		float s[3][CHUNK_SIZE];
+		float c[3][CHUNK_SIZE];
+
+		for (size_t base = 0; base < n; base += CHUNK_SIZE)
+		{
+			const size_t count = std::min(CHUNK_SIZE, n - base);
+
+			for (size_t i = 0; i < count; i++)
+			{
+				h[0][i] = r_x[base + i] * 0.5f;
+				h[1][i] = r_y[base + i] * 0.5f;
+				h[2][i] = r_z[base + i] * 0.5f;
+			}
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				FastMath::SinCosBatch(h[k], s[k], c[k], count);
+			}
+
+			for (size_t i = 0; i < count; i++)
+			{
+				const size_t index = base + i;
+				float* dst = q + (index / Matrix::BATCH_WIDTH) * BATCH_BLOCK_SIZE + (index % Matrix::BATCH_WIDTH);
+
+				const float c_x = c[0][i], s_x = s[0][i];
+				const float c_y = c[1][i], s_y = s[1][i];
+				const float c_z = c[2][i], s_z = s[2][i];
+
+				dst[0 * Matrix::BATCH_WIDTH] = c_x * c_y * s_z - s_x * s_y * c_z;
+				dst[1 * Matrix::BATCH_WIDTH] = c_x * s_y * c_z + s_x * c_y * s_z;
+				dst[2 * Matrix::BATCH_WIDTH] = s_x * c_y * c_z - c_x * s_y * s_z;
+				dst[3 * Matrix::BATCH_WIDTH] = c_x * c_y * c_z + s_x * s_y * s_z;
+			}
+		}
+	}
+
+	void Multiply(const float* q0, const float* q1, float* q2)
+	{
+		const float x = q1[3] * q0[0] + q1[0] * q0[3] + q1[1] * q0[2] - q1[2] * q0[1];
+		const float y = q1[3] * q0[1] - q1[0] * q0[2] + q1[1] * q0[3] + q1[2] * q0[0];
+		const float z = q1[3] * q0[2] + q1[0] * q0[1] - q1[1] * q0[0] + q1[2] * q0[3];
+		const float w = q1[3] * q0[3] - q1[0] * q0[0] - q1[1] * q0[1] - q1[2] * q0[2];
+
+		q2[0] = x;
+		q2[1] = y;
+		q2[2] = z;
+		q2[3] = w;
+	}
+
+	void Normalize(float* q)
+	{
+		const float s = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+		const float f = 0.5f * (3.0f - s);
+
+		q[0] *= f;
+		q[1] *= f;
+		q[2] *= f;
+		q[3] *= f;
+	}
+
+	void ToMatrix(const float* q, float* m)
+	{
+		const float x = q[0], y = q[1], z = q[2], w = q[3];
+
+		m[0]  = 1.0f - 2.0f * (y * y + z * z);
+		m[1]  = 2.0f * (x * y - w * z);
+		m[2]  = 2.0f * (x * z + w * y);
+		m[3]  = 0.0f;
+
+		m[4]  = 2.0f * (x * y + w * z);
+		m[5]  = 1.0f - 2.0f * (x * x + z * z);
+		m[6]  = 2.0f * (y * z - w * x);
+		m[7]  = 0.0f;
+
+		m[8]  = 2.0f * (x * z - w * y);
+		m[9]  = 2.0f * (y * z + w * x);
+		m[10] = 1.0f - 2.0f * (x * x + y * y);
+		m[11] = 0.0f;
+
+		m[12] = 0.0f;
+		m[13] = 0.0f;
+		m[14] = 0.0f;
+		m[15] = 1.0f;
+	}
+
+	void ToMatrix(const float* q, Matrix::Affine3x4& m)
+	{
+		float full[16];
+		ToMatrix(q, full);
+
+		CopyMemory(m.m, full, sizeof(m.m));
+	}
+
+	void Interpolate(const float* q0, const float* q1, float t, float* q)
+	{
+		const float d = q0[0] * q1[0] + q0[1] * q1[1] + q0[2] * q1[2] + q0[3] * q1[3];
+		const float s = (d < 0.0f) ? -t : t;
+
+		float r[4];
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			r[k] = q0[k] * (1.0f - t) + q1[k] * s;
+		}
+
+		const float f = 1.0f / std::sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			q[k] = r[k] * f;
+		}
+	}
+
+	void AdvanceBatch(float* q0, const float* q1, size_t n)
+	{
+		const size_t blocks = (n + Matrix::BATCH_WIDTH - 1) / Matrix::BATCH_WIDTH;
+
+		for (size_t block = 0; block < blocks; block++)
+		{
+			float*       a = q0 + block * BATCH_BLOCK_SIZE;
+			const float* b = q1 + block * BATCH_BLOCK_SIZE;
+
+			for (unsigned int l = 0; l < Matrix::BATCH_WIDTH; l++)
+			{
+				float q[4] = { a[l], a[Matrix::BATCH_WIDTH + l], a[2 * Matrix::BATCH_WIDTH + l], a[3 * Matrix::BATCH_WIDTH + l] };
+				float s[4] = { b[l], b[Matrix::BATCH_WIDTH + l], b[2 * Matrix::BATCH_WIDTH + l], b[3 * Matrix::BATCH_WIDTH + l] };
+
+				Multiply(q, s, q);
+				Normalize(q);
+
+				a[l] = q[0];
+				a[Matrix::BATCH_WIDTH + l] = q[1];
+				a[2 * Matrix::BATCH_WIDTH + l] = q[2];
+				a[3 * Matrix::BATCH_WIDTH + l] = q[3];
+			}
+		}
+	}
+
+	void ToMatrixBatch(const float* q, float* m, size_t n)
+	{
+		const size_t blocks = (n + Matrix::BATCH_WIDTH - 1) / Matrix::BATCH_WIDTH;
+
+		for (size_t block = 0; block < blocks; block++)
+		{
+			const float* a = q + block * BATCH_BLOCK_SIZE;
+			float*       b = m + block * Matrix::BATCH_BLOCK_SIZE;
+
+			for (unsigned int l = 0; l < Matrix::BATCH_WIDTH; l++)
+			{
+				float rotation[16];
+				float quaternion[4] = { a[l], a[Matrix::BATCH_WIDTH + l], a[2 * Matrix::BATCH_WIDTH + l], a[3 * Matrix::BATCH_WIDTH + l] };
+
+				ToMatrix(quaternion, rotation);
+
+				for (unsigned int e = 0; e < 16; e++)
+				{
+					b[e * Matrix::BATCH_WIDTH + l] = rotation[e];
+				}
+			}
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "Common.h"
+#include "Matrix.h"
+
+namespace Quaternion
+{
+	/*
+	* quaternions are stored as { x, y, z, w }. batched quaternions use the block layout of the matrix batches:
+	* component k of quaternion i is at [(i / BATCH_WIDTH) * BATCH_BLOCK_SIZE + k * BATCH_WIDTH + (i % BATCH_WIDTH)]
+	*/
+	enum {
+		BATCH_BLOCK_SIZE = 4 * Matrix::BATCH_WIDTH
+	};
+
+	size_t GetBatchSize(size_t n);
+
+	void StoreBatch(float* batch, size_t i, const float* q);
+
+	void ToIdentity(float* q);
+
+	// the same rotation as the euler matrix built by the renderer: rz(r_x) * ry(r_y) * rx(r_z)
+	void FromEuler(float r_x, float r_y, float r_z, float* q);
+
+	// FromEuler for n angles, written to the batch q. the angles stay in the range of FastMath::SinCos
+	void FromEulerBatch(const float* r_x, const float* r_y, const float* r_z, float* q, size_t n);
+
+	// q2 = q1 * q0, the same operand order as Matrix::Multiply. q2 may alias q0 or q1
+	void Multiply(const float* q0, const float* q1, float* q2);
+
+	/*
+	* the quaternions only drift from unit length by rounding errors, so one newton step of 1 / sqrt(s) around s = 1
+	* is enough. the remaining error is quadratic in the drift and is removed again on the next call.
+	*/
+	void Normalize(float* q);
+
+	void ToMatrix(const float* q, float* m);
+
+	// the rows of ToMatrix without the last one, which is 0 0 0 1
+	void ToMatrix(const float* q, Matrix::Affine3x4& m);
+
+	// normalized linear interpolation along the shorter arc, close enough to slerp for the small steps between ticks
+	void Interpolate(const float* q0, const float* q1, float t, float* q);
+
+	// q0[i] = normalize(q1[i] * q0[i]) for n batched quaternions. the lanes are independent so the loops vectorize
+	void AdvanceBatch(float* q0, const float* q1, size_t n);
+
+	// expands n batched quaternions into batched rotation matrices
+	void ToMatrixBatch(const float* q, float* m, size_t n);
+}
@@ -0,0 +1,270 @@
+#include "RenderContext.h"
+#include "Log.h"
+#include "Fnv.h"
+
+#if defined(_WIN32)
+
+D3DRenderContext::D3DRenderContext(ID3D11DeviceContext* pContext)
+{
+	m_pContext = pContext;
+	m_pContext1 = NULL;
+
+	if (FAILED(m_pContext->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&m_pContext1))))
+	{
+		m_pContext1 = NULL;
+	}
+}
+
+D3DRenderContext::~D3DRenderContext()
+{
+	if (m_pContext1 != NULL)
+	{
+		m_pContext1->Release();
+		m_pContext1 = NULL;
+	}
+}
+
+VOID D3DRenderContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView)
+{
+	m_pContext->OMSetRenderTargets(count, ppViews, pDepthStencilView);
+}
+
+VOID D3DRenderContext::IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	m_pContext->IASetVertexBuffers(slot, count, ppBuffers, pStrides, pOffsets);
+}
+
+VOID D3DRenderContext::IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset)
+{
+	m_pContext->IASetIndexBuffer(pBuffer, format, offset);
+}
+
+VOID D3DRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	m_pContext->IASetPrimitiveTopology(topology);
+}
+
+VOID D3DRenderContext::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+	m_pContext->IASetInputLayout(pInputLayout);
+}
+
+VOID D3DRenderContext::VSSetShader(ID3D11VertexShader* pShader)
+{
+	m_pContext->VSSetShader(pShader, NULL, 0);
+}
+
+VOID D3DRenderContext::VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers)
+{
+	m_pContext->VSSetConstantBuffers(slot, count, ppBuffers);
+}
+
+// d3d takes no empty ranges, a whole buffer is bound as the most a shader can see of it
+VOID D3DRenderContext::VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts)
+{
+	UINT first_constants[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	UINT constant_counts[D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	bool ranges = false;
+
+	for (UINT i = 0; (i < count) && (i < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT) && (pConstantCounts != NULL); i++)
+	{
+		ranges = ranges || (pConstantCounts[i] != 0);
+		first_constants[i] = (pConstantCounts[i] != 0) ? pFirstConstants[i] : 0;
+		constant_counts[i] = (pConstantCounts[i] != 0) ? pConstantCounts[i] : D3D11_REQ_CONSTANT_BUFFER_ELEMENT_COUNT;
+	}
+
+	if (ranges && (m_pContext1 != NULL) && (count <= D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT))
+	{
+		m_pContext1->VSSetConstantBuffers1(slot, count, ppBuffers, first_constants, constant_counts);
+	}
+	else
+	{
+		m_pContext->VSSetConstantBuffers(slot, count, ppBuffers);
+	}
+}
+
+VOID D3DRenderContext::PSSetShader(ID3D11PixelShader* pShader)
+{
+	m_pContext->PSSetShader(pShader, NULL, 0);
+}
+
+// dynamic buffers are mapped with discard, the others go through UpdateSubresource
+INT D3DRenderContext::UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size)
+{
+	INT status = STATUS_SUCCESS;
+
+	D3D11_BUFFER_DESC desc;
+	pBuffer->GetDesc(&desc);
+
+	if (desc.Usage == D3D11_USAGE_DYNAMIC)
+	{
+		D3D11_MAPPED_SUBRESOURCE mapped = {};
+		status = m_pContext->Map(pBuffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+
+		if (SUCCEEDED(status))
+		{
+			CopyMemory(mapped.pData, pData, size);
+			m_pContext->Unmap(pBuffer, 0);
+		}
+		else
+		{
+			WriteToConsole("error 0x%X: could not map a buffer for an update\n", status);
+		}
+	}
+	else
+	{
+		m_pContext->UpdateSubresource(pBuffer, 0, NULL, pData, 0, 0);
+	}
+
+	return status;
+}
+
+VOID D3DRenderContext::ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4])
+{
+	m_pContext->ClearRenderTargetView(pView, color);
+}
+
+VOID D3DRenderContext::ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil)
+{
+	m_pContext->ClearDepthStencilView(pView, flags, depth, stencil);
+}
+
+VOID D3DRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	m_pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+#endif
+
+RecordingRenderContext::RecordingRenderContext()
+{
+	ZeroMemory(&m_State, sizeof(m_State));
+	ZeroMemory(m_Binds, sizeof(m_Binds));
+}
+
+VOID RecordingRenderContext::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView)
+{
+	m_Binds[BIND_RENDER_TARGETS]++;
+
+	ZeroMemory(m_State.pRenderTargets, sizeof(m_State.pRenderTargets));
+	CopyMemory(m_State.pRenderTargets, ppViews, std::min<UINT>(count, RENDER_TARGET_SLOTS) * sizeof(ID3D11RenderTargetView*));
+	m_State.render_target_count = count;
+	m_State.pDepthStencilView = pDepthStencilView;
+}
+
+VOID RecordingRenderContext::IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	m_Binds[BIND_VERTEX_BUFFERS]++;
+
+	for (UINT i = 0; (i < count) && (slot + i < VERTEX_BUFFER_SLOTS); i++)
+	{
+		m_State.pVertexBuffers[slot + i] = ppBuffers[i];
+		m_State.strides[slot + i] = pStrides[i];
+		m_State.offsets[slot + i] = pOffsets[i];
+	}
+}
+
+VOID RecordingRenderContext::IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset)
+{
+	m_Binds[BIND_INDEX_BUFFER]++;
+
+	m_State.pIndexBuffer = pBuffer;
+	m_State.index_format = format;
+	m_State.index_offset = offset;
+}
+
+VOID RecordingRenderContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	m_Binds[BIND_TOPOLOGY]++;
+	m_State.topology = topology;
+}
+
+VOID RecordingRenderContext::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+	m_Binds[BIND_INPUT_LAYOUT]++;
+	m_State.pInputLayout = pInputLayout;
+}
+
+VOID RecordingRenderContext::VSSetShader(ID3D11VertexShader* pShader)
+{
+	m_Binds[BIND_VERTEX_SHADER]++;
+	m_State.pVertexShader = pShader;
+}
+
+VOID RecordingRenderContext::VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers)
+{
+	VSSetConstantBuffers1(slot, count, ppBuffers, NULL, NULL);
+}
+
+VOID RecordingRenderContext::VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts)
+{
+	m_Binds[BIND_CONSTANT_BUFFERS]++;
+
+	for (UINT i = 0; (i < count) && (slot + i < CONSTANT_BUFFER_SLOTS); i++)
+	{
+		const UINT constant_count = (pConstantCounts != NULL) ? pConstantCounts[i] : 0;
+
+		m_State.pConstantBuffers[slot + i] = ppBuffers[i];
+		m_State.first_constants[slot + i] = (constant_count != 0) ? pFirstConstants[i] : 0;
+		m_State.constant_counts[slot + i] = constant_count;
+	}
+}
+
+VOID RecordingRenderContext::PSSetShader(ID3D11PixelShader* pShader)
+{
+	m_Binds[BIND_PIXEL_SHADER]++;
+	m_State.pPixelShader = pShader;
+}
+
+INT RecordingRenderContext::UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size)
+{
+	const uint64_t hash = Fnv::Hash(&pBuffer, sizeof(pBuffer), Fnv::OFFSET_BASIS);
+	m_Events.push_back(Fnv::Hash(pData, size, hash));
+
+	return STATUS_SUCCESS;
+}
+
+VOID RecordingRenderContext::ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4])
+{
+	const uint64_t hash = Fnv::Hash(&pView, sizeof(pView), Fnv::OFFSET_BASIS);
+	m_Events.push_back(Fnv::Hash(color, sizeof(float) * 4, hash));
+}
+
+VOID RecordingRenderContext::ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil)
+{
+	uint32_t depth_bits = 0;
+	CopyMemory(&depth_bits, &depth, sizeof(depth));
+
+	const uint64_t arguments[] = { reinterpret_cast<uintptr_t>(pView), flags, depth_bits, stencil };
+	m_Events.push_back(Fnv::Hash(arguments, sizeof(arguments), Fnv::OFFSET_BASIS));
+}
+
+VOID RecordingRenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	const UINT arguments[] = { indexCount, instanceCount, startIndex, static_cast<UINT>(baseVertex), startInstance };
+
+	uint64_t hash = Fnv::Hash(&m_State, sizeof(m_State), Fnv::OFFSET_BASIS);
+	m_Events.push_back(Fnv::Hash(arguments, sizeof(arguments), hash));
+}
+
+uint64_t RecordingRenderContext::GetBindCount(Bind bind)
+{
+	return m_Binds[bind];
+}
+
+uint64_t RecordingRenderContext::GetBindCount()
+{
+	uint64_t count = 0;
+
+	for (unsigned int i = 0; i < BIND_COUNT; i++)
+	{
+		count += m_Binds[i];
+	}
+
+	return count;
+}
+
+const std::vector<uint64_t>& RecordingRenderContext::GetEvents()
+{
+	return m_Events;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include "Common.h"
+
+/*
+* the pipeline binds, buffer updates, clears and draws of the render pass. the renderer goes through this interface so
+* that a StateCache can sit in front of the device context, a CommandBuffer can record the calls for later, and a
+* RecordingRenderContext can stand in for the device. only the first slots of each stage are shadowed, which covers
+* everything the renderer binds.
+*
+* VSSetConstantBuffers1 binds ranges of constant buffers, in 16 byte constants as d3d 11.1 takes them. a range of 0
+* constants, or NULL ranges, binds the whole buffer, so binding whole buffers that way is the same as
+* VSSetConstantBuffers.
+*/
+class RenderContext
+{
+public:
+	enum {
+		RENDER_TARGET_SLOTS   = 1,
+		VERTEX_BUFFER_SLOTS   = 4,
+		CONSTANT_BUFFER_SLOTS = 4
+	};
+
+	enum Bind {
+		BIND_RENDER_TARGETS,
+		BIND_VERTEX_BUFFERS,
+		BIND_INDEX_BUFFER,
+		BIND_TOPOLOGY,
+		BIND_INPUT_LAYOUT,
+		BIND_VERTEX_SHADER,
+		BIND_CONSTANT_BUFFERS,
+		BIND_PIXEL_SHADER,
+		BIND_COUNT
+	};
+
+	// everything the binds below set, compared and hashed as plain memory so it is zeroed before it is filled in
+	struct PipelineState
+	{
+		ID3D11RenderTargetView*  pRenderTargets[RENDER_TARGET_SLOTS];
+		UINT                     render_target_count;
+		ID3D11DepthStencilView*  pDepthStencilView;
+		ID3D11Buffer*            pVertexBuffers[VERTEX_BUFFER_SLOTS];
+		UINT                     strides[VERTEX_BUFFER_SLOTS];
+		UINT                     offsets[VERTEX_BUFFER_SLOTS];
+		ID3D11Buffer*            pIndexBuffer;
+		DXGI_FORMAT              index_format;
+		UINT                     index_offset;
+		D3D11_PRIMITIVE_TOPOLOGY topology;
+		ID3D11InputLayout*       pInputLayout;
+		ID3D11VertexShader*      pVertexShader;
+		ID3D11Buffer*            pConstantBuffers[CONSTANT_BUFFER_SLOTS];
+		UINT                     first_constants[CONSTANT_BUFFER_SLOTS];
+		UINT                     constant_counts[CONSTANT_BUFFER_SLOTS];
+		ID3D11PixelShader*       pPixelShader;
+	};
+
+	virtual ~RenderContext() {}
+
+	virtual VOID OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView) = 0;
+	virtual VOID IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets) = 0;
+	virtual VOID IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+	virtual VOID IASetInputLayout(ID3D11InputLayout* pInputLayout) = 0;
+	virtual VOID VSSetShader(ID3D11VertexShader* pShader) = 0;
+	virtual VOID VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers) = 0;
+	virtual VOID VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts) = 0;
+	virtual VOID PSSetShader(ID3D11PixelShader* pShader) = 0;
+	virtual INT  UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size) = 0;
+	virtual VOID ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4]) = 0;
+	virtual VOID ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil) = 0;
+	virtual VOID DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance) = 0;
+};
+
+#if defined(_WIN32)
+
+class D3DRenderContext : public RenderContext
+{
+private:
+	ID3D11DeviceContext*  m_pContext;
+	ID3D11DeviceContext1* m_pContext1; // NULL without the 11.1 runtime, which binds only whole constant buffers
+
+public:
+	D3DRenderContext(ID3D11DeviceContext* pContext);
+	~D3DRenderContext();
+
+	VOID OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView);
+	VOID IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	VOID IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset);
+	VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	VOID IASetInputLayout(ID3D11InputLayout* pInputLayout);
+	VOID VSSetShader(ID3D11VertexShader* pShader);
+	VOID VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers);
+	VOID VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts);
+	VOID PSSetShader(ID3D11PixelShader* pShader);
+	INT  UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size);
+	VOID ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4]);
+	VOID ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil);
+	VOID DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+};
+
+#endif
+
+/*
+* applies the binds to a PipelineState instead of a device and counts them. every draw records a hash of the state it
+* would have run with, and every update and clear a hash of its arguments, so two ways of issuing the same work can
+* be compared event by event. used by the tests of the state cache and the command buffers.
+*/
+class RecordingRenderContext : public RenderContext
+{
+private:
+	PipelineState         m_State;
+	uint64_t              m_Binds[BIND_COUNT];
+	std::vector<uint64_t> m_Events;
+
+public:
+	RecordingRenderContext();
+
+	VOID OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView);
+	VOID IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	VOID IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset);
+	VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	VOID IASetInputLayout(ID3D11InputLayout* pInputLayout);
+	VOID VSSetShader(ID3D11VertexShader* pShader);
+	VOID VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers);
+	VOID VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts);
+	VOID PSSetShader(ID3D11PixelShader* pShader);
+	INT  UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size);
+	VOID ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4]);
+	VOID ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil);
+	VOID DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	uint64_t GetBindCount(Bind bind);
+	uint64_t GetBindCount();
+	const std::vector<uint64_t>& GetEvents();
+};
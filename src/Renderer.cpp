@@ -0,0 +1,884 @@
+#include "Renderer.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+#include "ShaderCompiler.h"
+#include "Mesh.h"
+#include "VertexPacking.h"
+#include "Culling.h"
+#include "MeshPack.h"
+#include "JobSystem.h"
+#include "ShaderBuild.h"
+#include "FrameArena.h"
+#include "InstanceUploader.h"
+#include "ConstantRing.h"
+#include "RenderContext.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
+#include "Simulation.h"
+
+Renderer::Renderer()
+{
+	m_pDevice = NULL;
+	m_pContext = NULL;
+	m_pSwapChain = NULL;
+	m_pBackBuffer = NULL;
+	m_pRenderTargetView = NULL;
+	m_pDepthStencilBuffer = NULL;
+	m_pDepthStencilView = NULL;
+	m_pDebugInterface = NULL;
+	m_pVertexShader = NULL;
+	m_pPixelShader = NULL;
+	m_pVertexBuffer = NULL;
+	m_pIndexBuffer = NULL;
+	m_pInstanceBuffer = NULL;
+	m_pMatrixBuffer = NULL;
+	m_pMeshBuffer = NULL;
+	m_pVertexShaderInputLayout = NULL;
+
+	m_VertexFormat = VertexPacking::FORMAT_FLOAT32;
+	m_VertexCount = 0;
+	m_IndexCount = 0;
+	m_IndexFormat = DXGI_FORMAT_R32_UINT;
+
+	Matrix::ToIdentity(m_MatrixBuffer.model_matrix);
+	ZeroMemory(&m_MatrixBlock, sizeof(m_MatrixBlock));
+	m_ConstantOffsets = false;
+	m_InstanceCount = 0;
+	m_VisibleCount = 0;
+	m_pVisibleTransforms = NULL;
+	ZeroMemory(&m_Viewport, sizeof(D3D11_VIEWPORT));
+	m_pCapturePath = NULL;
+	m_pJobs = NULL;
+}
+
+/*
+* draws the mesh of pMesh, which has to stay open until Initialize returns, or the cube of Data::Vertices if it is NULL.
+* the draws are recorded into commandBuffers command buffers on jobs, which has to outlive the renderer. with deferred
+* contexts the command buffers are also turned into command lists by those jobs. the shaders are compiled on jobs while
+* this thread creates the buffers, debugColor picks the pixel shader that draws bands of depth instead of the vertex colors.
+*/
+INT Renderer::Initialize(HWND hWnd, size_t instanceCount, VertexPacking::Format vertexFormat, MeshPack* pMesh, unsigned int commandBuffers, bool deferredContexts, bool debugColor, JobSystem& jobs)
+{
+	INT status = STATUS_SUCCESS;
+	ShaderBuild shaders;
+
+	m_InstanceCount = instanceCount;
+
+	// room for a frame with every instance visible
+	m_FrameArena.Initialize(instanceCount * (sizeof(uint32_t) + sizeof(float) * Data::INSTANCE_SIZE) + 2 * FrameArena::DEFAULT_ALIGNMENT, jobs);
+	m_VertexFormat = (pMesh != NULL) ? static_cast<VertexPacking::Format>(pMesh->GetHeader().streams[MeshPack::STREAM_VERTICES].format) : vertexFormat;
+
+	const D3D_FEATURE_LEVEL levels[] = { D3D_FEATURE_LEVEL_11_1 };
+
+	D3D_FEATURE_LEVEL level;
+	D3D11_TEXTURE2D_DESC bbDesc = {};
+
+	m_pJobs = &jobs;
+
+	if (SUCCEEDED(status))
+	{
+		m_FrameCommands = std::vector<FrameCommands>(commandBuffers + 1);
+
+		for (FrameCommands& frame : m_FrameCommands)
+		{
+			frame.pDeferredContext = NULL;
+			frame.pCommandList = NULL;
+			frame.status = STATUS_SUCCESS;
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = D3D11CreateDevice(NULL, D3D_DRIVER_TYPE_HARDWARE, NULL, D3D11_CREATE_DEVICE_DEBUG, levels, 1, D3D11_SDK_VERSION, &m_pDevice, &level, &m_pContext);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create device/context\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_pDevice->QueryInterface(__uuidof(ID3D11Debug), reinterpret_cast<void**>(&m_pDebugInterface));
+
+		if (m_pDebugInterface == NULL)
+		{
+			status = STATUS_UNSUCCESSFUL;
+			WriteToConsole("error 0x%X: could not get the dx11 debug interface\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		DXGI_SWAP_CHAIN_DESC desc;
+		ZeroMemory(&desc, sizeof(DXGI_SWAP_CHAIN_DESC));
+		desc.BufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		desc.SampleDesc.Count = 1;
+		desc.SampleDesc.Quality = 0;
+		desc.BufferUsage = DXGI_USAGE_RENDER_TARGET_OUTPUT;
+		desc.BufferCount = 2;
+		desc.OutputWindow = hWnd;
+		desc.Windowed = TRUE;
+		desc.SwapEffect = DXGI_SWAP_EFFECT_FLIP_SEQUENTIAL;
+
+		IDXGIDevice*  pDXGIDevice = NULL;
+		IDXGIAdapter* pDXGIAdapter = NULL;
+		IDXGIFactory* pIDXGIFactory = NULL;
+
+		m_pDevice->QueryInterface(__uuidof(IDXGIDevice), reinterpret_cast<void**>(&pDXGIDevice));
+		status = pDXGIDevice->GetAdapter(&pDXGIAdapter);
+
+		if (SUCCEEDED(status))
+		{
+			pDXGIAdapter->GetParent(__uuidof(IDXGIFactory), reinterpret_cast<void**>(&pIDXGIFactory));
+
+			status = pIDXGIFactory->CreateSwapChain(m_pDevice, &desc, &m_pSwapChain);
+			if (FAILED(status))
+			{
+				WriteToConsole("error 0x%X: could not create the swap chain\n", status);
+			}
+		}
+		else
+		{
+			WriteToConsole("error 0x%X: could not get the dxgi device's adapter\n", status);
+		}
+
+		pIDXGIFactory->Release();
+		pDXGIAdapter->Release();
+		pDXGIDevice->Release();
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = m_pSwapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&m_pBackBuffer));
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not get the swap chain back buffer\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = m_pDevice->CreateRenderTargetView(m_pBackBuffer, NULL, &m_pRenderTargetView);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create the render target view\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_pBackBuffer->GetDesc(&bbDesc);
+
+		D3D11_TEXTURE2D_DESC depthStencilDesc = {};
+		depthStencilDesc.Format = DXGI_FORMAT_D24_UNORM_S8_UINT;
+		depthStencilDesc.Width = bbDesc.Width;
+		depthStencilDesc.Height = bbDesc.Height;
+		depthStencilDesc.ArraySize = 1;
+		depthStencilDesc.MipLevels = 1;
+		depthStencilDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+		depthStencilDesc.Usage = D3D11_USAGE_DEFAULT;
+		depthStencilDesc.CPUAccessFlags = 0;
+		depthStencilDesc.SampleDesc.Count = 1;
+		depthStencilDesc.SampleDesc.Quality = 0;
+		depthStencilDesc.MiscFlags = 0;
+
+		status = m_pDevice->CreateTexture2D(&depthStencilDesc, NULL, &m_pDepthStencilBuffer);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create depth buffer\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		D3D11_DEPTH_STENCIL_VIEW_DESC depthStencilViewDesc = {};
+		depthStencilViewDesc.Texture2D.MipSlice = 0;
+		depthStencilViewDesc.Format = DXGI_FORMAT_UNKNOWN;
+		depthStencilViewDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
+		depthStencilViewDesc.Flags = 0;
+
+		status = m_pDevice->CreateDepthStencilView(m_pDepthStencilBuffer, &depthStencilViewDesc, &m_pDepthStencilView);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create depth buffer view\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_Viewport.Height = (float) bbDesc.Height;
+		m_Viewport.Width = (float) bbDesc.Width;
+		m_Viewport.MinDepth = 0;
+		m_Viewport.MaxDepth = 1;
+
+		m_pContext->RSSetViewports(1, &m_Viewport);
+
+		m_pRenderContext.reset(new D3DRenderContext(m_pContext));
+		m_pStateCache.reset(new StateCache(m_pRenderContext.get()));
+	}
+
+	// the first commands set up the frame on the immediate context
+	for (size_t i = 1; (i < m_FrameCommands.size()) && deferredContexts && SUCCEEDED(status); i++)
+	{
+		status = m_pDevice->CreateDeferredContext(0, &m_FrameCommands[i].pDeferredContext);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create deferred context %zu\n", status, i);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = m_ShaderCache.Open(SHADER_CACHE_PATH);
+	}
+
+	// the instance stream is always bound, only the packed formats need the dequantization
+	if (SUCCEEDED(status))
+	{
+		const UINT vs_features = Data::FEATURE_INSTANCED | (VertexPacking::Layouts[m_VertexFormat].quantized ? Data::FEATURE_QUANTIZED : 0);
+		const UINT ps_features = debugColor ? Data::FEATURE_DEBUG_COLOR : 0;
+
+		shaders.Add(ShaderPermutation(Data::SHADER_VERTEX, vs_features), CreateVertexShader, this);
+		shaders.Add(ShaderPermutation(Data::SHADER_PIXEL, ps_features), CreatePixelShader, this);
+
+		status = shaders.Start(jobs, m_ShaderCache, m_ShaderCompiler);
+	}
+
+	// the device is free threaded, the buffers are created while the jobs compile and create the shaders
+	if (SUCCEEDED(status))
+	{
+		status = CreateConstantBuffers();
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = GenerateBuffers(pMesh);
+	}
+
+	// the jobs use the cache and the renderer, so the build is waited for even after a failure
+	{
+		const INT build_status = shaders.Wait();
+
+		if (SUCCEEDED(status))
+		{
+			status = build_status;
+		}
+	}
+
+	// a cache that cannot be written only costs compile time on the next run
+	if (SUCCEEDED(status))
+	{
+		m_ShaderCache.Save();
+	}
+
+	m_ShaderCache.Close();
+
+	if (SUCCEEDED(status) && Profiler::IsEnabled())
+	{
+		status = m_GpuTimer.Initialize(m_pDevice);
+	}
+
+	return status;
+}
+
+VOID Renderer::Uninitialize()
+{
+	m_GpuTimer.Uninitialize();
+	m_FrameArena.Uninitialize();
+	m_pJobs = NULL;
+
+	for (FrameCommands& frame : m_FrameCommands)
+	{
+		if (frame.pCommandList != NULL)
+		{
+			frame.pCommandList->Release();
+		}
+
+		if (frame.pDeferredContext != NULL)
+		{
+			frame.pDeferredContext->Release();
+		}
+	}
+
+	m_FrameCommands.clear();
+
+	m_pStateCache.reset();
+	m_pRenderContext.reset();
+
+	if (m_pVertexShaderInputLayout != NULL)
+	{
+		m_pVertexShaderInputLayout->Release();
+		m_pVertexShaderInputLayout = NULL;
+	}
+
+	if (m_pVertexBuffer != NULL)
+	{
+		m_pVertexBuffer->Release();
+		m_pVertexBuffer = NULL;
+	}
+
+	if (m_pIndexBuffer != NULL)
+	{
+		m_pIndexBuffer->Release();
+		m_pIndexBuffer = NULL;
+	}
+
+	if (m_pInstanceBuffer != NULL)
+	{
+		m_pInstanceBuffer->Release();
+		m_pInstanceBuffer = NULL;
+	}
+
+	if (m_pMatrixBuffer != NULL)
+	{
+		m_pMatrixBuffer->Release();
+		m_pMatrixBuffer = NULL;
+	}
+
+	if (m_pMeshBuffer != NULL)
+	{
+		m_pMeshBuffer->Release();
+		m_pMeshBuffer = NULL;
+	}
+
+	if (m_pDepthStencilView != NULL)
+	{
+		m_pDepthStencilView->Release();
+		m_pDepthStencilView = NULL;
+	}
+
+	if (m_pDepthStencilBuffer != NULL)
+	{
+		m_pDepthStencilBuffer->Release();
+		m_pDepthStencilBuffer = NULL;
+	}
+
+	if (m_pRenderTargetView != NULL)
+	{
+		m_pRenderTargetView->Release();
+		m_pRenderTargetView = NULL;
+	}
+
+	if (m_pBackBuffer != NULL)
+	{
+		m_pBackBuffer->Release();
+		m_pBackBuffer = NULL;
+	}
+
+	if (m_pSwapChain != NULL)
+	{
+		m_pSwapChain->Release();
+		m_pSwapChain = NULL;
+	}
+
+	if (m_pVertexShader != NULL)
+	{
+		m_pVertexShader->Release();
+		m_pVertexShader = NULL;
+	}
+
+	if (m_pPixelShader != NULL)
+	{
+		m_pPixelShader->Release();
+		m_pPixelShader = NULL;
+	}
+
+	if (m_pContext != NULL)
+	{
+		m_pContext->Release();
+		m_pContext = NULL;
+	}
+
+	if (m_pDebugInterface != NULL)
+	{
+		m_pDebugInterface->Release();
+		m_pDebugInterface = NULL;
+	}
+
+	if (m_pDevice != NULL)
+	{
+		m_pDevice->Release();
+		m_pDevice = NULL;
+	}
+}
+
+INT Renderer::CreateVertexShader(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize)
+{
+	INT status = STATUS_SUCCESS;
+	Renderer& renderer = *static_cast<Renderer*>(pData);
+
+	status = renderer.m_pDevice->CreateVertexShader(pCode, codeSize, NULL, &renderer.m_pVertexShader);
+
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: could not create %s\n", status, permutation.GetName());
+	}
+
+	// create the vertex shader's input layout
+	if (SUCCEEDED(status))
+	{
+		// slot 0 is the mesh in the packed vertex format, slot 1 is the per-instance transform stream
+		const VertexPacking::Layout& layout = VertexPacking::Layouts[renderer.m_VertexFormat];
+
+		D3D11_INPUT_ELEMENT_DESC iaDesc[] = {
+			{ "POSITION", 0, layout.position_format,         0,                   0, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+			{ "COLOR",    0, layout.color_format,            0, layout.color_offset, D3D11_INPUT_PER_VERTEX_DATA,   0 },
+			{ "INSTANCE", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1,                   0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCE", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, sizeof(float) *   4, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+			{ "INSTANCE", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, sizeof(float) *   8, D3D11_INPUT_PER_INSTANCE_DATA, 1 }
+		};
+
+		// a permutation without the instance stream does not read it
+		const UINT elementCount = (permutation.GetFeatures() & Data::FEATURE_INSTANCED) ? ARRAYSIZE(iaDesc) : 2;
+
+		status = renderer.m_pDevice->CreateInputLayout(iaDesc, elementCount, pCode, codeSize, &renderer.m_pVertexShaderInputLayout);
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not create the input layout of %s\n", status, permutation.GetName());
+		}
+	}
+
+	return status;
+}
+
+INT Renderer::CreatePixelShader(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize)
+{
+	INT status = STATUS_SUCCESS;
+	Renderer& renderer = *static_cast<Renderer*>(pData);
+
+	status = renderer.m_pDevice->CreatePixelShader(pCode, codeSize, NULL, &renderer.m_pPixelShader);
+
+	if (FAILED(status))
+	{
+		WriteToConsole("error 0x%X: could not create %s\n", status, permutation.GetName());
+	}
+
+	return status;
+}
+
+INT Renderer::CreateConstantBuffers()
+{
+	INT status = STATUS_SUCCESS;
+
+	/*
+	* the vertex shader's matrix constant buffer is a ring that every frame writes a block of. binding a block needs
+	* constant buffer offsets and writing it without a discard needs NO_OVERWRITE on constant buffers, a device without
+	* either gets a ring of one slice that every frame discards and that draws bind whole.
+	*/
+	if (SUCCEEDED(status))
+	{
+		D3D11_FEATURE_DATA_D3D11_OPTIONS options = {};
+
+		m_ConstantOffsets = SUCCEEDED(m_pDevice->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))) &&
+			options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+
+		if (m_ConstantOffsets)
+		{
+			status = m_ConstantRing.Initialize(CONSTANT_RING_SIZE, ConstantRing::MAX_FRAMES);
+		}
+		else
+		{
+			status = m_ConstantRing.Initialize(sizeof(Data::MatrixBuffer), 1);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		D3D11_BUFFER_DESC cbDesc;
+		cbDesc.ByteWidth = static_cast<UINT>(m_ConstantRing.GetSize());
+		cbDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		cbDesc.Usage = D3D11_USAGE_DYNAMIC;
+		cbDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		cbDesc.MiscFlags = 0;
+		cbDesc.StructureByteStride = 0;
+
+		status = m_pDevice->CreateBuffer(&cbDesc, NULL, &m_pMatrixBuffer);
+	}
+
+	return status;
+}
+
+INT Renderer::GenerateBuffers(MeshPack* pMesh)
+{
+	INT status = STATUS_SUCCESS;
+
+	Mesh::IndexedMesh mesh;
+	Data::MeshBuffer meshBuffer;
+	std::vector<BYTE> vertices;
+	std::vector<uint16_t> indices16;
+
+	const void* pVertices = NULL;
+	size_t vertexSize = 0;
+	const void* pIndices = NULL;
+	UINT indexSize = sizeof(uint32_t);
+
+	if (pMesh != NULL)
+	{
+		// the streams of a pack are already packed, d3d reads them straight from the mapping
+		const MeshPack::Header& header = pMesh->GetHeader();
+		const MeshPack::Stream& vertexStream = header.streams[MeshPack::STREAM_VERTICES];
+		const MeshPack::Stream& indexStream = header.streams[MeshPack::STREAM_INDICES];
+
+		if ((vertexStream.size > UINT_MAX) || (indexStream.size > UINT_MAX))
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: the mesh is too large for a single buffer\n", status);
+		}
+
+		m_VertexCount = static_cast<unsigned int>(header.vertex_count);
+		m_IndexCount = static_cast<unsigned int>(header.index_count);
+		m_IndexFormat = static_cast<DXGI_FORMAT>(indexStream.format);
+		meshBuffer = header.dequantization;
+
+		pVertices = pMesh->GetStream(MeshPack::STREAM_VERTICES);
+		vertexSize = static_cast<size_t>(vertexStream.size);
+		pIndices = pMesh->GetStream(MeshPack::STREAM_INDICES);
+		indexSize = indexStream.stride;
+	}
+	else
+	{
+		Mesh::Build(Data::Vertices, ARRAYSIZE(Data::Vertices), mesh);
+
+		m_VertexCount = static_cast<unsigned int>(mesh.vertices.size());
+		m_IndexCount = static_cast<unsigned int>(mesh.indices.size());
+
+		VertexPacking::ComputeDequantization(m_VertexFormat, mesh.vertices.data(), mesh.vertices.size(), meshBuffer);
+		status = VertexPacking::PackChecked(m_VertexFormat, mesh.vertices.data(), mesh.vertices.size(), meshBuffer, vertices);
+
+		pVertices = vertices.data();
+		vertexSize = vertices.size();
+
+		// use 16 bit indices whenever the vertex count allows it to halve the index buffer
+		pIndices = mesh.indices.data();
+		m_IndexFormat = DXGI_FORMAT_R32_UINT;
+
+		if (m_VertexCount <= 0xFFFF)
+		{
+			indices16.assign(mesh.indices.begin(), mesh.indices.end());
+			pIndices = indices16.data();
+			indexSize = sizeof(uint16_t);
+			m_IndexFormat = DXGI_FORMAT_R16_UINT;
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		D3D11_BUFFER_DESC vDesc;
+		vDesc.ByteWidth = static_cast<UINT>(vertexSize);
+		vDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		vDesc.Usage = D3D11_USAGE_DEFAULT;
+		vDesc.CPUAccessFlags = 0;
+		vDesc.MiscFlags = 0;
+		vDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA vData;
+		vData.pSysMem = pVertices;
+		vData.SysMemPitch = 0;
+		vData.SysMemSlicePitch = 0;
+
+		status = m_pDevice->CreateBuffer(&vDesc, &vData, &m_pVertexBuffer);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		D3D11_BUFFER_DESC iDesc;
+		iDesc.ByteWidth = indexSize * m_IndexCount;
+		iDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		iDesc.Usage = D3D11_USAGE_DEFAULT;
+		iDesc.CPUAccessFlags = 0;
+		iDesc.MiscFlags = 0;
+		iDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA iData;
+		iData.pSysMem = pIndices;
+		iData.SysMemPitch = 0;
+		iData.SysMemSlicePitch = 0;
+
+		status = m_pDevice->CreateBuffer(&iDesc, &iData, &m_pIndexBuffer);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		D3D11_BUFFER_DESC mDesc;
+		mDesc.ByteWidth = sizeof(Data::MeshBuffer);
+		mDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+		mDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		mDesc.CPUAccessFlags = 0;
+		mDesc.MiscFlags = 0;
+		mDesc.StructureByteStride = 0;
+
+		D3D11_SUBRESOURCE_DATA mData;
+		mData.pSysMem = &meshBuffer;
+		mData.SysMemPitch = 0;
+		mData.SysMemSlicePitch = 0;
+
+		status = m_pDevice->CreateBuffer(&mDesc, &mData, &m_pMeshBuffer);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("vertex format: %s, %u bytes per vertex, %u bytes for the mesh\n",
+			VertexPacking::Layouts[m_VertexFormat].name, VertexPacking::Layouts[m_VertexFormat].stride, static_cast<unsigned int>(vertexSize));
+	}
+
+	// the instance transforms are rewritten every frame
+	if (SUCCEEDED(status))
+	{
+		D3D11_BUFFER_DESC instDesc;
+		instDesc.ByteWidth = static_cast<UINT>(sizeof(float) * Data::INSTANCE_SIZE * m_InstanceCount);
+		instDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		instDesc.Usage = D3D11_USAGE_DYNAMIC;
+		instDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+		instDesc.MiscFlags = 0;
+		instDesc.StructureByteStride = 0;
+
+		status = m_pDevice->CreateBuffer(&instDesc, NULL, &m_pInstanceBuffer);
+	}
+
+	return status;
+}
+
+// takes the scene between the last two simulation ticks, the state must stay valid until the frame is rendered
+INT Renderer::Update(const SimulationState& state, float interpolation)
+{
+	INT status = STATUS_SUCCESS;
+
+	m_FrameArena.BeginFrame();
+
+	float rotation[4];
+	Quaternion::Interpolate(state.previous_rotation, state.rotation, interpolation, rotation);
+	Quaternion::ToMatrix(rotation, m_MatrixBuffer.model_matrix);
+
+	{
+		PROFILE_SCOPE("Cull");
+
+		Culling::Frustum frustum;
+		Culling::ExtractFrustum(m_MatrixBuffer.model_matrix, frustum);
+
+		uint32_t* pVisible = m_FrameArena.Allocate<uint32_t>(m_InstanceCount);
+		float* pTransforms = NULL;
+
+		m_VisibleCount = 0;
+
+		if (pVisible != NULL)
+		{
+			m_VisibleCount = Culling::Cull(frustum, state.spheres.data(), m_InstanceCount, pVisible);
+			pTransforms = m_FrameArena.Allocate<float>(m_VisibleCount * Data::INSTANCE_SIZE);
+		}
+
+		if (pTransforms != NULL)
+		{
+			Culling::Gather(pVisible, m_VisibleCount, state.previous_transforms.data(), state.transforms.data(), interpolation, pTransforms);
+		}
+		else
+		{
+			status = STATUS_NO_MEMORY;
+			m_VisibleCount = 0;
+			WriteToConsole("error 0x%X: out of memory for the visible instances\n", status);
+		}
+
+		m_pVisibleTransforms = pTransforms;
+	}
+
+	return status;
+}
+
+INT Renderer::Render()
+{
+	INT status = STATUS_SUCCESS;
+
+	if (Profiler::IsEnabled())
+	{
+		m_GpuTimer.Begin(m_pContext);
+	}
+
+	{
+		PROFILE_SCOPE("Upload");
+
+		D3DInstanceUploader uploader(m_pContext, m_pInstanceBuffer);
+		status = uploader.Upload(m_pVisibleTransforms, m_VisibleCount * sizeof(float) * Data::INSTANCE_SIZE);
+
+		// the frame's constants, written once into a block of the ring before any draw is recorded
+		if (SUCCEEDED(status))
+		{
+			D3DConstantBufferWriter writer(m_pContext, m_pMatrixBuffer);
+
+			m_ConstantRing.BeginFrame();
+			status = m_ConstantRing.Write(writer, &m_MatrixBuffer, sizeof(m_MatrixBuffer), 1, &m_MatrixBlock);
+		}
+	}
+
+	{
+		PROFILE_SCOPE("Record");
+
+		CommandBuffer& setup = m_FrameCommands[0].commands;
+
+		setup.Clear();
+		setup.ClearRenderTargetView(m_pRenderTargetView, Data::ClearColor);
+		setup.ClearDepthStencilView(m_pDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0, 0);
+
+		m_pJobs->ParallelFor("Record", RecordJob, this, m_FrameCommands.size() - 1, 1);
+	}
+
+	{
+		PROFILE_SCOPE("Draw");
+
+		// the state cache drops the binds that are the same as in the last frame or the command buffer before
+		if (SUCCEEDED(status))
+		{
+			status = m_FrameCommands[0].commands.Replay(*m_pStateCache);
+		}
+
+		for (size_t i = 1; (i < m_FrameCommands.size()) && SUCCEEDED(status); i++)
+		{
+			FrameCommands& frame = m_FrameCommands[i];
+
+			if (frame.pDeferredContext == NULL)
+			{
+				status = frame.commands.Replay(*m_pStateCache);
+			}
+			else if (SUCCEEDED(frame.status))
+			{
+				m_pContext->ExecuteCommandList(frame.pCommandList, FALSE);
+			}
+			else
+			{
+				status = frame.status;
+			}
+		}
+
+		// executing a command list leaves the immediate context in its default state
+		if (m_FrameCommands.back().pDeferredContext != NULL)
+		{
+			for (FrameCommands& frame : m_FrameCommands)
+			{
+				if (frame.pCommandList != NULL)
+				{
+					frame.pCommandList->Release();
+					frame.pCommandList = NULL;
+				}
+			}
+
+			m_pContext->RSSetViewports(1, &m_Viewport);
+			m_pStateCache->Invalidate();
+		}
+	}
+
+	if (m_pCapturePath != NULL)
+	{
+		CommandBuffer capture;
+
+		for (const FrameCommands& frame : m_FrameCommands)
+		{
+			capture.Append(frame.commands);
+		}
+
+		if (SUCCEEDED(capture.Save(m_pCapturePath, NULL)))
+		{
+			WriteToConsole("captured %u commands in %zu bytes to %s\n", capture.GetCommandCount(), capture.GetSize(), m_pCapturePath);
+		}
+
+		m_pCapturePath = NULL;
+	}
+
+	if (Profiler::IsEnabled())
+	{
+		m_GpuTimer.End(m_pContext);
+	}
+
+	{
+		PROFILE_SCOPE("Present");
+
+		m_pSwapChain->Present(1, 0);
+
+		// the flip model unbinds the back buffer
+		m_pStateCache->InvalidateRenderTargets();
+	}
+
+	return status;
+}
+
+// writes the commands of the next frame to path, which has to stay valid until then
+VOID Renderer::Capture(const char* path)
+{
+	m_pCapturePath = path;
+}
+
+// records the share of the visible instances of m_FrameCommands[index], and with a deferred context its command list
+VOID Renderer::Record(size_t index)
+{
+	FrameCommands& frame = m_FrameCommands[index];
+
+	const size_t count = m_FrameCommands.size() - 1;
+	const size_t share = (m_VisibleCount + count - 1) / count;
+	const size_t begin = std::min(m_VisibleCount, (index - 1) * share);
+	const size_t end = std::min(m_VisibleCount, begin + share);
+
+	frame.commands.Clear();
+
+	// every command buffer binds all it needs, none relies on the state left by another
+	if (begin < end)
+	{
+		frame.commands.OMSetRenderTargets(1, &m_pRenderTargetView, m_pDepthStencilView);
+
+		DrawQueue::Draw draw = {};
+		draw.pVertexShader = m_pVertexShader;
+		draw.pPixelShader = m_pPixelShader;
+		draw.pInputLayout = m_pVertexShaderInputLayout;
+		draw.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		draw.pVertexBuffers[0] = m_pVertexBuffer;
+		draw.pVertexBuffers[1] = m_pInstanceBuffer;
+		draw.strides[0] = VertexPacking::Layouts[m_VertexFormat].stride;
+		draw.strides[1] = sizeof(float) * Data::INSTANCE_SIZE;
+		draw.vertex_buffer_count = 2;
+		draw.pIndexBuffer = m_pIndexBuffer;
+		draw.index_format = m_IndexFormat;
+		draw.pConstantBuffers[0] = m_pMatrixBuffer;
+		draw.pConstantBuffers[1] = m_pMeshBuffer;
+		draw.first_constants[0] = m_ConstantOffsets ? ConstantRing::GetFirstConstant(m_MatrixBlock, 0) : 0;
+		draw.constant_counts[0] = m_ConstantOffsets ? ConstantRing::GetConstantCount(m_MatrixBlock) : 0;
+		draw.constant_buffer_count = 2;
+		draw.index_count = m_IndexCount;
+		draw.instance_count = static_cast<UINT>(end - begin);
+		draw.start_instance = static_cast<UINT>(begin);
+
+		frame.draws.Add(draw);
+		frame.draws.Submit(frame.commands);
+	}
+
+	if (frame.pDeferredContext != NULL)
+	{
+		D3DRenderContext context(frame.pDeferredContext);
+
+		frame.pDeferredContext->RSSetViewports(1, &m_Viewport);
+		frame.status = frame.commands.Replay(context);
+
+		if (SUCCEEDED(frame.status))
+		{
+			frame.status = frame.pDeferredContext->FinishCommandList(FALSE, &frame.pCommandList);
+
+			if (FAILED(frame.status))
+			{
+				WriteToConsole("error 0x%X: could not finish command list %zu\n", frame.status, index);
+			}
+		}
+	}
+}
+
+VOID Renderer::RecordJob(VOID* pData, size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		static_cast<Renderer*>(pData)->Record(i + 1);
+	}
+}
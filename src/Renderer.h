@@ -0,0 +1,100 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "VertexPacking.h"
+#include "MeshPack.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "ConstantRing.h"
+#include "RenderContext.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
+#include "Simulation.h"
+#include "GpuTimer.h"
+
+class Renderer
+{
+private:
+	enum {
+		CONSTANT_RING_SIZE = 64 * 1024 // the frame's transforms go into a block of it, 256 frames before it wraps
+	};
+
+	/*
+	* the commands of a frame. the first set up the frame, the others record a share of the visible instances each, in
+	* parallel, and are replayed in their order. with deferred contexts each one is also replayed into a command list
+	* on the thread that recorded it.
+	*/
+	struct FrameCommands
+	{
+		CommandBuffer        commands;
+		DrawQueue            draws;
+		ID3D11DeviceContext* pDeferredContext;
+		ID3D11CommandList*   pCommandList;
+		INT                  status;
+	};
+
+	ID3D11Device*              m_pDevice;
+	ID3D11DeviceContext*       m_pContext;
+	IDXGISwapChain*            m_pSwapChain;
+	ID3D11Texture2D*           m_pBackBuffer;
+	ID3D11RenderTargetView*    m_pRenderTargetView;
+	ID3D11Texture2D*           m_pDepthStencilBuffer;
+	ID3D11DepthStencilView*    m_pDepthStencilView;
+	ID3D11Debug*               m_pDebugInterface;
+	ID3D11VertexShader*		   m_pVertexShader;
+	ID3D11PixelShader*		   m_pPixelShader;
+	ID3D11Buffer*              m_pVertexBuffer;
+	ID3D11Buffer*              m_pIndexBuffer;
+	ID3D11Buffer*              m_pInstanceBuffer;
+	ID3D11Buffer*              m_pMatrixBuffer;
+	ID3D11Buffer*              m_pMeshBuffer;
+	ID3D11InputLayout*         m_pVertexShaderInputLayout;
+
+	VertexPacking::Format      m_VertexFormat;
+	unsigned int               m_VertexCount;
+	unsigned int               m_IndexCount;
+	DXGI_FORMAT                m_IndexFormat;
+
+	Data::MatrixBuffer         m_MatrixBuffer;
+	ConstantRing               m_ConstantRing;
+	ConstantRing::Block        m_MatrixBlock;
+	bool                       m_ConstantOffsets; // draws bind the block of their frame, else the ring is one slice bound whole
+	size_t                     m_InstanceCount;
+	size_t                     m_VisibleCount;
+	const float*               m_pVisibleTransforms; // the transforms of the visible instances, in the INSTANCE stream layout
+	FrameArena                 m_FrameArena;
+	std::unique_ptr<D3DRenderContext> m_pRenderContext;
+	std::unique_ptr<StateCache>       m_pStateCache;
+	std::vector<FrameCommands> m_FrameCommands;
+	JobSystem*                 m_pJobs;
+	D3D11_VIEWPORT             m_Viewport;
+	const char*                m_pCapturePath;
+	GpuTimer                   m_GpuTimer;
+	ShaderCache                m_ShaderCache;
+	D3DShaderCompiler          m_ShaderCompiler;
+
+public:
+	Renderer();
+
+	INT  Initialize(HWND hWnd, size_t instanceCount, VertexPacking::Format vertexFormat, MeshPack* pMesh, unsigned int commandBuffers, bool deferredContexts, bool debugColor, JobSystem& jobs);
+	VOID Uninitialize();
+
+	INT  Update(const SimulationState& state, float interpolation);
+	INT  Render();
+
+	VOID Capture(const char* path);
+
+private:
+	INT CreateConstantBuffers();
+	INT GenerateBuffers(MeshPack* pMesh);
+
+	static INT CreateVertexShader(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize);
+	static INT CreatePixelShader(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize);
+
+	VOID Record(size_t index);
+
+	static VOID RecordJob(VOID* pData, size_t begin, size_t end);
+};
@@ -0,0 +1,262 @@
+#include "SceneHierarchy.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "JobSystem.h"
+
+SceneHierarchy::SceneHierarchy()
+{
+	m_Count = 0;
+	m_Stamp = 1;
+	m_Begin = 0;
+}
+
+/*
+* replaces the hierarchy by count nodes where node i is a child of pParents[i], or a root for INVALID. the nodes are
+* sorted breadth first with roots and siblings in the order given, GetIndex maps them to their sorted index which
+* every other call takes. all local matrices start as the identity and all nodes as dirty
+*/
+INT SceneHierarchy::Build(const uint32_t* pParents, size_t count)
+{
+	INT status = STATUS_SUCCESS;
+
+	if (count >= INVALID)
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: a hierarchy holds at most 0x%X nodes\n", status, INVALID - 1);
+	}
+
+	for (size_t i = 0; (i < count) && SUCCEEDED(status); i++)
+	{
+		if ((pParents[i] != INVALID) && (pParents[i] >= count))
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: the parent of node %zu is out of range\n", status, i);
+		}
+	}
+
+	// the children of every node in the order given, then the nodes in the order of a breadth first walk
+	std::vector<uint32_t> child_starts;
+	std::vector<uint32_t> children;
+	std::vector<uint32_t> order;
+
+	if (SUCCEEDED(status))
+	{
+		child_starts.assign(count + 1, 0);
+		children.resize(count);
+		order.reserve(count);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (pParents[i] != INVALID)
+			{
+				child_starts[pParents[i] + 1]++;
+			}
+		}
+
+		for (size_t i = 0; i < count; i++)
+		{
+			child_starts[i + 1] += child_starts[i];
+		}
+
+		std::vector<uint32_t> next(child_starts.begin(), child_starts.end() - 1);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			if (pParents[i] != INVALID)
+			{
+				children[next[pParents[i]]++] = static_cast<uint32_t>(i);
+			}
+			else
+			{
+				order.push_back(static_cast<uint32_t>(i));
+			}
+		}
+
+		for (size_t i = 0; i < order.size(); i++)
+		{
+			const uint32_t node = order[i];
+			order.insert(order.end(), children.begin() + child_starts[node], children.begin() + child_starts[node + 1]);
+		}
+
+		// the nodes on a cycle are never reached from a root
+		if (order.size() != count)
+		{
+			status = STATUS_INVALID_PARAMETER;
+			WriteToConsole("error 0x%X: %zu nodes of the hierarchy are on a cycle\n", status, count - order.size());
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_Count = count;
+		m_Stamp = 1;
+
+		m_Indices.resize(count);
+		m_Parents.resize(count);
+		m_FirstChildren.resize(count + 1);
+		m_NodeLevels.resize(count);
+		m_Stamps.assign(count, m_Stamp);
+		m_Locals.resize(count);
+		m_Worlds.resize(count);
+		m_Levels.clear();
+
+		for (size_t i = 0; i < count; i++)
+		{
+			m_Indices[order[i]] = static_cast<uint32_t>(i);
+		}
+
+		// the children of the sorted nodes follow each other, after the roots
+		size_t first_child = count - child_starts[count];
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const uint32_t node = order[i];
+
+			m_Parents[i] = (pParents[node] != INVALID) ? m_Indices[pParents[node]] : INVALID;
+			m_FirstChildren[i] = static_cast<uint32_t>(first_child);
+			first_child += child_starts[node + 1] - child_starts[node];
+
+			Matrix::ToIdentity(m_Locals[i]);
+			Matrix::ToIdentity(m_Worlds[i]);
+		}
+
+		m_FirstChildren[count] = static_cast<uint32_t>(count);
+
+		// the next level is the children of this one
+		size_t begin = 0;
+		size_t end = count - child_starts[count];
+
+		while (begin < end)
+		{
+			std::fill(m_NodeLevels.begin() + begin, m_NodeLevels.begin() + end, static_cast<uint32_t>(m_Levels.size()));
+			m_Levels.push_back(begin);
+
+			const size_t next = m_FirstChildren[end];
+			begin = end;
+			end = next;
+		}
+
+		m_Levels.push_back(count);
+
+		m_DirtyBegins.assign(m_Levels.begin(), m_Levels.end() - 1);
+		m_DirtyEnds.assign(m_Levels.begin() + 1, m_Levels.end());
+	}
+
+	return status;
+}
+
+// the sorted index of a node as it was given to Build
+uint32_t SceneHierarchy::GetIndex(uint32_t node)
+{
+	return m_Indices[node];
+}
+
+VOID SceneHierarchy::SetLocal(size_t index, const Matrix::Affine3x4& local)
+{
+	const size_t level = m_NodeLevels[index];
+
+	m_Locals[index] = local;
+	m_Stamps[index] = m_Stamp;
+
+	m_DirtyBegins[level] = std::min(m_DirtyBegins[level], index);
+	m_DirtyEnds[level] = std::max(m_DirtyEnds[level], index + 1);
+}
+
+// brings the world matrices up to date with the local matrices set since the last update
+VOID SceneHierarchy::Update(JobSystem& jobs)
+{
+	// the range updated on the level above, empty as [m_Count, 0)
+	size_t above_begin = m_Count;
+	size_t above_end = 0;
+
+	for (size_t level = 0; level + 1 < m_Levels.size(); level++)
+	{
+		size_t begin = m_DirtyBegins[level];
+		size_t end = m_DirtyEnds[level];
+
+		if ((above_begin < above_end) && (m_FirstChildren[above_begin] < m_FirstChildren[above_end]))
+		{
+			begin = std::min<size_t>(begin, m_FirstChildren[above_begin]);
+			end = std::max<size_t>(end, m_FirstChildren[above_end]);
+		}
+
+		if (end > begin + JOB_GRAIN)
+		{
+			m_Begin = begin;
+			jobs.ParallelFor("UpdateHierarchy", UpdateJob, this, end - begin, JOB_GRAIN);
+		}
+		else if (begin < end)
+		{
+			UpdateRange(begin, end);
+		}
+
+		above_begin = begin;
+		above_end = end;
+
+		m_DirtyBegins[level] = m_Count;
+		m_DirtyEnds[level] = 0;
+	}
+
+	// a stamp that wrapped around could match the ones of long ago
+	if (++m_Stamp == 0)
+	{
+		std::fill(m_Stamps.begin(), m_Stamps.end(), 0);
+		m_Stamp = 1;
+	}
+}
+
+const Matrix::Affine3x4& SceneHierarchy::GetLocal(size_t index)
+{
+	return m_Locals[index];
+}
+
+// as of the last update
+const Matrix::Affine3x4& SceneHierarchy::GetWorld(size_t index)
+{
+	return m_Worlds[index];
+}
+
+uint32_t SceneHierarchy::GetParent(size_t index)
+{
+	return m_Parents[index];
+}
+
+size_t SceneHierarchy::GetCount()
+{
+	return m_Count;
+}
+
+// the number of levels
+size_t SceneHierarchy::GetDepth()
+{
+	return m_Levels.empty() ? 0 : m_Levels.size() - 1;
+}
+
+// the nodes of [begin, end) are all on one level, whose parents are already up to date
+VOID SceneHierarchy::UpdateRange(size_t begin, size_t end)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		const uint32_t parent = m_Parents[i];
+
+		if (parent == INVALID)
+		{
+			if (m_Stamps[i] == m_Stamp)
+			{
+				m_Worlds[i] = m_Locals[i];
+			}
+		}
+		else if ((m_Stamps[i] == m_Stamp) || (m_Stamps[parent] == m_Stamp))
+		{
+			m_Stamps[i] = m_Stamp;
+			Matrix::Multiply(m_Locals[i], m_Worlds[parent], m_Worlds[i]);
+		}
+	}
+}
+
+VOID SceneHierarchy::UpdateJob(VOID* pData, size_t begin, size_t end)
+{
+	SceneHierarchy* pHierarchy = static_cast<SceneHierarchy*>(pData);
+
+	pHierarchy->UpdateRange(pHierarchy->m_Begin + begin, pHierarchy->m_Begin + end);
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.h"
+#include "Matrix.h"
+#include "JobSystem.h"
+
+/*
+* a hierarchy of affine transforms, a node's world matrix is its local matrix followed by the world matrix of its
+* parent. the nodes are stored sorted breadth first, so the parents of a level all come before it, every level is a
+* contiguous range, and the children of a node are a contiguous range of the next level in the order of their
+* parents. the local and world matrices, parents and child ranges are arrays over the sorted nodes.
+*
+* SetLocal only marks its node dirty. Update walks the levels top down and recomputes the world matrices of the dirty
+* nodes and of the nodes whose parent was recomputed. the descendants of a range of a level are a range of the next
+* level, so each level only scans the range below what changed above it plus the nodes set on it, in one linear pass
+* that is split over the job system when it is long. a node is dirty when its stamp is the one of the next update,
+* so nothing has to be cleared afterwards.
+*/
+class SceneHierarchy
+{
+public:
+	enum : uint32_t {
+		INVALID = 0xFFFFFFFF // the parent of a root
+	};
+
+private:
+	enum {
+		JOB_GRAIN = 4096 // nodes per job, a level of fewer is updated on the calling thread
+	};
+
+	size_t                         m_Count;
+	uint32_t                       m_Stamp;          // of the next update
+	size_t                         m_Begin;          // of the range of the level being updated by the jobs
+
+	std::vector<uint32_t>          m_Indices;        // the sorted index of each node as it was given to Build
+	std::vector<uint32_t>          m_Parents;
+	std::vector<uint32_t>          m_FirstChildren;  // the children of node i are [m_FirstChildren[i], m_FirstChildren[i + 1])
+	std::vector<uint32_t>          m_NodeLevels;
+	std::vector<uint32_t>          m_Stamps;
+	std::vector<Matrix::Affine3x4> m_Locals;
+	std::vector<Matrix::Affine3x4> m_Worlds;
+
+	std::vector<size_t>            m_Levels;         // the first node of every level, then m_Count
+	std::vector<size_t>            m_DirtyBegins;    // the range of the nodes set on every level since the last update
+	std::vector<size_t>            m_DirtyEnds;
+
+public:
+	SceneHierarchy();
+
+	INT  Build(const uint32_t* pParents, size_t count);
+
+	uint32_t GetIndex(uint32_t node);
+	VOID     SetLocal(size_t index, const Matrix::Affine3x4& local);
+	VOID     Update(JobSystem& jobs);
+
+	const Matrix::Affine3x4& GetLocal(size_t index);
+	const Matrix::Affine3x4& GetWorld(size_t index);
+	uint32_t                 GetParent(size_t index);
+
+	size_t GetCount();
+	size_t GetDepth();
+
+private:
+	VOID UpdateRange(size_t begin, size_t end);
+
+	static VOID UpdateJob(VOID* pData, size_t begin, size_t end);
+};
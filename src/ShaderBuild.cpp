@@ -0,0 +1,196 @@
+#include "ShaderBuild.h"
+#include "Log.h"
+#include "Data.h"
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "JobSystem.h"
+
+ShaderBuild::ShaderBuild()
+{
+	m_pJobs = NULL;
+	m_pCache = NULL;
+	m_pCompiler = NULL;
+	m_pDone = NULL;
+}
+
+// create may be NULL to only compile the permutation into the cache
+VOID ShaderBuild::Add(const ShaderPermutation& permutation, CreateFunction create, VOID* pData)
+{
+	Entry entry;
+	entry.pBuild = this;
+	entry.permutation = permutation;
+	entry.create = create;
+	entry.pData = pData;
+	entry.pCode = NULL;
+	entry.code_size = 0;
+	entry.status = STATUS_SUCCESS;
+
+	m_Entries.push_back(entry);
+}
+
+// builds the whole graph before the first job is submitted, the build is not finished until Wait returns
+INT ShaderBuild::Start(JobSystem& jobs, ShaderCache& cache, ShaderCompiler& compiler)
+{
+	INT status = STATUS_SUCCESS;
+
+	m_pJobs = &jobs;
+	m_pCache = &cache;
+	m_pCompiler = &compiler;
+
+	std::vector<JobSystem::Job*> compiles(m_Entries.size());
+
+	m_pDone = jobs.CreateParallelFor("ShaderBuild", DoneJob, this, 1, 1);
+
+	for (size_t i = 0; (i < m_Entries.size()) && SUCCEEDED(status); i++)
+	{
+		compiles[i] = jobs.CreateParallelFor("ShaderCompile", CompileJob, &m_Entries[i], 1, 1);
+
+		if (m_Entries[i].create != NULL)
+		{
+			JobSystem::Job* pCreate = jobs.CreateParallelFor("ShaderCreate", CreateJob, &m_Entries[i], 1, 1);
+
+			status = jobs.AddDependency(compiles[i], pCreate);
+
+			if (SUCCEEDED(status))
+			{
+				status = jobs.AddDependency(pCreate, m_pDone);
+			}
+
+			if (SUCCEEDED(status))
+			{
+				jobs.Submit(pCreate);
+			}
+		}
+		else
+		{
+			status = jobs.AddDependency(compiles[i], m_pDone);
+		}
+	}
+
+	// the creates only hold back on their compiles, so nothing can run before this point
+	if (SUCCEEDED(status))
+	{
+		for (JobSystem::Job* pCompile : compiles)
+		{
+			jobs.Submit(pCompile);
+		}
+
+		jobs.Submit(m_pDone);
+	}
+	else
+	{
+		m_pDone = NULL;
+	}
+
+	return status;
+}
+
+INT ShaderBuild::Wait()
+{
+	INT status = STATUS_SUCCESS;
+
+	if (m_pDone != NULL)
+	{
+		m_pJobs->Wait(m_pDone);
+		m_pDone = NULL;
+	}
+
+	for (size_t i = 0; (i < m_Entries.size()) && SUCCEEDED(status); i++)
+	{
+		status = m_Entries[i].status;
+	}
+
+	return status;
+}
+
+size_t ShaderBuild::GetCount()
+{
+	return m_Entries.size();
+}
+
+const ShaderPermutation& ShaderBuild::GetPermutation(size_t index)
+{
+	return m_Entries[index].permutation;
+}
+
+// NULL for a permutation that did not compile
+const void* ShaderBuild::GetCode(size_t index, size_t* pCodeSize)
+{
+	*pCodeSize = m_Entries[index].code_size;
+	return m_Entries[index].pCode;
+}
+
+VOID ShaderBuild::CompileJob(VOID* pData, size_t, size_t)
+{
+	Entry& entry = *static_cast<Entry*>(pData);
+	const Data::ShaderSource source = entry.permutation.GetSource();
+
+	entry.status = entry.pBuild->m_pCache->Get(source, *entry.pBuild->m_pCompiler, &entry.pCode, &entry.code_size);
+
+	if (FAILED(entry.status))
+	{
+		entry.pCode = NULL;
+		entry.code_size = 0;
+		WriteToConsole("error 0x%X: could not compile %s\n", entry.status, entry.permutation.GetName());
+	}
+}
+
+VOID ShaderBuild::CreateJob(VOID* pData, size_t, size_t)
+{
+	Entry& entry = *static_cast<Entry*>(pData);
+
+	if (SUCCEEDED(entry.status))
+	{
+		entry.status = entry.create(entry.pData, entry.permutation, entry.pCode, entry.code_size);
+	}
+}
+
+VOID ShaderBuild::DoneJob(VOID*, size_t, size_t)
+{
+}
+
+INT WarmShaderCache(const char* path, JobSystem& jobs)
+{
+	INT status = STATUS_SUCCESS;
+
+	ShaderCache cache;
+	D3DShaderCompiler compiler;
+	std::vector<ShaderPermutation> permutations;
+	ShaderBuild build;
+
+	for (UINT shader = 0; shader < ARRAYSIZE(Data::Shaders); shader++)
+	{
+		ShaderPermutation::Expand(shader, permutations);
+	}
+
+	for (const ShaderPermutation& permutation : permutations)
+	{
+		build.Add(permutation, NULL, NULL);
+	}
+
+	status = cache.Open(path);
+
+	if (SUCCEEDED(status))
+	{
+		status = build.Start(jobs, cache, compiler);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = build.Wait();
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = cache.Save();
+	}
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("shader cache %s: %zu permutations, %u cached, %u compiled\n", path, permutations.size(), cache.GetHitCount(), cache.GetMissCount());
+	}
+
+	cache.Close();
+
+	return status;
+}
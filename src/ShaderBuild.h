@@ -0,0 +1,59 @@
+#pragma once
+
+#include "Common.h"
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "JobSystem.h"
+
+/*
+* compiles shader permutations on the job system and hands each bytecode to its create function as soon as it is ready,
+* so the pipeline objects of the first permutations are created while the others still compile. every permutation is
+* a compile job followed by its create job, and one last job waits for all of them. the thread that starts the build is
+* free to do other work until Wait, where it helps with the remaining jobs.
+*
+* the compiles go through the shader cache, whose hits cost no more than a lookup. a permutation that fails to compile
+* skips its create, Wait returns the first failure.
+*/
+class ShaderBuild
+{
+public:
+	// runs on any thread of the job system, the bytecode belongs to the shader cache
+	typedef INT (*CreateFunction)(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize);
+
+private:
+	struct Entry
+	{
+		ShaderBuild*      pBuild;
+		ShaderPermutation permutation;
+		CreateFunction    create;
+		VOID*             pData;
+		const void*       pCode;
+		size_t            code_size;
+		INT               status;
+	};
+
+	std::vector<Entry> m_Entries; // the jobs point into it, so it is not touched between Start and Wait
+	JobSystem*         m_pJobs;
+	ShaderCache*       m_pCache;
+	ShaderCompiler*    m_pCompiler;
+	JobSystem::Job*    m_pDone;
+
+public:
+	ShaderBuild();
+
+	VOID Add(const ShaderPermutation& permutation, CreateFunction create, VOID* pData);
+	INT  Start(JobSystem& jobs, ShaderCache& cache, ShaderCompiler& compiler);
+	INT  Wait();
+
+	size_t GetCount();
+	const ShaderPermutation& GetPermutation(size_t index);
+	const void* GetCode(size_t index, size_t* pCodeSize);
+
+private:
+	static VOID CompileJob(VOID* pData, size_t begin, size_t end);
+	static VOID CreateJob(VOID* pData, size_t begin, size_t end);
+	static VOID DoneJob(VOID* pData, size_t begin, size_t end);
+};
+
+// compiles every permutation of every shader into the cache without creating a device, used to ship a pre-built pack
+INT WarmShaderCache(const char* path, JobSystem& jobs);
@@ -0,0 +1,350 @@
+#include "ShaderCache.h"
+#include "Log.h"
+#include "Data.h"
+#include "Fnv.h"
+#include "ShaderCompiler.h"
+#include "FileMapping.h"
+
+ShaderCache::ShaderCache()
+{
+	m_pView = NULL;
+	m_pEntries = NULL;
+	m_EntryCount = 0;
+	m_Dirty = false;
+
+	m_Hits = 0;
+	m_Misses = 0;
+}
+
+uint64_t ShaderCache::ComputeKey(const Data::ShaderSource& source)
+{
+	uint64_t key = Fnv::OFFSET_BASIS;
+
+	// the strings are hashed with their terminators so adjacent fields cannot run into each other
+	key = Fnv::Hash(source.pSrcData, source.SrcDataSize, key);
+	key = Fnv::Hash(source.pEntrypoint, strlen(source.pEntrypoint) + 1, key);
+	key = Fnv::Hash(source.pTarget, strlen(source.pTarget) + 1, key);
+	key = Fnv::Hash(&source.flags, sizeof(source.flags), key);
+
+	for (const Data::ShaderDefine* pDefine = source.pDefines; (pDefine != NULL) && (pDefine->name != NULL); pDefine++)
+	{
+		const char* value = (pDefine->value != NULL) ? pDefine->value : "";
+
+		key = Fnv::Hash(pDefine->name, strlen(pDefine->name) + 1, key);
+		key = Fnv::Hash(value, strlen(value) + 1, key);
+	}
+
+	return key;
+}
+
+INT ShaderCache::Open(const char* path)
+{
+	m_Path = path;
+	m_Dirty = false;
+
+	// a missing or damaged pack is not an error, every shader is simply a miss
+	if (FAILED(Map()))
+	{
+		m_Dirty = true;
+	}
+
+	return STATUS_SUCCESS;
+}
+
+VOID ShaderCache::Close()
+{
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	Unmap();
+	m_Pending.clear();
+}
+
+INT ShaderCache::Map()
+{
+	INT status = STATUS_SUCCESS;
+
+	// a missing pack is not reported, it is simply rebuilt
+	status = m_File.Open(m_Path.c_str());
+
+	if (SUCCEEDED(status))
+	{
+		if (m_File.GetSize() < sizeof(PackHeader))
+		{
+			status = STATUS_DATA_ERROR;
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = m_File.Map();
+		m_pView = m_File.GetData();
+
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not map the shader cache %s\n", status, m_Path.c_str());
+		}
+	}
+
+	// validate the header and the entry table, the blobs are validated when they are used
+	if (SUCCEEDED(status))
+	{
+		const PackHeader* pHeader = reinterpret_cast<const PackHeader*>(m_pView);
+		const uint64_t file_size = m_File.GetSize();
+		const uint64_t table_end = sizeof(PackHeader) + static_cast<uint64_t>(pHeader->entry_count) * sizeof(PackEntry);
+
+		if ((pHeader->magic != PACK_MAGIC) || (pHeader->version != PACK_VERSION) || (pHeader->file_size != file_size) || (table_end > file_size))
+		{
+			status = STATUS_DATA_ERROR;
+		}
+		else
+		{
+			m_pEntries = reinterpret_cast<const PackEntry*>(m_pView + sizeof(PackHeader));
+			m_EntryCount = pHeader->entry_count;
+
+			if (Fnv::Checksum(m_pEntries, m_EntryCount * sizeof(PackEntry)) != pHeader->table_checksum)
+			{
+				status = STATUS_DATA_ERROR;
+			}
+
+			for (uint32_t i = 0; SUCCEEDED(status) && (i < m_EntryCount); i++)
+			{
+				const PackEntry& entry = m_pEntries[i];
+
+				if ((entry.offset < table_end) || (entry.offset > file_size) || (entry.size > file_size - entry.offset) || ((i > 0) && (m_pEntries[i - 1].key >= entry.key)))
+				{
+					status = STATUS_DATA_ERROR;
+				}
+			}
+		}
+
+		if (FAILED(status))
+		{
+			WriteToConsole("warning: the shader cache %s is damaged and will be rebuilt\n", m_Path.c_str());
+		}
+	}
+
+	if (FAILED(status))
+	{
+		Unmap();
+	}
+
+	return status;
+}
+
+VOID ShaderCache::Unmap()
+{
+	m_File.Close();
+
+	m_pView = NULL;
+	m_pEntries = NULL;
+	m_EntryCount = 0;
+}
+
+const ShaderCache::PackEntry* ShaderCache::Find(uint64_t key)
+{
+	const PackEntry* pEnd = m_pEntries + m_EntryCount;
+	const PackEntry* pEntry = std::lower_bound(m_pEntries, pEnd, key, [](const PackEntry& entry, uint64_t k) { return entry.key < k; });
+
+	return ((pEntry != pEnd) && (pEntry->key == key)) ? pEntry : NULL;
+}
+
+// the returned bytecode stays valid until the cache is closed. safe to call from several threads.
+// hits in the pack are copied out, because Save replaces the pack and remaps it
+INT ShaderCache::Get(const Data::ShaderSource& source, ShaderCompiler& compiler, const void** ppCode, size_t* pCodeSize)
+{
+	INT status = STATUS_SUCCESS;
+	const uint64_t key = ComputeKey(source);
+
+	{
+		std::lock_guard<std::mutex> lock(m_Lock);
+
+		for (const std::unique_ptr<PendingEntry>& pending : m_Pending)
+		{
+			if (pending->key == key)
+			{
+				*ppCode = pending->bytecode.data();
+				*pCodeSize = pending->bytecode.size();
+				m_Hits++;
+
+				return status;
+			}
+		}
+
+		const PackEntry* pEntry = (m_pEntries != NULL) ? Find(key) : NULL;
+		if (pEntry != NULL)
+		{
+			const BYTE* pCode = m_pView + pEntry->offset;
+
+			if (Fnv::Checksum(pCode, pEntry->size) == pEntry->checksum)
+			{
+				std::unique_ptr<PendingEntry> loaded(new PendingEntry());
+				loaded->key = key;
+				loaded->bytecode.assign(pCode, pCode + pEntry->size);
+
+				*ppCode = loaded->bytecode.data();
+				*pCodeSize = loaded->bytecode.size();
+				m_Hits++;
+
+				m_Pending.push_back(std::move(loaded));
+
+				return status;
+			}
+
+			WriteToConsole("warning: damaged shader cache entry for %s, recompiling\n", source.pSourceName);
+		}
+	}
+
+	std::unique_ptr<PendingEntry> pending(new PendingEntry());
+	pending->key = key;
+
+	status = compiler.Compile(source, pending->bytecode);
+
+	if (SUCCEEDED(status))
+	{
+		*ppCode = pending->bytecode.data();
+		*pCodeSize = pending->bytecode.size();
+		m_Misses++;
+
+		std::lock_guard<std::mutex> lock(m_Lock);
+		m_Pending.push_back(std::move(pending));
+		m_Dirty = true;
+	}
+
+	return status;
+}
+
+// writes the valid entries of the current pack plus everything compiled since it was opened
+INT ShaderCache::Save()
+{
+	INT status = STATUS_SUCCESS;
+
+	std::lock_guard<std::mutex> lock(m_Lock);
+
+	if (!m_Dirty)
+	{
+		return status;
+	}
+
+	struct Source
+	{
+		uint64_t    key;
+		const BYTE* pCode;
+		size_t      size;
+	};
+
+	std::vector<Source> sources;
+
+	for (const std::unique_ptr<PendingEntry>& pending : m_Pending)
+	{
+		Source source = { pending->key, pending->bytecode.data(), pending->bytecode.size() };
+		sources.push_back(source);
+	}
+
+	for (uint32_t i = 0; i < m_EntryCount; i++)
+	{
+		const PackEntry& entry = m_pEntries[i];
+		const BYTE* pCode = m_pView + entry.offset;
+
+		if (Fnv::Checksum(pCode, entry.size) == entry.checksum)
+		{
+			Source source = { entry.key, pCode, entry.size };
+			sources.push_back(source);
+		}
+	}
+
+	// pending entries come first, so they win over damaged or stale entries with the same key
+	std::stable_sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.key < b.key; });
+	sources.erase(std::unique(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.key == b.key; }), sources.end());
+
+	const size_t table_end = sizeof(PackHeader) + sources.size() * sizeof(PackEntry);
+	size_t offset = (table_end + BLOB_ALIGNMENT - 1) & ~static_cast<size_t>(BLOB_ALIGNMENT - 1);
+
+	std::vector<PackEntry> entries(sources.size());
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		entries[i].key = sources[i].key;
+		entries[i].offset = offset;
+		entries[i].size = static_cast<uint32_t>(sources[i].size);
+		entries[i].checksum = Fnv::Checksum(sources[i].pCode, sources[i].size);
+
+		offset = (offset + sources[i].size + BLOB_ALIGNMENT - 1) & ~static_cast<size_t>(BLOB_ALIGNMENT - 1);
+	}
+
+	std::vector<BYTE> pack(offset, 0);
+
+	PackHeader header;
+	header.magic = PACK_MAGIC;
+	header.version = PACK_VERSION;
+	header.entry_count = static_cast<uint32_t>(entries.size());
+	header.table_checksum = Fnv::Checksum(entries.data(), entries.size() * sizeof(PackEntry));
+	header.file_size = pack.size();
+
+	CopyMemory(pack.data(), &header, sizeof(PackHeader));
+	if (!entries.empty())
+	{
+		CopyMemory(pack.data() + sizeof(PackHeader), entries.data(), entries.size() * sizeof(PackEntry));
+	}
+
+	for (size_t i = 0; i < sources.size(); i++)
+	{
+		CopyMemory(pack.data() + entries[i].offset, sources[i].pCode, sources[i].size);
+	}
+
+	// write a temporary file and move it over the old pack once it is complete
+	const std::string temp_path = m_Path + ".tmp";
+
+	FILE* pFile = OpenFileStream(temp_path.c_str(), "wb");
+	if (pFile == NULL)
+	{
+		status = GetErrnoStatus();
+		WriteToConsole("error 0x%X: could not create %s\n", status, temp_path.c_str());
+	}
+
+	if (SUCCEEDED(status))
+	{
+		// a full disk can cut the write short without setting errno, which must not read as success
+		errno = 0;
+
+		const bool written = (fwrite(pack.data(), 1, pack.size(), pFile) == pack.size());
+		const bool closed = (fclose(pFile) == 0);
+
+		if (!written || !closed)
+		{
+			status = (errno != 0) ? GetErrnoStatus() : STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: could not write %s\n", status, temp_path.c_str());
+		}
+	}
+
+	// the pending and loaded bytecode may still be in use, so it is kept until Close
+	if (SUCCEEDED(status))
+	{
+		Unmap();
+
+		status = MoveFileOver(temp_path.c_str(), m_Path.c_str());
+		if (FAILED(status))
+		{
+			WriteToConsole("error 0x%X: could not replace %s\n", status, m_Path.c_str());
+		}
+
+		Map();
+		m_Dirty = false;
+	}
+
+	// a pack that was not moved over the old one is never used
+	if (FAILED(status))
+	{
+		remove(temp_path.c_str());
+	}
+
+	return status;
+}
+
+uint32_t ShaderCache::GetHitCount()
+{
+	return m_Hits;
+}
+
+uint32_t ShaderCache::GetMissCount()
+{
+	return m_Misses;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "ShaderCompiler.h"
+#include "FileMapping.h"
+
+/*
+* an on-disk cache of shader bytecode keyed by a hash of everything that affects compilation: the source, the
+* entrypoint, the target, the flags and the defines. the pack file is memory mapped read-only and hits return
+* pointers straight into the mapping. misses are compiled and kept in memory until Save, which writes a new pack
+* next to the old one and swaps it in, so other processes reading the old pack are never disturbed.
+*
+* pack layout: PackHeader, PackEntry[entry_count] sorted by key, then the 16 byte aligned bytecode blobs.
+* a pack with a bad header or table is ignored as a whole, a blob with a bad checksum is treated as a miss.
+*/
+class ShaderCache
+{
+private:
+	enum {
+		PACK_MAGIC     = 0x43444853, // "SHDC"
+		PACK_VERSION   = 1,
+		BLOB_ALIGNMENT = 16
+	};
+
+	struct PackHeader
+	{
+		uint32_t magic;
+		uint32_t version;
+		uint32_t entry_count;
+		uint32_t table_checksum;
+		uint64_t file_size;
+	};
+
+	struct PackEntry
+	{
+		uint64_t key;
+		uint64_t offset;
+		uint32_t size;
+		uint32_t checksum;
+	};
+
+	struct PendingEntry
+	{
+		uint64_t          key;
+		std::vector<BYTE> bytecode;
+	};
+
+	std::string                                m_Path;
+	FileMapping                                m_File;
+	const BYTE*                                m_pView;
+	const PackEntry*                           m_pEntries;
+	uint32_t                                   m_EntryCount;
+
+	// guards the mapping as well as the entries, since Save remaps the pack.
+	// m_Pending holds the compiled entries and the copies handed out for pack hits
+	std::mutex                                 m_Lock;
+	std::vector<std::unique_ptr<PendingEntry>> m_Pending;
+	bool                                       m_Dirty;
+
+	std::atomic<uint32_t>                      m_Hits;
+	std::atomic<uint32_t>                      m_Misses;
+
+public:
+	ShaderCache();
+
+	INT  Open(const char* path);
+	VOID Close();
+
+	INT  Get(const Data::ShaderSource& source, ShaderCompiler& compiler, const void** ppCode, size_t* pCodeSize);
+	INT  Save();
+
+	uint32_t GetHitCount();
+	uint32_t GetMissCount();
+
+	static uint64_t ComputeKey(const Data::ShaderSource& source);
+
+private:
+	INT  Map();
+	VOID Unmap();
+	const PackEntry* Find(uint64_t key);
+};
@@ -0,0 +1,134 @@
+#include "ShaderCompiler.h"
+#include "Log.h"
+#include "Data.h"
+
+#if defined(_WIN32)
+
+INT D3DShaderCompiler::Compile(const Data::ShaderSource& source, std::vector<BYTE>& bytecode)
+{
+	INT status = STATUS_SUCCESS;
+	ID3DBlob* codeBlob = NULL;
+	ID3DBlob* errorBlob = NULL;
+
+	std::vector<D3D_SHADER_MACRO> defines;
+	for (const Data::ShaderDefine* pDefine = source.pDefines; (pDefine != NULL) && (pDefine->name != NULL); pDefine++)
+	{
+		D3D_SHADER_MACRO macro = { pDefine->name, pDefine->value };
+		defines.push_back(macro);
+	}
+
+	D3D_SHADER_MACRO terminator = { NULL, NULL };
+	defines.push_back(terminator);
+
+	status = D3DCompile(source.pSrcData, source.SrcDataSize, source.pSourceName, defines.data(), D3D_COMPILE_STANDARD_FILE_INCLUDE, source.pEntrypoint, source.pTarget, source.flags, 0, &codeBlob, &errorBlob);
+
+	if (SUCCEEDED(status))
+	{
+		const BYTE* pCode = static_cast<const BYTE*>(codeBlob->GetBufferPointer());
+		bytecode.assign(pCode, pCode + codeBlob->GetBufferSize());
+	}
+	else if (errorBlob != NULL)
+	{
+		WriteToConsole("%s\n", static_cast<const CHAR*>(errorBlob->GetBufferPointer()));
+	}
+
+	if (codeBlob != NULL)
+	{
+		codeBlob->Release();
+	}
+
+	if (errorBlob != NULL)
+	{
+		errorBlob->Release();
+	}
+
+	return status;
+}
+
+#else
+
+// d3dcompiler only exists on windows, elsewhere the cache is filled from packs built there
+INT D3DShaderCompiler::Compile(const Data::ShaderSource& source, std::vector<BYTE>&)
+{
+	INT status = STATUS_NOT_SUPPORTED;
+	WriteToConsole("error 0x%X: %s cannot be compiled without d3dcompiler\n", status, source.pSourceName);
+
+	return status;
+}
+
+#endif
+
+ShaderPermutation::ShaderPermutation()
+{
+	m_Shader = Data::SHADER_VERTEX;
+	m_Features = 0;
+	m_Defines[0].name = NULL;
+	m_Defines[0].value = NULL;
+	m_Name[0] = '\0';
+}
+
+// features the shader does not have are dropped
+ShaderPermutation::ShaderPermutation(UINT shader, UINT features)
+{
+	m_Shader = shader;
+	m_Features = features & Data::ShaderFeatures[shader];
+
+	int length = std::snprintf(m_Name, sizeof(m_Name), "%s", Data::Shaders[shader].pSourceName);
+	unsigned int count = 0;
+
+	for (unsigned int i = 0; i < Data::FEATURE_COUNT; i++)
+	{
+		if (Data::ShaderFeatures[shader] & (1 << i))
+		{
+			m_Defines[count].name = Data::ShaderFeatureNames[i];
+			m_Defines[count].value = (m_Features & (1 << i)) ? "1" : "0";
+			count++;
+
+			if ((m_Features & (1 << i)) && (length >= 0) && (static_cast<size_t>(length) < sizeof(m_Name)))
+			{
+				length += std::snprintf(m_Name + length, sizeof(m_Name) - length, "+%s", Data::ShaderFeatureNames[i]);
+			}
+		}
+	}
+
+	m_Defines[count].name = NULL;
+	m_Defines[count].value = NULL;
+}
+
+UINT ShaderPermutation::GetShader() const
+{
+	return m_Shader;
+}
+
+UINT ShaderPermutation::GetFeatures() const
+{
+	return m_Features;
+}
+
+const char* ShaderPermutation::GetName() const
+{
+	return m_Name;
+}
+
+Data::ShaderSource ShaderPermutation::GetSource() const
+{
+	Data::ShaderSource source = Data::Shaders[m_Shader];
+	source.pSourceName = m_Name;
+	source.pDefines = m_Defines;
+
+	return source;
+}
+
+// appends every combination of the shader's features
+VOID ShaderPermutation::Expand(UINT shader, std::vector<ShaderPermutation>& permutations)
+{
+	const UINT mask = Data::ShaderFeatures[shader];
+
+	// counts through the subsets of mask, ending with the empty one
+	UINT features = mask;
+	do
+	{
+		permutations.push_back(ShaderPermutation(shader, features));
+		features = (features - 1) & mask;
+	} while (features != mask);
+}
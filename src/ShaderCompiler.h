@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+
+// turns shader source into bytecode, the cache only talks to the compiler through this interface
+class ShaderCompiler
+{
+public:
+	virtual ~ShaderCompiler() {}
+
+	virtual INT Compile(const Data::ShaderSource& source, std::vector<BYTE>& bytecode) = 0;
+};
+
+class D3DShaderCompiler : public ShaderCompiler
+{
+public:
+	INT Compile(const Data::ShaderSource& source, std::vector<BYTE>& bytecode);
+};
+
+/*
+* a variant of one of Data::Shaders. every feature the shader has is defined, to 1 if the permutation has it and to 0
+* otherwise, so strict compiles see no undefined names. the defines are part of the shader cache key and every
+* permutation is cached on its own. the source points into the permutation, which has to outlive it.
+*/
+class ShaderPermutation
+{
+private:
+	UINT               m_Shader;
+	UINT               m_Features;
+	Data::ShaderDefine m_Defines[Data::FEATURE_COUNT + 1];
+	char               m_Name[64];
+
+public:
+	ShaderPermutation();
+	ShaderPermutation(UINT shader, UINT features);
+
+	UINT GetShader() const;
+	UINT GetFeatures() const;
+	const char* GetName() const;
+
+	Data::ShaderSource GetSource() const;
+
+	static VOID Expand(UINT shader, std::vector<ShaderPermutation>& permutations);
+};
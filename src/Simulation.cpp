@@ -0,0 +1,617 @@
+#include "Simulation.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "AnimationTracks.h"
+#include "SceneHierarchy.h"
+
+InstanceStore::InstanceStore()
+{
+	m_Count = 0;
+}
+
+VOID InstanceStore::Initialize(unsigned int grid)
+{
+	m_Count = static_cast<size_t>(grid) * grid * grid;
+
+	const size_t batch_size = Matrix::GetBatchSize(m_Count);
+	m_Placements.assign(batch_size, 0.0f);
+	m_RotationMatrices.assign(batch_size, 0.0f);
+	m_WorldMatrices.assign(batch_size, 0.0f);
+
+	m_Rotations.assign(Quaternion::GetBatchSize(m_Count), 0.0f);
+	m_RotationSteps.assign(Quaternion::GetBatchSize(m_Count), 0.0f);
+	m_Translations.assign(Quaternion::GetBatchSize(m_Count), 0.0f);
+
+	const float cell = 1.0f / grid;
+
+	float identity[4];
+	Quaternion::ToIdentity(identity);
+
+	for (size_t i = 0; i < m_Count; i++)
+	{
+		const size_t x = i % grid;
+		const size_t y = (i / grid) % grid;
+		const size_t z = i / (static_cast<size_t>(grid) * grid);
+
+		// each cube fills half of its cell
+		float placement[16];
+		Matrix::ToIdentity(placement);
+		placement[0]  = 0.5f * cell;
+		placement[5]  = 0.5f * cell;
+		placement[10] = 0.5f * cell;
+		placement[3]  = -0.5f + (x + 0.5f) * cell;
+		placement[7]  = -0.5f + (y + 0.5f) * cell;
+		placement[11] = -0.5f + (z + 0.5f) * cell;
+
+		Matrix::StoreBatch(m_Placements.data(), i, placement);
+		Quaternion::StoreBatch(m_Rotations.data(), i, identity);
+		Quaternion::StoreBatch(m_RotationSteps.data(), i, identity);
+	}
+}
+
+VOID InstanceStore::SetRotationStep(size_t index, const float* rotation)
+{
+	Quaternion::StoreBatch(m_RotationSteps.data(), index, rotation);
+}
+
+// sets the steps of count instances from euler angles, begin has to be a multiple of Matrix::BATCH_WIDTH
+VOID InstanceStore::SetRotationSteps(size_t begin, size_t count, const float* r_x, const float* r_y, const float* r_z)
+{
+	Quaternion::FromEulerBatch(r_x, r_y, r_z, &m_RotationSteps[(begin / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE], count);
+}
+
+/*
+* advances the rotations of the instances [begin, end) by their steps and rebuilds their world matrices. begin has
+* to be a multiple of Matrix::BATCH_WIDTH, so that ranges on different threads never share a batch block
+*/
+VOID InstanceStore::Integrate(size_t begin, size_t end)
+{
+	const size_t block = begin / Matrix::BATCH_WIDTH;
+	const size_t count = end - begin;
+
+	float* pRotations = &m_Rotations[block * Quaternion::BATCH_BLOCK_SIZE];
+	float* pRotationMatrices = &m_RotationMatrices[block * Matrix::BATCH_BLOCK_SIZE];
+
+	Quaternion::AdvanceBatch(pRotations, &m_RotationSteps[block * Quaternion::BATCH_BLOCK_SIZE], count);
+	Quaternion::ToMatrixBatch(pRotations, pRotationMatrices, count);
+
+	// rotations and placements are affine, and so are the world matrices
+	Matrix::MultiplyAffineBatch(pRotationMatrices, &m_Placements[block * Matrix::BATCH_BLOCK_SIZE], &m_WorldMatrices[block * Matrix::BATCH_BLOCK_SIZE], count);
+}
+
+/*
+* poses the instances [begin, end) with their tracks at time instead of integrating their steps, the translations
+* move them within their cells. begin has to be a multiple of Matrix::BATCH_WIDTH like for Integrate
+*/
+VOID InstanceStore::Animate(size_t begin, size_t end, AnimationTracks& tracks, float time)
+{
+	const size_t block = begin / Matrix::BATCH_WIDTH;
+	const size_t count = end - begin;
+
+	float* pRotationMatrices = &m_RotationMatrices[block * Matrix::BATCH_BLOCK_SIZE];
+
+	tracks.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, begin, end, m_Rotations.data(), m_Translations.data());
+	Quaternion::ToMatrixBatch(&m_Rotations[block * Quaternion::BATCH_BLOCK_SIZE], pRotationMatrices, count);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const float* translation = &m_Translations[(i / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH)];
+		float* m = &m_RotationMatrices[(i / Matrix::BATCH_WIDTH) * Matrix::BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH)];
+
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			m[(r * 4 + 3) * Matrix::BATCH_WIDTH] = translation[r * Matrix::BATCH_WIDTH];
+		}
+	}
+
+	Matrix::MultiplyAffineBatch(pRotationMatrices, &m_Placements[block * Matrix::BATCH_BLOCK_SIZE], &m_WorldMatrices[block * Matrix::BATCH_BLOCK_SIZE], count);
+}
+
+// takes the world matrices of the instances [begin, end) from the nodes of the same number in hierarchy
+VOID InstanceStore::Place(size_t begin, size_t end, SceneHierarchy& hierarchy)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		Matrix::Mat4 world;
+		Matrix::Expand(hierarchy.GetWorld(hierarchy.GetIndex(static_cast<uint32_t>(i))), world);
+		Matrix::StoreBatch(m_WorldMatrices.data(), i, world.m);
+	}
+}
+
+// writes the world matrices of the instances [begin, end) to pTransforms in the layout of the INSTANCE stream
+VOID InstanceStore::Pack(size_t begin, size_t end, float* pTransforms)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		Matrix::LoadAffineBatch(m_WorldMatrices.data(), i, &pTransforms[i * Data::INSTANCE_SIZE]);
+	}
+}
+
+// writes the world space bounding spheres of the instances [begin, end) to the culling batch pSpheres, begin has to be
+// a multiple of Matrix::BATCH_WIDTH. the radius grows with the largest scale of the world matrix
+VOID InstanceStore::Bound(size_t begin, size_t end, const Culling::Bounds& bounds, float* pSpheres)
+{
+	for (size_t i = begin; i < end; i++)
+	{
+		const float* m = &m_WorldMatrices[(i / Matrix::BATCH_WIDTH) * Matrix::BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH)];
+		float* sphere = &pSpheres[(i / Matrix::BATCH_WIDTH) * Culling::BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH)];
+
+		float scale_squared = 0.0f;
+
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			const float x = m[(c + 0) * Matrix::BATCH_WIDTH];
+			const float y = m[(c + 4) * Matrix::BATCH_WIDTH];
+			const float z = m[(c + 8) * Matrix::BATCH_WIDTH];
+
+			scale_squared = std::max(scale_squared, x * x + y * y + z * z);
+		}
+
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			const float* row = &m[r * 4 * Matrix::BATCH_WIDTH];
+
+			sphere[r * Matrix::BATCH_WIDTH] = row[0] * bounds.center[0] + row[Matrix::BATCH_WIDTH] * bounds.center[1] + row[2 * Matrix::BATCH_WIDTH] * bounds.center[2] + row[3 * Matrix::BATCH_WIDTH];
+		}
+
+		sphere[3 * Matrix::BATCH_WIDTH] = bounds.radius * sqrtf(scale_squared);
+	}
+}
+
+size_t InstanceStore::GetCount()
+{
+	return m_Count;
+}
+
+RandomStream::RandomStream(uint64_t seed)
+{
+	m_State = seed;
+}
+
+uint64_t RandomStream::Next()
+{
+	uint64_t z = (m_State += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+
+	return z ^ (z >> 31);
+}
+
+// uniform in [0, 1)
+float RandomStream::NextFloat()
+{
+	return static_cast<float>(Next() >> 40) * (1.0f / 16777216.0f);
+}
+
+Simulation::Simulation()
+{
+	m_Tick = 0;
+	m_IntervalTracker = ROTATION_INTERVAL;
+
+	Quaternion::ToIdentity(m_Rotation);
+	Quaternion::ToIdentity(m_RotationStep);
+
+	m_pJobs = NULL;
+	m_pTransforms = NULL;
+	m_pSpheres = NULL;
+	Culling::ComputeBounds(Data::Vertices, ARRAYSIZE(Data::Vertices), m_Bounds);
+	m_Motion = MOTION_SPIN;
+	m_AnimationTime = 0.0f;
+	m_Seed = 0x2545F4914F6CDD1DULL;
+	m_Epoch = 0;
+
+	m_Timestep = std::chrono::nanoseconds(1000000000 / TICK_RATE);
+	m_Running = false;
+}
+
+// the bounds of the mesh the instances are drawn with, Data::Vertices unless this is called before Initialize
+VOID Simulation::SetBounds(const Culling::Bounds& bounds)
+{
+	m_Bounds = bounds;
+}
+
+// call before Initialize
+VOID Simulation::SetMotion(Motion motion)
+{
+	m_Motion = motion;
+}
+
+VOID Simulation::Initialize(unsigned int grid, JobSystem& jobs)
+{
+	m_Instances.Initialize(grid);
+	m_pJobs = &jobs;
+
+	if ((m_Motion == MOTION_TRACKS) && FAILED(GenerateTracks()))
+	{
+		m_Motion = MOTION_SPIN;
+	}
+
+	if ((m_Motion == MOTION_ORBITS) && FAILED(GenerateOrbits()))
+	{
+		m_Motion = MOTION_SPIN;
+	}
+
+	SimulationState state;
+	state.tick = 0;
+	state.time = std::chrono::steady_clock::now();
+	Quaternion::ToIdentity(state.previous_rotation);
+	Quaternion::ToIdentity(state.rotation);
+	Matrix::ToIdentity(state.matrices.model_matrix);
+	state.transforms.assign(m_Instances.GetCount() * Data::INSTANCE_SIZE, 0.0f);
+	state.spheres.assign(Culling::GetBatchSize(m_Instances.GetCount()), 0.0f);
+
+	Matrix::Affine3x4 identity;
+	Matrix::ToIdentity(identity);
+
+	for (size_t i = 0; i < m_Instances.GetCount(); i++)
+	{
+		CopyMemory(&state.transforms[i * Data::INSTANCE_SIZE], identity.m, sizeof(identity.m));
+	}
+
+	state.previous_transforms = state.transforms;
+	m_LastTransforms = state.transforms;
+
+	m_Instances.Bound(0, m_Instances.GetCount(), m_Bounds, state.spheres.data());
+
+	m_States.Initialize(state);
+}
+
+INT Simulation::Start(unsigned int tickRate)
+{
+	INT status = STATUS_SUCCESS;
+
+	if (m_Running || (tickRate == 0))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: could not start the simulation\n", status);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_Timestep = std::chrono::nanoseconds(1000000000 / tickRate);
+		m_Running = true;
+		m_Thread = std::thread(&Simulation::Run, this);
+	}
+
+	return status;
+}
+
+VOID Simulation::Stop()
+{
+	if (m_Thread.joinable())
+	{
+		m_Running = false;
+		m_Thread.join();
+	}
+}
+
+VOID Simulation::Run()
+{
+	std::chrono::steady_clock::time_point next = std::chrono::steady_clock::now();
+
+	while (m_Running)
+	{
+		next += m_Timestep;
+		std::this_thread::sleep_until(next);
+
+		{
+			PROFILE_SCOPE("Simulate");
+			Step(next);
+		}
+
+		// after a long stall the missed ticks are skipped, catching up would only fall further behind
+		const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		if (now - next > m_Timestep * MAX_LAG)
+		{
+			next = now;
+		}
+	}
+}
+
+// advances the scene by one tick and publishes it. only called by one thread at a time
+VOID Simulation::Step(std::chrono::steady_clock::time_point time)
+{
+	const bool reseed = (m_IntervalTracker >= ROTATION_INTERVAL);
+
+	if (reseed)
+	{
+		m_Epoch++;
+		m_IntervalTracker = 0;
+
+		RandomStream random = GetRandomStream(m_Instances.GetCount());
+		GenerateRotation(random, m_RotationStep);
+	}
+	else
+	{
+		m_IntervalTracker++;
+	}
+
+	SimulationState& state = m_States.GetBack();
+
+	CopyMemory(state.previous_rotation, m_Rotation, sizeof(m_Rotation));
+
+	// the slot takes the transforms of the last tick, and its stale ones are overwritten by PackJob
+	state.previous_transforms.swap(m_LastTransforms);
+
+	Quaternion::Multiply(m_Rotation, m_RotationStep, m_Rotation);
+	Quaternion::Normalize(m_Rotation);
+
+	m_Tick++;
+
+	state.tick = m_Tick;
+	state.time = time;
+	CopyMemory(state.rotation, m_Rotation, sizeof(m_Rotation));
+	Quaternion::ToMatrix(m_Rotation, state.matrices.model_matrix);
+
+	m_pTransforms = state.transforms.data();
+	m_pSpheres = state.spheres.data();
+
+	// the time of the tick, so that a tick always shows the same pose
+	m_AnimationTime = static_cast<float>(fmod(static_cast<double>(m_Tick) / TICK_RATE, static_cast<double>(ANIMATION_PERIOD)));
+
+	// only the cubes with others around them turn, the rest follow through the hierarchy
+	if (m_Motion == MOTION_ORBITS)
+	{
+		const double orbit_time = static_cast<double>(m_Tick) / TICK_RATE;
+
+		for (size_t i = 0; i * ORBIT_FANOUT + 1 < m_Instances.GetCount(); i++)
+		{
+			SetOrbit(i, orbit_time);
+		}
+
+		m_Hierarchy.Update(*m_pJobs);
+	}
+
+	JobSystem::Job* pIntegrate =
+		(m_Motion == MOTION_TRACKS) ? m_pJobs->CreateParallelFor("Animate", AnimateJob, this, m_Instances.GetCount(), JOB_GRAIN) :
+		(m_Motion == MOTION_ORBITS) ? m_pJobs->CreateParallelFor("Place", PlaceJob, this, m_Instances.GetCount(), JOB_GRAIN) :
+		m_pJobs->CreateParallelFor("Integrate", IntegrateJob, this, m_Instances.GetCount(), JOB_GRAIN);
+	JobSystem::Job* pPack = m_pJobs->CreateParallelFor("Pack", PackJob, this, m_Instances.GetCount(), JOB_GRAIN);
+	m_pJobs->AddDependency(pIntegrate, pPack);
+
+	if (reseed && (m_Motion == MOTION_SPIN))
+	{
+		JobSystem::Job* pGenerate = m_pJobs->CreateParallelFor("Generate", GenerateRotationsJob, this, m_Instances.GetCount(), JOB_GRAIN);
+		m_pJobs->AddDependency(pGenerate, pIntegrate);
+		m_pJobs->Submit(pGenerate);
+	}
+
+	m_pJobs->Submit(pIntegrate);
+	m_pJobs->Submit(pPack);
+	m_pJobs->Wait(pPack);
+
+	m_States.Publish();
+}
+
+// the latest published tick, valid until the next call. only called by one thread at a time
+const SimulationState& Simulation::Acquire()
+{
+	m_States.Acquire();
+
+	return m_States.GetFront();
+}
+
+/*
+* the renderer shows the scene one tick in the past so that it always has two ticks to interpolate between.
+* returns where now - timestep falls between the previous tick (0) and state (1), for the rotation and the transforms
+*/
+float Simulation::GetInterpolation(const SimulationState& state, std::chrono::steady_clock::time_point now)
+{
+	const float t = std::chrono::duration<float>(now - state.time) / m_Timestep;
+
+	return std::min(std::max(t, 0.0f), 1.0f);
+}
+
+size_t Simulation::GetInstanceCount()
+{
+	return m_Instances.GetCount();
+}
+
+// the stream of one object for the current rotation interval, the scene itself is object GetInstanceCount()
+RandomStream Simulation::GetRandomStream(size_t object)
+{
+	RandomStream seed(m_Seed ^ (m_Epoch * 0xD1B54A32D192ED03ULL));
+
+	return RandomStream(seed.Next() ^ (object * 0x9E3779B97F4A7C15ULL));
+}
+
+VOID Simulation::GenerateAngles(RandomStream& random, float* r_x, float* r_y, float* r_z)
+{
+	*r_x = random.NextFloat() * M_PI / ROTATION_INTERVAL;
+	*r_y = random.NextFloat() * M_PI / ROTATION_INTERVAL;
+	*r_z = random.NextFloat() * M_PI / ROTATION_INTERVAL;
+}
+
+VOID Simulation::GenerateRotation(RandomStream& random, float* rotation)
+{
+	float r_x, r_y, r_z;
+	GenerateAngles(random, &r_x, &r_y, &r_z);
+
+	Quaternion::FromEuler(r_x, r_y, r_z, rotation);
+}
+
+/*
+* a looping track per instance: random orientations and offsets within the cell at evenly spaced keys, jittered by up
+* to a quarter of their spacing. the last key repeats the first
+*/
+INT Simulation::GenerateTracks()
+{
+	INT status = STATUS_SUCCESS;
+
+	const float spacing = static_cast<float>(ANIMATION_PERIOD) / (ANIMATION_KEYS - 1);
+
+	float times[ANIMATION_KEYS];
+	float rotations[ANIMATION_KEYS * 4];
+	float translations[ANIMATION_KEYS * 3];
+
+	m_Tracks.Initialize(false);
+
+	for (size_t i = 0; (i < m_Instances.GetCount()) && SUCCEEDED(status); i++)
+	{
+		RandomStream random(m_Seed ^ ((i + 1) * 0xD1B54A32D192ED03ULL));
+
+		for (unsigned int key = 0; key + 1 < ANIMATION_KEYS; key++)
+		{
+			const float jitter = (key > 0) ? (random.NextFloat() - 0.5f) * 0.5f * spacing : 0.0f;
+			times[key] = key * spacing + jitter;
+
+			const float r_x = random.NextFloat() * 2.0f * M_PI;
+			const float r_y = random.NextFloat() * 2.0f * M_PI;
+			const float r_z = random.NextFloat() * 2.0f * M_PI;
+			Quaternion::FromEuler(r_x, r_y, r_z, &rotations[key * 4]);
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				translations[key * 3 + k] = (random.NextFloat() - 0.5f) * 0.5f;
+			}
+		}
+
+		times[ANIMATION_KEYS - 1] = static_cast<float>(ANIMATION_PERIOD);
+		CopyMemory(&rotations[(ANIMATION_KEYS - 1) * 4], &rotations[0], sizeof(float) * 4);
+		CopyMemory(&translations[(ANIMATION_KEYS - 1) * 3], &translations[0], sizeof(float) * 3);
+
+		status = m_Tracks.AddTrack(times, rotations, translations, ANIMATION_KEYS);
+	}
+
+	return status;
+}
+
+/*
+* a cube at the center with ORBIT_FANOUT smaller cubes in a ring around it, each of them with a ring of its own and so
+* on, every ring tilted and turning at a random speed. the nodes are numbered level by level, which is already the
+* order of the hierarchy
+*/
+INT Simulation::GenerateOrbits()
+{
+	const float ROOT_SCALE = 0.15f;
+	const float CHILD_SCALE = 0.4f;
+	const float RADIUS = 2.0f; // of a ring, in the units of the cube at its center
+
+	INT status = STATUS_SUCCESS;
+
+	const size_t count = m_Instances.GetCount();
+
+	std::vector<uint32_t> parents(count);
+	m_Orbits.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		RandomStream random(m_Seed ^ ((i + 1) * 0x9E3779B97F4A7C15ULL));
+		Orbit& orbit = m_Orbits[i];
+
+		parents[i] = (i > 0) ? static_cast<uint32_t>((i - 1) / ORBIT_FANOUT) : SceneHierarchy::INVALID;
+
+		// close to the y axis, so that the rings stay rings
+		const float tilt_x = (random.NextFloat() - 0.5f) * 0.6f;
+		const float tilt_z = (random.NextFloat() - 0.5f) * 0.6f;
+		const float length = sqrtf(tilt_x * tilt_x + 1.0f + tilt_z * tilt_z);
+
+		orbit.axis[0] = tilt_x / length;
+		orbit.axis[1] = 1.0f / length;
+		orbit.axis[2] = tilt_z / length;
+		orbit.speed = (0.2f + random.NextFloat()) * ((random.Next() & 1) ? 1.0f : -1.0f);
+
+		const float angle = 2.0f * M_PI * ((i + ORBIT_FANOUT - 1) % ORBIT_FANOUT) / ORBIT_FANOUT;
+		const float radius = (i > 0) ? RADIUS : 0.0f;
+
+		orbit.offset[0] = radius * cosf(angle);
+		orbit.offset[1] = radius * (random.NextFloat() - 0.5f) * 0.5f;
+		orbit.offset[2] = radius * sinf(angle);
+		orbit.scale = (i > 0) ? CHILD_SCALE : ROOT_SCALE;
+	}
+
+	status = m_Hierarchy.Build(parents.data(), count);
+
+	for (size_t i = 0; (i < count) && SUCCEEDED(status); i++)
+	{
+		SetOrbit(i, 0.0);
+	}
+
+	return status;
+}
+
+// the local matrix of a node at time: turned about its axis, then moved along its turned offset from the parent
+VOID Simulation::SetOrbit(size_t node, double time)
+{
+	const Orbit& orbit = m_Orbits[node];
+	const float half_angle = static_cast<float>(fmod(orbit.speed * time, 2.0 * M_PI)) * 0.5f;
+	const float s = sinf(half_angle);
+
+	const float rotation[4] = { orbit.axis[0] * s, orbit.axis[1] * s, orbit.axis[2] * s, cosf(half_angle) };
+
+	Matrix::Affine3x4 local;
+	Quaternion::ToMatrix(rotation, local);
+
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		float* row = &local.m[r * 4];
+
+		row[3] = row[0] * orbit.offset[0] + row[1] * orbit.offset[1] + row[2] * orbit.offset[2];
+		row[0] *= orbit.scale;
+		row[1] *= orbit.scale;
+		row[2] *= orbit.scale;
+	}
+
+	m_Hierarchy.SetLocal(m_Hierarchy.GetIndex(static_cast<uint32_t>(node)), local);
+}
+
+// the angles are drawn per instance, the rotations are built a chunk at a time with the batched sincos
+VOID Simulation::GenerateRotationsJob(VOID* pData, size_t begin, size_t end)
+{
+	const size_t CHUNK_SIZE = 256;
+
+	Simulation* pSimulation = static_cast<Simulation*>(pData);
+
+	float r_x[CHUNK_SIZE];
+	float r_y[CHUNK_SIZE];
+	float r_z[CHUNK_SIZE];
+
+	for (size_t base = begin; base < end; base += CHUNK_SIZE)
+	{
+		const size_t count = std::min(CHUNK_SIZE, end - base);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			RandomStream random = pSimulation->GetRandomStream(base + i);
+			GenerateAngles(random, &r_x[i], &r_y[i], &r_z[i]);
+		}
+
+		pSimulation->m_Instances.SetRotationSteps(base, count, r_x, r_y, r_z);
+	}
+}
+
+VOID Simulation::IntegrateJob(VOID* pData, size_t begin, size_t end)
+{
+	Simulation* pSimulation = static_cast<Simulation*>(pData);
+
+	pSimulation->m_Instances.Integrate(begin, end);
+}
+
+VOID Simulation::AnimateJob(VOID* pData, size_t begin, size_t end)
+{
+	Simulation* pSimulation = static_cast<Simulation*>(pData);
+
+	pSimulation->m_Instances.Animate(begin, end, pSimulation->m_Tracks, pSimulation->m_AnimationTime);
+}
+
+VOID Simulation::PlaceJob(VOID* pData, size_t begin, size_t end)
+{
+	Simulation* pSimulation = static_cast<Simulation*>(pData);
+
+	pSimulation->m_Instances.Place(begin, end, pSimulation->m_Hierarchy);
+}
+
+VOID Simulation::PackJob(VOID* pData, size_t begin, size_t end)
+{
+	Simulation* pSimulation = static_cast<Simulation*>(pData);
+
+	pSimulation->m_Instances.Pack(begin, end, pSimulation->m_pTransforms);
+	pSimulation->m_Instances.Bound(begin, end, pSimulation->m_Bounds, pSimulation->m_pSpheres);
+
+	CopyMemory(&pSimulation->m_LastTransforms[begin * Data::INSTANCE_SIZE], &pSimulation->m_pTransforms[begin * Data::INSTANCE_SIZE], sizeof(float) * Data::INSTANCE_SIZE * (end - begin));
+}
@@ -0,0 +1,249 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "AnimationTracks.h"
+#include "SceneHierarchy.h"
+
+/*
+* cpu side state of the instanced cubes. each cube spins with its own rotation and sits in a cell of a grid x grid x grid
+* lattice spanning the original cube. the rotations are unit quaternions advanced by a per-instance step quaternion.
+* the simulation state is kept in the batch layouts and is only unpacked into the three rows of one affine transform
+* per instance, the layout of the INSTANCE stream, once per frame.
+*/
+class InstanceStore
+{
+private:
+	size_t             m_Count;
+
+	std::vector<float> m_Placements;
+	std::vector<float> m_Rotations;
+	std::vector<float> m_RotationSteps;
+	std::vector<float> m_Translations; // of the animated instances, within their cells
+	std::vector<float> m_RotationMatrices;
+	std::vector<float> m_WorldMatrices;
+
+public:
+	InstanceStore();
+
+	VOID Initialize(unsigned int grid);
+
+	VOID SetRotationStep(size_t index, const float* rotation);
+	VOID SetRotationSteps(size_t begin, size_t count, const float* r_x, const float* r_y, const float* r_z);
+	VOID Integrate(size_t begin, size_t end);
+	VOID Animate(size_t begin, size_t end, AnimationTracks& tracks, float time);
+	VOID Place(size_t begin, size_t end, SceneHierarchy& hierarchy);
+	VOID Pack(size_t begin, size_t end, float* pTransforms);
+	VOID Bound(size_t begin, size_t end, const Culling::Bounds& bounds, float* pSpheres);
+
+	size_t GetCount();
+};
+
+/*
+* a wait-free single producer, single consumer handoff of the latest value. the producer fills the back slot and
+* swaps it with the middle slot, the consumer swaps the middle slot with its front slot when a newer value is
+* there. neither side ever waits for the other, the producer simply overwrites values the consumer skipped.
+*/
+template <typename T>
+class TripleBuffer
+{
+private:
+	enum {
+		FRESH = 4 // set in m_Middle while the middle slot holds a value the consumer has not seen
+	};
+
+	T                         m_Slots[3];
+	std::atomic<unsigned int> m_Middle;
+	unsigned int              m_Back;
+	unsigned int              m_Front;
+
+public:
+	TripleBuffer();
+
+	VOID Initialize(const T& value);
+
+	T&   GetBack();
+	VOID Publish();
+
+	bool     Acquire();
+	const T& GetFront();
+};
+
+template <typename T>
+TripleBuffer<T>::TripleBuffer()
+{
+	m_Back = 0;
+	m_Middle = 1;
+	m_Front = 2;
+}
+
+// not thread safe, call before the producer starts
+template <typename T>
+VOID TripleBuffer<T>::Initialize(const T& value)
+{
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		m_Slots[i] = value;
+	}
+}
+
+template <typename T>
+T& TripleBuffer<T>::GetBack()
+{
+	return m_Slots[m_Back];
+}
+
+template <typename T>
+VOID TripleBuffer<T>::Publish()
+{
+	m_Back = m_Middle.exchange(m_Back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+// returns true if a newer value was moved to the front
+template <typename T>
+bool TripleBuffer<T>::Acquire()
+{
+	if ((m_Middle.load(std::memory_order_relaxed) & FRESH) == 0)
+	{
+		return false;
+	}
+
+	m_Front = m_Middle.exchange(m_Front, std::memory_order_acq_rel) & ~FRESH;
+
+	return true;
+}
+
+template <typename T>
+const T& TripleBuffer<T>::GetFront()
+{
+	return m_Slots[m_Front];
+}
+
+// one simulation tick as seen by the renderer
+struct SimulationState
+{
+	uint64_t                              tick;
+	std::chrono::steady_clock::time_point time;                 // when the tick was scheduled
+	float                                 previous_rotation[4]; // the scene rotation one tick earlier
+	float                                 rotation[4];
+	Data::MatrixBuffer                    matrices;             // built from rotation
+	std::vector<float>                    previous_transforms;  // the transforms one tick earlier
+	std::vector<float>                    transforms;           // Data::INSTANCE_SIZE floats per instance
+	std::vector<float>                    spheres;              // the world space bounds of the instances, see Culling
+};
+
+// splitmix64. every object draws from its own stream, so the values do not depend on which thread draws them
+class RandomStream
+{
+private:
+	uint64_t m_State;
+
+public:
+	RandomStream(uint64_t seed);
+
+	uint64_t Next();
+	float    NextFloat();
+};
+
+/*
+* the scene animation, advanced in fixed ticks on its own thread so that it runs at the same speed however fast
+* frames are presented. every tick is published through a triple buffer together with the scene rotation and the
+* instance transforms of the tick before, and the renderer interpolates both between the two ticks.
+*
+* the per-instance work of a tick runs on the job system as a small graph: new random rotation steps (every
+* ROTATION_INTERVAL ticks) -> rotation integration -> packing the transforms for upload. the other motions replace
+* the first two: sampling keyframe tracks at the time of the tick, or taking the world matrices of a hierarchy that
+* the tick has updated.
+*/
+class Simulation
+{
+public:
+	enum {
+		TICK_RATE = 60 // ticks per second
+	};
+
+	enum Motion {
+		MOTION_SPIN,   // every instance turns by a random step of its own, drawn again every ROTATION_INTERVAL ticks
+		MOTION_TRACKS, // the instances follow looping keyframe tracks within their cells
+		MOTION_ORBITS  // the instances are cubes orbiting cubes, ORBIT_FANOUT around each, instead of a lattice
+	};
+
+private:
+	enum {
+		ROTATION_INTERVAL = 180, // the rotation changes every 180 ticks
+		ANIMATION_KEYS    = 9,   // per track, the last one repeats the first so that the tracks loop
+		ANIMATION_PERIOD  = 8,   // seconds
+		ORBIT_FANOUT      = 8,   // instance i orbits instance (i - 1) / ORBIT_FANOUT
+		MAX_LAG           = 8,   // ticks dropped instead of caught up once the simulation falls this far behind
+		JOB_GRAIN         = 1024 // instances per job, a multiple of Matrix::BATCH_WIDTH
+	};
+
+	// how a node of the hierarchy moves relative to its parent
+	struct Orbit
+	{
+		float axis[3];   // of the rotation, which turns the offset and the node alike
+		float speed;     // radians per second
+		float offset[3]; // from the parent, in its units
+		float scale;     // relative to the parent
+	};
+
+	uint64_t                      m_Tick;
+	unsigned int                  m_IntervalTracker;
+	float                         m_Rotation[4];
+	float                         m_RotationStep[4];
+	InstanceStore                 m_Instances;
+	JobSystem*                    m_pJobs;
+	float*                        m_pTransforms; // the transforms of the tick being built
+	std::vector<float>            m_LastTransforms; // those of the last tick published, handed on as previous_transforms
+	float*                        m_pSpheres;    // and their bounding spheres
+	Culling::Bounds               m_Bounds;      // of the mesh
+	Motion                        m_Motion;
+	AnimationTracks               m_Tracks;      // one per instance
+	float                         m_AnimationTime;
+	SceneHierarchy                m_Hierarchy;   // a node per instance
+	std::vector<Orbit>            m_Orbits;
+
+	uint64_t                      m_Seed;
+	uint64_t                      m_Epoch;       // counts the rotation changes
+
+	TripleBuffer<SimulationState> m_States;
+
+	std::chrono::nanoseconds      m_Timestep;
+	std::atomic<bool>             m_Running;
+	std::thread                   m_Thread;
+
+public:
+	Simulation();
+
+	VOID SetBounds(const Culling::Bounds& bounds);
+	VOID SetMotion(Motion motion);
+	VOID Initialize(unsigned int grid, JobSystem& jobs);
+
+	INT  Start(unsigned int tickRate);
+	VOID Stop();
+
+	VOID Step(std::chrono::steady_clock::time_point time);
+
+	const SimulationState& Acquire();
+	float GetInterpolation(const SimulationState& state, std::chrono::steady_clock::time_point now);
+
+	size_t GetInstanceCount();
+
+private:
+	RandomStream GetRandomStream(size_t object);
+	static VOID  GenerateAngles(RandomStream& random, float* r_x, float* r_y, float* r_z);
+	static VOID  GenerateRotation(RandomStream& random, float* rotation);
+	INT          GenerateTracks();
+	INT          GenerateOrbits();
+	VOID         SetOrbit(size_t node, double time);
+
+	static VOID GenerateRotationsJob(VOID* pData, size_t begin, size_t end);
+	static VOID IntegrateJob(VOID* pData, size_t begin, size_t end);
+	static VOID AnimateJob(VOID* pData, size_t begin, size_t end);
+	static VOID PlaceJob(VOID* pData, size_t begin, size_t end);
+	static VOID PackJob(VOID* pData, size_t begin, size_t end);
+
+	VOID Run();
+};
@@ -0,0 +1,570 @@
+#include "SoftwareRasterizer.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Data.h"
+#include "JobSystem.h"
+
+SoftwareRasterizer::SoftwareRasterizer()
+{
+	m_Width = 0;
+	m_Height = 0;
+	m_Stride = 0;
+	m_TilesX = 0;
+	m_TilesY = 0;
+	m_ChunkCount = 0;
+	m_pJobs = NULL;
+
+	m_PixelCount = 0;
+	m_TriangleCount = 0;
+}
+
+// the bins and tiles are worked on by jobs, which has to stay initialized while the rasterizer is in use
+INT SoftwareRasterizer::Initialize(unsigned int width, unsigned int height, JobSystem& jobs)
+{
+	INT status = STATUS_SUCCESS;
+
+	if ((width == 0) || (height == 0))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: invalid software render target size %ux%u\n", status, width, height);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		m_Width = width;
+		m_Height = height;
+		m_TilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+		m_TilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+		m_ChunkCount = jobs.GetThreadCount();
+		m_pJobs = &jobs;
+
+		// the targets are padded to whole tiles so the shader can always work on 4 pixel spans
+		m_Stride = m_TilesX * TILE_SIZE;
+		m_ColorBuffer.resize(static_cast<size_t>(m_Stride) * m_TilesY * TILE_SIZE);
+		m_DepthBuffer.resize(static_cast<size_t>(m_Stride) * m_TilesY * TILE_SIZE);
+
+		// each binning chunk gets its own list per tile so binning needs no synchronization
+		m_Bins.resize(static_cast<size_t>(m_ChunkCount) * m_TilesX * m_TilesY);
+	}
+
+	return status;
+}
+
+VOID SoftwareRasterizer::Uninitialize()
+{
+	m_ColorBuffer.clear();
+	m_DepthBuffer.clear();
+	m_ClipVertices.clear();
+	m_OutCodes.clear();
+	m_Triangles.clear();
+	m_Bins.clear();
+}
+
+VOID SoftwareRasterizer::Clear(const float color[4], float depth)
+{
+	uint32_t rgba = 0;
+	for (unsigned int i = 0; i < 4; i++)
+	{
+		float c = std::min(std::max(color[i], 0.0f), 1.0f);
+		rgba |= static_cast<uint32_t>(c * 255.0f + 0.5f) << (i * 8);
+	}
+
+	std::fill(m_ColorBuffer.begin(), m_ColorBuffer.end(), rgba);
+	std::fill(m_DepthBuffer.begin(), m_DepthBuffer.end(), static_cast<uint32_t>(std::min(std::max(depth, 0.0f), 1.0f) * DEPTH_MAX + 0.5f));
+}
+
+// emulates VERTEX_SHADER: the position is transformed by model_matrix and the color is passed through
+VOID SoftwareRasterizer::TransformVertices(const Data::Vertex* pVertices, unsigned int count, const Data::MatrixBuffer& matrices)
+{
+	const float(*m)[4] = reinterpret_cast<const float(*)[4]>(matrices.model_matrix.m);
+
+	m_ClipVertices.resize(count);
+	m_OutCodes.resize(count);
+
+	for (unsigned int i = 0; i < count; i++)
+	{
+		const Data::Vertex& vertex = pVertices[i];
+		ClipVertex& v = m_ClipVertices[i];
+
+		// mul(model_matrix, float4(position, 1)) with the row major float3x4, w stays 1
+		for (unsigned int r = 0; r < 3; r++)
+		{
+			v.position[r] = m[r][0] * vertex.position[0] + m[r][1] * vertex.position[1] + m[r][2] * vertex.position[2] + m[r][3];
+		}
+
+		v.position[3] = 1.0f;
+
+		v.color[0] = vertex.color[0];
+		v.color[1] = vertex.color[1];
+		v.color[2] = vertex.color[2];
+
+		const float x = v.position[0], y = v.position[1], z = v.position[2], w = v.position[3];
+
+		unsigned int outcode = 0;
+		outcode |= (x < -w) ? 0x01 : 0;
+		outcode |= (x > +w) ? 0x02 : 0;
+		outcode |= (y < -w) ? 0x04 : 0;
+		outcode |= (y > +w) ? 0x08 : 0;
+		outcode |= (z < 0)  ? 0x10 : 0;
+		outcode |= (z > w)  ? 0x20 : 0;
+
+		m_OutCodes[i] = outcode;
+	}
+}
+
+VOID SoftwareRasterizer::AssembleTriangle(uint32_t i0, uint32_t i1, uint32_t i2)
+{
+	const unsigned int outside_all = m_OutCodes[i0] & m_OutCodes[i1] & m_OutCodes[i2];
+	const unsigned int outside_any = m_OutCodes[i0] | m_OutCodes[i1] | m_OutCodes[i2];
+
+	m_TriangleCount++;
+
+	// trivially reject triangles that are outside of a single clip plane
+	if (outside_all != 0)
+	{
+		return;
+	}
+
+	// only the depth planes are clipped, x and y are handled by the scissor in the tile loop
+	if ((outside_any & 0x30) != 0)
+	{
+		ClipTriangle(&m_ClipVertices[i0], &m_ClipVertices[i1], &m_ClipVertices[i2]);
+	}
+	else
+	{
+		SetupTriangle(&m_ClipVertices[i0], &m_ClipVertices[i1], &m_ClipVertices[i2]);
+	}
+}
+
+VOID SoftwareRasterizer::Draw(const Data::Vertex* pVertices, unsigned int count, const Data::MatrixBuffer& matrices)
+{
+	TransformVertices(pVertices, count, matrices);
+
+	for (unsigned int i = 0; i + 2 < count; i += 3)
+	{
+		AssembleTriangle(i, i + 1, i + 2);
+	}
+}
+
+// every vertex is transformed exactly once, like an ideal post-transform cache
+VOID SoftwareRasterizer::DrawIndexed(const Data::Vertex* pVertices, unsigned int vertex_count, const uint32_t* pIndices, unsigned int index_count, const Data::MatrixBuffer& matrices)
+{
+	TransformVertices(pVertices, vertex_count, matrices);
+
+	for (unsigned int i = 0; i + 2 < index_count; i += 3)
+	{
+		AssembleTriangle(pIndices[i], pIndices[i + 1], pIndices[i + 2]);
+	}
+}
+
+// instance transforms use the INSTANCE stream layout: the three rows of an affine matrix, applied before model_matrix
+VOID SoftwareRasterizer::DrawIndexedInstanced(const Data::Vertex* pVertices, unsigned int vertex_count, const uint32_t* pIndices, unsigned int index_count, const float* pInstances, size_t instance_count, const Data::MatrixBuffer& matrices)
+{
+	for (size_t i = 0; i < instance_count; i++)
+	{
+		Matrix::Affine3x4 transform;
+		CopyMemory(transform.m, &pInstances[i * Data::INSTANCE_SIZE], sizeof(transform.m));
+
+		Data::MatrixBuffer instance;
+		Matrix::Multiply(transform, matrices.model_matrix, instance.model_matrix);
+
+		DrawIndexed(pVertices, vertex_count, pIndices, index_count, instance);
+	}
+}
+
+VOID SoftwareRasterizer::ClipTriangle(const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2)
+{
+	ClipVertex buffers[2][MAX_CLIP_VERTICES] = { { *v0, *v1, *v2 } };
+	unsigned int count = 3;
+	unsigned int input = 0;
+
+	// sutherland-hodgman against z >= 0 and w - z >= 0
+	for (unsigned int plane = 0; plane < 2; plane++)
+	{
+		const ClipVertex* in  = buffers[input];
+		ClipVertex*       out = buffers[input ^ 1];
+		unsigned int      out_count = 0;
+
+		for (unsigned int i = 0; i < count; i++)
+		{
+			const ClipVertex& a = in[i];
+			const ClipVertex& b = in[(i + 1) % count];
+
+			float da = (plane == 0) ? a.position[2] : a.position[3] - a.position[2];
+			float db = (plane == 0) ? b.position[2] : b.position[3] - b.position[2];
+
+			if (da >= 0)
+			{
+				out[out_count++] = a;
+			}
+
+			if ((da >= 0) != (db >= 0))
+			{
+				float t = da / (da - db);
+
+				ClipVertex& v = out[out_count++];
+				for (unsigned int j = 0; j < 4; j++) v.position[j] = a.position[j] + (b.position[j] - a.position[j]) * t;
+				for (unsigned int j = 0; j < 3; j++) v.color[j] = a.color[j] + (b.color[j] - a.color[j]) * t;
+			}
+		}
+
+		count = out_count;
+		input ^= 1;
+	}
+
+	for (unsigned int i = 1; i + 1 < count; i++)
+	{
+		SetupTriangle(&buffers[input][0], &buffers[input][i], &buffers[input][i + 1]);
+	}
+}
+
+VOID SoftwareRasterizer::SetupTriangle(const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2)
+{
+	const ClipVertex* v[3] = { v0, v1, v2 };
+
+	float x[3], y[3], z[3], inv_w[3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		if (!(v[i]->position[3] > 0.0f))
+		{
+			return;
+		}
+
+		inv_w[i] = 1.0f / v[i]->position[3];
+		x[i] = (0.5f + 0.5f * v[i]->position[0] * inv_w[i]) * m_Width;
+		y[i] = (0.5f - 0.5f * v[i]->position[1] * inv_w[i]) * m_Height;
+		z[i] = v[i]->position[2] * inv_w[i];
+	}
+
+	// the default rasterizer state culls counter-clockwise triangles, which have a negative area with y pointing down
+	const float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+	if (!(area > 0.0f))
+	{
+		return;
+	}
+
+	const float min_x = std::max(std::min(std::min(x[0], x[1]), x[2]), 0.0f);
+	const float min_y = std::max(std::min(std::min(y[0], y[1]), y[2]), 0.0f);
+	const float max_x = std::min(std::max(std::max(x[0], x[1]), x[2]), static_cast<float>(m_Width - 1));
+	const float max_y = std::min(std::max(std::max(y[0], y[1]), y[2]), static_cast<float>(m_Height - 1));
+
+	if ((min_x > max_x) || (min_y > max_y))
+	{
+		return;
+	}
+
+	Triangle triangle;
+	triangle.min_x = static_cast<int>(min_x);
+	triangle.min_y = static_cast<int>(min_y);
+	triangle.max_x = static_cast<int>(std::ceil(max_x));
+	triangle.max_y = static_cast<int>(std::ceil(max_y));
+
+	// edge i runs from vertex i to vertex i + 1 and is zero on that edge and area at the opposite vertex
+	float barycentric[3][3];
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		const unsigned int j = (i + 1) % 3;
+		const unsigned int k = (i + 2) % 3;
+
+		const float a = y[i] - y[j];
+		const float b = x[j] - x[i];
+		const float c = -(a * x[i] + b * y[i]);
+
+		triangle.edge[i][0] = a;
+		triangle.edge[i][1] = b;
+		triangle.edge[i][2] = c;
+
+		// top-left fill rule: pixels exactly on an edge belong to the triangle if it is a top or a left edge
+		triangle.top_left[i] = (a > 0.0f) || ((a == 0.0f) && (b > 0.0f));
+
+		barycentric[k][0] = a / area;
+		barycentric[k][1] = b / area;
+		barycentric[k][2] = c / area;
+	}
+
+	// converts per-vertex values into a plane equation over the screen
+	auto plane = [&barycentric](float* p, float f0, float f1, float f2)
+	{
+		for (unsigned int i = 0; i < 3; i++)
+		{
+			p[i] = f0 * barycentric[0][i] + f1 * barycentric[1][i] + f2 * barycentric[2][i];
+		}
+	};
+
+	plane(triangle.depth, z[0], z[1], z[2]);
+	plane(triangle.inv_w, inv_w[0], inv_w[1], inv_w[2]);
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		plane(triangle.color[i], v[0]->color[i] * inv_w[0], v[1]->color[i] * inv_w[1], v[2]->color[i] * inv_w[2]);
+	}
+
+	m_Triangles.push_back(triangle);
+}
+
+VOID SoftwareRasterizer::BinTriangles(unsigned int chunk)
+{
+	const size_t tile_count = static_cast<size_t>(m_TilesX) * m_TilesY;
+	const size_t begin = (m_Triangles.size() * chunk) / m_ChunkCount;
+	const size_t end   = (m_Triangles.size() * (chunk + 1)) / m_ChunkCount;
+
+	std::vector<uint32_t>* bins = &m_Bins[chunk * tile_count];
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const Triangle& triangle = m_Triangles[i];
+
+		for (int ty = triangle.min_y / TILE_SIZE; ty <= triangle.max_y / TILE_SIZE; ty++)
+		{
+			for (int tx = triangle.min_x / TILE_SIZE; tx <= triangle.max_x / TILE_SIZE; tx++)
+			{
+				bins[ty * m_TilesX + tx].push_back(static_cast<uint32_t>(i));
+			}
+		}
+	}
+}
+
+// emulates PIXEL_SHADER with a less-than depth test, returns the number of pixels written
+uint64_t SoftwareRasterizer::ShadeTile(unsigned int tile)
+{
+	const size_t tile_count = static_cast<size_t>(m_TilesX) * m_TilesY;
+
+	const int tile_x = static_cast<int>(tile % m_TilesX) * TILE_SIZE;
+	const int tile_y = static_cast<int>(tile / m_TilesX) * TILE_SIZE;
+
+	uint64_t pixels = 0;
+
+	// the chunks are walked in order so triangles are shaded in submission order
+	for (unsigned int chunk = 0; chunk < m_ChunkCount; chunk++)
+	{
+		for (uint32_t index : m_Bins[chunk * tile_count + tile])
+		{
+			const Triangle& t = m_Triangles[index];
+
+			const int x0 = std::max(t.min_x, tile_x) & ~3;
+			const int x1 = std::min(t.max_x, tile_x + TILE_SIZE - 1);
+			const int y0 = std::max(t.min_y, tile_y);
+			const int y1 = std::min(t.max_y, tile_y + TILE_SIZE - 1);
+
+			for (int y = y0; y <= y1; y++)
+			{
+				uint32_t* color = &m_ColorBuffer[static_cast<size_t>(y) * m_Stride];
+				uint32_t* depth = &m_DepthBuffer[static_cast<size_t>(y) * m_Stride];
+				const float py = y + 0.5f;
+
+#if defined(SIMD_X86)
+				const __m128 width = _mm_set1_ps(static_cast<float>(m_Width));
+				const __m128 zero  = _mm_setzero_ps();
+				const __m128 one   = _mm_set1_ps(1.0f);
+				const __m128 vy    = _mm_set1_ps(py);
+
+				__m128 top_left[3];
+				for (unsigned int i = 0; i < 3; i++)
+				{
+					top_left[i] = _mm_castsi128_ps(_mm_set1_epi32(t.top_left[i] ? -1 : 0));
+				}
+
+				for (int x = x0; x <= x1; x += 4)
+				{
+					const __m128 vx = _mm_add_ps(_mm_set1_ps(x + 0.5f), _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f));
+
+				#define _PLANE(p) _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps((p)[0]), vx), _mm_mul_ps(_mm_set1_ps((p)[1]), vy)), _mm_set1_ps((p)[2]))
+
+					__m128 mask = _mm_cmplt_ps(vx, width);
+					for (unsigned int i = 0; i < 3; i++)
+					{
+						const __m128 e = _PLANE(t.edge[i]);
+						mask = _mm_and_ps(mask, _mm_or_ps(_mm_cmpgt_ps(e, zero), _mm_and_ps(_mm_cmpeq_ps(e, zero), top_left[i])));
+					}
+
+					if (_mm_movemask_ps(mask) == 0)
+					{
+						continue;
+					}
+
+					const __m128  z  = _mm_min_ps(_mm_max_ps(_PLANE(t.depth), zero), one);
+					const __m128i zq = _mm_cvtps_epi32(_mm_mul_ps(z, _mm_set1_ps(static_cast<float>(DEPTH_MAX))));
+					const __m128i zd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(depth + x));
+
+					mask = _mm_and_ps(mask, _mm_castsi128_ps(_mm_cmplt_epi32(zq, zd)));
+
+					const int bits = _mm_movemask_ps(mask);
+					if (bits == 0)
+					{
+						continue;
+					}
+
+					const __m128 w     = _mm_div_ps(one, _PLANE(t.inv_w));
+					const __m128 scale = _mm_set1_ps(255.0f);
+
+					__m128i rgba = _mm_set1_epi32(static_cast<int>(0xFF000000));
+					for (unsigned int i = 0; i < 3; i++)
+					{
+						const __m128 c = _mm_min_ps(_mm_max_ps(_mm_mul_ps(_PLANE(t.color[i]), w), zero), one);
+						rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_cvtps_epi32(_mm_mul_ps(c, scale)), i * 8));
+					}
+
+				#undef _PLANE
+
+					const __m128i m  = _mm_castps_si128(mask);
+					const __m128i cd = _mm_loadu_si128(reinterpret_cast<const __m128i*>(color + x));
+
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(color + x), _mm_or_si128(_mm_and_si128(m, rgba), _mm_andnot_si128(m, cd)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(depth + x), _mm_or_si128(_mm_and_si128(m, zq), _mm_andnot_si128(m, zd)));
+
+					pixels += (bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1);
+				}
+#else
+				for (int x = x0; x <= x1 && x < static_cast<int>(m_Width); x++)
+				{
+					const float px = x + 0.5f;
+
+				#define _PLANE(p) ((p)[0] * px + (p)[1] * py + (p)[2])
+
+					bool inside = true;
+					for (unsigned int i = 0; i < 3; i++)
+					{
+						const float e = _PLANE(t.edge[i]);
+						inside = inside && ((e > 0.0f) || ((e == 0.0f) && t.top_left[i]));
+					}
+
+					if (!inside)
+					{
+						continue;
+					}
+
+					const float    z  = std::min(std::max(_PLANE(t.depth), 0.0f), 1.0f);
+					const uint32_t zq = static_cast<uint32_t>(z * DEPTH_MAX + 0.5f);
+
+					if (zq >= depth[x])
+					{
+						continue;
+					}
+
+					const float w = 1.0f / _PLANE(t.inv_w);
+
+					uint32_t rgba = 0xFF000000;
+					for (unsigned int i = 0; i < 3; i++)
+					{
+						const float c = std::min(std::max(_PLANE(t.color[i]) * w, 0.0f), 1.0f);
+						rgba |= static_cast<uint32_t>(c * 255.0f + 0.5f) << (i * 8);
+					}
+
+				#undef _PLANE
+
+					color[x] = rgba;
+					depth[x] = zq;
+					pixels++;
+				}
+#endif
+			}
+		}
+	}
+
+	return pixels;
+}
+
+// bins the triangles submitted since the last flush into tiles and shades the tiles on the job system
+VOID SoftwareRasterizer::Flush()
+{
+	m_pJobs->ParallelFor("Bin", BinJob, this, m_ChunkCount, 1);
+	m_pJobs->ParallelFor("Shade", ShadeJob, this, static_cast<size_t>(m_TilesX) * m_TilesY, 1);
+
+	for (std::vector<uint32_t>& bin : m_Bins)
+	{
+		bin.clear();
+	}
+
+	m_Triangles.clear();
+}
+
+VOID SoftwareRasterizer::BinJob(VOID* pData, size_t begin, size_t end)
+{
+	for (size_t chunk = begin; chunk < end; chunk++)
+	{
+		static_cast<SoftwareRasterizer*>(pData)->BinTriangles(static_cast<unsigned int>(chunk));
+	}
+}
+
+VOID SoftwareRasterizer::ShadeJob(VOID* pData, size_t begin, size_t end)
+{
+	SoftwareRasterizer* pRasterizer = static_cast<SoftwareRasterizer*>(pData);
+	uint64_t pixels = 0;
+
+	for (size_t tile = begin; tile < end; tile++)
+	{
+		pixels += pRasterizer->ShadeTile(static_cast<unsigned int>(tile));
+	}
+
+	pRasterizer->m_PixelCount += pixels;
+}
+
+INT SoftwareRasterizer::WritePPM(const char* path)
+{
+	INT status = STATUS_SUCCESS;
+
+	CHAR header[64];
+	int header_length = std::snprintf(header, sizeof(header), "P6\n%u %u\n255\n", m_Width, m_Height);
+
+	std::vector<BYTE> data(header, header + header_length);
+	data.reserve(data.size() + static_cast<size_t>(m_Width) * m_Height * 3);
+
+	for (unsigned int y = 0; y < m_Height; y++)
+	{
+		for (unsigned int x = 0; x < m_Width; x++)
+		{
+			const uint32_t rgba = m_ColorBuffer[static_cast<size_t>(y) * m_Stride + x];
+			data.push_back(static_cast<BYTE>(rgba));
+			data.push_back(static_cast<BYTE>(rgba >> 8));
+			data.push_back(static_cast<BYTE>(rgba >> 16));
+		}
+	}
+
+	FILE* pFile = OpenFileStream(path, "wb");
+	if (pFile == NULL)
+	{
+		status = GetErrnoStatus();
+		WriteToConsole("error 0x%X: could not create %s\n", status, path);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		// a full disk can cut the write short without setting errno, which must not read as success
+		errno = 0;
+
+		const bool written = (fwrite(data.data(), 1, data.size(), pFile) == data.size());
+		const bool closed = (fclose(pFile) == 0);
+
+		if (!written || !closed)
+		{
+			status = (errno != 0) ? GetErrnoStatus() : STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: could not write %s\n", status, path);
+		}
+	}
+
+	return status;
+}
+
+const uint32_t* SoftwareRasterizer::GetColorBuffer()
+{
+	return m_ColorBuffer.data();
+}
+
+const uint32_t* SoftwareRasterizer::GetDepthBuffer()
+{
+	return m_DepthBuffer.data();
+}
+
+unsigned int SoftwareRasterizer::GetStride()
+{
+	return m_Stride;
+}
+
+uint64_t SoftwareRasterizer::GetTriangleCount()
+{
+	return m_TriangleCount;
+}
+
+uint64_t SoftwareRasterizer::GetPixelCount()
+{
+	return m_PixelCount;
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+#include "JobSystem.h"
+
+class SoftwareRasterizer
+{
+private:
+	enum {
+		TILE_SIZE         = 64,
+		MAX_CLIP_VERTICES = 8,
+		DEPTH_MAX         = 0xFFFFFF // 24 bit unorm, the same precision as DXGI_FORMAT_D24_UNORM_S8_UINT
+	};
+
+	struct ClipVertex
+	{
+		float position[4];
+		float color[3];
+	};
+
+	// a screen space triangle, every value is stored as a plane equation: a * x + b * y + c
+	struct Triangle
+	{
+		float edge[3][3];
+		bool  top_left[3];
+		float depth[3];
+		float inv_w[3];
+		float color[3][3]; // color / w, for perspective correct interpolation
+
+		int min_x, min_y;
+		int max_x, max_y;
+	};
+
+	unsigned int                       m_Width;
+	unsigned int                       m_Height;
+	unsigned int                       m_Stride;
+	unsigned int                       m_TilesX;
+	unsigned int                       m_TilesY;
+	unsigned int                       m_ChunkCount; // binning chunks, one per thread of the job system
+	JobSystem*                         m_pJobs;
+
+	std::vector<uint32_t>              m_ColorBuffer;
+	std::vector<uint32_t>              m_DepthBuffer;
+	std::vector<ClipVertex>            m_ClipVertices;
+	std::vector<unsigned int>          m_OutCodes;
+	std::vector<Triangle>              m_Triangles;
+	std::vector<std::vector<uint32_t>> m_Bins;
+
+	std::atomic<uint64_t>              m_PixelCount;
+	uint64_t                           m_TriangleCount;
+
+public:
+	SoftwareRasterizer();
+
+	INT  Initialize(unsigned int width, unsigned int height, JobSystem& jobs);
+	VOID Uninitialize();
+
+	VOID Clear(const float color[4], float depth);
+	VOID Draw(const Data::Vertex* pVertices, unsigned int count, const Data::MatrixBuffer& matrices);
+	VOID DrawIndexed(const Data::Vertex* pVertices, unsigned int vertex_count, const uint32_t* pIndices, unsigned int index_count, const Data::MatrixBuffer& matrices);
+	VOID DrawIndexedInstanced(const Data::Vertex* pVertices, unsigned int vertex_count, const uint32_t* pIndices, unsigned int index_count, const float* pInstances, size_t instance_count, const Data::MatrixBuffer& matrices);
+	VOID Flush();
+
+	INT  WritePPM(const char* path);
+
+	// the targets are rows of GetStride() pixels, rgba8 colors and 24 bit unorm depths in the low bits
+	const uint32_t* GetColorBuffer();
+	const uint32_t* GetDepthBuffer();
+	unsigned int    GetStride();
+
+	uint64_t GetTriangleCount();
+	uint64_t GetPixelCount();
+
+private:
+	VOID TransformVertices(const Data::Vertex* pVertices, unsigned int count, const Data::MatrixBuffer& matrices);
+	VOID AssembleTriangle(uint32_t i0, uint32_t i1, uint32_t i2);
+	VOID ClipTriangle(const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2);
+	VOID SetupTriangle(const ClipVertex* v0, const ClipVertex* v1, const ClipVertex* v2);
+
+	VOID BinTriangles(unsigned int chunk);
+	uint64_t ShadeTile(unsigned int tile);
+
+	static VOID BinJob(VOID* pData, size_t begin, size_t end);
+	static VOID ShadeJob(VOID* pData, size_t begin, size_t end);
+};
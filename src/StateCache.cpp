@@ -0,0 +1,328 @@
+#include "StateCache.h"
+#include "Fnv.h"
+#include "RenderContext.h"
+
+StateCache::StateCache(RenderContext* pContext)
+{
+	m_pContext = pContext;
+	m_Issued = 0;
+	m_Elided = 0;
+
+	Invalidate();
+}
+
+// the next bind of everything goes through
+VOID StateCache::Invalidate()
+{
+	ZeroMemory(&m_State, sizeof(m_State));
+	ZeroMemory(m_Valid, sizeof(m_Valid));
+	ZeroMemory(m_ValidVertexBuffers, sizeof(m_ValidVertexBuffers));
+	ZeroMemory(m_ValidConstantBuffers, sizeof(m_ValidConstantBuffers));
+}
+
+VOID StateCache::InvalidateRenderTargets()
+{
+	m_Valid[BIND_RENDER_TARGETS] = false;
+}
+
+VOID StateCache::OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView)
+{
+	const bool same = m_Valid[BIND_RENDER_TARGETS] && (count <= RENDER_TARGET_SLOTS) && (count == m_State.render_target_count) &&
+		(memcmp(ppViews, m_State.pRenderTargets, count * sizeof(ID3D11RenderTargetView*)) == 0) && (pDepthStencilView == m_State.pDepthStencilView);
+
+	if (same)
+	{
+		m_Elided++;
+		return;
+	}
+
+	// more targets than are shadowed go through every time
+	m_Valid[BIND_RENDER_TARGETS] = (count <= RENDER_TARGET_SLOTS);
+
+	if (m_Valid[BIND_RENDER_TARGETS])
+	{
+		ZeroMemory(m_State.pRenderTargets, sizeof(m_State.pRenderTargets));
+		CopyMemory(m_State.pRenderTargets, ppViews, count * sizeof(ID3D11RenderTargetView*));
+		m_State.render_target_count = count;
+		m_State.pDepthStencilView = pDepthStencilView;
+	}
+
+	m_Issued++;
+	m_pContext->OMSetRenderTargets(count, ppViews, pDepthStencilView);
+}
+
+VOID StateCache::IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets)
+{
+	// ranges past the shadowed slots go through, the slots they overlap are no longer known
+	if (slot + count > VERTEX_BUFFER_SLOTS)
+	{
+		for (UINT i = slot; i < VERTEX_BUFFER_SLOTS; i++)
+		{
+			m_ValidVertexBuffers[i] = false;
+		}
+
+		m_Issued++;
+		m_pContext->IASetVertexBuffers(slot, count, ppBuffers, pStrides, pOffsets);
+		return;
+	}
+
+	// the changed slots, from the first to the last one that differs
+	UINT first = count;
+	UINT last = 0;
+
+	for (UINT i = 0; i < count; i++)
+	{
+		const bool same = m_ValidVertexBuffers[slot + i] && (ppBuffers[i] == m_State.pVertexBuffers[slot + i]) && (pStrides[i] == m_State.strides[slot + i]) && (pOffsets[i] == m_State.offsets[slot + i]);
+
+		if (!same)
+		{
+			first = std::min(first, i);
+			last = i;
+		}
+
+		m_State.pVertexBuffers[slot + i] = ppBuffers[i];
+		m_State.strides[slot + i] = pStrides[i];
+		m_State.offsets[slot + i] = pOffsets[i];
+		m_ValidVertexBuffers[slot + i] = true;
+	}
+
+	if (first == count)
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_Issued++;
+	m_pContext->IASetVertexBuffers(slot + first, last - first + 1, ppBuffers + first, pStrides + first, pOffsets + first);
+}
+
+VOID StateCache::IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset)
+{
+	if (m_Valid[BIND_INDEX_BUFFER] && (pBuffer == m_State.pIndexBuffer) && (format == m_State.index_format) && (offset == m_State.index_offset))
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_State.pIndexBuffer = pBuffer;
+	m_State.index_format = format;
+	m_State.index_offset = offset;
+	m_Valid[BIND_INDEX_BUFFER] = true;
+
+	m_Issued++;
+	m_pContext->IASetIndexBuffer(pBuffer, format, offset);
+}
+
+VOID StateCache::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology)
+{
+	if (m_Valid[BIND_TOPOLOGY] && (topology == m_State.topology))
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_State.topology = topology;
+	m_Valid[BIND_TOPOLOGY] = true;
+
+	m_Issued++;
+	m_pContext->IASetPrimitiveTopology(topology);
+}
+
+VOID StateCache::IASetInputLayout(ID3D11InputLayout* pInputLayout)
+{
+	if (m_Valid[BIND_INPUT_LAYOUT] && (pInputLayout == m_State.pInputLayout))
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_State.pInputLayout = pInputLayout;
+	m_Valid[BIND_INPUT_LAYOUT] = true;
+
+	m_Issued++;
+	m_pContext->IASetInputLayout(pInputLayout);
+}
+
+VOID StateCache::VSSetShader(ID3D11VertexShader* pShader)
+{
+	if (m_Valid[BIND_VERTEX_SHADER] && (pShader == m_State.pVertexShader))
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_State.pVertexShader = pShader;
+	m_Valid[BIND_VERTEX_SHADER] = true;
+
+	m_Issued++;
+	m_pContext->VSSetShader(pShader);
+}
+
+VOID StateCache::VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers)
+{
+	VSSetConstantBuffers1(slot, count, ppBuffers, NULL, NULL);
+}
+
+// a slot is the same only with the same range of the same buffer, binds of whole buffers go on as VSSetConstantBuffers
+VOID StateCache::VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts)
+{
+	if (slot + count > CONSTANT_BUFFER_SLOTS)
+	{
+		for (UINT i = slot; i < CONSTANT_BUFFER_SLOTS; i++)
+		{
+			m_ValidConstantBuffers[i] = false;
+		}
+
+		m_Issued++;
+		m_pContext->VSSetConstantBuffers1(slot, count, ppBuffers, pFirstConstants, pConstantCounts);
+		return;
+	}
+
+	UINT first = count;
+	UINT last = 0;
+
+	for (UINT i = 0; i < count; i++)
+	{
+		const UINT constant_count = (pConstantCounts != NULL) ? pConstantCounts[i] : 0;
+		const UINT first_constant = (constant_count != 0) ? pFirstConstants[i] : 0;
+
+		const bool same = m_ValidConstantBuffers[slot + i] && (ppBuffers[i] == m_State.pConstantBuffers[slot + i]) &&
+			(first_constant == m_State.first_constants[slot + i]) && (constant_count == m_State.constant_counts[slot + i]);
+
+		if (!same)
+		{
+			first = std::min(first, i);
+			last = i;
+		}
+
+		m_State.pConstantBuffers[slot + i] = ppBuffers[i];
+		m_State.first_constants[slot + i] = first_constant;
+		m_State.constant_counts[slot + i] = constant_count;
+		m_ValidConstantBuffers[slot + i] = true;
+	}
+
+	if (first == count)
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_Issued++;
+
+	if (pConstantCounts != NULL)
+	{
+		m_pContext->VSSetConstantBuffers1(slot + first, last - first + 1, ppBuffers + first, pFirstConstants + first, pConstantCounts + first);
+	}
+	else
+	{
+		m_pContext->VSSetConstantBuffers(slot + first, last - first + 1, ppBuffers + first);
+	}
+}
+
+VOID StateCache::PSSetShader(ID3D11PixelShader* pShader)
+{
+	if (m_Valid[BIND_PIXEL_SHADER] && (pShader == m_State.pPixelShader))
+	{
+		m_Elided++;
+		return;
+	}
+
+	m_State.pPixelShader = pShader;
+	m_Valid[BIND_PIXEL_SHADER] = true;
+
+	m_Issued++;
+	m_pContext->PSSetShader(pShader);
+}
+
+INT StateCache::UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size)
+{
+	return m_pContext->UpdateBuffer(pBuffer, pData, size);
+}
+
+VOID StateCache::ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4])
+{
+	m_pContext->ClearRenderTargetView(pView, color);
+}
+
+VOID StateCache::ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil)
+{
+	m_pContext->ClearDepthStencilView(pView, flags, depth, stencil);
+}
+
+VOID StateCache::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	m_pContext->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+uint64_t StateCache::GetIssuedCount()
+{
+	return m_Issued;
+}
+
+uint64_t StateCache::GetElidedCount()
+{
+	return m_Elided;
+}
+
+// the queue keeps its memory between passes, so a pass that draws no more than the ones before it does not allocate
+VOID DrawQueue::Add(const Draw& draw)
+{
+	Entry entry = { ComputeKey(draw), static_cast<uint32_t>(m_Draws.size()) };
+
+	m_Draws.push_back(draw);
+	m_Entries.push_back(entry);
+}
+
+// issues the draws in key order and empties the queue
+VOID DrawQueue::Submit(RenderContext& context)
+{
+	std::sort(m_Entries.begin(), m_Entries.end(), [](const Entry& a, const Entry& b)
+	{
+		return (a.key < b.key) || ((a.key == b.key) && (a.draw < b.draw));
+	});
+
+	for (const Entry& entry : m_Entries)
+	{
+		const Draw& draw = m_Draws[entry.draw];
+
+		context.VSSetShader(draw.pVertexShader);
+		context.PSSetShader(draw.pPixelShader);
+		context.IASetInputLayout(draw.pInputLayout);
+		context.IASetPrimitiveTopology(draw.topology);
+		context.IASetVertexBuffers(0, draw.vertex_buffer_count, draw.pVertexBuffers, draw.strides, draw.offsets);
+		context.IASetIndexBuffer(draw.pIndexBuffer, draw.index_format, 0);
+		context.VSSetConstantBuffers1(0, draw.constant_buffer_count, draw.pConstantBuffers, draw.first_constants, draw.constant_counts);
+
+		context.DrawIndexedInstanced(draw.index_count, draw.instance_count, draw.start_index, draw.base_vertex, draw.start_instance);
+	}
+
+	m_Draws.clear();
+	m_Entries.clear();
+}
+
+uint64_t DrawQueue::ComputeKey(const Draw& draw)
+{
+	const void* shaders[] = { draw.pVertexShader, draw.pPixelShader };
+	const uint64_t layout[] = { reinterpret_cast<uintptr_t>(draw.pInputLayout), static_cast<uint64_t>(draw.topology) };
+
+	uint64_t buffers = Fnv::Hash(draw.pVertexBuffers, draw.vertex_buffer_count * sizeof(ID3D11Buffer*), Fnv::OFFSET_BASIS);
+	buffers = Fnv::Hash(draw.strides, draw.vertex_buffer_count * sizeof(UINT), buffers);
+	buffers = Fnv::Hash(draw.offsets, draw.vertex_buffer_count * sizeof(UINT), buffers);
+	buffers = Fnv::Hash(&draw.pIndexBuffer, sizeof(draw.pIndexBuffer), buffers);
+	buffers = Fnv::Hash(&draw.index_format, sizeof(draw.index_format), buffers);
+
+	uint64_t constants = Fnv::Hash(draw.pConstantBuffers, draw.constant_buffer_count * sizeof(ID3D11Buffer*), Fnv::OFFSET_BASIS);
+	constants = Fnv::Hash(draw.first_constants, draw.constant_buffer_count * sizeof(UINT), constants);
+	constants = Fnv::Hash(draw.constant_counts, draw.constant_buffer_count * sizeof(UINT), constants);
+
+	return (Fold(Fnv::Hash(shaders, sizeof(shaders), Fnv::OFFSET_BASIS), 20) << 44) |
+		(Fold(Fnv::Hash(layout, sizeof(layout), Fnv::OFFSET_BASIS), 12) << 32) |
+		(Fold(buffers, 20) << 12) |
+		Fold(constants, 12);
+}
+
+// the low bits of a 64 bit hash with the high ones mixed in
+uint64_t DrawQueue::Fold(uint64_t hash, unsigned int bits)
+{
+	return (hash ^ (hash >> bits) ^ (hash >> (2 * bits))) & ((1ULL << bits) - 1);
+}
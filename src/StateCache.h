@@ -0,0 +1,98 @@
+#pragma once
+
+#include "Common.h"
+#include "RenderContext.h"
+
+/*
+* a shadow copy of the state bound through it, binds that would not change anything are dropped before they reach the
+* context behind it. slot ranges are trimmed to the slots that change. objects are compared by pointer, so anything
+* that rebinds or releases state behind the cache's back has to be followed by Invalidate, and the flip model swap
+* chains unbind the back buffer in Present, which InvalidateRenderTargets covers.
+*/
+class StateCache : public RenderContext
+{
+private:
+	RenderContext* m_pContext;
+	PipelineState  m_State;
+	bool           m_Valid[BIND_COUNT];
+	bool           m_ValidVertexBuffers[VERTEX_BUFFER_SLOTS];
+	bool           m_ValidConstantBuffers[CONSTANT_BUFFER_SLOTS];
+	uint64_t       m_Issued;
+	uint64_t       m_Elided;
+
+public:
+	StateCache(RenderContext* pContext);
+
+	VOID Invalidate();
+	VOID InvalidateRenderTargets();
+
+	VOID OMSetRenderTargets(UINT count, ID3D11RenderTargetView* const* ppViews, ID3D11DepthStencilView* pDepthStencilView);
+	VOID IASetVertexBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pStrides, const UINT* pOffsets);
+	VOID IASetIndexBuffer(ID3D11Buffer* pBuffer, DXGI_FORMAT format, UINT offset);
+	VOID IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+	VOID IASetInputLayout(ID3D11InputLayout* pInputLayout);
+	VOID VSSetShader(ID3D11VertexShader* pShader);
+	VOID VSSetConstantBuffers(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers);
+	VOID VSSetConstantBuffers1(UINT slot, UINT count, ID3D11Buffer* const* ppBuffers, const UINT* pFirstConstants, const UINT* pConstantCounts);
+	VOID PSSetShader(ID3D11PixelShader* pShader);
+	INT  UpdateBuffer(ID3D11Buffer* pBuffer, const void* pData, size_t size);
+	VOID ClearRenderTargetView(ID3D11RenderTargetView* pView, const float color[4]);
+	VOID ClearDepthStencilView(ID3D11DepthStencilView* pView, UINT flags, float depth, UINT8 stencil);
+	VOID DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	uint64_t GetIssuedCount();
+	uint64_t GetElidedCount();
+};
+
+/*
+* draws collected over a pass and issued sorted by a key made from the state they need, the most expensive change in
+* the highest bits: shaders, then input layout and topology, then the vertex and index buffers, then the constant
+* buffers. draws that share state end up next to each other, which leaves most of their binds to the StateCache to
+* drop. the fields of the key are hashes of the pointers, a collision only costs a bind. draws with equal keys keep
+* the order they were added in.
+*/
+class DrawQueue
+{
+public:
+	struct Draw
+	{
+		ID3D11VertexShader*      pVertexShader;
+		ID3D11PixelShader*       pPixelShader;
+		ID3D11InputLayout*       pInputLayout;
+		D3D11_PRIMITIVE_TOPOLOGY topology;
+		ID3D11Buffer*            pVertexBuffers[RenderContext::VERTEX_BUFFER_SLOTS];
+		UINT                     strides[RenderContext::VERTEX_BUFFER_SLOTS];
+		UINT                     offsets[RenderContext::VERTEX_BUFFER_SLOTS];
+		UINT                     vertex_buffer_count;
+		ID3D11Buffer*            pIndexBuffer;
+		DXGI_FORMAT              index_format;
+		ID3D11Buffer*            pConstantBuffers[RenderContext::CONSTANT_BUFFER_SLOTS];
+		UINT                     first_constants[RenderContext::CONSTANT_BUFFER_SLOTS];
+		UINT                     constant_counts[RenderContext::CONSTANT_BUFFER_SLOTS]; // 0 for the whole buffer
+		UINT                     constant_buffer_count;
+		UINT                     index_count;
+		UINT                     instance_count;
+		UINT                     start_index;
+		INT                      base_vertex;
+		UINT                     start_instance;
+	};
+
+private:
+	struct Entry
+	{
+		uint64_t key;
+		uint32_t draw;
+	};
+
+	std::vector<Draw>  m_Draws;
+	std::vector<Entry> m_Entries;
+
+public:
+	VOID Add(const Draw& draw);
+	VOID Submit(RenderContext& context);
+
+	static uint64_t ComputeKey(const Draw& draw);
+
+private:
+	static uint64_t Fold(uint64_t hash, unsigned int bits);
+};
@@ -0,0 +1,426 @@
+#include "VertexPacking.h"
+#include "Log.h"
+#include "Data.h"
+
+namespace VertexPacking
+{
+	const Layout Layouts[FORMAT_COUNT] =
+	{
+		{ "float32", DXGI_FORMAT_R32G32B32_FLOAT,    DXGI_FORMAT_R32G32B32_FLOAT, sizeof(float) * 3, sizeof(Data::Vertex), false },
+		{ "snorm16", DXGI_FORMAT_R16G16B16A16_SNORM, DXGI_FORMAT_R8G8B8A8_UNORM,  8,                 12,                   true },
+		{ "float16", DXGI_FORMAT_R16G16B16A16_FLOAT, DXGI_FORMAT_R8G8B8A8_UNORM,  8,                 12,                   false },
+		{ "unorm10", DXGI_FORMAT_R10G10B10A2_UNORM,  DXGI_FORMAT_R8G8B8A8_UNORM,  4,                 8,                    true }
+	};
+
+	bool FindFormat(const char* name, Format* pFormat)
+	{
+		for (unsigned int i = 0; i < FORMAT_COUNT; i++)
+		{
+			if (strcmp(name, Layouts[i].name) == 0)
+			{
+				*pFormat = static_cast<Format>(i);
+				return true;
+			}
+		}
+
+		return false;
+	}
+
+	// round to nearest even, overflows to infinity
+	uint16_t FloatToHalf(float f)
+	{
+		const uint32_t HALF_MAX     = (127 + 16) << 23;
+		const uint32_t FLOAT_INF    = 255 << 23;
+		const uint32_t DENORM_MAGIC = ((127 - 15) + (23 - 10) + 1) << 23;
+
+		uint32_t x;
+		memcpy(&x, &f, sizeof(x));
+
+		const uint32_t sign = x & 0x80000000;
+		x ^= sign;
+
+		uint32_t h;
+		if (x >= HALF_MAX)
+		{
+			h = (x > FLOAT_INF) ? 0x7E00 : 0x7C00;
+		}
+		else if (x < (113 << 23))
+		{
+			// the addition shifts the mantissa into place and rounds it
+			float magic, a;
+			memcpy(&magic, &DENORM_MAGIC, sizeof(magic));
+			memcpy(&a, &x, sizeof(a));
+			a += magic;
+			memcpy(&x, &a, sizeof(x));
+			h = x - DENORM_MAGIC;
+		}
+		else
+		{
+			x += (static_cast<uint32_t>(15 - 127) << 23) + 0xFFF + ((x >> 13) & 1);
+			h = x >> 13;
+		}
+
+		return static_cast<uint16_t>(h | (sign >> 16));
+	}
+
+	float HalfToFloat(uint16_t h)
+	{
+		const uint32_t sign = static_cast<uint32_t>(h & 0x8000) << 16;
+		const uint32_t exponent = (h >> 10) & 0x1F;
+		const uint32_t mantissa = h & 0x3FF;
+
+		if (exponent == 0)
+		{
+			const float f = mantissa * (1.0f / 16777216.0f);
+			return sign ? -f : f;
+		}
+
+		const uint32_t x = sign | ((exponent == 31) ? (0x7F800000 | (mantissa << 13)) : (((exponent + 112) << 23) | (mantissa << 13)));
+
+		float f;
+		memcpy(&f, &x, sizeof(f));
+
+		return f;
+	}
+
+	VOID ComputeDequantization(Format format, const Data::Vertex* pVertices, size_t count, Data::MeshBuffer& meshBuffer)
+	{
+		float lo[3] = { FLT_MAX, FLT_MAX, FLT_MAX };
+		float hi[3] = { -FLT_MAX, -FLT_MAX, -FLT_MAX };
+
+		for (size_t i = 0; i < count; i++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				lo[k] = std::min(lo[k], pVertices[i].position[k]);
+				hi[k] = std::max(hi[k], pVertices[i].position[k]);
+			}
+		}
+
+		for (unsigned int k = 0; k < 4; k++)
+		{
+			meshBuffer.position_scale[k] = 1.0f;
+			meshBuffer.position_bias[k] = 0.0f;
+		}
+
+		for (unsigned int k = 0; (k < 3) && (count > 0); k++)
+		{
+			if (format == FORMAT_SNORM16)
+			{
+				meshBuffer.position_scale[k] = (hi[k] - lo[k]) * 0.5f;
+				meshBuffer.position_bias[k] = (hi[k] + lo[k]) * 0.5f;
+			}
+			else if (format == FORMAT_UNORM10)
+			{
+				meshBuffer.position_scale[k] = hi[k] - lo[k];
+				meshBuffer.position_bias[k] = lo[k];
+			}
+
+			// a flat axis still needs a scale that can be inverted
+			if (meshBuffer.position_scale[k] <= 0.0f)
+			{
+				meshBuffer.position_scale[k] = 1.0f;
+			}
+		}
+	}
+
+	uint32_t PackColor(const float* color)
+	{
+		uint32_t packed = 0xFF000000;
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			packed |= static_cast<uint32_t>(std::min(std::max(color[k], 0.0f), 1.0f) * 255.0f + 0.5f) << (k * 8);
+		}
+
+		return packed;
+	}
+
+	VOID UnpackColor(uint32_t packed, float* color)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			color[k] = ((packed >> (k * 8)) & 0xFF) * (1.0f / 255.0f);
+		}
+	}
+
+	// the snorm16 kernels carry the common case, the other formats are only packed at load time
+	VOID PackSnorm16(const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, BYTE* pPacked)
+	{
+#if defined(SIMD_X86)
+		const __m128 bias      = _mm_loadu_ps(meshBuffer.position_bias);
+		const __m128 inv_scale = _mm_div_ps(_mm_set1_ps(1.0f), _mm_loadu_ps(meshBuffer.position_scale));
+		const __m128 lo        = _mm_set1_ps(-1.0f);
+		const __m128 hi        = _mm_set1_ps(1.0f);
+		const __m128 zero      = _mm_setzero_ps();
+		const __m128 xyz       = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// the four wide loads spill into the color, so both stay inside the vertex. the alpha lane is overwritten
+			const __m128 p = _mm_and_ps(_mm_loadu_ps(pVertices[i].position), xyz);
+			const __m128 t = _mm_loadu_ps(&pVertices[i].position[2]);
+			const __m128 c = _mm_shuffle_ps(t, t, _MM_SHUFFLE(0, 3, 2, 1));
+
+			__m128 n = _mm_mul_ps(_mm_sub_ps(p, bias), inv_scale);
+			n = _mm_and_ps(_mm_min_ps(_mm_max_ps(n, lo), hi), xyz);
+
+			const __m128i q = _mm_cvtps_epi32(_mm_mul_ps(n, _mm_set1_ps(32767.0f)));
+			_mm_storel_epi64(reinterpret_cast<__m128i*>(pPacked), _mm_packs_epi32(q, q));
+
+			const __m128i r = _mm_cvtps_epi32(_mm_mul_ps(_mm_min_ps(_mm_max_ps(c, zero), hi), _mm_set1_ps(255.0f)));
+			const __m128i b = _mm_packus_epi16(_mm_packs_epi32(r, r), _mm_setzero_si128());
+			const uint32_t color = static_cast<uint32_t>(_mm_cvtsi128_si32(b)) | 0xFF000000;
+			memcpy(pPacked + 8, &color, sizeof(color));
+
+			pPacked += 12;
+		}
+#else
+		for (size_t i = 0; i < count; i++)
+		{
+			int16_t position[4] = { 0, 0, 0, 0 };
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				const float n = (pVertices[i].position[k] - meshBuffer.position_bias[k]) / meshBuffer.position_scale[k];
+				position[k] = static_cast<int16_t>(std::lrint(std::min(std::max(n, -1.0f), 1.0f) * 32767.0f));
+			}
+
+			const uint32_t color = PackColor(pVertices[i].color);
+
+			memcpy(pPacked, position, sizeof(position));
+			memcpy(pPacked + 8, &color, sizeof(color));
+			pPacked += 12;
+		}
+#endif
+	}
+
+	VOID UnpackSnorm16(const BYTE* pPacked, size_t count, const Data::MeshBuffer& meshBuffer, Data::Vertex* pVertices)
+	{
+#if defined(SIMD_X86)
+		const __m128 bias  = _mm_loadu_ps(meshBuffer.position_bias);
+		const __m128 scale = _mm_mul_ps(_mm_loadu_ps(meshBuffer.position_scale), _mm_set1_ps(1.0f / 32767.0f));
+		const __m128 lo    = _mm_set1_ps(-32767.0f);
+		const __m128 inv   = _mm_set1_ps(1.0f / 255.0f);
+
+		for (size_t i = 0; i < count; i++)
+		{
+			// sign extends the four int16 lanes, -32768 decodes to -1 like the d3d snorm conversion
+			const __m128i q = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(pPacked));
+			const __m128  n = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(q, q), 16));
+			const __m128  p = _mm_add_ps(_mm_mul_ps(_mm_max_ps(n, lo), scale), bias);
+
+			uint32_t packed;
+			memcpy(&packed, pPacked + 8, sizeof(packed));
+
+			const __m128i b = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(static_cast<int>(packed)), _mm_setzero_si128()), _mm_setzero_si128());
+			const __m128  c = _mm_mul_ps(_mm_cvtepi32_ps(b), inv);
+
+			float position[4], color[4];
+			_mm_storeu_ps(position, p);
+			_mm_storeu_ps(color, c);
+
+			memcpy(pVertices[i].position, position, sizeof(pVertices[i].position));
+			memcpy(pVertices[i].color, color, sizeof(pVertices[i].color));
+			pPacked += 12;
+		}
+#else
+		for (size_t i = 0; i < count; i++)
+		{
+			int16_t position[4];
+			uint32_t color;
+			memcpy(position, pPacked, sizeof(position));
+			memcpy(&color, pPacked + 8, sizeof(color));
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				const float n = std::max(position[k] * (1.0f / 32767.0f), -1.0f);
+				pVertices[i].position[k] = n * meshBuffer.position_scale[k] + meshBuffer.position_bias[k];
+			}
+
+			UnpackColor(color, pVertices[i].color);
+			pPacked += 12;
+		}
+#endif
+	}
+
+	VOID Pack(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, BYTE* pPacked)
+	{
+		if (format == FORMAT_FLOAT32)
+		{
+			if (count > 0)
+			{
+				CopyMemory(pPacked, pVertices, count * sizeof(Data::Vertex));
+			}
+		}
+		else if (format == FORMAT_SNORM16)
+		{
+			PackSnorm16(pVertices, count, meshBuffer, pPacked);
+		}
+		else if (format == FORMAT_FLOAT16)
+		{
+			for (size_t i = 0; i < count; i++, pPacked += 12)
+			{
+				uint16_t position[4] = { 0, 0, 0, FloatToHalf(1.0f) };
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					position[k] = FloatToHalf(pVertices[i].position[k]);
+				}
+
+				const uint32_t color = PackColor(pVertices[i].color);
+
+				memcpy(pPacked, position, sizeof(position));
+				memcpy(pPacked + 8, &color, sizeof(color));
+			}
+		}
+		else if (format == FORMAT_UNORM10)
+		{
+			for (size_t i = 0; i < count; i++, pPacked += 8)
+			{
+				uint32_t position = 0;
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					const float n = (pVertices[i].position[k] - meshBuffer.position_bias[k]) / meshBuffer.position_scale[k];
+					position |= static_cast<uint32_t>(std::lrint(std::min(std::max(n, 0.0f), 1.0f) * 1023.0f)) << (k * 10);
+				}
+
+				const uint32_t color = PackColor(pVertices[i].color);
+
+				memcpy(pPacked, &position, sizeof(position));
+				memcpy(pPacked + 4, &color, sizeof(color));
+			}
+		}
+	}
+
+	VOID Pack(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<BYTE>& packed)
+	{
+		packed.assign(count * Layouts[format].stride, 0);
+		Pack(format, pVertices, count, meshBuffer, packed.data());
+	}
+
+	VOID Unpack(Format format, const BYTE* pPacked, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<Data::Vertex>& vertices)
+	{
+		vertices.resize(count);
+
+		if (format == FORMAT_FLOAT32)
+		{
+			if (count > 0)
+			{
+				CopyMemory(vertices.data(), pPacked, count * sizeof(Data::Vertex));
+			}
+		}
+		else if (format == FORMAT_SNORM16)
+		{
+			UnpackSnorm16(pPacked, count, meshBuffer, vertices.data());
+		}
+		else if (format == FORMAT_FLOAT16)
+		{
+			for (size_t i = 0; i < count; i++, pPacked += 12)
+			{
+				uint16_t position[4];
+				uint32_t color;
+				memcpy(position, pPacked, sizeof(position));
+				memcpy(&color, pPacked + 8, sizeof(color));
+
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					vertices[i].position[k] = HalfToFloat(position[k]) * meshBuffer.position_scale[k] + meshBuffer.position_bias[k];
+				}
+
+				UnpackColor(color, vertices[i].color);
+			}
+		}
+		else if (format == FORMAT_UNORM10)
+		{
+			for (size_t i = 0; i < count; i++, pPacked += 8)
+			{
+				uint32_t position;
+				uint32_t color;
+				memcpy(&position, pPacked, sizeof(position));
+				memcpy(&color, pPacked + 4, sizeof(color));
+
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					const float n = ((position >> (k * 10)) & 0x3FF) * (1.0f / 1023.0f);
+					vertices[i].position[k] = n * meshBuffer.position_scale[k] + meshBuffer.position_bias[k];
+				}
+
+				UnpackColor(color, vertices[i].color);
+			}
+		}
+	}
+
+	VOID GetErrorBound(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, float* pPositionBound, float* pColorBound)
+	{
+		float extent = 0.0f;
+		for (size_t i = 0; i < count; i++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				extent = std::max(extent, std::fabs(pVertices[i].position[k]));
+			}
+		}
+
+		float scale = 0.0f;
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			scale = std::max(scale, meshBuffer.position_scale[k]);
+		}
+
+		const float rounding = 4.0f * FLT_EPSILON * (extent + scale);
+
+		*pPositionBound = 0.0f;
+		*pColorBound = (format == FORMAT_FLOAT32) ? 0.0f : 0.5f / 255.0f + FLT_EPSILON;
+
+		if (format == FORMAT_SNORM16)
+		{
+			*pPositionBound = scale * (0.5f / 32767.0f) + rounding;
+		}
+		else if (format == FORMAT_FLOAT16)
+		{
+			*pPositionBound = extent * (1.0f / 2048.0f) + 1.0f / 16777216.0f;
+		}
+		else if (format == FORMAT_UNORM10)
+		{
+			*pPositionBound = scale * (0.5f / 1023.0f) + rounding;
+		}
+	}
+
+	VOID MeasureError(const Data::Vertex* pExpected, const Data::Vertex* pActual, size_t count, float* pPositionError, float* pColorError)
+	{
+		*pPositionError = 0.0f;
+		*pColorError = 0.0f;
+
+		for (size_t i = 0; i < count; i++)
+		{
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				*pPositionError = std::max(*pPositionError, std::fabs(pExpected[i].position[k] - pActual[i].position[k]));
+				*pColorError = std::max(*pColorError, std::fabs(std::min(std::max(pExpected[i].color[k], 0.0f), 1.0f) - pActual[i].color[k]));
+			}
+		}
+	}
+
+	INT PackChecked(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<BYTE>& packed)
+	{
+		INT status = STATUS_SUCCESS;
+
+		std::vector<Data::Vertex> unpacked;
+		float position_error, color_error, position_bound, color_bound;
+
+		Pack(format, pVertices, count, meshBuffer, packed);
+		Unpack(format, packed.data(), count, meshBuffer, unpacked);
+
+		MeasureError(pVertices, unpacked.data(), count, &position_error, &color_error);
+		GetErrorBound(format, pVertices, count, meshBuffer, &position_bound, &color_bound);
+
+		if ((position_error > position_bound) || (color_error > color_bound))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s vertices exceed their error bound, position %g > %g or color %g > %g\n",
+				status, Layouts[format].name, position_error, position_bound, color_error, color_bound);
+		}
+
+		return status;
+	}
+}
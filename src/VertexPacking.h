@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Common.h"
+#include "Data.h"
+
+/*
+* compact vertex formats for the gpu copy of a mesh. positions are stored normalized against a per-mesh scale and
+* bias (Data::MeshBuffer) that the vertex shader applies, colors are always rgba8. the input assembler expands
+* every format back to floats, so the shader is the same for all of them.
+*/
+namespace VertexPacking
+{
+	enum Format {
+		FORMAT_FLOAT32, // the unpacked Data::Vertex, 24 bytes
+		FORMAT_SNORM16, // rgba16 snorm position, rgba8 color, 12 bytes
+		FORMAT_FLOAT16, // rgba16 float position, rgba8 color, 12 bytes
+		FORMAT_UNORM10, // rgb10a2 unorm position, rgba8 color, 8 bytes
+		FORMAT_COUNT
+	};
+
+	struct Layout
+	{
+		const char* name;
+		DXGI_FORMAT position_format;
+		DXGI_FORMAT color_format;
+		UINT        color_offset;
+		UINT        stride;
+		bool        quantized; // the positions go through the MeshBuffer dequantization, the others have scale 1 and bias 0
+	};
+
+	extern const Layout Layouts[FORMAT_COUNT];
+
+	bool FindFormat(const char* name, Format* pFormat);
+
+	// picks the scale and bias that map the mesh bounds onto the range of the position format
+	VOID ComputeDequantization(Format format, const Data::Vertex* pVertices, size_t count, Data::MeshBuffer& meshBuffer);
+
+	// packs count vertices into count * Layouts[format].stride bytes
+	// packs into count * Layouts[format].stride bytes at pPacked
+	VOID Pack(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, BYTE* pPacked);
+
+	VOID Pack(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<BYTE>& packed);
+
+	// the inverse of Pack, decoding exactly like the input assembler and the vertex shader do
+	VOID Unpack(Format format, const BYTE* pPacked, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<Data::Vertex>& vertices);
+
+	/*
+	* the largest error a round trip through the format may introduce: half a quantization step of the position
+	* format (relative for float16), half a step of the color, plus a few float roundings of the dequantization.
+	*/
+	VOID GetErrorBound(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, float* pPositionBound, float* pColorBound);
+
+	// the largest per-component differences between two vertex arrays
+	VOID MeasureError(const Data::Vertex* pExpected, const Data::Vertex* pActual, size_t count, float* pPositionError, float* pColorError);
+
+	// packs the vertices and checks that they decode within the error bound of the format
+	INT PackChecked(Format format, const Data::Vertex* pVertices, size_t count, const Data::MeshBuffer& meshBuffer, std::vector<BYTE>& packed);
+}
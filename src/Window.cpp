@@ -0,0 +1,122 @@
+#include "Window.h"
+#include "Log.h"
+
+Window* Window::m_Instance = NULL;
+
+Window::Window()
+{
+	m_hInstance = NULL;
+	m_hWindow = NULL;
+}
+
+RECT Window::CalculateWindowRect()
+{
+	HWND hDesktop = GetDesktopWindow();
+	RECT rWindow = {};
+
+	GetClientRect(hDesktop, &rWindow);
+	rWindow.left   = (rWindow.right  - WIDTH)  / 2;
+	rWindow.top    = (rWindow.bottom - HEIGHT) / 2;
+	rWindow.right  = rWindow.left + WIDTH;
+	rWindow.bottom = rWindow.top  - HEIGHT;
+
+	return rWindow;
+}
+
+INT Window::Initialize()
+{
+	INT status = STATUS_SUCCESS;
+
+	m_Instance = this;
+	m_hInstance = GetModuleHandleW(NULL);
+
+	if (SUCCEEDED(status))
+	{
+		WNDCLASSEXA wndClass;
+		wndClass.cbSize = sizeof(WNDCLASSEXA);
+		wndClass.style = 0;
+		wndClass.lpfnWndProc = WindowProc;
+		wndClass.cbClsExtra = 0;
+		wndClass.cbWndExtra = 0;
+		wndClass.hInstance = m_hInstance;
+		wndClass.hIcon = NULL;
+		wndClass.hCursor = LoadCursor(NULL, IDC_ARROW);
+		wndClass.hbrBackground = (HBRUSH)GetStockObject(BLACK_BRUSH);
+		wndClass.lpszMenuName = NULL;
+		wndClass.lpszClassName = CLASS_NAME;
+		wndClass.hIconSm = NULL;
+
+		if (!RegisterClassExA(&wndClass))
+		{
+			DWORD dwError = GetLastError();
+			if (dwError != ERROR_CLASS_ALREADY_EXISTS)
+			{
+				status = HRESULT_FROM_WIN32(dwError);
+				WriteToConsole("error 0x%X: could not register window class\n", dwError);
+			}
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		RECT r = CalculateWindowRect();
+
+		m_hWindow = CreateWindowExA(0, CLASS_NAME, WINDOW_NAME, WS_OVERLAPPEDWINDOW, r.left, r.top, r.right - r.left, r.top - r.bottom, NULL, NULL, m_hInstance, NULL);
+
+		if (m_hWindow == NULL)
+		{
+			DWORD dwError = GetLastError();
+
+			status = HRESULT_FROM_WIN32(dwError);
+			WriteToConsole("error 0x%X: could not create window\n", status);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		ShowWindow(m_hWindow, SW_SHOW);
+	}
+	else
+	{
+		Uninitialize();
+	}
+
+	return status;
+}
+
+LRESULT WINAPI Window::WindowProc(_In_ HWND hWnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam)
+{
+	switch (uMsg)
+	{
+		case WM_CLOSE:
+		{
+			m_Instance->Uninitialize();
+			return 0;
+		}
+
+		case WM_DESTROY:
+		{
+			PostQuitMessage(0);
+			break;
+		}
+	}
+
+	return DefWindowProcA(hWnd, uMsg, wParam, lParam);
+}
+
+VOID Window::Uninitialize()
+{
+	HMENU hMenu = GetMenu(m_hWindow);
+	if (hMenu != NULL)
+	{
+		DestroyMenu(hMenu);
+	}
+
+	DestroyWindow(m_hWindow);
+	UnregisterClassA(CLASS_NAME, m_hInstance);
+}
+
+HWND Window::GetWindowHandle()
+{
+	return m_hWindow;
+}
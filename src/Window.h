@@ -0,0 +1,25 @@
+#pragma once
+
+#include "Common.h"
+
+class Window
+{
+private:
+	HINSTANCE      m_hInstance;
+	HWND           m_hWindow;
+
+	static Window* m_Instance;
+
+private:
+	RECT CalculateWindowRect();
+
+	static LRESULT WINAPI WindowProc(_In_ HWND hWnd, _In_ UINT uMsg, _In_ WPARAM wParam, _In_ LPARAM lParam);
+
+public:
+	Window();
+
+	INT  Initialize();
+	VOID Uninitialize();
+
+	HWND GetWindowHandle();
+};
@@ -0,0 +1,254 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "AnimationTracks.h"
+#include "Simulation.h"
+
+// the angle of the rotation from quaternion q0 to q1, in double precision so that small angles are not lost
+double RotationError(const float* q0, const float* q1)
+{
+	double plus = 0.0;
+	double minus = 0.0;
+
+	for (unsigned int k = 0; k < 4; k++)
+	{
+		plus += (static_cast<double>(q0[k]) + q1[k]) * (static_cast<double>(q0[k]) + q1[k]);
+		minus += (static_cast<double>(q0[k]) - q1[k]) * (static_cast<double>(q0[k]) - q1[k]);
+	}
+
+	// q and -q are the same rotation, the chord between them gives the angle on the sphere, which is half the rotation's
+	return 4.0 * std::asin(std::min(std::sqrt(std::min(plus, minus)) * 0.5, 1.0));
+}
+
+INT RunAnimationBenchmark(size_t trackCount)
+{
+	const unsigned int KEY_COUNT = 16;
+	const float DURATION = 10.0f;
+	const float FRAME_TIME = 1.0f / 60.0f;
+	const unsigned int FRAME_COUNT = 120;
+	const unsigned int CHECK_COUNT = 64;      // random times the tracks are checked at
+	const size_t CHECK_TRACKS = 4096;         // tracks checked against the exact slerp at each of them
+	const double MAX_SLERP_ERROR = 1e-4;      // radians
+	const double MAX_QUANTIZED_ERROR = 1e-3;  // radians, the keys are off by up to half a 16 bit step per component
+	const double MAX_TRANSLATION_ERROR = 1e-4;
+
+	INT status = STATUS_SUCCESS;
+
+	// the keys of every track also in arrays of structures, for the references
+	std::vector<float> times(trackCount * KEY_COUNT);
+	std::vector<float> rotations(trackCount * KEY_COUNT * 4);
+	std::vector<float> translations(trackCount * KEY_COUNT * 3);
+
+	AnimationTracks tracks;
+	AnimationTracks quantized;
+
+	tracks.Initialize(false);
+	quantized.Initialize(true);
+
+	// random orientations, consecutive keys are anything up to 180 degrees apart
+	for (size_t track = 0; (track < trackCount) && SUCCEEDED(status); track++)
+	{
+		RandomStream random(track + 1);
+		float* pTimes = &times[track * KEY_COUNT];
+		float* pRotations = &rotations[track * KEY_COUNT * 4];
+		float* pTranslations = &translations[track * KEY_COUNT * 3];
+
+		for (unsigned int key = 0; key < KEY_COUNT; key++)
+		{
+			pTimes[key] = DURATION * (key + (key > 0 ? random.NextFloat() * 0.5f - 0.25f : 0.0f)) / (KEY_COUNT - 1);
+
+			const float r_x = random.NextFloat() * 2.0f * M_PI;
+			const float r_y = random.NextFloat() * 2.0f * M_PI;
+			const float r_z = random.NextFloat() * 2.0f * M_PI;
+			Quaternion::FromEuler(r_x, r_y, r_z, &pRotations[key * 4]);
+
+			for (unsigned int k = 0; k < 3; k++)
+			{
+				pTranslations[key * 3 + k] = (random.NextFloat() - 0.5f) * 10.0f;
+			}
+		}
+
+		pTimes[KEY_COUNT - 1] = DURATION;
+
+		status = tracks.AddTrack(pTimes, pRotations, pTranslations, KEY_COUNT);
+
+		if (SUCCEEDED(status))
+		{
+			status = quantized.AddTrack(pTimes, pRotations, pTranslations, KEY_COUNT);
+		}
+	}
+
+	std::vector<float> batch_rotations(Quaternion::GetBatchSize(trackCount));
+	std::vector<float> batch_translations(Quaternion::GetBatchSize(trackCount));
+	std::vector<float> expected_rotations(Quaternion::GetBatchSize(trackCount));
+	std::vector<float> expected_translations(Quaternion::GetBatchSize(trackCount));
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("%zu tracks of %u keys: %zu bytes per key, %zu quantized, and %zu bytes of cursor per track\n",
+			trackCount, KEY_COUNT, tracks.GetKeySize(), quantized.GetKeySize(), tracks.GetSegmentSize());
+	}
+
+	// the batched evaluation against the exact slerp of the keys found by a linear search, at random times including the ends
+	if (SUCCEEDED(status))
+	{
+		const AnimationTracks::Interpolation INTERPOLATIONS[] = { AnimationTracks::INTERPOLATION_SLERP, AnimationTracks::INTERPOLATION_NLERP, AnimationTracks::INTERPOLATION_SLERP };
+		const char* NAMES[] = { "slerp", "nlerp", "quantized slerp" };
+
+		RandomStream random(0);
+		double rotation_errors[3] = {};
+		double translation_errors[3] = {};
+		const size_t checked = std::min(trackCount, CHECK_TRACKS);
+
+		for (unsigned int check = 0; check < CHECK_COUNT; check++)
+		{
+			const float time = (check == 0) ? -1.0f : (check == 1) ? DURATION + 1.0f : random.NextFloat() * DURATION;
+
+			for (unsigned int variant = 0; variant < ARRAYSIZE(INTERPOLATIONS); variant++)
+			{
+				AnimationTracks& evaluated = (variant == 2) ? quantized : tracks;
+				evaluated.Evaluate(time, INTERPOLATIONS[variant], 0, checked, batch_rotations.data(), batch_translations.data());
+
+				for (size_t track = 0; track < checked; track++)
+				{
+					const float* pTimes = &times[track * KEY_COUNT];
+
+					unsigned int key = 0;
+					while ((key + 2 < KEY_COUNT) && (time >= pTimes[key + 1]))
+					{
+						key++;
+					}
+
+					const float u = std::min(std::max((time - pTimes[key]) / (pTimes[key + 1] - pTimes[key]), 0.0f), 1.0f);
+
+					float expected[4];
+					float rotation[4];
+					float translation[3];
+					AnimationTracks::Slerp(&rotations[(track * KEY_COUNT + key) * 4], &rotations[(track * KEY_COUNT + key + 1) * 4], u, expected);
+
+					for (unsigned int k = 0; k < 4; k++)
+					{
+						rotation[k] = batch_rotations[(track / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + k * Matrix::BATCH_WIDTH + (track % Matrix::BATCH_WIDTH)];
+					}
+
+					for (unsigned int k = 0; k < 3; k++)
+					{
+						translation[k] = batch_translations[(track / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + k * Matrix::BATCH_WIDTH + (track % Matrix::BATCH_WIDTH)];
+
+						const float p0 = translations[(track * KEY_COUNT + key) * 3 + k];
+						const float p1 = translations[(track * KEY_COUNT + key + 1) * 3 + k];
+						translation_errors[variant] = std::max(translation_errors[variant], std::fabs(static_cast<double>(translation[k]) - (p0 + (p1 - p0) * static_cast<double>(u))));
+					}
+
+					rotation_errors[variant] = std::max(rotation_errors[variant], RotationError(rotation, expected));
+				}
+			}
+		}
+
+		for (unsigned int variant = 0; variant < ARRAYSIZE(INTERPOLATIONS); variant++)
+		{
+			WriteToConsole("%s: max error %.3g radians, %.3g in translation\n", NAMES[variant], rotation_errors[variant], translation_errors[variant]);
+		}
+
+		// the translations are 10 units across, so a 16 bit step is 1.5e-4
+		if ((rotation_errors[0] > MAX_SLERP_ERROR) || (rotation_errors[2] > MAX_QUANTIZED_ERROR) ||
+			(translation_errors[0] > MAX_TRANSLATION_ERROR) || (translation_errors[2] > 10.0 / 65535))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the interpolation is further off the exact slerp than %.3g radians, %.3g quantized\n", status, MAX_SLERP_ERROR, MAX_QUANTIZED_ERROR);
+		}
+	}
+
+	// playback forwards and backwards through the cursors gives the same poses as searches from scratch
+	for (unsigned int frame = 0; (frame < 2 * FRAME_COUNT) && SUCCEEDED(status); frame++)
+	{
+		const unsigned int step = (frame < FRAME_COUNT) ? frame : 2 * FRAME_COUNT - frame;
+		const float time = step * FRAME_TIME * 5.0f;
+
+		tracks.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, 0, trackCount, batch_rotations.data(), batch_translations.data());
+
+		if (frame % 17 == 0)
+		{
+			tracks.ResetCursors();
+			tracks.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, 0, trackCount, expected_rotations.data(), expected_translations.data());
+
+			if ((batch_rotations != expected_rotations) || (batch_translations != expected_translations))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the cursors gave a different pose at %.3f seconds\n", status, time);
+			}
+		}
+	}
+
+	/*
+	* a playback of FRAME_COUNT frames at 60 per second through every variant. the reference is the exact slerp of each
+	* track after a binary search of its keys, one track at a time.
+	*/
+	if (SUCCEEDED(status))
+	{
+		double seconds[5] = {};
+
+		for (unsigned int variant = 0; variant < ARRAYSIZE(seconds); variant++)
+		{
+			RandomStream random(variant);
+
+			tracks.ResetCursors();
+			quantized.ResetCursors();
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+			{
+				const float time = (variant == 3) ? random.NextFloat() * DURATION : frame * FRAME_TIME;
+
+				if (variant == 0)
+				{
+					tracks.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, 0, trackCount, batch_rotations.data(), batch_translations.data());
+				}
+				else if (variant == 1)
+				{
+					tracks.Evaluate(time, AnimationTracks::INTERPOLATION_NLERP, 0, trackCount, batch_rotations.data(), batch_translations.data());
+				}
+				else if (variant == 2)
+				{
+					quantized.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, 0, trackCount, batch_rotations.data(), batch_translations.data());
+				}
+				else if (variant == 3)
+				{
+					tracks.Evaluate(time, AnimationTracks::INTERPOLATION_SLERP, 0, trackCount, batch_rotations.data(), batch_translations.data());
+				}
+				else
+				{
+					for (size_t track = 0; track < trackCount; track++)
+					{
+						const float* pTimes = &times[track * KEY_COUNT];
+						const size_t key = std::min<size_t>(std::upper_bound(pTimes + 1, pTimes + KEY_COUNT - 1, time) - pTimes - 1, KEY_COUNT - 2);
+						const float u = std::min(std::max((time - pTimes[key]) / (pTimes[key + 1] - pTimes[key]), 0.0f), 1.0f);
+
+						float q[4];
+						AnimationTracks::Slerp(&rotations[(track * KEY_COUNT + key) * 4], &rotations[(track * KEY_COUNT + key + 1) * 4], u, q);
+						Quaternion::StoreBatch(batch_rotations.data(), track, q);
+
+						for (unsigned int k = 0; k < 3; k++)
+						{
+							const float p0 = translations[(track * KEY_COUNT + key) * 3 + k];
+							const float p1 = translations[(track * KEY_COUNT + key + 1) * 3 + k];
+							batch_translations[(track / Matrix::BATCH_WIDTH) * Quaternion::BATCH_BLOCK_SIZE + k * Matrix::BATCH_WIDTH + (track % Matrix::BATCH_WIDTH)] = p0 + (p1 - p0) * u;
+						}
+					}
+				}
+			}
+
+			seconds[variant] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		const double count = static_cast<double>(trackCount) * FRAME_COUNT;
+
+		WriteToConsole("playback: %.2f ns per track with slerp, %.2f with nlerp, %.2f quantized, %.2f seeking to random times, %.2f for the exact slerp one track at a time\n",
+			seconds[0] * 1e9 / count, seconds[1] * 1e9 / count, seconds[2] * 1e9 / count, seconds[3] * 1e9 / count, seconds[4] * 1e9 / count);
+		WriteToConsole("%.2f ms per frame of %zu tracks with slerp\n", seconds[0] * 1e3 / FRAME_COUNT, trackCount);
+	}
+
+	return status;
+}
@@ -0,0 +1,225 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "Bvh.h"
+#include "Simulation.h"
+
+// count cubes at random points of the unit cube, turned at random and sized like the cells of a grid of the same count
+VOID GenerateScene(size_t count, uint64_t seed, std::vector<float>& transforms)
+{
+	RandomStream random(seed);
+
+	const float scale = 0.5f / cbrtf(static_cast<float>(count));
+	const float angle = 2.0f * static_cast<float>(M_PI);
+
+	transforms.resize(count * Data::INSTANCE_SIZE);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float rotation[4];
+		Matrix::Affine3x4 matrix;
+		float* transform = &transforms[i * Data::INSTANCE_SIZE];
+
+		Quaternion::FromEuler(random.NextFloat() * angle, random.NextFloat() * angle, random.NextFloat() * angle, rotation);
+		Quaternion::ToMatrix(rotation, matrix);
+
+		for (unsigned int k = 0; k < 12; k++)
+		{
+			transform[k] = matrix.m[k] * scale;
+		}
+
+		transform[3]  = random.NextFloat() - 0.5f;
+		transform[7]  = random.NextFloat() - 0.5f;
+		transform[11] = random.NextFloat() - 0.5f;
+	}
+}
+
+// turns every instance in place by a random rotation, the update that Bvh::Refit is meant for
+VOID RotateScene(size_t count, uint64_t seed, std::vector<float>& transforms)
+{
+	RandomStream random(seed);
+
+	const float angle = 2.0f * static_cast<float>(M_PI);
+
+	for (size_t i = 0; i < count; i++)
+	{
+		float rotation[4];
+		Matrix::Affine3x4 matrix;
+		Matrix::Affine3x4 instance;
+		float* transform = &transforms[i * Data::INSTANCE_SIZE];
+
+		Quaternion::FromEuler(random.NextFloat() * angle, random.NextFloat() * angle, random.NextFloat() * angle, rotation);
+		Quaternion::ToMatrix(rotation, matrix);
+
+		CopyMemory(instance.m, transform, sizeof(instance.m));
+		Matrix::Multiply(matrix, instance, matrix);
+
+		for (unsigned int k = 0; k < 12; k++)
+		{
+			if ((k % 4) != 3)
+			{
+				transform[k] = matrix.m[k];
+			}
+		}
+	}
+}
+
+INT RunBvhBenchmark(size_t maxCount, JobSystem& jobs)
+{
+	const unsigned int VIEW_COUNT = 8;
+	const unsigned int RAY_COUNT = 10000;
+
+	INT status = STATUS_SUCCESS;
+
+	Culling::Bounds bounds;
+	Culling::ComputeBounds(Data::Vertices, ARRAYSIZE(Data::Vertices), bounds);
+
+	for (size_t count = 10000; (count <= maxCount) && SUCCEEDED(status); count *= 10)
+	{
+		std::vector<float> transforms;
+		GenerateScene(count, count, transforms);
+
+		Bvh bvh;
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		status = bvh.Build(transforms.data(), count, bounds, jobs);
+		const double build_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		for (unsigned int pass = 0; (pass < 2) && SUCCEEDED(status); pass++)
+		{
+			double refit_seconds = 0.0;
+
+			// the second pass checks the refitted tree
+			if (pass == 1)
+			{
+				RotateScene(count, count + 1, transforms);
+
+				start = std::chrono::steady_clock::now();
+				bvh.Refit(transforms.data());
+				refit_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			std::vector<Bvh::Aabb> boxes(count);
+			for (size_t i = 0; i < count; i++)
+			{
+				Bvh::ComputeBounds(&transforms[i * Data::INSTANCE_SIZE], bounds, boxes[i]);
+			}
+
+			std::vector<uint32_t> visible(count);
+			std::vector<uint32_t> reference(count);
+
+			RandomStream random(count + pass);
+
+			double query_seconds = 0.0;
+			size_t visible_total = 0;
+
+			for (unsigned int view = 0; (view < VIEW_COUNT) && SUCCEEDED(status); view++)
+			{
+				// the scene matrix turned at random and zoomed in on a part of the scene
+				float rotation[4];
+				float m[16];
+				const float angle = 2.0f * static_cast<float>(M_PI);
+				Quaternion::FromEuler(random.NextFloat() * angle, random.NextFloat() * angle, random.NextFloat() * angle, rotation);
+				Quaternion::ToMatrix(rotation, m);
+
+				const float zoom = 1.0f + 3.0f * random.NextFloat();
+				for (unsigned int k = 0; k < 8; k++)
+				{
+					m[k] *= zoom;
+				}
+
+				Culling::Frustum frustum;
+				Culling::ExtractFrustum(m, frustum);
+
+				start = std::chrono::steady_clock::now();
+				const size_t visible_count = bvh.Query(frustum, visible.data());
+				query_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				size_t reference_count = 0;
+				for (size_t i = 0; i < count; i++)
+				{
+					if (Bvh::Classify(frustum, boxes[i]) >= 0)
+					{
+						reference[reference_count++] = static_cast<uint32_t>(i);
+					}
+				}
+
+				visible_total += visible_count;
+				std::sort(visible.begin(), visible.begin() + visible_count);
+
+				if ((visible_count != reference_count) || !std::equal(visible.begin(), visible.begin() + visible_count, reference.begin()))
+				{
+					status = STATUS_DATA_ERROR;
+					WriteToConsole("error 0x%X: %zu instances, the bvh finds %zu instead of %zu in view %u\n", status, count, visible_count, reference_count, view);
+				}
+			}
+
+			// rays from outside of the scene through random points in it, a few are checked against every instance
+			const unsigned int check_count = static_cast<unsigned int>(std::max<size_t>(4, 1000000 / count));
+
+			double pick_seconds = 0.0;
+			unsigned int hits = 0;
+
+			for (unsigned int ray = 0; (ray < RAY_COUNT) && SUCCEEDED(status); ray++)
+			{
+				float origin[3];
+				float direction[3];
+
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					origin[k] = 4.0f * random.NextFloat() - 2.0f;
+					direction[k] = 0.8f * random.NextFloat() - 0.4f - origin[k];
+				}
+
+				float distance;
+
+				start = std::chrono::steady_clock::now();
+				const uint32_t instance = bvh.Pick(origin, direction, &distance);
+				pick_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+				hits += (instance != Bvh::INVALID) ? 1 : 0;
+
+				if (ray < check_count)
+				{
+					uint32_t reference_instance = Bvh::INVALID;
+					float reference_distance = FLT_MAX;
+
+					for (size_t i = 0; i < count; i++)
+					{
+						float d;
+
+						if (Bvh::IntersectInstance(&transforms[i * Data::INSTANCE_SIZE], bounds, origin, direction, &d) && (d < reference_distance))
+						{
+							reference_distance = d;
+							reference_instance = static_cast<uint32_t>(i);
+						}
+					}
+
+					if ((instance != reference_instance) || ((instance != Bvh::INVALID) && (distance != reference_distance)))
+					{
+						status = STATUS_DATA_ERROR;
+						WriteToConsole("error 0x%X: %zu instances, ray %u picks %d instead of %d\n", status, count, ray, instance, reference_instance);
+					}
+				}
+			}
+
+			if (pass == 0)
+			{
+				WriteToConsole("%8zu instances: build %8.2f ms, depth %zu, ", count, build_seconds * 1e3, bvh.GetDepth());
+			}
+			else
+			{
+				WriteToConsole("%8zu instances: refit %8.2f ms,           ", count, refit_seconds * 1e3);
+			}
+
+			WriteToConsole("query %8.3f ms (%4.1f%% visible), pick %6.2f us (%4.1f%% hit)\n",
+				query_seconds * 1e3 / VIEW_COUNT, 100.0 * visible_total / (static_cast<double>(count) * VIEW_COUNT), pick_seconds * 1e6 / RAY_COUNT, 100.0 * hits / RAY_COUNT);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,317 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "Fnv.h"
+#include "VertexPacking.h"
+#include "JobSystem.h"
+#include "RenderContext.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
+#include "Simulation.h"
+
+struct CommandBufferJob
+{
+	const std::vector<DrawQueue::Draw>* pDraws;
+	CommandBuffer*                      pBuffers;
+	size_t                              chunk_size;
+};
+
+// records the draws of a chunk with every bind, a chunk starts with an update of its own material
+VOID RecordCommandBuffer(const std::vector<DrawQueue::Draw>& draws, size_t chunk, size_t chunk_size, RenderContext& context)
+{
+	const size_t begin = chunk * chunk_size;
+	const size_t end = std::min(draws.size(), begin + chunk_size);
+
+	float material[16];
+
+	for (unsigned int i = 0; i < 16; i++)
+	{
+		material[i] = static_cast<float>(chunk * 16 + i);
+	}
+
+	context.UpdateBuffer(draws[begin].pConstantBuffers[1], material, sizeof(material));
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const DrawQueue::Draw& draw = draws[i];
+
+		context.VSSetShader(draw.pVertexShader);
+		context.PSSetShader(draw.pPixelShader);
+		context.IASetInputLayout(draw.pInputLayout);
+		context.IASetPrimitiveTopology(draw.topology);
+		context.IASetVertexBuffers(0, draw.vertex_buffer_count, draw.pVertexBuffers, draw.strides, draw.offsets);
+		context.IASetIndexBuffer(draw.pIndexBuffer, draw.index_format, 0);
+		context.VSSetConstantBuffers(0, draw.constant_buffer_count, draw.pConstantBuffers);
+
+		context.DrawIndexedInstanced(draw.index_count, draw.instance_count, draw.start_index, draw.base_vertex, draw.start_instance);
+	}
+}
+
+VOID CommandBufferRecordJob(VOID* pData, size_t begin, size_t end)
+{
+	CommandBufferJob& job = *static_cast<CommandBufferJob*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		job.pBuffers[i].Clear();
+		RecordCommandBuffer(*job.pDraws, i, job.chunk_size, job.pBuffers[i]);
+	}
+}
+
+INT RunCommandBufferBenchmark(JobSystem& jobs)
+{
+	const unsigned int DRAW_COUNT = 65536;
+	const unsigned int CHUNK_SIZE = 256;
+	const unsigned int CHUNK_COUNT = DRAW_COUNT / CHUNK_SIZE;
+	const unsigned int MESH_COUNT = 16;
+	const unsigned int MATERIAL_COUNT = 32;
+	const unsigned int REPEAT_COUNT = 20;
+	const char* CAPTURE_PATH = "benchmark.capture";
+
+	enum { KIND_VERTEX_SHADER, KIND_PIXEL_SHADER, KIND_LAYOUT, KIND_VERTEX_BUFFER, KIND_INDEX_BUFFER, KIND_CONSTANT_BUFFER, KIND_TARGET };
+
+	INT status = STATUS_SUCCESS;
+
+	RandomStream random(1);
+	std::vector<DrawQueue::Draw> draws(DRAW_COUNT);
+
+	for (DrawQueue::Draw& draw : draws)
+	{
+		const unsigned int mesh = random.Next() % MESH_COUNT;
+		const unsigned int material = random.Next() % MATERIAL_COUNT;
+
+		draw = DrawQueue::Draw();
+		draw.pVertexShader = GetFakeObject<ID3D11VertexShader>(KIND_VERTEX_SHADER, material % 4);
+		draw.pPixelShader = GetFakeObject<ID3D11PixelShader>(KIND_PIXEL_SHADER, material % 4);
+		draw.pInputLayout = GetFakeObject<ID3D11InputLayout>(KIND_LAYOUT, mesh % 2);
+		draw.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		draw.pVertexBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, mesh);
+		draw.pVertexBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, MESH_COUNT);
+		draw.strides[0] = VertexPacking::Layouts[mesh % 2].stride;
+		draw.strides[1] = sizeof(float) * Data::INSTANCE_SIZE;
+		draw.vertex_buffer_count = 2;
+		draw.pIndexBuffer = GetFakeObject<ID3D11Buffer>(KIND_INDEX_BUFFER, mesh);
+		draw.index_format = DXGI_FORMAT_R16_UINT;
+		draw.pConstantBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 0);
+		draw.pConstantBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 1 + material);
+		draw.constant_buffer_count = 2;
+		draw.index_count = 36 * (mesh + 1);
+		draw.instance_count = 1;
+		draw.start_instance = static_cast<UINT>(&draw - draws.data());
+	}
+
+	ID3D11RenderTargetView* pTarget = GetFakeObject<ID3D11RenderTargetView>(KIND_TARGET, 0);
+	ID3D11DepthStencilView* pDepth = GetFakeObject<ID3D11DepthStencilView>(KIND_TARGET, 1);
+
+	// one thread issuing everything straight into the recording
+	RecordingRenderContext direct;
+
+	direct.ClearRenderTargetView(pTarget, Data::ClearColor);
+	direct.ClearDepthStencilView(pDepth, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	direct.OMSetRenderTargets(1, &pTarget, pDepth);
+
+	for (unsigned int chunk = 0; chunk < CHUNK_COUNT; chunk++)
+	{
+		RecordCommandBuffer(draws, chunk, CHUNK_SIZE, direct);
+	}
+
+	// the same set up into the first buffer, the chunks into the others on the job threads
+	std::vector<CommandBuffer> buffers(CHUNK_COUNT + 1);
+
+	buffers[0].ClearRenderTargetView(pTarget, Data::ClearColor);
+	buffers[0].ClearDepthStencilView(pDepth, D3D11_CLEAR_DEPTH, 1.0f, 0);
+	buffers[0].OMSetRenderTargets(1, &pTarget, pDepth);
+
+	CommandBufferJob job = { &draws, &buffers[1], CHUNK_SIZE };
+	jobs.ParallelFor("Record", CommandBufferRecordJob, &job, CHUNK_COUNT, 1);
+
+	CommandBuffer merged;
+
+	for (const CommandBuffer& buffer : buffers)
+	{
+		merged.Append(buffer);
+	}
+
+	{
+		RecordingRenderContext replayed;
+		RecordingRenderContext appended;
+
+		status = CommandBuffer::Replay(buffers.data(), buffers.size(), replayed);
+
+		if (SUCCEEDED(status))
+		{
+			status = merged.Replay(appended);
+		}
+
+		if (SUCCEEDED(status) && ((replayed.GetEvents() != direct.GetEvents()) || (appended.GetEvents() != direct.GetEvents())))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the replay of the command buffers differs from issuing the commands directly\n", status);
+		}
+	}
+
+	// the capture replays onto its handles until it is bound to the objects again
+	if (SUCCEEDED(status))
+	{
+		std::vector<uint64_t> objects;
+		CommandBuffer loaded;
+
+		status = merged.Save(CAPTURE_PATH, &objects);
+
+		if (SUCCEEDED(status))
+		{
+			status = loaded.Load(CAPTURE_PATH);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			RecordingRenderContext unbound;
+			loaded.Replay(unbound);
+
+			WriteToConsole("capture: %u commands, %zu bytes, %zu objects\n", loaded.GetCommandCount(), loaded.GetSize(), objects.size());
+
+			if (unbound.GetEvents().size() != direct.GetEvents().size())
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the capture does not replay the commands it was saved from\n", status);
+			}
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = loaded.Bind(objects);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			RecordingRenderContext bound;
+			loaded.Replay(bound);
+
+			if ((loaded.GetCommandCount() != merged.GetCommandCount()) || (bound.GetEvents() != direct.GetEvents()))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the capture does not replay the commands it was saved from\n", status);
+			}
+		}
+
+		// a stream that passes the checksum but has a command of a bad size has to be refused, not replayed
+		if (SUCCEEDED(status))
+		{
+			std::vector<BYTE> file(sizeof(CommandBuffer::CaptureHeader) + merged.GetSize());
+			CommandBuffer::CaptureHeader header;
+
+			FILE* pFile = OpenFileStream(CAPTURE_PATH, "rb");
+			if (pFile != NULL)
+			{
+				file.resize(fread(file.data(), 1, file.size(), pFile));
+				fclose(pFile);
+			}
+
+			CommandBuffer::Command command = { CommandBuffer::COMMAND_RENDER_TARGETS, 4 };
+			CopyMemory(&file[sizeof(header)], &command, sizeof(command));
+
+			CopyMemory(&header, file.data(), sizeof(header));
+			header.checksum = Fnv::Checksum(&file[sizeof(header)], file.size() - sizeof(header));
+			CopyMemory(file.data(), &header, sizeof(header));
+
+			pFile = OpenFileStream(CAPTURE_PATH, "wb");
+			if (pFile != NULL)
+			{
+				fwrite(file.data(), 1, file.size(), pFile);
+				fclose(pFile);
+			}
+
+			WriteToConsole("loading a damaged capture, which has to fail:\n");
+
+			if (loaded.Load(CAPTURE_PATH) != STATUS_DATA_ERROR)
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: a damaged capture was loaded\n", status);
+			}
+		}
+
+		remove(CAPTURE_PATH);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		double direct_seconds = 0.0;
+		double record_seconds = 0.0;
+		double parallel_seconds = 0.0;
+		double replay_seconds = 0.0;
+
+		NullRenderContext null_context;
+
+		for (unsigned int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned int chunk = 0; chunk < CHUNK_COUNT; chunk++)
+			{
+				RecordCommandBuffer(draws, chunk, CHUNK_SIZE, null_context);
+			}
+
+			direct_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			CommandBufferRecordJob(&job, 0, CHUNK_COUNT);
+
+			record_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			jobs.ParallelFor("Record", CommandBufferRecordJob, &job, CHUNK_COUNT, 1);
+
+			parallel_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			CommandBuffer::Replay(buffers.data(), buffers.size(), null_context);
+
+			replay_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		const double draw_count = static_cast<double>(DRAW_COUNT) * REPEAT_COUNT;
+
+		WriteToConsole("%u draws in %u command buffers, per draw: %.1f ns issued directly, %.1f ns recorded on one thread, %.1f ns recorded on %u threads, %.1f ns replayed\n",
+			DRAW_COUNT, CHUNK_COUNT, direct_seconds * 1e9 / draw_count, record_seconds * 1e9 / draw_count, parallel_seconds * 1e9 / draw_count,
+			jobs.GetThreadCount(), replay_seconds * 1e9 / draw_count);
+	}
+
+	return status;
+}
+
+INT RunCaptureReplay(const char* path, unsigned int repeats)
+{
+	INT status = STATUS_SUCCESS;
+
+	CommandBuffer capture;
+	status = capture.Load(path);
+
+	if (SUCCEEDED(status))
+	{
+		RecordingRenderContext recording;
+		StateCache cache(&recording);
+
+		status = capture.Replay(cache);
+
+		WriteToConsole("%s: %u commands in %zu bytes, %llu binds of which the state cache drops %llu\n", path, capture.GetCommandCount(), capture.GetSize(),
+			static_cast<unsigned long long>(cache.GetIssuedCount() + cache.GetElidedCount()), static_cast<unsigned long long>(cache.GetElidedCount()));
+	}
+
+	if (SUCCEEDED(status))
+	{
+		NullRenderContext null_context;
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (unsigned int repeat = 0; (repeat < repeats) && SUCCEEDED(status); repeat++)
+		{
+			status = capture.Replay(null_context);
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		WriteToConsole("replayed %u times, %.1f ns per command\n", repeats, seconds * 1e9 / (static_cast<double>(capture.GetCommandCount()) * std::max(repeats, 1u)));
+	}
+
+	return status;
+}
@@ -0,0 +1,433 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "VertexPacking.h"
+#include "ConstantRing.h"
+#include "RenderContext.h"
+#include "StateCache.h"
+#include "CommandBuffer.h"
+#include "Simulation.h"
+
+/*
+* a persistently mapped stand-in for the buffer of a ConstantRing. a discard keeps the contents where d3d would rename
+* the buffer, so a block written over one that a frame in flight still reads shows up in the data. like d3d it refuses
+* NO_OVERWRITE before the first discard and a map of a buffer that is still mapped.
+*/
+class FakeConstantBuffer : public ConstantBufferWriter
+{
+private:
+	std::vector<BYTE> m_Data;
+	uint64_t          m_MapCount;
+	uint64_t          m_DiscardCount;
+	bool              m_Mapped;
+
+public:
+	FakeConstantBuffer(size_t size);
+
+	INT  Map(bool discard, BYTE** ppData);
+	VOID Unmap();
+
+	const BYTE* GetData();
+	uint64_t    GetMapCount();
+	uint64_t    GetDiscardCount();
+};
+
+FakeConstantBuffer::FakeConstantBuffer(size_t size) : m_Data(size)
+{
+	m_MapCount = 0;
+	m_DiscardCount = 0;
+	m_Mapped = false;
+}
+
+INT FakeConstantBuffer::Map(bool discard, BYTE** ppData)
+{
+	if (m_Mapped || (!discard && (m_DiscardCount == 0)))
+	{
+		return STATUS_INVALID_PARAMETER;
+	}
+
+	m_Mapped = true;
+	m_MapCount++;
+	m_DiscardCount += discard ? 1 : 0;
+	*ppData = m_Data.data();
+
+	return STATUS_SUCCESS;
+}
+
+VOID FakeConstantBuffer::Unmap()
+{
+	m_Mapped = false;
+}
+
+const BYTE* FakeConstantBuffer::GetData()
+{
+	return m_Data.data();
+}
+
+uint64_t FakeConstantBuffer::GetMapCount()
+{
+	return m_MapCount;
+}
+
+uint64_t FakeConstantBuffer::GetDiscardCount()
+{
+	return m_DiscardCount;
+}
+
+// bytes that differ for every seed
+VOID FillConstants(BYTE* p, size_t size, uint64_t seed)
+{
+	RandomStream random(seed);
+
+	for (size_t i = 0; i < size; i += sizeof(uint64_t))
+	{
+		const uint64_t bits = random.Next();
+		CopyMemory(p + i, &bits, std::min(sizeof(uint64_t), size - i));
+	}
+}
+
+INT RunConstantRingBenchmark()
+{
+	const size_t RING_SIZE = 64 * 1024;
+	const unsigned int FRAME_COUNT = 10000;
+	const size_t ELEMENT_SIZES[] = { 16, sizeof(Data::MatrixBuffer), 64, 200, 256, 300, 1000 };
+	const size_t OBJECT_COUNT = 1024;
+	const unsigned int REPEAT_COUNT = 1000;
+	const char* CAPTURE_PATH = "constant-ring.capture";
+
+	enum { KIND_SHADER, KIND_LAYOUT, KIND_VERTEX_BUFFER, KIND_CONSTANT_BUFFER };
+
+	INT status = STATUS_SUCCESS;
+
+	// frames of random blocks of up to a quarter of the ring, which always fit next to the frames in flight
+	{
+		struct Frame
+		{
+			ConstantRing::Block block;
+			size_t              element_size;
+			uint64_t            seed;
+		};
+
+		ConstantRing ring;
+		FakeConstantBuffer buffer(RING_SIZE);
+		RandomStream random(1);
+		Frame frames[ConstantRing::MAX_FRAMES] = {};
+		std::vector<BYTE> elements;
+		std::vector<BYTE> expected;
+		size_t largest = 0;
+
+		status = ring.Initialize(RING_SIZE, ConstantRing::MAX_FRAMES);
+
+		for (unsigned int frame = 0; (frame < FRAME_COUNT) && SUCCEEDED(status); frame++)
+		{
+			Frame& current = frames[frame % ConstantRing::MAX_FRAMES];
+			current.element_size = ELEMENT_SIZES[random.Next() % ARRAYSIZE(ELEMENT_SIZES)];
+			current.seed = random.Next();
+
+			const size_t count = 1 + static_cast<size_t>(random.Next() % (RING_SIZE / 4 / ConstantRing::GetStride(current.element_size)));
+			largest = std::max(largest, count * ConstantRing::GetStride(current.element_size));
+
+			elements.resize(count * current.element_size);
+			FillConstants(elements.data(), elements.size(), current.seed);
+
+			ring.BeginFrame();
+			status = ring.Write(buffer, elements.data(), current.element_size, count, &current.block);
+
+			const ConstantRing::Block& block = current.block;
+
+			if (SUCCEEDED(status) && ((block.offset % ConstantRing::ALIGNMENT != 0) || (block.stride < current.element_size) ||
+				(block.offset + static_cast<size_t>(block.stride) * count > RING_SIZE) || (block.discard != (block.offset == 0)) ||
+				(ConstantRing::GetFirstConstant(block, count - 1) % 16 != 0) || (ConstantRing::GetConstantCount(block) % 16 != 0)))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: frame %u got %zu elements of %u bytes at %u, which d3d cannot bind\n", status, frame, count, block.stride, block.offset);
+			}
+
+			// every frame in flight still reads what it wrote
+			for (unsigned int age = 0; (age < ConstantRing::MAX_FRAMES) && (age <= frame) && SUCCEEDED(status); age++)
+			{
+				const Frame& written = frames[(frame - age) % ConstantRing::MAX_FRAMES];
+
+				expected.resize(written.block.count * written.element_size);
+				FillConstants(expected.data(), expected.size(), written.seed);
+
+				for (UINT i = 0; i < written.block.count; i++)
+				{
+					if (memcmp(buffer.GetData() + written.block.offset + i * written.block.stride, &expected[i * written.element_size], written.element_size) != 0)
+					{
+						status = STATUS_DATA_ERROR;
+						WriteToConsole("error 0x%X: frame %u wrote over the constants of frame %u\n", status, frame, frame - age);
+						break;
+					}
+				}
+			}
+		}
+
+		const ConstantRing::Statistics statistics = ring.GetStatistics();
+
+		if (SUCCEEDED(status) && ((statistics.discard_count < 2) || (buffer.GetMapCount() != FRAME_COUNT) || (buffer.GetDiscardCount() != statistics.discard_count)))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %llu maps and %llu discards for %u frames\n", status,
+				static_cast<unsigned long long>(buffer.GetMapCount()), static_cast<unsigned long long>(buffer.GetDiscardCount()), FRAME_COUNT);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%u frames of up to %zu bytes in a ring of %zu: one map each, %llu discards, at most %zu bytes in flight\n",
+				FRAME_COUNT, largest, RING_SIZE, static_cast<unsigned long long>(statistics.discard_count), statistics.high_water);
+		}
+	}
+
+	// blocks of 256 byte elements, a frame that reaches into a frame in flight fails and leaves the ring as it was
+	if (SUCCEEDED(status))
+	{
+		struct Step
+		{
+			bool   begin_frame;
+			size_t count;
+			INT    status;
+			UINT   offset;
+		};
+
+		const size_t SLICES = RING_SIZE / ConstantRing::ALIGNMENT;
+
+		const Step steps[] = {
+			{ true,  SLICES * 3 / 8, STATUS_SUCCESS,           0 },
+			{ true,  SLICES * 3 / 8, STATUS_SUCCESS,           RING_SIZE * 3 / 8 },
+			{ true,  SLICES * 3 / 8, STATUS_BUFFER_TOO_SMALL,  0 },                 // wraps into the first frame
+			{ false, SLICES / 4,     STATUS_SUCCESS,           RING_SIZE * 6 / 8 }, // the rest of the buffer
+			{ true,  SLICES * 3 / 8, STATUS_SUCCESS,           0 },                 // the first frame is done
+			{ false, 1,              STATUS_BUFFER_TOO_SMALL,  0 },                 // the ring is full
+			{ false, SLICES + 1,     STATUS_BUFFER_TOO_SMALL,  0 },
+			{ true,  SLICES * 3 / 8, STATUS_SUCCESS,           RING_SIZE * 3 / 8 }
+		};
+
+		ConstantRing ring;
+		status = ring.Initialize(RING_SIZE, ConstantRing::MAX_FRAMES);
+
+		for (size_t i = 0; (i < ARRAYSIZE(steps)) && SUCCEEDED(status); i++)
+		{
+			ConstantRing::Block block = {};
+
+			if (steps[i].begin_frame)
+			{
+				ring.BeginFrame();
+			}
+
+			const INT result = ring.Allocate(ConstantRing::ALIGNMENT, steps[i].count, &block);
+
+			if ((result != steps[i].status) || (SUCCEEDED(result) && (block.offset != steps[i].offset)))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: step %zu of the full ring returned 0x%X at %u, not 0x%X at %u\n", status, i, result, block.offset, steps[i].status, steps[i].offset);
+			}
+		}
+
+		ConstantRing::Block block;
+
+		if (SUCCEEDED(status) && (ring.Allocate(ConstantRing::MAX_ELEMENT_SIZE + 1, 1, &block) != STATUS_INVALID_PARAMETER))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the ring hands out elements larger than a shader can see\n", status);
+		}
+
+		// the ring of a device without constant buffer offsets
+		if (SUCCEEDED(status))
+		{
+			status = ring.Initialize(sizeof(Data::MatrixBuffer), 1);
+		}
+
+		for (unsigned int frame = 0; (frame < 10) && SUCCEEDED(status); frame++)
+		{
+			ring.BeginFrame();
+			status = ring.Allocate(sizeof(Data::MatrixBuffer), 1, &block);
+
+			if (SUCCEEDED(status) && ((ring.GetSize() != ConstantRing::ALIGNMENT) || (block.offset != 0) || !block.discard))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: a ring of one frame does not discard every frame\n", status);
+			}
+		}
+	}
+
+	// a draw for each object binding its own element of the frame's block, every one twice
+	if (SUCCEEDED(status))
+	{
+		ConstantRing ring;
+		ConstantRing::Block block = {};
+		std::vector<DrawQueue::Draw> draws(2 * OBJECT_COUNT);
+
+		status = ring.Initialize(RING_SIZE * 16, ConstantRing::MAX_FRAMES);
+
+		if (SUCCEEDED(status))
+		{
+			ring.BeginFrame();
+			status = ring.Allocate(sizeof(Data::MatrixBuffer), OBJECT_COUNT, &block);
+		}
+
+		for (size_t i = 0; i < draws.size(); i++)
+		{
+			DrawQueue::Draw& draw = draws[i];
+
+			draw = DrawQueue::Draw();
+			draw.pVertexShader = GetFakeObject<ID3D11VertexShader>(KIND_SHADER, 0);
+			draw.pPixelShader = GetFakeObject<ID3D11PixelShader>(KIND_SHADER, 1);
+			draw.pInputLayout = GetFakeObject<ID3D11InputLayout>(KIND_LAYOUT, 0);
+			draw.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			draw.pVertexBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, 0);
+			draw.strides[0] = VertexPacking::Layouts[VertexPacking::FORMAT_SNORM16].stride;
+			draw.vertex_buffer_count = 1;
+			draw.pIndexBuffer = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, 1);
+			draw.index_format = DXGI_FORMAT_R16_UINT;
+			draw.pConstantBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 0);
+			draw.pConstantBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 1);
+			draw.first_constants[0] = ConstantRing::GetFirstConstant(block, i / 2);
+			draw.constant_counts[0] = ConstantRing::GetConstantCount(block);
+			draw.constant_buffer_count = 2;
+			draw.index_count = 36;
+			draw.instance_count = 1;
+			draw.start_instance = static_cast<UINT>(i);
+		}
+
+		RecordingRenderContext direct;
+		RecordingRenderContext cached;
+		RecordingRenderContext replayed;
+		StateCache cache(&cached);
+		CommandBuffer commands;
+		DrawQueue queue;
+
+		for (const DrawQueue::Draw& draw : draws)
+		{
+			queue.Add(draw);
+			queue.Submit(direct);
+
+			queue.Add(draw);
+			queue.Submit(cache);
+
+			queue.Add(draw);
+			queue.Submit(commands);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = commands.Replay(replayed);
+		}
+
+		if (SUCCEEDED(status) && ((direct.GetEvents() != cached.GetEvents()) || (direct.GetEvents() != replayed.GetEvents())))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the state cache or the command buffer changes the constant ranges the draws see\n", status);
+		}
+
+		// the second draw of an object finds its range bound
+		if (SUCCEEDED(status) && (cached.GetBindCount(RenderContext::BIND_CONSTANT_BUFFERS) != OBJECT_COUNT))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %llu constant buffer binds through the state cache for %zu ranges\n", status,
+				static_cast<unsigned long long>(cached.GetBindCount(RenderContext::BIND_CONSTANT_BUFFERS)), OBJECT_COUNT);
+		}
+
+		std::vector<uint64_t> objects;
+		CommandBuffer loaded;
+
+		if (SUCCEEDED(status))
+		{
+			status = commands.Save(CAPTURE_PATH, &objects);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = loaded.Load(CAPTURE_PATH);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = loaded.Bind(objects);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			RecordingRenderContext bound;
+			status = loaded.Replay(bound);
+
+			if (SUCCEEDED(status) && (bound.GetEvents() != direct.GetEvents()))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the capture does not replay the constant ranges it was saved with\n", status);
+			}
+		}
+
+		remove(CAPTURE_PATH);
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%zu draws of %zu objects: %llu constant buffer binds, %llu through the state cache, %zu bytes of commands\n",
+				draws.size(), OBJECT_COUNT, static_cast<unsigned long long>(direct.GetBindCount(RenderContext::BIND_CONSTANT_BUFFERS)),
+				static_cast<unsigned long long>(cached.GetBindCount(RenderContext::BIND_CONSTANT_BUFFERS)), commands.GetSize());
+		}
+	}
+
+	// the transforms of many objects written in one block against a map of a constant buffer of each object
+	if (SUCCEEDED(status))
+	{
+		ConstantRing ring;
+		FakeConstantBuffer ring_buffer(RING_SIZE * 16);
+		std::vector<std::unique_ptr<FakeConstantBuffer>> object_buffers(OBJECT_COUNT);
+		std::vector<Data::MatrixBuffer> objects(OBJECT_COUNT);
+		double ring_seconds = 0.0;
+		double object_seconds = 0.0;
+
+		FillConstants(reinterpret_cast<BYTE*>(objects.data()), objects.size() * sizeof(Data::MatrixBuffer), 2);
+
+		for (std::unique_ptr<FakeConstantBuffer>& pBuffer : object_buffers)
+		{
+			pBuffer.reset(new FakeConstantBuffer(ConstantRing::ALIGNMENT));
+		}
+
+		status = ring.Initialize(RING_SIZE * 16, ConstantRing::MAX_FRAMES);
+
+		if (SUCCEEDED(status))
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned int repeat = 0; (repeat < REPEAT_COUNT) && SUCCEEDED(status); repeat++)
+			{
+				ConstantRing::Block block;
+
+				ring.BeginFrame();
+				status = ring.Write(ring_buffer, objects.data(), sizeof(Data::MatrixBuffer), objects.size(), &block);
+			}
+
+			ring_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			for (unsigned int repeat = 0; (repeat < REPEAT_COUNT) && SUCCEEDED(status); repeat++)
+			{
+				for (size_t i = 0; (i < OBJECT_COUNT) && SUCCEEDED(status); i++)
+				{
+					BYTE* pData = NULL;
+					status = object_buffers[i]->Map(true, &pData);
+
+					if (SUCCEEDED(status))
+					{
+						CopyMemory(pData, &objects[i], sizeof(objects[i]));
+						object_buffers[i]->Unmap();
+					}
+				}
+			}
+
+			object_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		if (SUCCEEDED(status))
+		{
+			const double count = static_cast<double>(OBJECT_COUNT) * REPEAT_COUNT;
+
+			WriteToConsole("%zu objects of %zu bytes per frame: %.2f ns per object in one block with 1 map, %.2f ns with %zu maps of fake buffers\n",
+				OBJECT_COUNT, sizeof(Data::MatrixBuffer), ring_seconds * 1e9 / count, object_seconds * 1e9 / count, OBJECT_COUNT);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,145 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "Simulation.h"
+
+INT RunCullingBenchmark(JobSystem& jobs)
+{
+	const unsigned int GRID = 100;
+	const unsigned int VIEW_COUNT = 16;
+	const unsigned int REPEAT_COUNT = 10;
+
+	INT status = STATUS_SUCCESS;
+
+	// a million instances, stepped once so that they face random directions
+	Simulation simulation;
+	simulation.Initialize(GRID, jobs);
+	simulation.Step(std::chrono::steady_clock::now());
+
+	const SimulationState& state = simulation.Acquire();
+	const size_t count = simulation.GetInstanceCount();
+
+	Culling::Bounds bounds;
+	Culling::ComputeBounds(Data::Vertices, ARRAYSIZE(Data::Vertices), bounds);
+
+	std::vector<uint32_t> visible(count);
+	std::vector<uint32_t> reference(count);
+
+	RandomStream random(1);
+
+	double seconds[2] = {};
+	size_t visible_total = 0;
+
+	for (unsigned int view = 0; (view < VIEW_COUNT) && SUCCEEDED(status); view++)
+	{
+		// the even views are the orthographic scene matrix, the odd ones a perspective camera two units in front of it
+		float rotation[4];
+		float m[16];
+		const float angle = 2.0f * static_cast<float>(M_PI);
+		Quaternion::FromEuler(random.NextFloat() * angle, random.NextFloat() * angle, random.NextFloat() * angle, rotation);
+		Quaternion::ToMatrix(rotation, m);
+
+		if ((view % 2) == 1)
+		{
+			const float z_near = 0.1f;
+			const float z_far = 10.0f;
+			const float scale = 1.0f / tanf(0.25f * static_cast<float>(M_PI) * (0.5f + random.NextFloat()));
+
+			float projection[16] = {};
+			projection[0]  = scale;
+			projection[5]  = scale;
+			projection[10] = z_far / (z_far - z_near);
+			projection[11] = -z_near * z_far / (z_far - z_near);
+			projection[14] = 1.0f;
+
+			float camera[16];
+			Matrix::Copy(camera, m);
+			camera[11] += 0.5f + 2.0f * random.NextFloat();
+
+			Matrix::Multiply(camera, projection, m);
+		}
+
+		Culling::Frustum frustum;
+		Culling::ExtractFrustum(m, frustum);
+
+		size_t reference_count = 0;
+		size_t visible_count = 0;
+
+		for (unsigned int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			reference_count = Culling::CullScalar(frustum, state.spheres.data(), count, reference.data());
+			seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			start = std::chrono::steady_clock::now();
+			visible_count = Culling::Cull(frustum, state.spheres.data(), count, visible.data());
+			seconds[1] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		visible_total += visible_count;
+
+		if ((visible_count != reference_count) || (memcmp(visible.data(), reference.data(), visible_count * sizeof(uint32_t)) != 0))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: view %u, %zu visible instances instead of %zu or a different list\n", status, view, visible_count, reference_count);
+		}
+
+		// every culled instance has to lie completely outside of one plane, checked on the corners of its box
+		size_t next = 0;
+
+		for (size_t i = 0; (i < count) && SUCCEEDED(status); i++)
+		{
+			if ((next < reference_count) && (reference[next] == i))
+			{
+				next++;
+				continue;
+			}
+
+			const float* transform = &state.transforms[i * Data::INSTANCE_SIZE];
+			bool outside = false;
+
+			for (unsigned int p = 0; (p < Culling::PLANE_COUNT) && !outside; p++)
+			{
+				const float* plane = frustum.planes[p];
+				float d_max = -FLT_MAX;
+
+				for (unsigned int corner = 0; corner < 8; corner++)
+				{
+					float local[3];
+					float world[3];
+
+					for (unsigned int k = 0; k < 3; k++)
+					{
+						local[k] = ((corner >> k) & 1) ? bounds.aabb_max[k] : bounds.aabb_min[k];
+					}
+
+					for (unsigned int r = 0; r < 3; r++)
+					{
+						world[r] = transform[r * 4] * local[0] + transform[r * 4 + 1] * local[1] + transform[r * 4 + 2] * local[2] + transform[r * 4 + 3];
+					}
+
+					d_max = std::max(d_max, plane[0] * world[0] + plane[1] * world[1] + plane[2] * world[2] + plane[3]);
+				}
+
+				outside = (d_max <= 1e-5f);
+			}
+
+			if (!outside)
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: view %u culls instance %zu, which is not outside of the frustum\n", status, view, i);
+			}
+		}
+	}
+
+	const double tests = static_cast<double>(count) * VIEW_COUNT * REPEAT_COUNT;
+
+	WriteToConsole("culling %zu instances, %.1f%% visible: %.2f ns scalar, %.2f ns simd, %.2fx\n",
+		count, 100.0 * visible_total / (static_cast<double>(count) * VIEW_COUNT), seconds[0] * 1e9 / tests, seconds[1] * 1e9 / tests, seconds[0] / seconds[1]);
+
+	return status;
+}
@@ -0,0 +1,293 @@
+#include "Tests.h"
+#include "Log.h"
+#include "HeapCounter.h"
+#include "Matrix.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "Simulation.h"
+
+struct FrameArenaJob
+{
+	FrameArena*             pArena;
+	uint32_t**              ppItems;  // the block of every item
+	const Culling::Frustum* pFrustum;
+	const float*            pSpheres;
+	std::atomic<size_t>     visible;
+};
+
+// every item takes a block from the arena of the thread that runs it and fills it with its index
+VOID FrameArenaItemsJob(VOID* pData, size_t begin, size_t end)
+{
+	FrameArenaJob* pJob = static_cast<FrameArenaJob*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		const size_t count = (i % 7 + 1) * 8;
+		uint32_t* pItem = pJob->pArena->Allocate<uint32_t>(count);
+
+		for (size_t k = 0; (pItem != NULL) && (k < count); k++)
+		{
+			pItem[k] = static_cast<uint32_t>(i);
+		}
+
+		pJob->ppItems[i] = pItem;
+	}
+}
+
+// culls the instances [begin, end) into a list of their own, begin is a multiple of the batch width
+VOID FrameArenaCullJob(VOID* pData, size_t begin, size_t end)
+{
+	FrameArenaJob* pJob = static_cast<FrameArenaJob*>(pData);
+
+	uint32_t* pVisible = pJob->pArena->Allocate<uint32_t>(end - begin);
+
+	if (pVisible != NULL)
+	{
+		const float* pSpheres = pJob->pSpheres + (begin / Matrix::BATCH_WIDTH) * Culling::BATCH_BLOCK_SIZE;
+		pJob->visible.fetch_add(Culling::Cull(*pJob->pFrustum, pSpheres, end - begin, pVisible), std::memory_order_relaxed);
+	}
+}
+
+INT RunFrameArenaBenchmark(JobSystem& jobs)
+{
+	const unsigned int ALLOCATION_COUNT = 100;
+	const unsigned int SETTLE_FRAMES = 16;
+	const size_t ITEM_COUNT = 4096;
+	const size_t CULL_GRAIN = 4096;
+	const unsigned int STEADY_FRAMES = 256;
+	const unsigned int MAX_FRAMES = 4096;
+	const size_t BENCHMARK_COUNT = 1 << 20;
+
+	INT status = STATUS_SUCCESS;
+
+	// one thread allocating the same pattern every frame, tagged with the frame so that overlaps show up
+	{
+		FrameArena arena;
+		arena.Initialize(4096, jobs);
+
+		std::vector<BYTE*> blocks[FrameArena::FRAME_COUNT];
+		size_t overflows = 0;
+
+		for (unsigned int frame = 0; (frame < SETTLE_FRAMES) && SUCCEEDED(status); frame++)
+		{
+			arena.BeginFrame();
+
+			blocks[frame % FrameArena::FRAME_COUNT].clear();
+
+			for (unsigned int i = 0; i < ALLOCATION_COUNT; i++)
+			{
+				const size_t size = (i * 37) % 3000 + 1;
+				const size_t alignment = static_cast<size_t>(8) << (i % 6);
+				BYTE* pBlock = static_cast<BYTE*>(arena.Allocate(size, alignment));
+
+				if ((pBlock == NULL) || (reinterpret_cast<uintptr_t>(pBlock) % alignment != 0))
+				{
+					status = STATUS_DATA_ERROR;
+					WriteToConsole("error 0x%X: frame %u, allocation %u is missing or not aligned to %zu\n", status, frame, i, alignment);
+					break;
+				}
+
+				memset(pBlock, static_cast<BYTE>(frame * 31 + i), size);
+				blocks[frame % FrameArena::FRAME_COUNT].push_back(pBlock);
+			}
+
+			// the blocks of this frame and the ones before it that are still in flight
+			for (unsigned int age = 0; (age < std::min(frame + 1, static_cast<unsigned int>(FrameArena::FRAME_COUNT))) && SUCCEEDED(status); age++)
+			{
+				const std::vector<BYTE*>& frame_blocks = blocks[(frame - age) % FrameArena::FRAME_COUNT];
+
+				for (unsigned int i = 0; (i < frame_blocks.size()) && SUCCEEDED(status); i++)
+				{
+					const size_t size = (i * 37) % 3000 + 1;
+					const BYTE tag = static_cast<BYTE>((frame - age) * 31 + i);
+
+					for (size_t k = 0; k < size; k++)
+					{
+						if (frame_blocks[i][k] != tag)
+						{
+							status = STATUS_DATA_ERROR;
+							WriteToConsole("error 0x%X: allocation %u of frame %u was overwritten by frame %u\n", status, i, frame - age, frame);
+							break;
+						}
+					}
+				}
+			}
+
+			if (frame + 2 * FrameArena::FRAME_COUNT == SETTLE_FRAMES)
+			{
+				overflows = arena.GetStatistics().overflow_count;
+			}
+		}
+
+		const FrameArena::Statistics statistics = arena.GetStatistics();
+
+		if (SUCCEEDED(status) && ((statistics.overflow_count == 0) || (statistics.overflow_count != overflows)))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %zu overflows in total and %zu in the last frames, expected some and then none\n",
+				status, statistics.overflow_count, statistics.overflow_count - overflows);
+		}
+
+		WriteToConsole("single thread: %u frames, %zu overflows (%zu bytes) while growing to %zu bytes, high water %zu bytes\n",
+			SETTLE_FRAMES, statistics.overflow_count, statistics.overflow_bytes, statistics.capacity, statistics.high_water);
+	}
+
+	// the workers of the job system, every item has to keep its own contents
+	if (SUCCEEDED(status))
+	{
+		FrameArena arena;
+		arena.Initialize(0, jobs);
+
+		std::vector<uint32_t*> items(ITEM_COUNT);
+
+		FrameArenaJob job;
+		job.pArena = &arena;
+		job.ppItems = items.data();
+
+		for (unsigned int frame = 0; (frame < SETTLE_FRAMES) && SUCCEEDED(status); frame++)
+		{
+			arena.BeginFrame();
+			jobs.ParallelFor("Items", FrameArenaItemsJob, &job, ITEM_COUNT, 64);
+
+			for (size_t i = 0; (i < ITEM_COUNT) && SUCCEEDED(status); i++)
+			{
+				const size_t count = (i % 7 + 1) * 8;
+
+				for (size_t k = 0; k < count; k++)
+				{
+					if ((items[i] == NULL) || (items[i][k] != i))
+					{
+						status = STATUS_DATA_ERROR;
+						WriteToConsole("error 0x%X: frame %u, item %zu was overwritten by another one\n", status, frame, i);
+						break;
+					}
+				}
+			}
+		}
+
+		const FrameArena::Statistics statistics = arena.GetStatistics();
+
+		WriteToConsole("%u threads: %zu items per frame, %zu overflows while growing to %zu bytes\n",
+			jobs.GetThreadCount(), ITEM_COUNT, statistics.overflow_count, statistics.capacity);
+	}
+
+	// the hot path, which has to settle into frames that do not allocate
+	if (SUCCEEDED(status))
+	{
+		Simulation simulation;
+		simulation.Initialize(INSTANCE_GRID, jobs);
+
+		const size_t count = simulation.GetInstanceCount();
+
+		FrameArena arena;
+		arena.Initialize(count * (sizeof(uint32_t) + sizeof(float) * Data::INSTANCE_SIZE) + 2 * FrameArena::DEFAULT_ALIGNMENT, jobs);
+
+		FrameArenaJob job;
+		job.pArena = &arena;
+
+		unsigned int frame = 0;
+		unsigned int steady = 0;
+
+		for (frame = 0; (frame < MAX_FRAMES) && (steady < STEADY_FRAMES) && SUCCEEDED(status); frame++)
+		{
+			const size_t allocations = HeapCounter::GetAllocationCount();
+
+			arena.BeginFrame();
+			simulation.Step(std::chrono::steady_clock::now());
+
+			const SimulationState& state = simulation.Acquire();
+
+			Culling::Frustum frustum;
+			Culling::ExtractFrustum(state.matrices.model_matrix, frustum);
+
+			uint32_t* pVisible = arena.Allocate<uint32_t>(count);
+			const size_t visible_count = (pVisible != NULL) ? Culling::Cull(frustum, state.spheres.data(), count, pVisible) : 0;
+			float* pTransforms = arena.Allocate<float>(visible_count * Data::INSTANCE_SIZE);
+
+			if ((pVisible != NULL) && (pTransforms != NULL))
+			{
+				Culling::Gather(pVisible, visible_count, state.transforms.data(), pTransforms);
+			}
+
+			job.pFrustum = &frustum;
+			job.pSpheres = state.spheres.data();
+			job.visible = 0;
+			jobs.ParallelFor("Cull", FrameArenaCullJob, &job, count, CULL_GRAIN);
+
+			steady = (HeapCounter::GetAllocationCount() == allocations) ? steady + 1 : 0;
+
+			if ((pVisible == NULL) || (pTransforms == NULL) || (job.visible != visible_count))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: frame %u, the parallel cull found %zu visible instances instead of %zu\n", status, frame, job.visible.load(), visible_count);
+			}
+		}
+
+		const FrameArena::Statistics statistics = arena.GetStatistics();
+
+		if (SUCCEEDED(status) && (steady < STEADY_FRAMES))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the frames still allocate after %u of them\n", status, frame);
+		}
+
+		WriteToConsole("frame loop: settled after %u frames, then %u frames without heap allocations, %zu overflows, %zu arena bytes, high water %zu bytes\n",
+			frame - steady, steady, statistics.overflow_count, statistics.capacity, statistics.high_water);
+	}
+
+	// small blocks, the arena against new and delete
+	if (SUCCEEDED(status))
+	{
+		FrameArena arena;
+		arena.Initialize(BENCHMARK_COUNT * 64, jobs);
+
+		std::vector<BYTE*> blocks(BENCHMARK_COUNT);
+		double arena_seconds = 0.0;
+		double heap_seconds = 0.0;
+
+		// the first round faults in the memory of both
+		for (unsigned int round = 0; round < 2; round++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned int frame = 0; frame < FrameArena::FRAME_COUNT; frame++)
+			{
+				arena.BeginFrame();
+
+				for (size_t i = 0; i < BENCHMARK_COUNT; i++)
+				{
+					blocks[i] = static_cast<BYTE*>(arena.Allocate(48));
+					blocks[i][0] = static_cast<BYTE>(i);
+				}
+			}
+
+			arena_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			for (unsigned int frame = 0; frame < FrameArena::FRAME_COUNT; frame++)
+			{
+				for (size_t i = 0; i < BENCHMARK_COUNT; i++)
+				{
+					blocks[i] = new BYTE[48];
+					blocks[i][0] = static_cast<BYTE>(i);
+				}
+
+				for (size_t i = 0; i < BENCHMARK_COUNT; i++)
+				{
+					delete[] blocks[i];
+				}
+			}
+
+			heap_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		arena_seconds /= FrameArena::FRAME_COUNT;
+		heap_seconds /= FrameArena::FRAME_COUNT;
+
+		WriteToConsole("%zu allocations of 48 bytes: %.2f ns arena, %.2f ns new and delete, %.1fx\n",
+			BENCHMARK_COUNT, arena_seconds * 1e9 / BENCHMARK_COUNT, heap_seconds * 1e9 / BENCHMARK_COUNT, heap_seconds / arena_seconds);
+	}
+
+	return status;
+}
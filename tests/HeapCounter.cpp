@@ -0,0 +1,96 @@
+#include "HeapCounter.h"
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#define HEAP_COUNTER_CRT_HOOK
+#endif
+
+namespace HeapCounter
+{
+	std::atomic<size_t> g_Allocations(0);
+
+	size_t GetAllocationCount()
+	{
+		return g_Allocations.load(std::memory_order_relaxed);
+	}
+
+#if defined(HEAP_COUNTER_CRT_HOOK)
+	INT AllocHook(INT type, VOID*, size_t, INT, long, const unsigned char*, INT)
+	{
+		if ((type == _HOOK_ALLOC) || (type == _HOOK_REALLOC))
+		{
+			g_Allocations.fetch_add(1, std::memory_order_relaxed);
+		}
+
+		return TRUE;
+	}
+
+	// installed before main, so that every allocation of the tests is seen
+	struct HookRegistration
+	{
+		HookRegistration()
+		{
+			_CrtSetAllocHook(AllocHook);
+		}
+	};
+
+	HookRegistration g_Hook;
+#else
+	VOID* Allocate(size_t size)
+	{
+		g_Allocations.fetch_add(1, std::memory_order_relaxed);
+
+		return std::malloc((size != 0) ? size : 1);
+	}
+#endif
+}
+
+#if !defined(HEAP_COUNTER_CRT_HOOK)
+VOID* operator new(size_t size)
+{
+	VOID* p = HeapCounter::Allocate(size);
+
+	if (p == NULL)
+	{
+		throw std::bad_alloc();
+	}
+
+	return p;
+}
+
+VOID* operator new[](size_t size)
+{
+	return operator new(size);
+}
+
+VOID* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return HeapCounter::Allocate(size);
+}
+
+VOID* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return HeapCounter::Allocate(size);
+}
+
+VOID operator delete(VOID* p) noexcept
+{
+	std::free(p);
+}
+
+VOID operator delete[](VOID* p) noexcept
+{
+	std::free(p);
+}
+
+// c++14 compilers call the sized forms when the size is known, they must free what the replaced new allocated
+VOID operator delete(VOID* p, size_t) noexcept
+{
+	operator delete(p);
+}
+
+VOID operator delete[](VOID* p, size_t) noexcept
+{
+	operator delete[](p);
+}
+#endif
@@ -0,0 +1,14 @@
+#pragma once
+
+#include "Common.h"
+
+/*
+* counts heap allocations, so that a frame can be checked for touching the heap. only the test project links this, as
+* it replaces the global operator new. with the msvc debug crt the count comes from its allocation hook and covers
+* malloc, _aligned_malloc and everything the crt allocates as well as new. elsewhere only new and new[] are counted.
+* HeapAlloc and VirtualAlloc bypass both.
+*/
+namespace HeapCounter
+{
+	size_t GetAllocationCount();
+}
@@ -0,0 +1,138 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "InstanceUploader.h"
+#include "Simulation.h"
+
+INT RunInstanceUploadBenchmark(JobSystem& jobs)
+{
+	const unsigned int FRAME_COUNT = 400;
+	const unsigned int INTERPOLATION_STEPS = 4;
+	const float MAX_BLEND_ERROR = 1e-6f;
+
+	INT status = STATUS_SUCCESS;
+
+	Simulation simulation;
+	simulation.Initialize(INSTANCE_GRID, jobs);
+
+	const size_t count = simulation.GetInstanceCount();
+	const size_t stride = sizeof(float) * Data::INSTANCE_SIZE;
+
+	Culling::Bounds bounds;
+	Culling::ComputeBounds(Data::Vertices, ARRAYSIZE(Data::Vertices), bounds);
+
+	FrameArena arena;
+	arena.Initialize(count * (sizeof(uint32_t) + stride) + 2 * FrameArena::DEFAULT_ALIGNMENT, jobs);
+
+	RecordingInstanceUploader recorder;
+	InstanceUploader& uploader = recorder;
+
+	size_t visible_total = 0;
+	double seconds = 0.0;
+
+	// the frames of Renderer::Update and Render: cull at the interpolated scene rotation, blend the visible transforms
+	// between the last two ticks and upload them
+	for (unsigned int frame = 0; (frame < FRAME_COUNT) && SUCCEEDED(status); frame++)
+	{
+		simulation.Step(std::chrono::steady_clock::now());
+
+		const SimulationState& state = simulation.Acquire();
+		const float interpolation = static_cast<float>(frame % (INTERPOLATION_STEPS + 1)) / INTERPOLATION_STEPS;
+
+		const uint64_t uploads_before = recorder.GetUploadCount();
+		const uint64_t bytes_before = recorder.GetByteCount();
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		arena.BeginFrame();
+
+		float rotation[4];
+		Data::MatrixBuffer matrices;
+		Quaternion::Interpolate(state.previous_rotation, state.rotation, interpolation, rotation);
+		Quaternion::ToMatrix(rotation, matrices.model_matrix);
+
+		Culling::Frustum frustum;
+		Culling::ExtractFrustum(matrices.model_matrix, frustum);
+
+		uint32_t* pVisible = arena.Allocate<uint32_t>(count);
+		const size_t visible_count = (pVisible != NULL) ? Culling::Cull(frustum, state.spheres.data(), count, pVisible) : 0;
+		float* pTransforms = arena.Allocate<float>(visible_count * Data::INSTANCE_SIZE);
+
+		if ((pVisible == NULL) || (pTransforms == NULL))
+		{
+			status = STATUS_NO_MEMORY;
+			WriteToConsole("error 0x%X: frame %u, out of memory for the visible instances\n", status, frame);
+			break;
+		}
+
+		Culling::Gather(pVisible, visible_count, state.previous_transforms.data(), state.transforms.data(), interpolation, pTransforms);
+		status = uploader.Upload(pTransforms, visible_count * stride);
+
+		seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		visible_total += visible_count;
+
+		// one upload of exactly the visible instances
+		const std::vector<BYTE>& upload = recorder.GetLastUpload();
+
+		if (SUCCEEDED(status) && ((recorder.GetUploadCount() != uploads_before + 1) || (recorder.GetByteCount() - bytes_before != visible_count * stride) || (upload.size() != visible_count * stride)))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: frame %u, %llu bytes uploaded for %zu visible instances of %zu bytes\n",
+				status, frame, static_cast<unsigned long long>(recorder.GetByteCount() - bytes_before), visible_count, stride);
+		}
+
+		// every instance of the upload has to be the blend of its transforms in the two ticks, and at the end of the
+		// tick its transform has to carry the center of the mesh to the center of the sphere the simulation culled
+		for (size_t k = 0; SUCCEEDED(status) && (k < visible_count); k++)
+		{
+			const uint32_t i = pVisible[k];
+			const float* previous = &state.previous_transforms[i * Data::INSTANCE_SIZE];
+			const float* current = &state.transforms[i * Data::INSTANCE_SIZE];
+
+			float uploaded[Data::INSTANCE_SIZE];
+			CopyMemory(uploaded, &upload[k * stride], stride);
+
+			float blend_error = 0.0f;
+			for (unsigned int e = 0; e < Data::INSTANCE_SIZE; e++)
+			{
+				blend_error = std::max(blend_error, fabsf(uploaded[e] - (previous[e] + (current[e] - previous[e]) * interpolation)));
+			}
+
+			float center_error = 0.0f;
+			if (interpolation == 1.0f)
+			{
+				const float* sphere = &state.spheres[(i / Matrix::BATCH_WIDTH) * Culling::BATCH_BLOCK_SIZE + (i % Matrix::BATCH_WIDTH)];
+
+				for (unsigned int r = 0; r < 3; r++)
+				{
+					const float* row = &uploaded[r * 4];
+					const float center = row[0] * bounds.center[0] + row[1] * bounds.center[1] + row[2] * bounds.center[2] + row[3];
+
+					center_error = std::max(center_error, fabsf(center - sphere[r * Matrix::BATCH_WIDTH]));
+				}
+			}
+
+			if ((blend_error > MAX_BLEND_ERROR) || (center_error > MAX_BLEND_ERROR))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: frame %u, the upload of instance %u is off its transforms by %g and its sphere by %g\n",
+					status, frame, i, blend_error, center_error);
+			}
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("instance upload: %zu instances, %zu visible and %zu bytes uploaded per frame, %zu bytes per instance instead of %zu\n",
+			count, visible_total / FRAME_COUNT, visible_total / FRAME_COUNT * stride, stride, sizeof(Matrix::Mat4));
+		WriteToConsole("cull, gather and upload: %.3f ms per frame, %.2f GB/s of instance stream\n",
+			seconds * 1e3 / FRAME_COUNT, visible_total * stride / seconds * 1e-9);
+	}
+
+	return status;
+}
@@ -0,0 +1,132 @@
+#include "Tests.h"
+#include "Log.h"
+#include "JobSystem.h"
+#include "Simulation.h"
+
+struct OutsideThreadJob
+{
+	JobSystem*           pJobs;
+	std::atomic<size_t>* pSum;
+};
+
+VOID AddIndicesJob(VOID* pData, size_t begin, size_t end)
+{
+	std::atomic<size_t>* pSum = static_cast<std::atomic<size_t>*>(pData);
+
+	for (size_t i = begin; i < end; i++)
+	{
+		pSum->fetch_add(i, std::memory_order_relaxed);
+	}
+}
+
+VOID OutsideThread(OutsideThreadJob* pJob)
+{
+	pJob->pJobs->ParallelFor("Outside", AddIndicesJob, pJob->pSum, 1000, 10);
+}
+
+/*
+* threads outside the pool take one of the spare slots and have to give it back when they exit. runs many more such
+* threads than there are spare slots, one after another and EXTRA_THREADS at a time, which aborts if a slot leaks.
+*/
+INT RunOutsideThreadTest()
+{
+	const unsigned int ROUNDS = 16;
+
+	INT status = STATUS_SUCCESS;
+
+	JobSystem jobs;
+	std::atomic<size_t> sum(0);
+	OutsideThreadJob job = { &jobs, &sum };
+	unsigned int runs = 0;
+
+	status = jobs.Initialize(2);
+
+	for (unsigned int round = 0; SUCCEEDED(status) && (round < ROUNDS); round++)
+	{
+		std::thread single(OutsideThread, &job);
+		single.join();
+		runs++;
+
+		std::thread threads[JobSystem::EXTRA_THREADS];
+
+		for (unsigned int t = 0; t < JobSystem::EXTRA_THREADS; t++)
+		{
+			threads[t] = std::thread(OutsideThread, &job);
+		}
+
+		for (unsigned int t = 0; t < JobSystem::EXTRA_THREADS; t++)
+		{
+			threads[t].join();
+			runs++;
+		}
+	}
+
+	if (SUCCEEDED(status) && (sum.load() != runs * (999 * 1000 / 2)))
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: the jobs of the outside threads added up to %zu\n", status, sum.load());
+	}
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("%u threads outside the pool ran their jobs through %u spare slots\n", runs, JobSystem::EXTRA_THREADS);
+	}
+
+	jobs.Uninitialize();
+
+	return status;
+}
+
+INT RunJobBenchmark()
+{
+	const unsigned int TICK_COUNT = 200;
+
+	INT status = RunOutsideThreadTest();
+
+	std::vector<float> reference;
+	double reference_seconds = 0.0;
+
+	for (unsigned int threads = 1; (threads <= JobSystem::MAX_THREADS) && SUCCEEDED(status); threads *= 2)
+	{
+		JobSystem jobs;
+		Simulation simulation;
+
+		status = jobs.Initialize(threads);
+
+		if (SUCCEEDED(status))
+		{
+			simulation.Initialize(INSTANCE_GRID, jobs);
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (unsigned int tick = 0; tick < TICK_COUNT; tick++)
+			{
+				simulation.Step(start);
+			}
+
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const SimulationState& state = simulation.Acquire();
+
+			if (threads == 1)
+			{
+				reference = state.transforms;
+				reference_seconds = seconds;
+			}
+
+			const bool deterministic = (memcmp(reference.data(), state.transforms.data(), reference.size() * sizeof(float)) == 0);
+
+			WriteToConsole("%2u threads: %.3f ms per tick, %.2fx, %s\n",
+				threads, seconds * 1e3 / TICK_COUNT, reference_seconds / seconds, deterministic ? "deterministic" : "differs from 1 thread");
+
+			if (!deterministic)
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the simulation depends on the thread count\n", status);
+			}
+		}
+
+		jobs.Uninitialize();
+	}
+
+	return status;
+}
@@ -0,0 +1,237 @@
+#include "Tests.h"
+#include "Log.h"
+
+struct LoggerBenchmarkJob
+{
+	unsigned int thread;
+	unsigned int burst_count;
+	unsigned int burst_size;
+	unsigned int flood_size;
+	unsigned int record;        // the next record number of the thread
+	double       burst_seconds;
+	double       flood_seconds;
+};
+
+/*
+* writes bursts that fit into the ring of the thread and waits for the log thread after each, then writes without
+* pause so that the ring fills up. only the Write calls are timed.
+*/
+VOID LoggerBenchmarkThread(LoggerBenchmarkJob* pJob)
+{
+	const CHAR* name = "benchmark";
+
+	for (unsigned int burst = 0; burst < pJob->burst_count; burst++)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < pJob->burst_size; i++, pJob->record++)
+		{
+			Log::Write("thread %u record %u: %.3f ms on %s\n", pJob->thread, pJob->record, pJob->record * 0.25, name);
+		}
+
+		pJob->burst_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		Log::Flush();
+	}
+
+	const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	for (unsigned int i = 0; i < pJob->flood_size; i++, pJob->record++)
+	{
+		Log::Write("thread %u record %u: %.3f ms on %s\n", pJob->thread, pJob->record, pJob->record * 0.25, name);
+	}
+
+	pJob->flood_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+INT RunLoggerBenchmark()
+{
+	const unsigned int MAX_THREADS = 8;
+	const unsigned int BURST_COUNT = 100;
+	const unsigned int BURST_SIZE = 256;     // about a quarter of a ring
+	const unsigned int FLOOD_SIZE = 100000;
+	const unsigned int SYNCHRONOUS_COUNT = 100000;
+	const CHAR* LOG_PATH = "benchmark.log";
+
+	INT status = STATUS_SUCCESS;
+
+	LoggerBenchmarkJob jobs[MAX_THREADS] = {};
+	double synchronous_seconds = 0.0;
+	double burst_seconds[MAX_THREADS + 1] = {};
+	double flood_seconds[MAX_THREADS + 1] = {};
+	uint64_t flood_dropped[MAX_THREADS + 1] = {};
+	uint64_t dropped = 0;
+
+	// the lines of the benchmark go to the file, its results to the console once the file is closed
+	Log::Stop();
+
+	FILE* file = OpenFileStream(LOG_PATH, "wb");
+	if (file == NULL)
+	{
+		status = GetErrnoStatus();
+		WriteToConsole("error 0x%X: could not create %s\n", status, LOG_PATH);
+	}
+
+	// what every call cost before: formatting and writing on the calling thread, unbuffered like the log file
+	if (SUCCEEDED(status))
+	{
+		setvbuf(file, NULL, _IONBF, 0);
+
+		const CHAR* name = "benchmark";
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (unsigned int i = 0; i < SYNCHRONOUS_COUNT; i++)
+		{
+			CHAR buffer[Log::BUFFER_SIZE];
+			const INT length = std::snprintf(buffer, sizeof(buffer), "thread %u record %u: %.3f ms on %s\n", 0u, i, i * 0.25, name);
+
+			fwrite(buffer, 1, Log::GetLength(length, sizeof(buffer)), file);
+		}
+
+		synchronous_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		fclose(file);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = Log::Start(LOG_PATH);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		const uint64_t dropped_before = Log::GetDroppedCount();
+
+		for (unsigned int threads = 1; threads <= MAX_THREADS; threads *= 2)
+		{
+			std::thread workers[MAX_THREADS];
+
+			for (unsigned int t = 0; t < threads; t++)
+			{
+				jobs[t].thread = t;
+				jobs[t].burst_count = BURST_COUNT;
+				jobs[t].burst_size = BURST_SIZE;
+				jobs[t].flood_size = FLOOD_SIZE;
+				jobs[t].burst_seconds = 0.0;
+				jobs[t].flood_seconds = 0.0;
+			}
+
+			const uint64_t dropped_start = Log::GetDroppedCount();
+
+			for (unsigned int t = 0; t < threads; t++)
+			{
+				workers[t] = std::thread(LoggerBenchmarkThread, &jobs[t]);
+			}
+
+			for (unsigned int t = 0; t < threads; t++)
+			{
+				workers[t].join();
+				burst_seconds[threads] += jobs[t].burst_seconds;
+				flood_seconds[threads] += jobs[t].flood_seconds;
+			}
+
+			Log::Flush();
+			flood_dropped[threads] = Log::GetDroppedCount() - dropped_start;
+		}
+
+		dropped = Log::GetDroppedCount() - dropped_before;
+
+		Log::Stop();
+	}
+
+	// Start created the file again, so it holds the records of every thread with increasing numbers
+	if (SUCCEEDED(status))
+	{
+		std::vector<CHAR> contents;
+
+		file = OpenFileStream(LOG_PATH, "rb");
+		if (file == NULL)
+		{
+			status = GetErrnoStatus();
+			WriteToConsole("error 0x%X: could not open %s\n", status, LOG_PATH);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			fseek(file, 0, SEEK_END);
+			contents.resize(static_cast<size_t>(std::max(ftell(file), 0L)) + 1);
+			fseek(file, 0, SEEK_SET);
+
+			const size_t read = fread(contents.data(), 1, contents.size() - 1, file);
+			contents[read] = 0;
+
+			fclose(file);
+		}
+
+		uint64_t records = 0;
+		uint64_t reported = 0;
+		uint64_t reordered = 0;
+		int64_t next[MAX_THREADS] = {};
+
+		for (CHAR* line = contents.data(); SUCCEEDED(status) && (*line != 0); )
+		{
+			unsigned int thread = 0;
+			unsigned int record = 0;
+			unsigned long long count = 0;
+
+			// sscanf would measure the rest of the file on every call
+			CHAR* end = strchr(line, '\n');
+			if (end != NULL)
+			{
+				*end = 0;
+			}
+
+			if ((std::sscanf(line, "thread %u record %u:", &thread, &record) == 2) && (thread < MAX_THREADS))
+			{
+				reordered += (record < next[thread]) ? 1 : 0;
+				next[thread] = static_cast<int64_t>(record) + 1;
+				records++;
+			}
+			else if (std::sscanf(line, "log: %llu records dropped", &count) == 1)
+			{
+				reported += count;
+			}
+			else
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: %s holds a line that was not written\n", status, LOG_PATH);
+			}
+
+			line = (end != NULL) ? end + 1 : line + strlen(line);
+		}
+
+		uint64_t written = 0;
+
+		for (unsigned int t = 0; t < MAX_THREADS; t++)
+		{
+			written += jobs[t].record;
+		}
+
+		if (SUCCEEDED(status) && ((records + dropped != written) || (reported != dropped) || (reordered != 0)))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %llu of %llu records logged, %llu dropped, %llu reported dropped, %llu out of order\n", status,
+				static_cast<unsigned long long>(records), static_cast<unsigned long long>(written), static_cast<unsigned long long>(dropped),
+				static_cast<unsigned long long>(reported), static_cast<unsigned long long>(reordered));
+		}
+	}
+
+	remove(LOG_PATH);
+
+	Log::Start(NULL);
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("synchronous snprintf and fwrite: %.1f ns per call\n", synchronous_seconds * 1e9 / SYNCHRONOUS_COUNT);
+
+		for (unsigned int threads = 1; threads <= MAX_THREADS; threads *= 2)
+		{
+			WriteToConsole("%u threads: %.1f ns per call in bursts, %.1f ns per call flooding the rings, %llu of %u flooded records dropped\n", threads,
+				burst_seconds[threads] * 1e9 / (static_cast<double>(BURST_COUNT) * BURST_SIZE * threads), flood_seconds[threads] * 1e9 / (static_cast<double>(FLOOD_SIZE) * threads),
+				static_cast<unsigned long long>(flood_dropped[threads]), FLOOD_SIZE * threads);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,370 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Data.h"
+
+// the fma kernel rounds once per multiply-add instead of twice, so it is allowed to drift from the scalar result
+const unsigned int MAX_ULP_ERROR = 4;
+
+// the object counts the products are timed on, from inside the caches to far out of them, where the products stop
+// being bound by the kernels and start being bound by memory bandwidth
+const size_t SWEEP_COUNTS[] = { 1000, 10000, 100000, 1000000 };
+const size_t SWEEP_MATRICES = 2000000; // per run, every count is repeated until it has about as many products
+const unsigned int SWEEP_RUN_COUNT = 3;
+
+// times product(count) and returns the best of SWEEP_RUN_COUNT runs in ns per matrix
+template <typename Product>
+double TimeMatrixSweep(size_t count, const Product& product)
+{
+	const size_t repeat_count = std::max<size_t>(SWEEP_MATRICES / count, 1);
+	double best = DBL_MAX;
+
+	for (unsigned int run = 0; run < SWEEP_RUN_COUNT; run++)
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (size_t repeat = 0; repeat < repeat_count; repeat++)
+		{
+			product(count);
+		}
+
+		best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	return best * 1e9 / (count * repeat_count);
+}
+
+// compares a kernel set against the scalar reference on a fixed set of random matrices, returns what failed or NULL
+const char* ValidateKernels(const Matrix::Kernels& kernels)
+{
+	std::default_random_engine generator(0x5EED);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	for (unsigned int i = 0; i < 256; i++)
+	{
+		float m0[16], m1[16], expected[16], result[16];
+		for (unsigned int j = 0; j < 16; j++)
+		{
+			m0[j] = distribution(generator);
+			m1[j] = distribution(generator);
+		}
+
+		Matrix::Scalar::Multiply(m0, m1, expected);
+		kernels.Multiply(m0, m1, result);
+
+		for (unsigned int c = 0; c < 4; c++)
+		{
+			for (unsigned int r = 0; r < 4; r++)
+			{
+				// the error of a dot product is bounded relative to the sum of its absolute terms, not to the (possibly cancelled) result
+				float magnitude = 0.0f;
+				for (unsigned int k = 0; k < 4; k++)
+				{
+					magnitude += std::fabs(m0[k * 4 + r] * m1[c * 4 + k]);
+				}
+
+				if (std::fabs(expected[c * 4 + r] - result[c * 4 + r]) > MAX_ULP_ERROR * FLT_EPSILON * magnitude)
+				{
+					return "Multiply is off the scalar product";
+				}
+			}
+		}
+
+		// the batch kernel must agree with the single matrix kernel of the same set
+		float b0[Matrix::BATCH_BLOCK_SIZE] = {}, b1[Matrix::BATCH_BLOCK_SIZE] = {}, b2[Matrix::BATCH_BLOCK_SIZE] = {};
+		Matrix::StoreBatch(b0, i % Matrix::BATCH_WIDTH, m0);
+		Matrix::StoreBatch(b1, i % Matrix::BATCH_WIDTH, m1);
+		kernels.MultiplyBatch(b0, b1, b2, Matrix::BATCH_WIDTH);
+		Matrix::LoadBatch(b2, i % Matrix::BATCH_WIDTH, expected);
+		if (memcmp(result, expected, sizeof(result)) != 0)
+		{
+			return "MultiplyBatch differs from Multiply";
+		}
+
+		kernels.Copy(result, m0);
+		if (memcmp(result, m0, sizeof(m0)) != 0)
+		{
+			return "Copy does not copy";
+		}
+
+		// and so must the affine kernels once the last rows are 0 0 0 1, compared with == since a dropped term
+		// of +0 can turn a -0 into a +0
+		const float last_row[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+		CopyMemory(m0 + 12, last_row, sizeof(last_row));
+		CopyMemory(m1 + 12, last_row, sizeof(last_row));
+
+		kernels.Multiply(m0, m1, expected);
+		kernels.MultiplyAffine(m0, m1, result);
+
+		for (unsigned int e = 0; e < 12; e++)
+		{
+			if (result[e] != expected[e])
+			{
+				return "MultiplyAffine differs from Multiply";
+			}
+		}
+
+		Matrix::StoreBatch(b0, i % Matrix::BATCH_WIDTH, m0);
+		Matrix::StoreBatch(b1, i % Matrix::BATCH_WIDTH, m1);
+		kernels.MultiplyBatch(b0, b1, b2, Matrix::BATCH_WIDTH);
+		Matrix::LoadBatch(b2, i % Matrix::BATCH_WIDTH, expected);
+		kernels.MultiplyAffineBatch(b0, b1, b2, Matrix::BATCH_WIDTH);
+		Matrix::LoadBatch(b2, i % Matrix::BATCH_WIDTH, result);
+
+		for (unsigned int e = 0; e < 16; e++)
+		{
+			if (result[e] != expected[e])
+			{
+				return "MultiplyAffineBatch differs from MultiplyBatch";
+			}
+		}
+	}
+
+	float identity[16], result[16];
+	Matrix::Scalar::ToIdentity(identity);
+	kernels.ToIdentity(result);
+	if (memcmp(result, identity, sizeof(identity)) != 0)
+	{
+		return "ToIdentity is not the identity";
+	}
+
+	return NULL;
+}
+
+INT RunMatrixBenchmark()
+{
+	const size_t COUNT = SWEEP_COUNTS[ARRAYSIZE(SWEEP_COUNTS) - 1];
+	const size_t BYTES_PER_MATRIX = 3 * sizeof(Matrix::Mat4); // two read, one written
+
+	INT status = STATUS_SUCCESS;
+
+	std::default_random_engine generator(0x5EED);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	std::vector<float> m0(COUNT * 16), m1(COUNT * 16), m2(COUNT * 16);
+	std::vector<float> b0(Matrix::GetBatchSize(COUNT)), b1(Matrix::GetBatchSize(COUNT)), b2(Matrix::GetBatchSize(COUNT));
+
+	for (size_t i = 0; i < COUNT * 16; i++)
+	{
+		m0[i] = distribution(generator);
+		m1[i] = distribution(generator);
+	}
+
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		Matrix::StoreBatch(b0.data(), i, &m0[i * 16]);
+		Matrix::StoreBatch(b1.data(), i, &m1[i * 16]);
+	}
+
+	const Matrix::Kernels* kernels[Matrix::MAX_KERNEL_SETS];
+	const size_t kernel_count = Matrix::GetSupportedKernels(kernels);
+
+	double scalar[ARRAYSIZE(SWEEP_COUNTS)][2] = {};
+
+	for (size_t k = 0; k < kernel_count; k++)
+	{
+		const char* failure = ValidateKernels(*kernels[k]);
+
+		if (failure != NULL)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s kernels: %s, within %u ulp\n", status, kernels[k]->name, failure, MAX_ULP_ERROR);
+		}
+
+		for (size_t c = 0; c < ARRAYSIZE(SWEEP_COUNTS); c++)
+		{
+			double ns[2];
+
+			ns[0] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+				{
+					kernels[k]->Multiply(&m0[i * 16], &m1[i * 16], &m2[i * 16]);
+				}
+			});
+
+			ns[1] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				kernels[k]->MultiplyBatch(b0.data(), b1.data(), b2.data(), n);
+			});
+
+			for (unsigned int i = 0; i < 2; i++)
+			{
+				scalar[c][i] = (k == 0) ? ns[i] : scalar[c][i];
+			}
+
+			WriteToConsole("%-8s %7zu matrices: Multiply %6.2f ns %5.1f GB/s, %5.2fx the scalar kernel, MultiplyBatch %6.2f ns %5.1f GB/s per matrix, %5.2fx\n",
+				kernels[k]->name, SWEEP_COUNTS[c], ns[0], BYTES_PER_MATRIX / ns[0], scalar[c][0] / ns[0], ns[1], BYTES_PER_MATRIX / ns[1], scalar[c][1] / ns[1]);
+		}
+	}
+
+	WriteToConsole("%zu kernel sets checked within %u ulp of the scalar product, Initialize picks %s\n", kernel_count, MAX_ULP_ERROR, Matrix::GetKernelName());
+
+	return status;
+}
+
+INT RunAffineBenchmark()
+{
+	const size_t COUNT = 4096;
+	const size_t BATCH_COUNT = 1024;
+	const size_t SWEEP_COUNT = SWEEP_COUNTS[ARRAYSIZE(SWEEP_COUNTS) - 1];
+
+	// bytes read and written per product: full matrices read two and write one, Affine3x4 read and write 12 floats,
+	// and the affine batch kernel reads 12 floats of each batch and writes all 16
+	const size_t BYTES_PER_MATRIX[4] = { 3 * sizeof(Matrix::Mat4), 3 * sizeof(Matrix::Affine3x4), 3 * sizeof(Matrix::Mat4), 2 * sizeof(Matrix::Affine3x4) + sizeof(Matrix::Mat4) };
+
+	INT status = STATUS_SUCCESS;
+
+	std::default_random_engine generator(0x5EED);
+	std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+
+	std::vector<Matrix::Affine3x4> affine(COUNT);
+	std::vector<Matrix::Mat4> full(COUNT);
+
+	// rotations with a translation, so that the chains below neither vanish nor overflow
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		float rotation[4];
+		Quaternion::FromEuler(distribution(generator) * 3.0f, distribution(generator) * 3.0f, distribution(generator) * 3.0f, rotation);
+		Quaternion::ToMatrix(rotation, affine[i]);
+
+		affine[i].m[3] = distribution(generator);
+		affine[i].m[7] = distribution(generator);
+		affine[i].m[11] = distribution(generator);
+
+		Matrix::Expand(affine[i], full[i]);
+	}
+
+	// compared with == since a dropped term of +0 can turn a -0 into a +0
+	size_t mismatches = 0;
+
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		const size_t j = (i + 1) % COUNT;
+
+		Matrix::Mat4 expected;
+		Matrix::Multiply(full[i].m, full[j].m, expected.m);
+
+		Matrix::Mat4 expected_scalar;
+		Matrix::Scalar::Multiply(full[i].m, full[j].m, expected_scalar.m);
+
+		Matrix::Affine3x4 product;
+		Matrix::Multiply(affine[i], affine[j], product);
+
+		Matrix::Affine3x4 left = affine[i];
+		Matrix::Multiply(left, affine[j], left);
+
+		Matrix::Affine3x4 right = affine[j];
+		Matrix::Multiply(affine[i], right, right);
+
+		Matrix::Mat4 mixed;
+		Matrix::Multiply(full[i], affine[j], mixed);
+
+		for (unsigned int e = 0; e < 16; e++)
+		{
+			const bool affine_row = e < 12;
+
+			if ((affine_row && ((product.m[e] != expected.m[e]) || (left.m[e] != expected.m[e]) || (right.m[e] != expected.m[e]))) ||
+				(mixed.m[e] != expected_scalar.m[e]) || (!affine_row && (expected.m[e] != ((e == 15) ? 1.0f : 0.0f))))
+			{
+				mismatches++;
+				break;
+			}
+		}
+	}
+
+	if (mismatches != 0)
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: %zu of %zu affine products differ from the full product\n", status, mismatches, COUNT);
+	}
+
+	// rotations and placements like the instance store's, through the kernels picked for this cpu
+	std::vector<float> rotations(Matrix::GetBatchSize(BATCH_COUNT));
+	std::vector<float> placements(Matrix::GetBatchSize(BATCH_COUNT));
+	std::vector<float> expected(Matrix::GetBatchSize(BATCH_COUNT));
+	std::vector<float> world(Matrix::GetBatchSize(BATCH_COUNT));
+
+	if (SUCCEEDED(status))
+	{
+		for (size_t i = 0; i < BATCH_COUNT; i++)
+		{
+			Matrix::StoreBatch(rotations.data(), i, full[i % COUNT].m);
+			Matrix::StoreBatch(placements.data(), i, full[(i * 7 + 3) % COUNT].m);
+		}
+
+		Matrix::MultiplyBatch(rotations.data(), placements.data(), expected.data(), BATCH_COUNT);
+		Matrix::MultiplyAffineBatch(rotations.data(), placements.data(), world.data(), BATCH_COUNT);
+
+		for (size_t i = 0; i < world.size(); i++)
+		{
+			if (world[i] != expected[i])
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the %s affine batch kernel differs from the full one at %zu\n", status, Matrix::GetKernelName(), i);
+				break;
+			}
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		// the checked matrices repeated up to the largest count
+		std::vector<Matrix::Mat4> full_left(SWEEP_COUNT), full_right(SWEEP_COUNT), full_products(SWEEP_COUNT);
+		std::vector<Matrix::Affine3x4> affine_left(SWEEP_COUNT), affine_right(SWEEP_COUNT), affine_products(SWEEP_COUNT);
+		std::vector<float> batch_left(Matrix::GetBatchSize(SWEEP_COUNT)), batch_right(Matrix::GetBatchSize(SWEEP_COUNT)), batch_products(Matrix::GetBatchSize(SWEEP_COUNT));
+
+		for (size_t i = 0; i < SWEEP_COUNT; i++)
+		{
+			full_left[i] = full[i % COUNT];
+			full_right[i] = full[(i * 7 + 3) % COUNT];
+			affine_left[i] = affine[i % COUNT];
+			affine_right[i] = affine[(i * 7 + 3) % COUNT];
+
+			Matrix::StoreBatch(batch_left.data(), i, full_left[i].m);
+			Matrix::StoreBatch(batch_right.data(), i, full_right[i].m);
+		}
+
+		WriteToConsole("%s kernels, %zu affine products checked\n", Matrix::GetKernelName(), COUNT);
+
+		for (size_t c = 0; c < ARRAYSIZE(SWEEP_COUNTS); c++)
+		{
+			double ns[4];
+
+			ns[0] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+				{
+					Matrix::Multiply(full_left[i].m, full_right[i].m, full_products[i].m);
+				}
+			});
+
+			ns[1] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				for (size_t i = 0; i < n; i++)
+				{
+					Matrix::Multiply(affine_left[i], affine_right[i], affine_products[i]);
+				}
+			});
+
+			ns[2] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				Matrix::MultiplyBatch(batch_left.data(), batch_right.data(), batch_products.data(), n);
+			});
+
+			ns[3] = TimeMatrixSweep(SWEEP_COUNTS[c], [&](size_t n)
+			{
+				Matrix::MultiplyAffineBatch(batch_left.data(), batch_right.data(), batch_products.data(), n);
+			});
+
+			WriteToConsole("%7zu matrices, single product: %6.2f ns %5.1f GB/s full, %6.2f ns %5.1f GB/s affine, batch: %6.2f ns %5.1f GB/s full, %6.2f ns %5.1f GB/s affine per matrix\n",
+				SWEEP_COUNTS[c], ns[0], BYTES_PER_MATRIX[0] / ns[0], ns[1], BYTES_PER_MATRIX[1] / ns[1], ns[2], BYTES_PER_MATRIX[2] / ns[2], ns[3], BYTES_PER_MATRIX[3] / ns[3]);
+		}
+
+		WriteToConsole("model matrix upload: %zu bytes, %zu as a full matrix\n", sizeof(Data::MatrixBuffer), sizeof(Matrix::Mat4));
+		WriteToConsole("instance stream: %zu bytes per instance, %zu as a full matrix\n", sizeof(float) * Data::INSTANCE_SIZE, sizeof(Matrix::Mat4));
+	}
+
+	return status;
+}
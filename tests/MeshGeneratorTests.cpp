@@ -0,0 +1,217 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "Mesh.h"
+#include "VertexPacking.h"
+#include "MeshPack.h"
+#include "JobSystem.h"
+#include "MeshGenerator.h"
+
+// the triangles of a mesh that face inward, and the ones without an area, against the direction out of the surface
+VOID CountWinding(const MeshGenerator::Desc& desc, const std::vector<Data::Vertex>& vertices, const std::vector<uint32_t>& indices, uint64_t* pInward, uint64_t* pDegenerate)
+{
+	const bool ground = (desc.shape == MeshGenerator::SHAPE_GRID) || (desc.shape == MeshGenerator::SHAPE_TERRAIN);
+
+	*pInward = 0;
+	*pDegenerate = 0;
+
+	for (size_t t = 0; t + 2 < indices.size(); t += 3)
+	{
+		const float* a = vertices[indices[t + 0]].position;
+		const float* b = vertices[indices[t + 1]].position;
+		const float* c = vertices[indices[t + 2]].position;
+
+		double ab[3], ac[3], out[3];
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			ab[k] = static_cast<double>(b[k]) - a[k];
+			ac[k] = static_cast<double>(c[k]) - a[k];
+
+			// the closed shapes are convex around the origin
+			out[k] = ground ? ((k == 1) ? 1.0 : 0.0) : (static_cast<double>(a[k]) + b[k] + c[k]);
+		}
+
+		const double cross[3] = { ab[1] * ac[2] - ab[2] * ac[1], ab[2] * ac[0] - ab[0] * ac[2], ab[0] * ac[1] - ab[1] * ac[0] };
+		const double facing = cross[0] * out[0] + cross[1] * out[1] + cross[2] * out[2];
+
+		*pInward += (facing < 0.0) ? 1 : 0;
+		*pDegenerate += (facing == 0.0) ? 1 : 0;
+	}
+}
+
+INT RunMeshGeneratorBenchmark(uint64_t triangles, JobSystem& jobs)
+{
+	const char* PATH = "benchmark.mesh";
+	const float EXTENT_TOLERANCE = 1.0e-6f; // sin and cos are not exact
+
+	INT status = STATUS_SUCCESS;
+
+	JobSystem serial;
+	status = serial.Initialize(1);
+
+	for (unsigned int shape = 0; (shape < MeshGenerator::SHAPE_COUNT) && SUCCEEDED(status); shape++)
+	{
+		MeshGenerator::Desc desc = { static_cast<MeshGenerator::Shape>(shape), MeshGenerator::GetDetail(static_cast<MeshGenerator::Shape>(shape), triangles), 1 };
+
+		status = MeshGenerator::Check(desc);
+
+		const size_t vertex_count = SUCCEEDED(status) ? static_cast<size_t>(MeshGenerator::GetVertexCount(desc)) : 0;
+		const size_t index_count = SUCCEEDED(status) ? static_cast<size_t>(MeshGenerator::GetIndexCount(desc)) : 0;
+
+		std::vector<Data::Vertex> vertices(vertex_count);
+		std::vector<uint32_t> indices(index_count);
+		std::vector<Data::Vertex> serial_vertices(vertex_count);
+		std::vector<uint32_t> serial_indices(index_count);
+
+		double seconds[2] = {};
+
+		// the first round faults in the memory
+		for (unsigned int round = 0; (round < 2) && SUCCEEDED(status); round++)
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			MeshGenerator::GenerateVertices(desc, 0, vertex_count, vertices.data(), jobs);
+			MeshGenerator::GenerateIndices(desc, 0, index_count, indices.data(), jobs);
+
+			seconds[0] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			start = std::chrono::steady_clock::now();
+
+			MeshGenerator::GenerateVertices(desc, 0, vertex_count, serial_vertices.data(), serial);
+			MeshGenerator::GenerateIndices(desc, 0, index_count, serial_indices.data(), serial);
+
+			seconds[1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		if (SUCCEEDED(status) && ((memcmp(vertices.data(), serial_vertices.data(), vertex_count * sizeof(Data::Vertex)) != 0) ||
+			(memcmp(indices.data(), serial_indices.data(), index_count * sizeof(uint32_t)) != 0)))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the %s differs between %u threads and one\n", status, MeshGenerator::ShapeNames[shape], jobs.GetThreadCount());
+		}
+
+		if (SUCCEEDED(status))
+		{
+			Data::Vertex extent[2];
+			MeshGenerator::GetExtent(desc, extent);
+
+			size_t outside = 0;
+			size_t out_of_range = 0;
+
+			for (const Data::Vertex& vertex : vertices)
+			{
+				for (unsigned int k = 0; k < 3; k++)
+				{
+					outside += ((vertex.position[k] < extent[0].position[k] - EXTENT_TOLERANCE) || (vertex.position[k] > extent[1].position[k] + EXTENT_TOLERANCE)) ? 1 : 0;
+				}
+			}
+
+			// the rows that GetIndices steps through have to agree with GetIndex
+			for (size_t k = 0; k < index_count; k++)
+			{
+				out_of_range += ((indices[k] >= vertex_count) || (indices[k] != MeshGenerator::GetIndex(desc, k))) ? 1 : 0;
+			}
+
+			uint64_t inward = 0;
+			uint64_t degenerate = 0;
+			CountWinding(desc, vertices, indices, &inward, &degenerate);
+
+			// the first triangle of every quad at the north pole and the second at the south pole
+			const uint64_t poles = (desc.shape == MeshGenerator::SHAPE_UV_SPHERE) ? 4 * static_cast<uint64_t>(desc.detail) : 0;
+
+			if ((outside != 0) || (out_of_range != 0) || (inward != 0) || (degenerate != poles))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the %s has %zu coordinates outside of its extent, %zu indices out of range or unlike GetIndex, %llu triangles facing in and %llu degenerate\n",
+					status, MeshGenerator::ShapeNames[shape], outside, out_of_range, static_cast<unsigned long long>(inward), static_cast<unsigned long long>(degenerate));
+			}
+		}
+
+		if (SUCCEEDED(status))
+		{
+			const double triangle_count = static_cast<double>(MeshGenerator::GetTriangleCount(desc));
+			const double bytes = static_cast<double>(vertex_count) * sizeof(Data::Vertex) + static_cast<double>(index_count) * sizeof(uint32_t);
+
+			WriteToConsole("%-9s detail %5u: %10.0f triangles, %9zu vertices, %7.1f Mtri/s on %u threads (%5.2f GB/s), %7.1f Mtri/s on one\n",
+				MeshGenerator::ShapeNames[shape], desc.detail, triangle_count, vertex_count, triangle_count * 1e-6 / seconds[0], jobs.GetThreadCount(),
+				bytes / seconds[0] / (1 << 30), triangle_count * 1e-6 / seconds[1]);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		MeshGenerator::Desc desc = { MeshGenerator::SHAPE_TERRAIN, 64, 1 };
+
+		std::vector<Data::Vertex> seeds[2];
+
+		for (unsigned int seed = 0; seed < 2; seed++)
+		{
+			desc.seed = seed + 1;
+			seeds[seed].resize(static_cast<size_t>(MeshGenerator::GetVertexCount(desc)));
+			MeshGenerator::GenerateVertices(desc, 0, seeds[seed].size(), seeds[seed].data(), jobs);
+		}
+
+		if (memcmp(seeds[0].data(), seeds[1].data(), seeds[0].size() * sizeof(Data::Vertex)) == 0)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the seed does not change the terrain\n", status);
+		}
+	}
+
+	// through a pack, in blocks
+	if (SUCCEEDED(status))
+	{
+		const VertexPacking::Format format = VertexPacking::FORMAT_SNORM16;
+		const MeshGenerator::Desc desc = { MeshGenerator::SHAPE_TERRAIN, MeshGenerator::GetDetail(MeshGenerator::SHAPE_TERRAIN, triangles), 1 };
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		status = MeshGenerator::WritePack(PATH, desc, format, jobs);
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		MeshPack pack;
+		Mesh::IndexedMesh mesh;
+
+		if (SUCCEEDED(status))
+		{
+			status = pack.Open(PATH);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = pack.Unpack(mesh);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			std::vector<Data::Vertex> vertices(mesh.vertices.size());
+			std::vector<uint32_t> indices(mesh.indices.size());
+
+			MeshGenerator::GenerateVertices(desc, 0, vertices.size(), vertices.data(), jobs);
+			MeshGenerator::GenerateIndices(desc, 0, indices.size(), indices.data(), jobs);
+
+			float position_error, color_error, position_bound, color_bound;
+			VertexPacking::MeasureError(vertices.data(), mesh.vertices.data(), vertices.size(), &position_error, &color_error);
+			VertexPacking::GetErrorBound(format, vertices.data(), vertices.size(), pack.GetHeader().dequantization, &position_bound, &color_bound);
+
+			if ((vertices.size() != MeshGenerator::GetVertexCount(desc)) || (indices != mesh.indices) || (position_error > position_bound) || (color_error > color_bound))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the pack of the terrain does not hold the terrain\n", status);
+			}
+			else
+			{
+				WriteToConsole("%s: %llu triangles in %s written in %.2f s, %.1f Mtri/s, %.1f MB/s\n", PATH, static_cast<unsigned long long>(MeshGenerator::GetTriangleCount(desc)),
+					VertexPacking::Layouts[format].name, seconds, MeshGenerator::GetTriangleCount(desc) * 1e-6 / seconds, pack.GetHeader().file_size / seconds / (1 << 20));
+			}
+		}
+
+		pack.Close();
+		remove(PATH);
+	}
+
+	serial.Uninitialize();
+
+	return status;
+}
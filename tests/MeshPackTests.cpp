@@ -0,0 +1,295 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "VertexPacking.h"
+#include "Culling.h"
+#include "MeshPack.h"
+#include "Simulation.h"
+
+#if !defined(_WIN32)
+#include <sys/resource.h>
+#endif
+
+// the page faults of the process and its resident memory
+struct MemoryCounters
+{
+	uint64_t page_faults;
+	uint64_t working_set;
+};
+
+VOID ReadMemoryCounters(MemoryCounters& counters)
+{
+#if defined(_WIN32)
+	PROCESS_MEMORY_COUNTERS process = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &process, sizeof(process));
+
+	counters.page_faults = process.PageFaultCount;
+	counters.working_set = process.WorkingSetSize;
+#else
+	rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+
+	unsigned long long pages = 0;
+	unsigned long long resident = 0;
+
+	FILE* pFile = OpenFileStream("/proc/self/statm", "r");
+	if (pFile != NULL)
+	{
+		if (fscanf(pFile, "%llu %llu", &pages, &resident) != 2)
+		{
+			resident = 0;
+		}
+
+		fclose(pFile);
+	}
+
+	counters.page_faults = static_cast<uint64_t>(usage.ru_minflt) + static_cast<uint64_t>(usage.ru_majflt);
+	counters.working_set = resident * static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+// the grid vertex i of the benchmark mesh, rows of MESH_PACK_ROW_LENGTH vertices
+VOID GetBenchmarkVertex(uint64_t i, uint64_t rows, Data::Vertex& vertex)
+{
+	const uint64_t MESH_PACK_ROW_LENGTH = 4096;
+
+	const float u = static_cast<float>(i % MESH_PACK_ROW_LENGTH) / (MESH_PACK_ROW_LENGTH - 1);
+	const float v = static_cast<float>(i / MESH_PACK_ROW_LENGTH) / static_cast<float>(std::max<uint64_t>(rows - 1, 1));
+
+	vertex.position[0] = u - 0.5f;
+	vertex.position[1] = 0.0f;
+	vertex.position[2] = v - 0.5f;
+	vertex.color[0] = u;
+	vertex.color[1] = v;
+	vertex.color[2] = 0.5f;
+}
+
+// the index k of the triangles over the grid, two per cell
+uint32_t GetBenchmarkIndex(uint64_t k)
+{
+	const uint64_t MESH_PACK_ROW_LENGTH = 4096;
+	const uint64_t corners[6][2] = { { 0, 0 }, { 1, 0 }, { 0, 1 }, { 0, 1 }, { 1, 0 }, { 1, 1 } };
+
+	const uint64_t cell = k / 6;
+	const uint64_t row = cell / (MESH_PACK_ROW_LENGTH - 1);
+	const uint64_t column = cell % (MESH_PACK_ROW_LENGTH - 1);
+
+	return static_cast<uint32_t>((row + corners[k % 6][0]) * MESH_PACK_ROW_LENGTH + column + corners[k % 6][1]);
+}
+
+INT RunMeshPackBenchmark(unsigned int gigabytes)
+{
+	const char* PATH = "benchmark.mesh";
+	const uint64_t MESH_PACK_ROW_LENGTH = 4096;
+	const size_t CHUNK_VERTICES = 1 << 20;
+	const uint64_t SPARSE_STRIDE = 64 << 20;
+	const unsigned int SAMPLE_COUNT = 1000;
+
+	INT status = STATUS_SUCCESS;
+
+	const VertexPacking::Format format = VertexPacking::FORMAT_SNORM16;
+	const uint64_t size = static_cast<uint64_t>(gigabytes) << 30;
+
+	// three quarters vertices, one quarter 32 bit indices
+	MeshPack::Header header = {};
+	header.magic = MeshPack::PACK_MAGIC;
+	header.version = MeshPack::PACK_VERSION;
+	header.stream_count = MeshPack::STREAM_COUNT;
+	header.vertex_count = std::min<uint64_t>(size / 4 * 3 / VertexPacking::Layouts[format].stride, 0xFFFFFFFF) / MESH_PACK_ROW_LENGTH * MESH_PACK_ROW_LENGTH;
+
+	const uint64_t rows = header.vertex_count / MESH_PACK_ROW_LENGTH;
+	header.index_count = std::min<uint64_t>(size / 4 / sizeof(uint32_t), (rows - 1) * (MESH_PACK_ROW_LENGTH - 1) * 6) / 6 * 6;
+
+	Data::Vertex corners[2];
+	GetBenchmarkVertex(0, rows, corners[0]);
+	GetBenchmarkVertex(header.vertex_count - 1, rows, corners[1]);
+	VertexPacking::ComputeDequantization(format, corners, 2, header.dequantization);
+	Culling::ComputeBounds(corners, 2, header.bounds);
+
+	header.streams[MeshPack::STREAM_VERTICES].size = header.vertex_count * VertexPacking::Layouts[format].stride;
+	header.streams[MeshPack::STREAM_VERTICES].stride = VertexPacking::Layouts[format].stride;
+	header.streams[MeshPack::STREAM_VERTICES].format = format;
+	header.streams[MeshPack::STREAM_INDICES].size = header.index_count * sizeof(uint32_t);
+	header.streams[MeshPack::STREAM_INDICES].stride = sizeof(uint32_t);
+	header.streams[MeshPack::STREAM_INDICES].format = DXGI_FORMAT_R32_UINT;
+
+	MeshPackWriter writer;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	status = writer.Begin(PATH, header);
+
+	{
+		std::vector<Data::Vertex> vertices(CHUNK_VERTICES);
+		std::vector<BYTE> packed;
+
+		for (uint64_t first = 0; (first < header.vertex_count) && SUCCEEDED(status); first += CHUNK_VERTICES)
+		{
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(CHUNK_VERTICES, header.vertex_count - first));
+
+			for (size_t i = 0; i < count; i++)
+			{
+				GetBenchmarkVertex(first + i, rows, vertices[i]);
+			}
+
+			VertexPacking::Pack(format, vertices.data(), count, header.dequantization, packed);
+			status = writer.Write(packed.data(), packed.size());
+		}
+
+		std::vector<uint32_t> indices(CHUNK_VERTICES);
+
+		for (uint64_t first = 0; (first < header.index_count) && SUCCEEDED(status); first += CHUNK_VERTICES)
+		{
+			const size_t count = static_cast<size_t>(std::min<uint64_t>(CHUNK_VERTICES, header.index_count - first));
+
+			for (size_t i = 0; i < count; i++)
+			{
+				indices[i] = GetBenchmarkIndex(first + i);
+			}
+
+			status = writer.Write(indices.data(), count * sizeof(uint32_t));
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = writer.End();
+	}
+	else
+	{
+		writer.Abort();
+	}
+
+	if (SUCCEEDED(status))
+	{
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		MeshPack::Layout(header);
+
+		WriteToConsole("wrote %s: %llu vertices, %llu indices, %.2f GB in %.2f s\n", PATH, static_cast<unsigned long long>(header.vertex_count),
+			static_cast<unsigned long long>(header.index_count), header.file_size / static_cast<double>(1 << 30), seconds);
+	}
+
+	MeshPack pack;
+	MemoryCounters counters[4] = {};
+	double seconds[4] = {};
+	uint64_t touched[4] = {};
+	uint64_t checksum = 0;
+
+	if (SUCCEEDED(status))
+	{
+		ReadMemoryCounters(counters[0]);
+
+		start = std::chrono::steady_clock::now();
+		status = pack.Open(PATH);
+		seconds[1] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		ReadMemoryCounters(counters[1]);
+		touched[1] = sizeof(MeshPack::Header);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		const BYTE* pVertices = static_cast<const BYTE*>(pack.GetStream(MeshPack::STREAM_VERTICES));
+		const uint64_t stream_size = pack.GetHeader().streams[MeshPack::STREAM_VERTICES].size;
+
+		start = std::chrono::steady_clock::now();
+
+		for (uint64_t offset = 0; offset < stream_size; offset += SPARSE_STRIDE)
+		{
+			checksum += pVertices[offset];
+			touched[2] += 4096;
+		}
+
+		seconds[2] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ReadMemoryCounters(counters[2]);
+
+		start = std::chrono::steady_clock::now();
+
+		for (unsigned int s = 0; s < MeshPack::STREAM_COUNT; s++)
+		{
+			const BYTE* pStream = static_cast<const BYTE*>(pack.GetStream(s));
+
+			for (uint64_t offset = 0; offset < pack.GetHeader().streams[s].size; offset += 4096)
+			{
+				checksum += pStream[offset];
+			}
+
+			touched[3] += pack.GetHeader().streams[s].size;
+		}
+
+		seconds[3] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		ReadMemoryCounters(counters[3]);
+
+		const char* names[4] = { NULL, "open", "sparse touch", "touch every page" };
+
+		for (unsigned int i = 1; i < 4; i++)
+		{
+			WriteToConsole("%-16s %10.3f ms, %8.1f MB touched, %8llu page faults, working set %+9.1f MB\n",
+				names[i], seconds[i] * 1e3, touched[i] / 1048576.0, static_cast<unsigned long long>(counters[i].page_faults - counters[i - 1].page_faults),
+				(static_cast<double>(counters[i].working_set) - static_cast<double>(counters[i - 1].working_set)) / 1048576.0);
+		}
+
+		// the mapped data has to be what was written
+		RandomStream random(gigabytes);
+		std::vector<BYTE> expected;
+
+		for (unsigned int i = 0; (i < SAMPLE_COUNT) && SUCCEEDED(status); i++)
+		{
+			const uint64_t vertex = random.Next() % header.vertex_count;
+			const uint64_t index = random.Next() % header.index_count;
+			const uint32_t stride = VertexPacking::Layouts[format].stride;
+
+			Data::Vertex v;
+			GetBenchmarkVertex(vertex, rows, v);
+			VertexPacking::Pack(format, &v, 1, header.dequantization, expected);
+
+			const uint32_t* pIndices = static_cast<const uint32_t*>(pack.GetStream(MeshPack::STREAM_INDICES));
+
+			if ((memcmp(pVertices + vertex * stride, expected.data(), stride) != 0) || (pIndices[index] != GetBenchmarkIndex(index)))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: vertex %llu or index %llu of the mapped mesh differs from what was written\n",
+					status, static_cast<unsigned long long>(vertex), static_cast<unsigned long long>(index));
+			}
+		}
+
+		pack.Close();
+	}
+
+	// the same file read front to back into a reused buffer, the least a loader without a mapping has to do
+	if (SUCCEEDED(status))
+	{
+		FILE* pFile = OpenFileStream(PATH, "rb");
+		std::vector<BYTE> buffer(SPARSE_STRIDE);
+		uint64_t total = 0;
+		size_t read = 0;
+
+		start = std::chrono::steady_clock::now();
+
+		// unbuffered, the reads are large enough to go to the file as they are
+		if (pFile != NULL)
+		{
+			setvbuf(pFile, NULL, _IONBF, 0);
+		}
+
+		while ((pFile != NULL) && ((read = fread(buffer.data(), 1, buffer.size(), pFile)) != 0))
+		{
+			checksum += buffer[0];
+			total += read;
+		}
+
+		const double read_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (pFile != NULL)
+		{
+			fclose(pFile);
+		}
+
+		WriteToConsole("%-16s %10.3f ms, %8.1f MB read (checksum %llu)\n", "full read", read_seconds * 1e3, total / 1048576.0, static_cast<unsigned long long>(checksum));
+	}
+
+	remove(PATH);
+
+	return status;
+}
@@ -0,0 +1,224 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "Mesh.h"
+#include "MeshGenerator.h"
+#include "JobSystem.h"
+
+// a triangle by its vertex values, rotated to start at its smallest vertex so that the winding is kept
+struct MeshTriangle
+{
+	Data::Vertex vertices[3];
+
+	bool operator<(const MeshTriangle& other) const
+	{
+		return memcmp(vertices, other.vertices, sizeof(vertices)) < 0;
+	}
+
+	bool operator==(const MeshTriangle& other) const
+	{
+		return memcmp(vertices, other.vertices, sizeof(vertices)) == 0;
+	}
+};
+
+// the triangles of an indexed mesh, rotated and sorted, in a form that does not depend on the order of either buffer
+VOID GetMeshTriangles(const std::vector<Data::Vertex>& vertices, const std::vector<uint32_t>& indices, std::vector<MeshTriangle>& triangles)
+{
+	triangles.resize(indices.size() / 3);
+
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		unsigned int first = 0;
+
+		for (unsigned int k = 1; k < 3; k++)
+		{
+			if (memcmp(&vertices[indices[t * 3 + k]], &vertices[indices[t * 3 + first]], sizeof(Data::Vertex)) < 0)
+			{
+				first = k;
+			}
+		}
+
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			triangles[t].vertices[k] = vertices[indices[t * 3 + (first + k) % 3]];
+		}
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+}
+
+// the triangles of an index buffer, rotated to start at their smallest index and sorted
+VOID GetIndexTriangles(const std::vector<uint32_t>& indices, std::vector<uint64_t>& triangles)
+{
+	triangles.resize(indices.size() / 3);
+
+	for (size_t t = 0; t < triangles.size(); t++)
+	{
+		const uint32_t* triangle = &indices[t * 3];
+		const unsigned int first = (triangle[0] <= std::min(triangle[1], triangle[2])) ? 0 : ((triangle[1] <= triangle[2]) ? 1 : 2);
+
+		// 21 bits per index, enough for the meshes the check runs on
+		triangles[t] = static_cast<uint64_t>(triangle[first]) << 42 | static_cast<uint64_t>(triangle[(first + 1) % 3]) << 21 | triangle[(first + 2) % 3];
+	}
+
+	std::sort(triangles.begin(), triangles.end());
+}
+
+// the mesh of the generator as the triangle list Mesh::Build takes
+VOID GenerateTriangleList(const MeshGenerator::Desc& desc, std::vector<Data::Vertex>& triangles, JobSystem& jobs)
+{
+	std::vector<Data::Vertex> vertices(static_cast<size_t>(MeshGenerator::GetVertexCount(desc)));
+	std::vector<uint32_t> indices(static_cast<size_t>(MeshGenerator::GetIndexCount(desc)));
+
+	MeshGenerator::GenerateVertices(desc, 0, vertices.size(), vertices.data(), jobs);
+	MeshGenerator::GenerateIndices(desc, 0, indices.size(), indices.data(), jobs);
+
+	triangles.resize(indices.size());
+	for (size_t i = 0; i < indices.size(); i++)
+	{
+		triangles[i] = vertices[indices[i]];
+	}
+}
+
+/*
+* runs the steps of Mesh::Build on a triangle list and checks each of them: the cache optimization may only reorder
+* the triangles and rotate their indices, the fetch optimization may only renumber the vertices, so the vertex values
+* of the triangles have to come out as they went in, with the winding kept, and every welded vertex has to be used.
+* the acmr may not get worse.
+*/
+INT CheckMeshBuild(const char* name, const Data::Vertex* pTriangles, size_t count)
+{
+	INT status = STATUS_SUCCESS;
+
+	Mesh::IndexedMesh mesh;
+	Mesh::Weld(pTriangles, count, mesh);
+
+	const size_t welded_count = mesh.vertices.size();
+	const Mesh::CacheStatistics before = Mesh::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+	std::vector<uint64_t> welded_triangles;
+	std::vector<uint64_t> optimized_triangles;
+
+	GetIndexTriangles(mesh.indices, welded_triangles);
+	Mesh::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+	GetIndexTriangles(mesh.indices, optimized_triangles);
+
+	if (welded_triangles != optimized_triangles)
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: %s: the cache optimization changed the triangles, not only their order\n", status, name);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		Mesh::OptimizeVertexFetch(mesh);
+
+		std::vector<uint32_t> list(count);
+		for (size_t i = 0; i < count; i++)
+		{
+			list[i] = static_cast<uint32_t>(i);
+		}
+
+		std::vector<Data::Vertex> input(pTriangles, pTriangles + count);
+		std::vector<MeshTriangle> input_triangles;
+		std::vector<MeshTriangle> output_triangles;
+
+		GetMeshTriangles(input, list, input_triangles);
+		GetMeshTriangles(mesh.vertices, mesh.indices, output_triangles);
+
+		if ((mesh.vertices.size() != welded_count) || (input_triangles != output_triangles))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s: the fetch optimization kept %zu of %zu vertices or changed the triangles\n", status, name, mesh.vertices.size(), welded_count);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		const Mesh::CacheStatistics after = Mesh::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		if (after.acmr > before.acmr)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s: the acmr got worse, %.3f -> %.3f\n", status, name, before.acmr, after.acmr);
+		}
+		else
+		{
+			WriteToConsole("%s: %zu triangles, %zu vertices, acmr %.3f -> %.3f, atvr %.3f -> %.3f\n",
+				name, count / 3, welded_count, before.acmr, after.acmr, before.atvr, after.atvr);
+		}
+	}
+
+	return status;
+}
+
+INT RunMeshOptimizeBenchmark(uint64_t triangles, JobSystem& jobs)
+{
+	const uint64_t CHECK_TRIANGLES = 50000;
+	const unsigned int SCALING_STEPS = 4; // each a quarter of the triangles of the next
+
+	INT status = CheckMeshBuild("cube", Data::Vertices, ARRAYSIZE(Data::Vertices));
+
+	for (unsigned int s = 0; SUCCEEDED(status) && (s < MeshGenerator::SHAPE_COUNT); s++)
+	{
+		const MeshGenerator::Shape shape = static_cast<MeshGenerator::Shape>(s);
+		const MeshGenerator::Desc desc = { shape, MeshGenerator::GetDetail(shape, CHECK_TRIANGLES), 1 };
+
+		std::vector<Data::Vertex> list;
+		GenerateTriangleList(desc, list, jobs);
+
+		status = CheckMeshBuild(MeshGenerator::ShapeNames[s], list.data(), list.size());
+	}
+
+	// the optimizers on terrains of up to triangles triangles, the time per triangle has to stay about the same
+	double first_ns = 0.0;
+
+	for (unsigned int step = 0; SUCCEEDED(status) && (step < SCALING_STEPS); step++)
+	{
+		const uint64_t target = std::max<uint64_t>(triangles >> (2 * (SCALING_STEPS - 1 - step)), 1);
+		const MeshGenerator::Desc desc = { MeshGenerator::SHAPE_TERRAIN, MeshGenerator::GetDetail(MeshGenerator::SHAPE_TERRAIN, target), 1 };
+
+		Mesh::IndexedMesh mesh;
+		mesh.vertices.resize(static_cast<size_t>(MeshGenerator::GetVertexCount(desc)));
+		mesh.indices.resize(static_cast<size_t>(MeshGenerator::GetIndexCount(desc)));
+
+		MeshGenerator::GenerateVertices(desc, 0, mesh.vertices.size(), mesh.vertices.data(), jobs);
+		MeshGenerator::GenerateIndices(desc, 0, mesh.indices.size(), mesh.indices.data(), jobs);
+
+		const size_t count = mesh.indices.size() / 3;
+		const Mesh::CacheStatistics before = Mesh::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		Mesh::OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+
+		const std::chrono::steady_clock::time_point middle = std::chrono::steady_clock::now();
+
+		Mesh::OptimizeVertexFetch(mesh);
+
+		const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+		const Mesh::CacheStatistics after = Mesh::AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+
+		const double cache_ns = std::chrono::duration<double, std::nano>(middle - start).count() / count;
+		const double fetch_ns = std::chrono::duration<double, std::nano>(end - middle).count() / count;
+
+		if (step == 0)
+		{
+			first_ns = cache_ns + fetch_ns;
+		}
+
+		if ((mesh.indices.size() != count * 3) || (after.acmr > before.acmr))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %zu triangles, the acmr got worse, %.3f -> %.3f\n", status, count, before.acmr, after.acmr);
+		}
+		else
+		{
+			WriteToConsole("%9zu triangles: vertex cache %.1f ns/triangle, vertex fetch %.1f ns/triangle, %.2fx the time per triangle of the smallest, acmr %.3f -> %.3f\n",
+				count, cache_ns, fetch_ns, (cache_ns + fetch_ns) / first_ns, before.acmr, after.acmr);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,57 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Profiler.h"
+
+INT RunProfilerBenchmark()
+{
+	const unsigned int SCOPE_COUNT = 10000000;
+	const unsigned int REPEATS = 5;
+
+	INT status = STATUS_SUCCESS;
+
+	const bool was_enabled = Profiler::IsEnabled();
+	volatile unsigned int counter = 0;
+	double seconds[3] = { DBL_MAX, DBL_MAX, DBL_MAX }; // no scope, disabled, enabled
+
+	for (unsigned int repeat = 0; repeat < REPEATS; repeat++)
+	{
+		for (unsigned int mode = 0; mode < 3; mode++)
+		{
+			Profiler::Enable(mode == 2);
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			if (mode == 0)
+			{
+				for (unsigned int i = 0; i < SCOPE_COUNT; i++)
+				{
+					counter = counter + 1;
+				}
+			}
+			else
+			{
+				for (unsigned int i = 0; i < SCOPE_COUNT; i++)
+				{
+					PROFILE_SCOPE("Benchmark");
+					counter = counter + 1;
+				}
+			}
+
+			seconds[mode] = std::min(seconds[mode], std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+	}
+
+	Profiler::Enable(was_enabled);
+
+#if defined(_MSC_VER)
+	WriteToConsole("msvc %d: ", _MSC_VER);
+#elif defined(__clang__)
+	WriteToConsole("clang %d.%d: ", __clang_major__, __clang_minor__);
+#elif defined(__GNUC__)
+	WriteToConsole("gcc %d.%d: ", __GNUC__, __GNUC_MINOR__);
+#endif
+	WriteToConsole("%.2f ns per scope disabled, %.2f ns per scope enabled, best of %u runs of %u scopes\n",
+		std::max(seconds[1] - seconds[0], 0.0) * 1e9 / SCOPE_COUNT, std::max(seconds[2] - seconds[0], 0.0) * 1e9 / SCOPE_COUNT, REPEATS, SCOPE_COUNT);
+
+	return status;
+}
@@ -0,0 +1,284 @@
+#include "Tests.h"
+#include "Log.h"
+#include "FastMath.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "Simulation.h"
+
+INT RunRotationBenchmark()
+{
+	const size_t COUNT = 1 << 20;
+	const unsigned int REPEAT_COUNT = 10;
+
+	INT status = STATUS_SUCCESS;
+
+	// the error of the batched sincos against double precision, over the angles the simulation uses and the full range
+	const float ranges[][2] = { { 0.0f, static_cast<float>(M_PI) / 180.0f }, { -static_cast<float>(M_PI), static_cast<float>(M_PI) }, { -FastMath::MAX_SINCOS_ARGUMENT, FastMath::MAX_SINCOS_ARGUMENT } };
+
+	std::vector<float> x(COUNT);
+	std::vector<float> s(COUNT);
+	std::vector<float> c(COUNT);
+
+	for (size_t r = 0; r < ARRAYSIZE(ranges); r++)
+	{
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			x[i] = ranges[r][0] + (ranges[r][1] - ranges[r][0]) * (static_cast<float>(i) / (COUNT - 1));
+		}
+
+		FastMath::SinCosBatch(x.data(), s.data(), c.data(), COUNT);
+
+		double error = 0.0;
+
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			error = std::max(error, std::fabs(s[i] - sin(static_cast<double>(x[i]))));
+			error = std::max(error, std::fabs(c[i] - cos(static_cast<double>(x[i]))));
+		}
+
+		WriteToConsole("sincos [%.4g, %.4g]: max error %.3g\n", ranges[r][0], ranges[r][1], error);
+
+		if (error > FastMath::MAX_SINCOS_ERROR)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the sincos error is above %.3g\n", status, FastMath::MAX_SINCOS_ERROR);
+		}
+	}
+
+	// the rotation builders against the per object path through the c runtime
+	std::vector<float> r_x(COUNT);
+	std::vector<float> r_y(COUNT);
+	std::vector<float> r_z(COUNT);
+
+	RandomStream random(1);
+
+	for (size_t i = 0; i < COUNT; i++)
+	{
+		r_x[i] = random.NextFloat() * static_cast<float>(M_PI);
+		r_y[i] = random.NextFloat() * static_cast<float>(M_PI);
+		r_z[i] = random.NextFloat() * static_cast<float>(M_PI);
+	}
+
+	std::vector<float> quaternions(Quaternion::GetBatchSize(COUNT));
+	std::vector<float> reference_quaternions(Quaternion::GetBatchSize(COUNT));
+	std::vector<float> matrices(Matrix::GetBatchSize(COUNT));
+	std::vector<float> reference_matrices(Matrix::GetBatchSize(COUNT));
+
+	double quaternion_seconds[2] = {};
+	double matrix_seconds[2] = {};
+
+	for (unsigned int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+	{
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			float rotation[4];
+			Quaternion::FromEuler(r_x[i], r_y[i], r_z[i], rotation);
+			Quaternion::StoreBatch(reference_quaternions.data(), i, rotation);
+		}
+
+		quaternion_seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+
+		Quaternion::FromEulerBatch(r_x.data(), r_y.data(), r_z.data(), quaternions.data(), COUNT);
+
+		quaternion_seconds[1] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+
+		for (size_t i = 0; i < COUNT; i++)
+		{
+			float rotation[4];
+			float matrix[16];
+			Quaternion::FromEuler(r_x[i], r_y[i], r_z[i], rotation);
+			Quaternion::ToMatrix(rotation, matrix);
+			Matrix::StoreBatch(reference_matrices.data(), i, matrix);
+		}
+
+		matrix_seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		start = std::chrono::steady_clock::now();
+
+		Matrix::FromEulerBatch(r_x.data(), r_y.data(), r_z.data(), matrices.data(), COUNT);
+
+		matrix_seconds[1] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	double quaternion_error = 0.0;
+	double matrix_error = 0.0;
+
+	for (size_t i = 0; i < quaternions.size(); i++)
+	{
+		quaternion_error = std::max(quaternion_error, static_cast<double>(std::fabs(quaternions[i] - reference_quaternions[i])));
+	}
+
+	for (size_t i = 0; i < matrices.size(); i++)
+	{
+		matrix_error = std::max(matrix_error, static_cast<double>(std::fabs(matrices[i] - reference_matrices[i])));
+	}
+
+	WriteToConsole("quaternions: %.2f ns libm, %.2f ns batched, %.2fx, max difference %.3g\n",
+		quaternion_seconds[0] * 1e9 / (COUNT * REPEAT_COUNT), quaternion_seconds[1] * 1e9 / (COUNT * REPEAT_COUNT), quaternion_seconds[0] / quaternion_seconds[1], quaternion_error);
+	WriteToConsole("matrices:    %.2f ns libm, %.2f ns batched, %.2fx, max difference %.3g\n",
+		matrix_seconds[0] * 1e9 / (COUNT * REPEAT_COUNT), matrix_seconds[1] * 1e9 / (COUNT * REPEAT_COUNT), matrix_seconds[0] / matrix_seconds[1], matrix_error);
+
+	// a few ulps of the unit range on top of the sincos error, the builders multiply up to three factors
+	if ((quaternion_error > 1e-6) || (matrix_error > 1e-6))
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: the batched rotations differ from the reference\n", status);
+	}
+
+	return status;
+}
+
+// how far the upper 3x3 of the 16 float matrix m is from a rotation: |det - 1| and the largest element of m m^T - I
+VOID MeasureRotation(const float* m, double* pDeterminant, double* pOrthogonality)
+{
+	double a[3][3];
+
+	for (unsigned int r = 0; r < 3; r++)
+	{
+		for (unsigned int c = 0; c < 3; c++)
+		{
+			a[r][c] = m[r * 4 + c];
+		}
+	}
+
+	const double determinant =
+		a[0][0] * (a[1][1] * a[2][2] - a[1][2] * a[2][1]) -
+		a[0][1] * (a[1][0] * a[2][2] - a[1][2] * a[2][0]) +
+		a[0][2] * (a[1][0] * a[2][1] - a[1][1] * a[2][0]);
+
+	double orthogonality = 0.0;
+
+	for (unsigned int i = 0; i < 3; i++)
+	{
+		for (unsigned int j = 0; j < 3; j++)
+		{
+			const double dot = a[i][0] * a[j][0] + a[i][1] * a[j][1] + a[i][2] * a[j][2];
+			orthogonality = std::max(orthogonality, std::fabs(dot - ((i == j) ? 1.0 : 0.0)));
+		}
+	}
+
+	*pDeterminant = std::fabs(determinant - 1.0);
+	*pOrthogonality = orthogonality;
+}
+
+// the euler matrix the renderer built with the c runtime before the rotations were quaternions
+VOID BuildEulerMatrix(float r_x, float r_y, float r_z, float* m)
+{
+	const float c_x = std::cos(r_x), s_x = std::sin(r_x);
+	const float c_y = std::cos(r_y), s_y = std::sin(r_y);
+	const float c_z = std::cos(r_z), s_z = std::sin(r_z);
+
+	const float rotation[16] = {
+		c_x * c_y, c_x * s_y * s_z - s_x * c_z, c_x * s_y * c_z + s_x * s_z, 0,
+		s_x * c_y, s_x * s_y * s_z + c_x * c_z, s_x * s_y * c_z - c_x * s_z, 0,
+		-s_y, c_y * s_z, c_y * c_z, 0,
+		0, 0, 0, 1
+	};
+
+	CopyMemory(m, rotation, sizeof(rotation));
+}
+
+INT RunRotationDriftBenchmark(uint64_t frames)
+{
+	const unsigned int ROTATION_INTERVAL = 180; // frames per random step, as in the simulation
+	const double MAX_DRIFT = 1e-6;              // a few float ulps at 1
+
+	INT status = STATUS_SUCCESS;
+
+	// both paths draw the same steps
+	RandomStream quaternion_random(7);
+	RandomStream matrix_random(7);
+
+	float rotation[4];
+	float step[4];
+	Quaternion::ToIdentity(rotation);
+	Quaternion::ToIdentity(step);
+
+	// a few upload matrices in turn, so that expanding every frame is not optimized into expanding the last one
+	float models[16][16];
+
+	float matrix[16];
+	float matrix_step[16];
+	Matrix::Scalar::ToIdentity(matrix);
+	Matrix::Scalar::ToIdentity(matrix_step);
+
+	double seconds[2] = {};
+	uint64_t frame = 0;
+
+	for (uint64_t checkpoint = 10000; SUCCEEDED(status); checkpoint *= 10)
+	{
+		const uint64_t end = std::min(checkpoint, frames);
+
+		// the current path: a quaternion product, a renormalization and the expansion for the upload every frame
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (uint64_t f = frame; f < end; f++)
+		{
+			if (f % ROTATION_INTERVAL == 0)
+			{
+				const float r_x = quaternion_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				const float r_y = quaternion_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				const float r_z = quaternion_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				Quaternion::FromEuler(r_x, r_y, r_z, step);
+			}
+
+			Quaternion::Multiply(rotation, step, rotation);
+			Quaternion::Normalize(rotation);
+			Quaternion::ToMatrix(rotation, models[f & 15]);
+		}
+
+		seconds[0] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// the old path: a copy and a full scalar product every frame, and sin and cos for every new step
+		start = std::chrono::steady_clock::now();
+
+		for (uint64_t f = frame; f < end; f++)
+		{
+			if (f % ROTATION_INTERVAL == 0)
+			{
+				const float r_x = matrix_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				const float r_y = matrix_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				const float r_z = matrix_random.NextFloat() * static_cast<float>(M_PI) / ROTATION_INTERVAL;
+				BuildEulerMatrix(r_x, r_y, r_z, matrix_step);
+			}
+
+			float current[16];
+			Matrix::Scalar::Copy(current, matrix);
+			Matrix::Scalar::Multiply(current, matrix_step, matrix);
+		}
+
+		seconds[1] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		frame = end;
+
+		double determinant[2];
+		double orthogonality[2];
+		MeasureRotation(models[(end - 1) & 15], &determinant[0], &orthogonality[0]);
+		MeasureRotation(matrix, &determinant[1], &orthogonality[1]);
+
+		const double length = static_cast<double>(rotation[0]) * rotation[0] + static_cast<double>(rotation[1]) * rotation[1] +
+			static_cast<double>(rotation[2]) * rotation[2] + static_cast<double>(rotation[3]) * rotation[3];
+
+		WriteToConsole("%11llu frames: quaternion |det - 1| %.2e, orthogonality %.2e, ||q|^2 - 1| %.2e; matrix |det - 1| %.2e, orthogonality %.2e\n",
+			static_cast<unsigned long long>(end), determinant[0], orthogonality[0], std::fabs(length - 1.0), determinant[1], orthogonality[1]);
+
+		if ((determinant[0] > MAX_DRIFT) || (orthogonality[0] > MAX_DRIFT) || (std::fabs(length - 1.0) > MAX_DRIFT))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the quaternion rotation drifted further than %.0e after %llu frames\n", status, MAX_DRIFT, static_cast<unsigned long long>(end));
+		}
+
+		if (end == frames)
+		{
+			break;
+		}
+	}
+
+	WriteToConsole("per frame: %.2f ns quaternion with the expansion, %.2f ns euler matrix product, %.2fx\n",
+		seconds[0] * 1e9 / frame, seconds[1] * 1e9 / frame, seconds[1] / seconds[0]);
+
+	return status;
+}
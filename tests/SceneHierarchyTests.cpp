@@ -0,0 +1,237 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "JobSystem.h"
+#include "SceneHierarchy.h"
+#include "Simulation.h"
+
+// a node of a scene graph as it is usually written, allocated one by one and walked through pointers
+struct NaiveSceneNode
+{
+	Matrix::Affine3x4            local;
+	Matrix::Affine3x4            world;
+	bool                         dirty;
+	std::vector<NaiveSceneNode*> children;
+};
+
+// recomputes the world matrices under pNode, all of them or only those of dirty nodes and their descendants
+VOID PropagateNaive(NaiveSceneNode* pNode, const Matrix::Affine3x4* pParentWorld, bool dirty, bool all, size_t* pCount)
+{
+	dirty = dirty || pNode->dirty;
+
+	if (dirty || all)
+	{
+		if (pParentWorld != NULL)
+		{
+			Matrix::Multiply(pNode->local, *pParentWorld, pNode->world);
+		}
+		else
+		{
+			pNode->world = pNode->local;
+		}
+
+		(*pCount)++;
+	}
+
+	pNode->dirty = false;
+
+	for (size_t i = 0; i < pNode->children.size(); i++)
+	{
+		PropagateNaive(pNode->children[i], &pNode->world, dirty, all, pCount);
+	}
+}
+
+INT RunHierarchyBenchmark(size_t nodeCount, JobSystem& jobs)
+{
+	const unsigned int FRAME_COUNT = 16;
+	const size_t LOCAL_COUNT = 4096; // distinct local matrices set by the frames
+	const double FRACTIONS[] = { 0.001, 0.01, 0.1, 1.0 };
+
+	INT status = STATUS_SUCCESS;
+
+	if ((nodeCount == 0) || (nodeCount >= SceneHierarchy::INVALID))
+	{
+		status = STATUS_INVALID_PARAMETER;
+		WriteToConsole("error 0x%X: the scene needs 1 to 0x%X nodes\n", status, SceneHierarchy::INVALID - 1);
+	}
+
+	RandomStream random(0x5CE4E);
+
+	std::vector<uint32_t> numbers;
+	std::vector<uint32_t> parents;
+	std::vector<Matrix::Affine3x4> locals(LOCAL_COUNT);
+
+	if (SUCCEEDED(status))
+	{
+		numbers.resize(nodeCount);
+		parents.resize(nodeCount);
+
+		for (size_t k = 0; k < nodeCount; k++)
+		{
+			numbers[k] = static_cast<uint32_t>(k);
+		}
+
+		for (size_t k = nodeCount - 1; k > 0; k--)
+		{
+			std::swap(numbers[k], numbers[random.Next() % (k + 1)]);
+		}
+
+		parents[numbers[0]] = SceneHierarchy::INVALID;
+
+		for (size_t k = 1; k < nodeCount; k++)
+		{
+			parents[numbers[k]] = numbers[random.Next() % k];
+		}
+
+		// rotations with a short translation, so that the chains neither vanish nor overflow
+		for (size_t i = 0; i < LOCAL_COUNT; i++)
+		{
+			float rotation[4];
+			Quaternion::FromEuler(random.NextFloat() * 2.0f * M_PI, random.NextFloat() * 2.0f * M_PI, random.NextFloat() * 2.0f * M_PI, rotation);
+			Quaternion::ToMatrix(rotation, locals[i]);
+
+			locals[i].m[3] = random.NextFloat() - 0.5f;
+			locals[i].m[7] = random.NextFloat() - 0.5f;
+			locals[i].m[11] = random.NextFloat() - 0.5f;
+		}
+	}
+
+	SceneHierarchy hierarchy;
+
+	if (SUCCEEDED(status))
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		status = hierarchy.Build(parents.data(), nodeCount);
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%zu nodes on %zu levels, built in %.2f ms, %u threads\n", nodeCount, hierarchy.GetDepth(),
+				std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() * 1e3, jobs.GetThreadCount());
+		}
+	}
+
+	// the breadth first order: parents before their children, levels and siblings contiguous
+	for (size_t node = 0; (node < nodeCount) && SUCCEEDED(status); node++)
+	{
+		const uint32_t index = hierarchy.GetIndex(static_cast<uint32_t>(node));
+		const uint32_t parent = hierarchy.GetParent(index);
+
+		if ((parents[node] == SceneHierarchy::INVALID) ? (parent != SceneHierarchy::INVALID) : (parent != hierarchy.GetIndex(parents[node])) || (parent >= index))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: node %zu is not sorted after its parent\n", status, node);
+		}
+	}
+
+	std::vector<NaiveSceneNode> naive;
+	NaiveSceneNode* pRoot = NULL;
+
+	if (SUCCEEDED(status))
+	{
+		naive.resize(nodeCount);
+
+		for (size_t node = 0; node < nodeCount; node++)
+		{
+			naive[node].local = locals[node % LOCAL_COUNT];
+			naive[node].dirty = true;
+
+			if (parents[node] != SceneHierarchy::INVALID)
+			{
+				naive[parents[node]].children.push_back(&naive[node]);
+			}
+			else
+			{
+				pRoot = &naive[node];
+			}
+
+			hierarchy.SetLocal(hierarchy.GetIndex(static_cast<uint32_t>(node)), locals[node % LOCAL_COUNT]);
+		}
+
+		size_t count = 0;
+		PropagateNaive(pRoot, NULL, false, true, &count);
+		hierarchy.Update(jobs);
+	}
+
+	// the same products in the same order, so the world matrices have to match exactly
+	for (unsigned int pass = 0; (pass <= ARRAYSIZE(FRACTIONS)) && SUCCEEDED(status); pass++)
+	{
+		if (pass > 0)
+		{
+			const double fraction = FRACTIONS[pass - 1];
+			const size_t changes = std::max<size_t>(static_cast<size_t>(nodeCount * fraction), 1);
+
+			std::vector<uint32_t> changed(changes * FRAME_COUNT);
+			for (size_t i = 0; i < changed.size(); i++)
+			{
+				changed[i] = static_cast<uint32_t>(random.Next() % nodeCount);
+			}
+
+			double seconds[3] = {};
+			size_t recomputed = 0;
+
+			for (unsigned int variant = 0; variant < ARRAYSIZE(seconds); variant++)
+			{
+				const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+				for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+				{
+					const uint32_t* pChanged = &changed[frame * changes];
+
+					if (variant == 0)
+					{
+						for (size_t i = 0; i < changes; i++)
+						{
+							hierarchy.SetLocal(hierarchy.GetIndex(pChanged[i]), locals[(frame + i) % LOCAL_COUNT]);
+						}
+
+						hierarchy.Update(jobs);
+					}
+					else
+					{
+						for (size_t i = 0; i < changes; i++)
+						{
+							naive[pChanged[i]].local = locals[(frame + i) % LOCAL_COUNT];
+							naive[pChanged[i]].dirty = true;
+						}
+
+						size_t count = 0;
+						PropagateNaive(pRoot, NULL, false, variant == 1, &count);
+
+						if (variant == 2)
+						{
+							recomputed += count;
+						}
+					}
+				}
+
+				seconds[variant] = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			}
+
+			WriteToConsole("%.1f%% of the nodes set per frame, %.1f%% recomputed: %.3f ms flattened, %.3f ms recursive, %.3f ms recursive with dirty flags\n",
+				fraction * 100.0, recomputed * 100.0 / (static_cast<double>(nodeCount) * FRAME_COUNT),
+				seconds[0] * 1e3 / FRAME_COUNT, seconds[1] * 1e3 / FRAME_COUNT, seconds[2] * 1e3 / FRAME_COUNT);
+		}
+
+		size_t mismatches = 0;
+
+		for (size_t node = 0; node < nodeCount; node++)
+		{
+			const Matrix::Affine3x4& world = hierarchy.GetWorld(hierarchy.GetIndex(static_cast<uint32_t>(node)));
+
+			if (memcmp(world.m, naive[node].world.m, sizeof(world.m)) != 0)
+			{
+				mismatches++;
+			}
+		}
+
+		if (mismatches != 0)
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %zu of %zu world matrices differ from the recursive propagation\n", status, mismatches, nodeCount);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,728 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "ShaderCompiler.h"
+#include "ShaderCache.h"
+#include "JobSystem.h"
+#include "ShaderBuild.h"
+#include "Simulation.h"
+
+/*
+* stands in for the d3d compiler where there is none: every compile blocks for the latency and returns bytecode made
+* from the cache key of the source, so equal sources give equal bytecode. a permutation can be made to fail by name.
+*/
+class StubShaderCompiler : public ShaderCompiler
+{
+private:
+	unsigned int              m_Microseconds;
+	const char*               m_pFailure;
+	std::atomic<unsigned int> m_Compiles;
+	std::atomic<unsigned int> m_Active;
+	std::atomic<unsigned int> m_MaxActive;
+
+public:
+	StubShaderCompiler(unsigned int microseconds, const char* pFailure);
+
+	INT Compile(const Data::ShaderSource& source, std::vector<BYTE>& bytecode);
+
+	unsigned int GetCompileCount();
+	unsigned int GetMaxActive(); // the most compiles that ran at the same time
+};
+
+StubShaderCompiler::StubShaderCompiler(unsigned int microseconds, const char* pFailure)
+{
+	m_Microseconds = microseconds;
+	m_pFailure = pFailure;
+	m_Compiles = 0;
+	m_Active = 0;
+	m_MaxActive = 0;
+}
+
+INT StubShaderCompiler::Compile(const Data::ShaderSource& source, std::vector<BYTE>& bytecode)
+{
+	INT status = STATUS_SUCCESS;
+
+	const unsigned int active = ++m_Active;
+	unsigned int max_active = m_MaxActive;
+	while ((active > max_active) && !m_MaxActive.compare_exchange_weak(max_active, active))
+	{
+	}
+
+	m_Compiles++;
+	std::this_thread::sleep_for(std::chrono::microseconds(m_Microseconds));
+
+	if ((m_pFailure != NULL) && (strcmp(source.pSourceName, m_pFailure) == 0))
+	{
+		status = STATUS_UNSUCCESSFUL;
+	}
+	else
+	{
+		RandomStream random(ShaderCache::ComputeKey(source));
+
+		bytecode.resize(256);
+		for (size_t i = 0; i < bytecode.size(); i += sizeof(uint64_t))
+		{
+			const uint64_t word = random.Next();
+			CopyMemory(&bytecode[i], &word, sizeof(word));
+		}
+	}
+
+	m_Active--;
+
+	return status;
+}
+
+unsigned int StubShaderCompiler::GetCompileCount()
+{
+	return m_Compiles;
+}
+
+unsigned int StubShaderCompiler::GetMaxActive()
+{
+	return m_MaxActive;
+}
+
+// what the create function of every permutation of the shader build benchmark saw
+struct ShaderBuildCreates
+{
+	std::vector<std::atomic<unsigned int>> counts;
+	std::vector<std::vector<BYTE>>         bytecode;
+	std::vector<ShaderPermutation>         permutations;
+};
+
+INT CountShaderCreate(VOID* pData, const ShaderPermutation& permutation, const void* pCode, size_t codeSize)
+{
+	ShaderBuildCreates& creates = *static_cast<ShaderBuildCreates*>(pData);
+
+	for (size_t i = 0; i < creates.permutations.size(); i++)
+	{
+		if (strcmp(creates.permutations[i].GetName(), permutation.GetName()) == 0)
+		{
+			const BYTE* pBytes = static_cast<const BYTE*>(pCode);
+
+			creates.bytecode[i].assign(pBytes, pBytes + codeSize);
+			creates.counts[i]++;
+		}
+	}
+
+	return STATUS_SUCCESS;
+}
+
+INT RunShaderBuildBenchmark()
+{
+	const char* CACHE_PATH = "shader-build.cache";
+	const char* FAILING_PERMUTATION = "pixel_shader+DEBUG_COLOR";
+	const unsigned int LATENCY_MICROSECONDS = 20000;
+	const unsigned int SETUP_MICROSECONDS = 60000; // the buffers and the rest of the renderer setup on the main thread
+	const unsigned int MAX_THREADS = 8;
+
+	INT status = STATUS_SUCCESS;
+
+	std::vector<ShaderPermutation> permutations;
+
+	for (UINT shader = 0; shader < ARRAYSIZE(Data::Shaders); shader++)
+	{
+		ShaderPermutation::Expand(shader, permutations);
+	}
+
+	ShaderBuildCreates creates;
+	creates.counts = std::vector<std::atomic<unsigned int>>(permutations.size());
+	creates.bytecode.resize(permutations.size());
+	creates.permutations = permutations;
+
+	// every combination of features once, each one defining every feature of its shader and cached on its own
+	{
+		std::vector<uint64_t> keys;
+		size_t expected = 0;
+
+		for (UINT shader = 0; shader < ARRAYSIZE(Data::Shaders); shader++)
+		{
+			unsigned int feature_count = 0;
+			for (unsigned int i = 0; i < Data::FEATURE_COUNT; i++)
+			{
+				feature_count += (Data::ShaderFeatures[shader] >> i) & 1;
+			}
+
+			expected += size_t(1) << feature_count;
+		}
+
+		for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			const Data::ShaderSource source = permutations[i].GetSource();
+			UINT defined = 0;
+			UINT enabled = 0;
+
+			for (const Data::ShaderDefine* pDefine = source.pDefines; pDefine->name != NULL; pDefine++)
+			{
+				for (unsigned int k = 0; k < Data::FEATURE_COUNT; k++)
+				{
+					if (strcmp(pDefine->name, Data::ShaderFeatureNames[k]) == 0)
+					{
+						defined |= 1 << k;
+						enabled |= (strcmp(pDefine->value, "1") == 0) ? (1 << k) : 0;
+					}
+				}
+			}
+
+			if ((defined != Data::ShaderFeatures[permutations[i].GetShader()]) || (enabled != permutations[i].GetFeatures()))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: %s defines 0x%X to 0x%X\n", status, permutations[i].GetName(), defined, enabled);
+			}
+
+			keys.push_back(ShaderCache::ComputeKey(source));
+		}
+
+		std::sort(keys.begin(), keys.end());
+
+		if (SUCCEEDED(status) && ((permutations.size() != expected) || (std::unique(keys.begin(), keys.end()) != keys.end())))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %zu permutations of %zu expected, or two of them share a cache key\n", status, permutations.size(), expected);
+		}
+	}
+
+	/*
+	* the main thread sets up while the jobs compile, as the renderer does. the compiler blocks like one that waits on
+	* a process or a service, the setup before the build was overlapped with it took setup + permutations * latency.
+	*/
+	std::vector<std::vector<BYTE>> reference;
+	const double serial_seconds = (SETUP_MICROSECONDS + permutations.size() * LATENCY_MICROSECONDS) * 1e-6;
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("%zu permutations, %.1f ms per compile, %.1f ms of setup, %.1f ms one after the other\n",
+			permutations.size(), LATENCY_MICROSECONDS * 1e-3, SETUP_MICROSECONDS * 1e-3, serial_seconds * 1e3);
+	}
+
+	for (unsigned int threads = 1; (threads <= MAX_THREADS) && SUCCEEDED(status); threads *= 2)
+	{
+		JobSystem jobs;
+		ShaderCache cache;
+		StubShaderCompiler compiler(LATENCY_MICROSECONDS, NULL);
+		ShaderBuild build;
+
+		remove(CACHE_PATH);
+
+		for (std::atomic<unsigned int>& count : creates.counts)
+		{
+			count = 0;
+		}
+
+		for (const ShaderPermutation& permutation : permutations)
+		{
+			build.Add(permutation, CountShaderCreate, &creates);
+		}
+
+		status = jobs.Initialize(threads);
+
+		if (SUCCEEDED(status))
+		{
+			status = cache.Open(CACHE_PATH);
+		}
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if (SUCCEEDED(status))
+		{
+			status = build.Start(jobs, cache, compiler);
+		}
+
+		std::this_thread::sleep_for(std::chrono::microseconds(SETUP_MICROSECONDS));
+
+		if (SUCCEEDED(status))
+		{
+			status = build.Wait();
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		// every create ran once, on the bytecode its compile left in the cache, which no thread count changes
+		for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			size_t code_size = 0;
+			const BYTE* pCode = static_cast<const BYTE*>(build.GetCode(i, &code_size));
+
+			if (threads == 1)
+			{
+				reference.push_back(creates.bytecode[i]);
+			}
+
+			if ((creates.counts[i] != 1) || (pCode == NULL) || (creates.bytecode[i] != std::vector<BYTE>(pCode, pCode + code_size)) ||
+				(creates.bytecode[i] != reference[i]))
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: %u threads created %s %u times, or not from its bytecode\n", status, threads, permutations[i].GetName(), creates.counts[i].load());
+			}
+		}
+
+		if (SUCCEEDED(status) && (compiler.GetCompileCount() != permutations.size()))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %u compiles for %zu permutations\n", status, compiler.GetCompileCount(), permutations.size());
+		}
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%u threads: %.1f ms, %.2fx, %u compiles at once\n", threads, seconds * 1e3, serial_seconds / seconds, compiler.GetMaxActive());
+			status = cache.Save();
+		}
+
+		cache.Close();
+		jobs.Uninitialize();
+	}
+
+	// the pack of the last build has every permutation, a second build creates from it without compiling
+	if (SUCCEEDED(status))
+	{
+		JobSystem jobs;
+		ShaderCache cache;
+		StubShaderCompiler compiler(LATENCY_MICROSECONDS, NULL);
+		ShaderBuild build;
+
+		for (const ShaderPermutation& permutation : permutations)
+		{
+			build.Add(permutation, CountShaderCreate, &creates);
+		}
+
+		status = jobs.Initialize(MAX_THREADS);
+
+		if (SUCCEEDED(status))
+		{
+			status = cache.Open(CACHE_PATH);
+		}
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		if (SUCCEEDED(status))
+		{
+			status = build.Start(jobs, cache, compiler);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = build.Wait();
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (SUCCEEDED(status) && ((compiler.GetCompileCount() != 0) || (cache.GetHitCount() != permutations.size())))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: a warm cache still compiled %u of %zu permutations\n", status, compiler.GetCompileCount(), permutations.size());
+		}
+
+		for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			if (creates.bytecode[i] != reference[i])
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: the cached bytecode of %s differs from the compiled one\n", status, permutations[i].GetName());
+			}
+		}
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("warm cache: %.3f ms, %u hits\n", seconds * 1e3, cache.GetHitCount());
+		}
+
+		cache.Close();
+		jobs.Uninitialize();
+	}
+
+	// a permutation that does not compile fails the build and skips its create, the others are still created
+	if (SUCCEEDED(status))
+	{
+		JobSystem jobs;
+		ShaderCache cache;
+		StubShaderCompiler compiler(0, FAILING_PERMUTATION);
+		ShaderBuild build;
+		INT build_status = STATUS_SUCCESS;
+
+		remove(CACHE_PATH);
+
+		for (std::atomic<unsigned int>& count : creates.counts)
+		{
+			count = 0;
+		}
+
+		for (const ShaderPermutation& permutation : permutations)
+		{
+			build.Add(permutation, CountShaderCreate, &creates);
+		}
+
+		status = jobs.Initialize(MAX_THREADS);
+
+		if (SUCCEEDED(status))
+		{
+			status = cache.Open(CACHE_PATH);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%s is made to fail:\n", FAILING_PERMUTATION);
+
+			build_status = build.Start(jobs, cache, compiler);
+		}
+
+		if (SUCCEEDED(status) && SUCCEEDED(build_status))
+		{
+			build_status = build.Wait();
+		}
+
+		if (SUCCEEDED(status) && SUCCEEDED(build_status))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the build succeeded without %s\n", status, FAILING_PERMUTATION);
+		}
+
+		for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			const unsigned int expected = (strcmp(permutations[i].GetName(), FAILING_PERMUTATION) == 0) ? 0 : 1;
+
+			if (creates.counts[i] != expected)
+			{
+				status = STATUS_DATA_ERROR;
+				WriteToConsole("error 0x%X: %s was created %u times after the failure\n", status, permutations[i].GetName(), creates.counts[i].load());
+			}
+		}
+
+		cache.Close();
+		jobs.Uninitialize();
+	}
+
+	remove(CACHE_PATH);
+
+	return status;
+}
+
+// whether bytecode handed out by the cache is the expected one
+bool MatchesBytecode(const void* pCode, size_t codeSize, const std::vector<BYTE>& expected)
+{
+	return (pCode != NULL) && (codeSize == expected.size()) && (memcmp(pCode, expected.data(), codeSize) == 0);
+}
+
+VOID ReadWholeFile(const char* path, std::vector<BYTE>& file)
+{
+	file.clear();
+
+	FILE* pFile = OpenFileStream(path, "rb");
+	if (pFile != NULL)
+	{
+		if ((fseek(pFile, 0, SEEK_END) == 0) && (ftell(pFile) > 0))
+		{
+			file.resize(static_cast<size_t>(ftell(pFile)));
+			rewind(pFile);
+			file.resize(fread(file.data(), 1, file.size(), pFile));
+		}
+
+		fclose(pFile);
+	}
+}
+
+VOID WriteWholeFile(const char* path, const BYTE* pData, size_t size)
+{
+	FILE* pFile = OpenFileStream(path, "wb");
+	if (pFile != NULL)
+	{
+		fwrite(pData, 1, size, pFile);
+		fclose(pFile);
+	}
+}
+
+/*
+* opens the pack, gets every permutation from it and saves it. fails unless every bytecode is the expected one and
+* exactly the given number of them had to be compiled.
+*/
+INT CheckShaderPack(const char* path, const std::vector<ShaderPermutation>& permutations, const std::vector<std::vector<BYTE>>& expected, unsigned int compiles)
+{
+	INT status = STATUS_SUCCESS;
+
+	ShaderCache cache;
+	StubShaderCompiler compiler(0, NULL);
+	unsigned int mismatches = 0;
+
+	status = cache.Open(path);
+
+	for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+	{
+		const void* pCode = NULL;
+		size_t code_size = 0;
+
+		if (FAILED(cache.Get(permutations[i].GetSource(), compiler, &pCode, &code_size)) || !MatchesBytecode(pCode, code_size, expected[i]))
+		{
+			mismatches++;
+		}
+	}
+
+	if (SUCCEEDED(status) && ((mismatches != 0) || (compiler.GetCompileCount() != compiles)))
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: %u of %zu shaders were wrong, %u compiles instead of %u\n", status, mismatches, permutations.size(), compiler.GetCompileCount(), compiles);
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = cache.Save();
+	}
+
+	cache.Close();
+
+	return status;
+}
+
+struct ShaderCacheReader
+{
+	ShaderCache*                          pCache;
+	ShaderCompiler*                       pCompiler;
+	const std::vector<ShaderPermutation>* pPermutations;
+	const std::vector<std::vector<BYTE>>* pExpected;
+	const std::atomic<bool>*              pWriterDone;
+	unsigned int                          min_passes;
+	unsigned int                          passes;
+	unsigned int                          mismatches;
+	std::vector<const void*>              first_code; // what the first pass got, which has to stay valid until Close
+};
+
+// gets every permutation over and over until the writer is done, checking the bytecode each time
+VOID ShaderCacheReaderThread(ShaderCacheReader* pReader)
+{
+	const std::vector<ShaderPermutation>& permutations = *pReader->pPermutations;
+
+	pReader->first_code.assign(permutations.size(), NULL);
+
+	for (pReader->passes = 0; (pReader->passes < pReader->min_passes) || !*pReader->pWriterDone; pReader->passes++)
+	{
+		for (size_t i = 0; i < permutations.size(); i++)
+		{
+			const void* pCode = NULL;
+			size_t code_size = 0;
+
+			if (FAILED(pReader->pCache->Get(permutations[i].GetSource(), *pReader->pCompiler, &pCode, &code_size)) ||
+				!MatchesBytecode(pCode, code_size, (*pReader->pExpected)[i]))
+			{
+				pReader->mismatches++;
+			}
+			else if (pReader->first_code[i] == NULL)
+			{
+				pReader->first_code[i] = pCode;
+			}
+		}
+	}
+}
+
+INT RunShaderCacheBenchmark()
+{
+	const char* CACHE_PATH = "shader-cache.cache";
+	const unsigned int LATENCY_MICROSECONDS = 5000;
+	const unsigned int READER_COUNT = 4;
+	const unsigned int MIN_PASSES = 100;
+
+	INT status = STATUS_SUCCESS;
+
+	std::vector<ShaderPermutation> permutations;
+
+	for (UINT shader = 0; shader < ARRAYSIZE(Data::Shaders); shader++)
+	{
+		ShaderPermutation::Expand(shader, permutations);
+	}
+
+	const size_t cached_count = permutations.size() / 2;
+	std::vector<std::vector<BYTE>> expected(permutations.size());
+
+	{
+		StubShaderCompiler compiler(0, NULL);
+
+		for (size_t i = 0; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			status = compiler.Compile(permutations[i].GetSource(), expected[i]);
+		}
+	}
+
+	// a pack with the first half of the permutations
+	if (SUCCEEDED(status))
+	{
+		ShaderCache cache;
+		StubShaderCompiler compiler(0, NULL);
+
+		remove(CACHE_PATH);
+
+		status = cache.Open(CACHE_PATH);
+
+		for (size_t i = 0; (i < cached_count) && SUCCEEDED(status); i++)
+		{
+			const void* pCode = NULL;
+			size_t code_size = 0;
+
+			status = cache.Get(permutations[i].GetSource(), compiler, &pCode, &code_size);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = cache.Save();
+		}
+
+		cache.Close();
+	}
+
+	/*
+	* readers get every permutation while a writer compiles the second half and saves after each one, which replaces
+	* and remaps the pack under them. the readers compile the missing ones too, racing the writer. every Get has to
+	* return the right bytecode, and what a reader got first still has to be intact after all the saves.
+	*/
+	if (SUCCEEDED(status))
+	{
+		ShaderCache cache;
+		StubShaderCompiler compiler(LATENCY_MICROSECONDS, NULL);
+		std::atomic<bool> writer_done(false);
+		ShaderCacheReader readers[READER_COUNT];
+		std::thread threads[READER_COUNT];
+		unsigned int writer_mismatches = 0;
+
+		status = cache.Open(CACHE_PATH);
+
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (unsigned int r = 0; (r < READER_COUNT) && SUCCEEDED(status); r++)
+		{
+			readers[r].pCache = &cache;
+			readers[r].pCompiler = &compiler;
+			readers[r].pPermutations = &permutations;
+			readers[r].pExpected = &expected;
+			readers[r].pWriterDone = &writer_done;
+			readers[r].min_passes = MIN_PASSES;
+			readers[r].passes = 0;
+			readers[r].mismatches = 0;
+
+			threads[r] = std::thread(ShaderCacheReaderThread, &readers[r]);
+		}
+
+		for (size_t i = cached_count; (i < permutations.size()) && SUCCEEDED(status); i++)
+		{
+			const void* pCode = NULL;
+			size_t code_size = 0;
+
+			if (FAILED(cache.Get(permutations[i].GetSource(), compiler, &pCode, &code_size)) || !MatchesBytecode(pCode, code_size, expected[i]))
+			{
+				writer_mismatches++;
+			}
+
+			status = cache.Save();
+		}
+
+		writer_done = true;
+
+		unsigned int passes = 0;
+		unsigned int mismatches = writer_mismatches;
+
+		for (unsigned int r = 0; r < READER_COUNT; r++)
+		{
+			if (threads[r].joinable())
+			{
+				threads[r].join();
+
+				passes += readers[r].passes;
+				mismatches += readers[r].mismatches;
+
+				for (size_t i = 0; i < permutations.size(); i++)
+				{
+					const void* pCode = readers[r].first_code[i];
+
+					if ((pCode != NULL) && !MatchesBytecode(pCode, expected[i].size(), expected[i]))
+					{
+						mismatches++;
+					}
+				}
+			}
+		}
+
+		const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (SUCCEEDED(status) && (mismatches != 0))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %u gets returned the wrong bytecode or lost it to a save\n", status, mismatches);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			WriteToConsole("%u readers: %u passes over %zu permutations in %.1f ms while %zu were compiled and saved, %u compiles\n",
+				READER_COUNT, passes, permutations.size(), seconds * 1e3, permutations.size() - cached_count, compiler.GetCompileCount());
+			status = cache.Save();
+		}
+
+		cache.Close();
+	}
+
+	// the pack the readers and the writer left behind has everything
+	if (SUCCEEDED(status))
+	{
+		status = CheckShaderPack(CACHE_PATH, permutations, expected, 0);
+	}
+
+	std::vector<BYTE> pack;
+	ReadWholeFile(CACHE_PATH, pack);
+
+	// a truncated pack is ignored as a whole, everything is compiled again and the rewritten pack is whole
+	if (SUCCEEDED(status))
+	{
+		const size_t lengths[] = { 0, 7, pack.size() / 2, pack.size() - 1 };
+
+		WriteToConsole("loading truncated packs, which have to be rebuilt:\n");
+
+		for (size_t i = 0; (i < ARRAYSIZE(lengths)) && SUCCEEDED(status); i++)
+		{
+			WriteWholeFile(CACHE_PATH, pack.data(), lengths[i]);
+
+			status = CheckShaderPack(CACHE_PATH, permutations, expected, static_cast<unsigned int>(permutations.size()));
+
+			if (SUCCEEDED(status))
+			{
+				status = CheckShaderPack(CACHE_PATH, permutations, expected, 0);
+			}
+		}
+	}
+
+	// a damaged blob is a single miss, a damaged entry table throws away the pack
+	if (SUCCEEDED(status))
+	{
+		std::vector<BYTE> damaged = pack;
+
+		WriteToConsole("loading damaged packs, which have to be repaired:\n");
+
+		// the bytecode is a multiple of the blob alignment, so the last byte of the pack is in the last blob
+		damaged.back() ^= 0x40;
+		WriteWholeFile(CACHE_PATH, damaged.data(), damaged.size());
+
+		status = CheckShaderPack(CACHE_PATH, permutations, expected, 1);
+
+		if (SUCCEEDED(status))
+		{
+			status = CheckShaderPack(CACHE_PATH, permutations, expected, 0);
+		}
+
+		// the header is 24 bytes, so byte 24 is in the key of the first entry
+		if (SUCCEEDED(status))
+		{
+			damaged = pack;
+			damaged[24] ^= 0x40;
+			WriteWholeFile(CACHE_PATH, damaged.data(), damaged.size());
+
+			status = CheckShaderPack(CACHE_PATH, permutations, expected, static_cast<unsigned int>(permutations.size()));
+		}
+
+		if (SUCCEEDED(status))
+		{
+			status = CheckShaderPack(CACHE_PATH, permutations, expected, 0);
+		}
+	}
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("every truncated and damaged pack was recovered\n");
+	}
+
+	remove(CACHE_PATH);
+
+	return status;
+}
@@ -0,0 +1,118 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+#include "JobSystem.h"
+#include "Simulation.h"
+
+INT RunSimulationStress(unsigned int seconds, JobSystem& jobs)
+{
+	const unsigned int GRID = 4;
+	const unsigned int TICK_RATE = 2000;
+	const unsigned int STALL_INTERVAL = 100; // frames
+	const std::chrono::milliseconds STALL_TIME(50);
+	const std::chrono::nanoseconds LATENCY_BOUND(4 * 1000000000LL / TICK_RATE);
+
+	INT status = STATUS_SUCCESS;
+
+	Simulation simulation;
+	simulation.Initialize(GRID, jobs);
+
+	std::default_random_engine generator;
+	std::uniform_int_distribution<int> frame_time(0, 2000);
+
+	uint64_t frames = 0;
+	uint64_t torn = 0;
+	uint64_t reordered = 0;
+	uint64_t blocked = 0;
+	uint64_t late = 0;
+	uint64_t last_tick = 0;
+	float last_rotation[4];
+	std::vector<float> last_transforms;
+	std::chrono::nanoseconds max_acquire(0);
+	std::chrono::nanoseconds max_latency(0);
+
+	Quaternion::ToIdentity(last_rotation);
+
+	status = simulation.Start(TICK_RATE);
+
+	const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+
+	while (SUCCEEDED(status) && (std::chrono::steady_clock::now() < end))
+	{
+		const std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		const SimulationState& state = simulation.Acquire();
+		const std::chrono::steady_clock::time_point acquired = std::chrono::steady_clock::now();
+
+		max_acquire = std::max(max_acquire, std::chrono::duration_cast<std::chrono::nanoseconds>(acquired - begin));
+
+		const std::chrono::nanoseconds latency = std::chrono::duration_cast<std::chrono::nanoseconds>(acquired - state.time);
+		max_latency = std::max(max_latency, latency);
+		late += (latency > LATENCY_BOUND) ? 1 : 0;
+
+		// a torn state mixes fields written by different ticks
+		Matrix::Affine3x4 expected;
+		Quaternion::ToMatrix(state.rotation, expected);
+
+		if (memcmp(&expected, &state.matrices.model_matrix, sizeof(expected)) != 0)
+		{
+			torn++;
+		}
+
+		if ((state.tick == last_tick + 1) && (memcmp(last_rotation, state.previous_rotation, sizeof(last_rotation)) != 0))
+		{
+			torn++;
+		}
+
+		// the transforms to interpolate from have to be the ones of the tick before
+		if ((state.tick == last_tick + 1) && (last_transforms != state.previous_transforms))
+		{
+			torn++;
+		}
+
+		if (state.tick < last_tick)
+		{
+			reordered++;
+		}
+
+		last_tick = state.tick;
+		CopyMemory(last_rotation, state.rotation, sizeof(last_rotation));
+		last_transforms = state.transforms;
+
+		// the producer has to keep publishing while the consumer holds on to one state
+		if (frames % STALL_INTERVAL == STALL_INTERVAL - 1)
+		{
+			std::this_thread::sleep_for(STALL_TIME);
+			blocked += (simulation.Acquire().tick == last_tick) ? 1 : 0;
+
+			last_tick = 0;
+		}
+		else
+		{
+			std::this_thread::sleep_for(std::chrono::microseconds(frame_time(generator)));
+		}
+
+		frames++;
+	}
+
+	simulation.Stop();
+
+	if (SUCCEEDED(status))
+	{
+		WriteToConsole("simulation stress: %llu frames, %llu torn, %llu reordered, %llu blocked, max acquire %.3f us\n",
+			static_cast<unsigned long long>(frames), static_cast<unsigned long long>(torn), static_cast<unsigned long long>(reordered),
+			static_cast<unsigned long long>(blocked), max_acquire.count() * 1e-3);
+
+		WriteToConsole("simulation stress: %.2f%% of frames later than %.3f ms, max latency %.3f ms\n",
+			frames ? 100.0 * late / frames : 0.0, LATENCY_BOUND.count() * 1e-6, max_latency.count() * 1e-6);
+
+		// the latency depends on how the os schedules both threads, so a few late frames are tolerated
+		if ((torn != 0) || (reordered != 0) || (blocked != 0) || (late * 20 > frames))
+		{
+			status = STATUS_UNSUCCESSFUL;
+			WriteToConsole("error 0x%X: the simulation stress test failed\n", status);
+		}
+	}
+
+	return status;
+}
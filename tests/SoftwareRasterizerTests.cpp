@@ -0,0 +1,381 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Profiler.h"
+#include "Matrix.h"
+#include "Data.h"
+#include "Mesh.h"
+#include "Culling.h"
+#include "JobSystem.h"
+#include "FrameArena.h"
+#include "InstanceUploader.h"
+#include "Simulation.h"
+#include "SoftwareRasterizer.h"
+
+// a screen aligned rectangle in pixels, drawn as two clockwise triangles. its depth runs linearly from depth[0] on the
+// left edge to depth[1] on the right one, and its color is the same all over
+struct RasterRect
+{
+	float x0, y0;
+	float x1, y1;
+	float depth[2];
+	float color[3];
+};
+
+uint32_t GetRasterColor(const float color[3])
+{
+	return 0xFF000000 | static_cast<uint32_t>(color[0] * 255.0f) | static_cast<uint32_t>(color[1] * 255.0f) << 8 | static_cast<uint32_t>(color[2] * 255.0f) << 16;
+}
+
+// the rects as triangles in clip space, under an identity model matrix, w is 1
+VOID DrawRasterRects(SoftwareRasterizer& rasterizer, const std::vector<RasterRect>& rects, unsigned int size)
+{
+	std::vector<Data::Vertex> vertices;
+
+	for (const RasterRect& rect : rects)
+	{
+		const float corners[4][3] =
+		{
+			{ rect.x0, rect.y0, rect.depth[0] }, { rect.x1, rect.y0, rect.depth[1] },
+			{ rect.x0, rect.y1, rect.depth[0] }, { rect.x1, rect.y1, rect.depth[1] }
+		};
+
+		const unsigned int order[6] = { 0, 1, 2, 1, 3, 2 };
+
+		for (unsigned int k = 0; k < 6; k++)
+		{
+			const float* corner = corners[order[k]];
+
+			Data::Vertex vertex;
+			vertex.position[0] = 2.0f * corner[0] / size - 1.0f;
+			vertex.position[1] = 1.0f - 2.0f * corner[1] / size;
+			vertex.position[2] = corner[2];
+			CopyMemory(vertex.color, rect.color, sizeof(vertex.color));
+
+			vertices.push_back(vertex);
+		}
+	}
+
+	Data::MatrixBuffer matrices;
+	Matrix::ToIdentity(matrices.model_matrix);
+
+	rasterizer.Draw(vertices.data(), static_cast<unsigned int>(vertices.size()), matrices);
+	rasterizer.Flush();
+}
+
+/*
+* what d3d draws for the rects: a pixel belongs to a rect if its center is in [x0, x1) x [y0, y1), the top-left rule
+* on its edges, and its depth at the center is within the clip volume 0 <= z <= 1. it is written if its depth is less
+* than the one in the target. returns the number of pixels written.
+*/
+uint64_t RenderRasterReference(const std::vector<RasterRect>& rects, unsigned int size, std::vector<uint32_t>& colors, std::vector<uint32_t>& depths)
+{
+	uint64_t pixels = 0;
+
+	for (const RasterRect& rect : rects)
+	{
+		for (unsigned int y = 0; y < size; y++)
+		{
+			for (unsigned int x = 0; x < size; x++)
+			{
+				const double px = x + 0.5;
+				const double py = y + 0.5;
+
+				if ((px < rect.x0) || (px >= rect.x1) || (py < rect.y0) || (py >= rect.y1))
+				{
+					continue;
+				}
+
+				const double z = rect.depth[0] + (rect.depth[1] - rect.depth[0]) * (px - rect.x0) / (rect.x1 - rect.x0);
+				if ((z < 0.0) || (z > 1.0))
+				{
+					continue;
+				}
+
+				const uint32_t zq = static_cast<uint32_t>(z * 0xFFFFFF + 0.5);
+				if (zq < depths[y * size + x])
+				{
+					colors[y * size + x] = GetRasterColor(rect.color);
+					depths[y * size + x] = zq;
+					pixels++;
+				}
+			}
+		}
+	}
+
+	return pixels;
+}
+
+// draws the rects and compares the targets and the pixels written to the reference, the depths within maxDepthError
+INT CheckRasterScene(SoftwareRasterizer& rasterizer, const char* name, const std::vector<RasterRect>& rects, unsigned int size, uint32_t maxDepthError, std::vector<uint32_t>& colors)
+{
+	const float clear_color[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	INT status = STATUS_SUCCESS;
+
+	colors.assign(static_cast<size_t>(size) * size, 0xFF000000);
+	std::vector<uint32_t> depths(static_cast<size_t>(size) * size, 0xFFFFFF);
+	const uint64_t expected_pixels = RenderRasterReference(rects, size, colors, depths);
+
+	const uint64_t pixels_before = rasterizer.GetPixelCount();
+
+	rasterizer.Clear(clear_color, 1.0f);
+	DrawRasterRects(rasterizer, rects, size);
+
+	const uint64_t pixels = rasterizer.GetPixelCount() - pixels_before;
+
+	size_t color_errors = 0;
+	uint32_t depth_error = 0;
+	unsigned int first_x = 0, first_y = 0;
+
+	for (unsigned int y = 0; y < size; y++)
+	{
+		for (unsigned int x = 0; x < size; x++)
+		{
+			const uint32_t color = rasterizer.GetColorBuffer()[static_cast<size_t>(y) * rasterizer.GetStride() + x];
+			const uint32_t depth = rasterizer.GetDepthBuffer()[static_cast<size_t>(y) * rasterizer.GetStride() + x];
+			const uint32_t expected_depth = depths[y * size + x];
+
+			if ((color != colors[y * size + x]) && (color_errors++ == 0))
+			{
+				first_x = x;
+				first_y = y;
+			}
+
+			depth_error = std::max(depth_error, (depth > expected_depth) ? depth - expected_depth : expected_depth - depth);
+		}
+	}
+
+	if ((color_errors != 0) || (depth_error > maxDepthError) || (pixels != expected_pixels))
+	{
+		status = STATUS_DATA_ERROR;
+		WriteToConsole("error 0x%X: %s: %zu pixels of the wrong color, the first at %u %u, depths off by up to %u, %llu pixels written instead of %llu\n",
+			status, name, color_errors, first_x, first_y, depth_error, static_cast<unsigned long long>(pixels), static_cast<unsigned long long>(expected_pixels));
+
+		// the frame is kept for a look at what went wrong
+		rasterizer.WritePPM("rasterizer-error.ppm");
+	}
+	else
+	{
+		WriteToConsole("%s: %llu pixels written, as expected\n", name, static_cast<unsigned long long>(pixels));
+	}
+
+	return status;
+}
+
+// renders the spinning instances with the software rasterizer for FRAME_COUNT frames and reports the throughput
+INT RenderRasterizerFrames(unsigned int width, unsigned int height, JobSystem& jobs, const char* ppmPath)
+{
+	const unsigned int FRAME_COUNT = 100;
+
+	INT status = STATUS_SUCCESS;
+
+	// the simulation is stepped once per frame on this thread so every run renders the same frames
+	Simulation simulation;
+	SoftwareRasterizer rasterizer;
+	RecordingInstanceUploader uploader;
+	Mesh::IndexedMesh mesh;
+
+	Mesh::Build(Data::Vertices, ARRAYSIZE(Data::Vertices), mesh);
+	simulation.Initialize(INSTANCE_GRID, jobs);
+
+	FrameArena arena;
+	arena.Initialize(simulation.GetInstanceCount() * (sizeof(uint32_t) + sizeof(float) * Data::INSTANCE_SIZE) + 2 * FrameArena::DEFAULT_ALIGNMENT, jobs);
+
+	size_t visible_total = 0;
+
+	status = rasterizer.Initialize(width, height, jobs);
+
+	if (SUCCEEDED(status))
+	{
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+		for (unsigned int frame = 0; frame < FRAME_COUNT; frame++)
+		{
+			PROFILE_SCOPE("Frame");
+
+			arena.BeginFrame();
+
+			{
+				PROFILE_SCOPE("Update");
+				simulation.Step(std::chrono::steady_clock::now());
+			}
+
+			const SimulationState& state = simulation.Acquire();
+			size_t visible_count = 0;
+			float* transforms = NULL;
+
+			{
+				PROFILE_SCOPE("Cull");
+
+				Culling::Frustum frustum;
+				Culling::ExtractFrustum(state.matrices.model_matrix, frustum);
+
+				uint32_t* visible = arena.Allocate<uint32_t>(simulation.GetInstanceCount());
+
+				if (visible != NULL)
+				{
+					visible_count = Culling::Cull(frustum, state.spheres.data(), simulation.GetInstanceCount(), visible);
+					transforms = arena.Allocate<float>(visible_count * Data::INSTANCE_SIZE);
+				}
+
+				if (transforms != NULL)
+				{
+					Culling::Gather(visible, visible_count, state.transforms.data(), transforms);
+				}
+				else
+				{
+					status = STATUS_NO_MEMORY;
+					WriteToConsole("error 0x%X: out of memory for the visible instances\n", status);
+					break;
+				}
+
+				visible_total += visible_count;
+			}
+
+			uploader.Upload(transforms, visible_count * sizeof(float) * Data::INSTANCE_SIZE);
+
+			PROFILE_SCOPE("Rasterize");
+
+			rasterizer.Clear(Data::ClearColor, 1.0f);
+			rasterizer.DrawIndexedInstanced(mesh.vertices.data(), static_cast<unsigned int>(mesh.vertices.size()), mesh.indices.data(), static_cast<unsigned int>(mesh.indices.size()),
+				transforms, visible_count, state.matrices);
+			rasterizer.Flush();
+		}
+
+		if (SUCCEEDED(status))
+		{
+			const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+			WriteToConsole("software rasterizer %ux%u, %u threads: %.1f fps, %.3f Mtri/s, %.1f Mpix/s\n",
+				width, height, jobs.GetThreadCount(), FRAME_COUNT / seconds,
+				rasterizer.GetTriangleCount() / seconds * 1e-6, rasterizer.GetPixelCount() / seconds * 1e-6);
+
+			WriteToConsole("instance stream: %zu instances, %zu visible and %llu bytes uploaded per frame\n",
+				simulation.GetInstanceCount(), visible_total / FRAME_COUNT, static_cast<unsigned long long>(uploader.GetByteCount() / uploader.GetUploadCount()));
+		}
+
+		if (SUCCEEDED(status) && (ppmPath != NULL))
+		{
+			status = rasterizer.WritePPM(ppmPath);
+		}
+	}
+
+	rasterizer.Uninitialize();
+
+	return status;
+}
+
+INT RunRasterizerBenchmark(unsigned int width, unsigned int height, JobSystem& jobs)
+{
+	const unsigned int SCENE_SIZE = 256; // 4 x 4 tiles
+	const uint32_t MAX_DEPTH_ERROR = 16; // of the 24 bit depth, about 1e-6, interpolated in float
+
+	INT status = STATUS_SUCCESS;
+
+	SoftwareRasterizer rasterizer;
+	status = rasterizer.Initialize(SCENE_SIZE, SCENE_SIZE, jobs);
+
+	// a 4 x 4 grid of rects that share their edges, with the pixel centers right on the edges and across the tile
+	// border at 64. every pixel has to be drawn by exactly one triangle: each rect is nearer than the ones before, so
+	// a pixel drawn twice would be counted twice and a pixel missed would keep the clear color
+	if (SUCCEEDED(status))
+	{
+		std::vector<RasterRect> rects;
+		std::vector<uint32_t> colors;
+
+		for (unsigned int j = 0; j < 4; j++)
+		{
+			for (unsigned int i = 0; i < 4; i++)
+			{
+				// neighbours differ in color, none is black like the clear color
+				const unsigned int c = 1 + (i + 2 * j) % 7;
+				const float depth = 0.5f - 0.01f * (j * 4 + i);
+
+				RasterRect rect = { 40.5f + 16.0f * i, 40.5f + 16.0f * j, 56.5f + 16.0f * i, 56.5f + 16.0f * j, { depth, depth },
+					{ static_cast<float>(c & 1), static_cast<float>((c >> 1) & 1), static_cast<float>((c >> 2) & 1) } };
+				rects.push_back(rect);
+			}
+		}
+
+		status = CheckRasterScene(rasterizer, "top-left fill rule", rects, SCENE_SIZE, MAX_DEPTH_ERROR, colors);
+	}
+
+	// depth across a rect, and rects that reach in front of the near plane and behind the far one or lie all outside
+	// of them. the clipped parts must not be drawn at the clamped depth
+	if (SUCCEEDED(status))
+	{
+		const RasterRect rects[] =
+		{
+			{ 140.0f,  20.0f, 204.0f,  50.0f, {  0.25f, 0.75f }, { 1.0f, 0.0f, 0.0f } },
+			{ 140.0f,  60.0f, 204.0f,  90.0f, { -0.50f, 0.50f }, { 0.0f, 1.0f, 0.0f } },
+			{ 140.0f, 100.0f, 204.0f, 130.0f, {  0.50f, 1.50f }, { 0.0f, 0.0f, 1.0f } },
+			{ 140.0f, 140.0f, 204.0f, 170.0f, { -1.00f, -0.5f }, { 1.0f, 1.0f, 0.0f } },
+			{ 140.0f, 180.0f, 204.0f, 210.0f, {  1.25f, 2.00f }, { 1.0f, 0.0f, 1.0f } }
+		};
+
+		std::vector<uint32_t> colors;
+		status = CheckRasterScene(rasterizer, "depth and near and far clipping", std::vector<RasterRect>(rects, rects + ARRAYSIZE(rects)), SCENE_SIZE, MAX_DEPTH_ERROR, colors);
+	}
+
+	// two overlapping rects drawn front to back and back to front have to give the same frame, back to front writes
+	// the overlap twice. the same rect drawn again in other colors has the same depths and keeps the first one drawn,
+	// also when its triangles are binned by different threads
+	if (SUCCEEDED(status))
+	{
+		const RasterRect near_rect = { 20.0f, 150.0f, 120.0f, 230.0f, { 0.3f, 0.3f }, { 1.0f, 0.0f, 0.0f } };
+		const RasterRect far_rect  = { 60.0f, 170.0f, 180.0f, 250.0f, { 0.6f, 0.6f }, { 0.0f, 1.0f, 0.0f } };
+
+		std::vector<RasterRect> front_to_back;
+		front_to_back.push_back(near_rect);
+		front_to_back.push_back(far_rect);
+
+		std::vector<RasterRect> back_to_front;
+		back_to_front.push_back(far_rect);
+		back_to_front.push_back(near_rect);
+
+		std::vector<uint32_t> front_to_back_colors;
+		std::vector<uint32_t> back_to_front_colors;
+
+		status = CheckRasterScene(rasterizer, "front to back", front_to_back, SCENE_SIZE, MAX_DEPTH_ERROR, front_to_back_colors);
+
+		if (SUCCEEDED(status))
+		{
+			status = CheckRasterScene(rasterizer, "back to front", back_to_front, SCENE_SIZE, MAX_DEPTH_ERROR, back_to_front_colors);
+		}
+
+		if (SUCCEEDED(status) && (front_to_back_colors != back_to_front_colors))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: drawing front to back and back to front gave different frames\n", status);
+		}
+
+		if (SUCCEEDED(status))
+		{
+			std::vector<RasterRect> equal_depth;
+			std::vector<uint32_t> colors;
+
+			for (unsigned int c = 1; c < 8; c++)
+			{
+				RasterRect rect = { 10.0f, 10.0f, 230.0f, 140.0f, { 0.25f, 0.75f },
+					{ static_cast<float>(c & 1), static_cast<float>((c >> 1) & 1), static_cast<float>((c >> 2) & 1) } };
+				equal_depth.push_back(rect);
+			}
+
+			status = CheckRasterScene(rasterizer, "same depths in submission order", equal_depth, SCENE_SIZE, MAX_DEPTH_ERROR, colors);
+		}
+	}
+
+	rasterizer.Uninitialize();
+
+	if (SUCCEEDED(status))
+	{
+		status = RenderRasterizerFrames(WIDTH, HEIGHT, jobs, "frame.ppm");
+	}
+
+	if (SUCCEEDED(status))
+	{
+		status = RenderRasterizerFrames(width, height, jobs, NULL);
+	}
+
+	return status;
+}
@@ -0,0 +1,184 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "VertexPacking.h"
+#include "ConstantRing.h"
+#include "RenderContext.h"
+#include "StateCache.h"
+#include "Simulation.h"
+
+INT RunStateCacheBenchmark()
+{
+	const unsigned int FRAME_COUNT = 100;
+	const unsigned int DRAW_COUNT = 4096;
+	const unsigned int SHADER_COUNT = 4;
+	const unsigned int LAYOUT_COUNT = 2;
+	const unsigned int MESH_COUNT = 16;
+	const unsigned int MATERIAL_COUNT = 32;
+	const unsigned int REPEAT_COUNT = 10;
+
+	enum { KIND_VERTEX_SHADER, KIND_PIXEL_SHADER, KIND_LAYOUT, KIND_VERTEX_BUFFER, KIND_INDEX_BUFFER, KIND_CONSTANT_BUFFER, KIND_TARGET };
+
+	INT status = STATUS_SUCCESS;
+
+	// the draw of Renderer::Render, every frame the same but for the block of the constant ring it binds
+	{
+		RecordingRenderContext direct;
+		RecordingRenderContext recording;
+		StateCache cache(&recording);
+		ConstantRing ring;
+
+		status = ring.Initialize(64 * 1024, ConstantRing::MAX_FRAMES);
+
+		ID3D11RenderTargetView* pTarget = GetFakeObject<ID3D11RenderTargetView>(KIND_TARGET, 0);
+		ID3D11DepthStencilView* pDepth = GetFakeObject<ID3D11DepthStencilView>(KIND_TARGET, 1);
+
+		DrawQueue::Draw draw = {};
+		draw.pVertexShader = GetFakeObject<ID3D11VertexShader>(KIND_VERTEX_SHADER, 0);
+		draw.pPixelShader = GetFakeObject<ID3D11PixelShader>(KIND_PIXEL_SHADER, 0);
+		draw.pInputLayout = GetFakeObject<ID3D11InputLayout>(KIND_LAYOUT, 0);
+		draw.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+		draw.pVertexBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, 0);
+		draw.pVertexBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, 1);
+		draw.strides[0] = VertexPacking::Layouts[VertexPacking::FORMAT_SNORM16].stride;
+		draw.strides[1] = sizeof(float) * Data::INSTANCE_SIZE;
+		draw.vertex_buffer_count = 2;
+		draw.pIndexBuffer = GetFakeObject<ID3D11Buffer>(KIND_INDEX_BUFFER, 0);
+		draw.index_format = DXGI_FORMAT_R16_UINT;
+		draw.pConstantBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 0);
+		draw.pConstantBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 1);
+		draw.constant_buffer_count = 2;
+		draw.index_count = 36;
+
+		DrawQueue queues[2];
+
+		for (unsigned int frame = 0; (frame < FRAME_COUNT) && SUCCEEDED(status); frame++)
+		{
+			ConstantRing::Block block;
+
+			ring.BeginFrame();
+			status = ring.Allocate(sizeof(Data::MatrixBuffer), 1, &block);
+
+			draw.first_constants[0] = ConstantRing::GetFirstConstant(block, 0);
+			draw.constant_counts[0] = ConstantRing::GetConstantCount(block);
+			draw.instance_count = frame;
+
+			direct.OMSetRenderTargets(1, &pTarget, pDepth);
+			queues[0].Add(draw);
+			queues[0].Submit(direct);
+
+			cache.OMSetRenderTargets(1, &pTarget, pDepth);
+			queues[1].Add(draw);
+			queues[1].Submit(cache);
+			cache.InvalidateRenderTargets();
+		}
+
+		if (SUCCEEDED(status) && (direct.GetEvents() != recording.GetEvents()))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the state cache changes the state the renderer's draws see\n", status);
+		}
+
+		WriteToConsole("renderer frame: %.2f binds per frame, %.2f through the state cache\n",
+			direct.GetBindCount() / static_cast<double>(FRAME_COUNT), recording.GetBindCount() / static_cast<double>(FRAME_COUNT));
+	}
+
+	// a pass of random draws, each a mesh of one of the layouts drawn with some shader and material
+	if (SUCCEEDED(status))
+	{
+		RandomStream random(1);
+		std::vector<DrawQueue::Draw> draws(DRAW_COUNT);
+
+		for (DrawQueue::Draw& draw : draws)
+		{
+			const unsigned int shader = random.Next() % SHADER_COUNT;
+			const unsigned int mesh = random.Next() % MESH_COUNT;
+			const unsigned int material = random.Next() % MATERIAL_COUNT;
+
+			draw = DrawQueue::Draw();
+			draw.pVertexShader = GetFakeObject<ID3D11VertexShader>(KIND_VERTEX_SHADER, shader);
+			draw.pPixelShader = GetFakeObject<ID3D11PixelShader>(KIND_PIXEL_SHADER, shader);
+			draw.pInputLayout = GetFakeObject<ID3D11InputLayout>(KIND_LAYOUT, mesh % LAYOUT_COUNT);
+			draw.topology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+			draw.pVertexBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, mesh);
+			draw.pVertexBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_VERTEX_BUFFER, MESH_COUNT);
+			draw.strides[0] = VertexPacking::Layouts[mesh % LAYOUT_COUNT].stride;
+			draw.strides[1] = sizeof(float) * Data::INSTANCE_SIZE;
+			draw.vertex_buffer_count = 2;
+			draw.pIndexBuffer = GetFakeObject<ID3D11Buffer>(KIND_INDEX_BUFFER, mesh);
+			draw.index_format = DXGI_FORMAT_R16_UINT;
+			draw.pConstantBuffers[0] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 0);
+			draw.pConstantBuffers[1] = GetFakeObject<ID3D11Buffer>(KIND_CONSTANT_BUFFER, 1 + material);
+			draw.constant_buffer_count = 2;
+			draw.index_count = 36 * (mesh + 1);
+			draw.instance_count = 1;
+			draw.start_instance = static_cast<UINT>(&draw - draws.data());
+		}
+
+		RecordingRenderContext direct;
+		RecordingRenderContext cached;
+		RecordingRenderContext sorted;
+		StateCache cache(&cached);
+		StateCache sorted_cache(&sorted);
+		DrawQueue queue;
+
+		// every draw binds everything, in the order the draws were made
+		for (const DrawQueue::Draw& draw : draws)
+		{
+			queue.Add(draw);
+			queue.Submit(direct);
+		}
+
+		for (const DrawQueue::Draw& draw : draws)
+		{
+			queue.Add(draw);
+			queue.Submit(cache);
+		}
+
+		double seconds = 0.0;
+
+		for (unsigned int repeat = 0; repeat < REPEAT_COUNT; repeat++)
+		{
+			RecordingRenderContext timed;
+			StateCache timed_cache(&timed);
+
+			const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+			for (const DrawQueue::Draw& draw : draws)
+			{
+				queue.Add(draw);
+			}
+
+			queue.Submit((repeat == 0) ? sorted_cache : timed_cache);
+
+			seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+
+		std::vector<uint64_t> expected = direct.GetEvents();
+		std::vector<uint64_t> actual = sorted.GetEvents();
+		std::sort(expected.begin(), expected.end());
+		std::sort(actual.begin(), actual.end());
+
+		if ((direct.GetEvents() != cached.GetEvents()) || (expected != actual))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: the state cache or the draw queue changes the state the draws see\n", status);
+		}
+
+		WriteToConsole("%u draws, binds per draw: %.2f, %.2f through the state cache, %.2f sorted (%.1f ns per draw to queue, sort and submit to the recording)\n",
+			DRAW_COUNT, direct.GetBindCount() / static_cast<double>(DRAW_COUNT), cached.GetBindCount() / static_cast<double>(DRAW_COUNT),
+			sorted.GetBindCount() / static_cast<double>(DRAW_COUNT), seconds * 1e9 / (static_cast<double>(DRAW_COUNT) * REPEAT_COUNT));
+
+		const char* names[RenderContext::BIND_COUNT] = { "render targets", "vertex buffers", "index buffer", "topology", "input layout", "vertex shader", "constant buffers", "pixel shader" };
+
+		for (unsigned int i = 0; i < RenderContext::BIND_COUNT; i++)
+		{
+			const RenderContext::Bind bind = static_cast<RenderContext::Bind>(i);
+
+			WriteToConsole("  %-16s %6llu %6llu %6llu\n", names[i], static_cast<unsigned long long>(direct.GetBindCount(bind)),
+				static_cast<unsigned long long>(cached.GetBindCount(bind)), static_cast<unsigned long long>(sorted.GetBindCount(bind)));
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Common.h"
+#include "JobSystem.h"
+
+/*
+* runs the simulation thread far faster than its normal tick rate against a fake renderer that only acquires states,
+* with frames of random length and the occasional long stall, and checks the handoff between the two threads:
+* every state must be internally consistent and never older than the one before it, the producer must keep ticking
+* while the consumer stalls, and the consumer should see a tick at most a few timesteps after it was scheduled.
+*/
+INT RunSimulationStress(unsigned int seconds, JobSystem& jobs);
+
+/*
+* packs and unpacks a large random mesh in every vertex format, reports the throughput of both directions and fails
+* if any round trip leaves the error bound of its format
+*/
+INT RunVertexPackingBenchmark();
+
+/*
+* checks every matrix kernel set the cpu supports against the scalar reference, within MAX_ULP_ERROR for Multiply and
+* exactly between the kernels of a set, and times Multiply and MultiplyBatch of each set against the scalar ones on
+* SWEEP_COUNTS matrices, in ns and in GB/s read and written per matrix, so that the counts where the products run out
+* of the caches and become bound by memory bandwidth show
+*/
+INT RunMatrixBenchmark();
+
+/*
+* checks the affine matrix path against the full one: Multiply on two Affine3x4 has to give the result of the full
+* kernel on the expanded matrices, also in place, a Mat4 times an Affine3x4 the one of Scalar::Multiply, and the
+* affine batch kernel the one of the full batch kernel. times both paths on SWEEP_COUNTS matrices, in ns and in GB/s
+* per matrix, and prints the size of the model matrix upload and of the instance stream.
+*/
+INT RunAffineBenchmark();
+
+/*
+* first checks that threads outside the pool give their spare slots back when they exit. then steps the full scene on
+* job systems of 1 to 64 threads and reports the time per tick. the ticks include a change of rotation, and every
+* thread count has to produce exactly the transforms of the single threaded run.
+*/
+INT RunJobBenchmark();
+
+INT RunRotationBenchmark();
+
+/*
+* steps a rotation by random steps like the simulation for the given number of frames, once as a renormalized
+* quaternion expanded to a matrix every frame and once as the accumulated euler matrix product the renderer used
+* before. fails if the quaternion path drifts from a rotation by more than a few ulps, reports the drift of both paths
+* every tenfold of frames and their time per frame.
+*/
+INT RunRotationDriftBenchmark(uint64_t frames);
+
+INT RunAnimationBenchmark(size_t trackCount);
+
+/*
+* a random scene of nodeCount nodes: node k is attached to a random one of the nodes made before it, and the nodes
+* are then numbered in a random order, as if they had been loaded and attached in no particular order. every frame
+* sets new local matrices on a fraction of the nodes at random. the flattened hierarchy is checked against a full
+* recursive propagation through a naive pointer based scene graph and timed against it, recomputing everything or
+* only the dirty subtrees.
+*/
+INT RunHierarchyBenchmark(size_t nodeCount, JobSystem& jobs);
+
+INT RunCullingBenchmark(JobSystem& jobs);
+
+/*
+* checks the software rasterizer on frames of screen aligned rects whose every pixel is known: a grid of rects sharing
+* their edges has to draw each pixel on them exactly once by the top-left rule, depths have to be interpolated and
+* clipped to the near and far planes instead of clamped, overlapping rects have to give the same frame front to back
+* and back to front, and a rect drawn again at the same depths has to keep the first one drawn. then renders the
+* spinning instances at WIDTH x HEIGHT, which goes to frame.ppm, and at width x height and reports the throughput of both.
+*/
+INT RunRasterizerBenchmark(unsigned int width, unsigned int height, JobSystem& jobs);
+
+/*
+* builds, refits and queries bvhs of 10 thousand up to maxCount instances. the frustum queries have to find exactly
+* the instances whose boxes a linear pass over all of them finds and every pick has to hit the same instance at the
+* same distance as testing every instance.
+*/
+INT RunBvhBenchmark(size_t maxCount, JobSystem& jobs);
+
+/*
+* writes a grid mesh of about gigabytes into a pack and loads it three ways: by opening it and touching one vertex in
+* every 64 MB, by touching every page of it, and by reading the whole file without a mapping. the page faults and
+* working set show that opening only maps the file and that pages come in as they are touched. the file was just
+* written, so the pages come from the file cache unless it was evicted, the same as a second run of the application.
+*/
+INT RunMeshPackBenchmark(unsigned int gigabytes);
+
+/*
+* generates every shape with about triangles triangles on the job system and on one thread and checks that both are
+* the same to the bit, that every index is in range, every vertex inside GetExtent, that only the poles of the uv
+* sphere are degenerate and that every triangle faces out. another seed has to change the terrain, and a terrain
+* streamed into a pack has to come back within the error of its vertex format. prints the rates of all of it.
+*/
+INT RunMeshGeneratorBenchmark(uint64_t triangles, JobSystem& jobs);
+
+/*
+* checks the steps of Mesh::Build on the cube and on every shape of the generator: the vertex cache optimization keeps
+* the triangles up to their order and rotation, the vertex fetch optimization keeps every vertex and the vertex values
+* of every triangle, and the acmr does not get worse. then times both optimizations on terrains of a 64th, a 16th, a
+* quarter and all of triangles triangles, the time per triangle stays about the same when they scale linearly.
+*/
+INT RunMeshOptimizeBenchmark(uint64_t triangles, JobSystem& jobs);
+
+/*
+* checks the frame arena: allocations are aligned, do not overlap and stay intact for FRAME_COUNT frames, workers
+* allocate from their own arenas, and overflowing arenas grow until a frame no longer touches the heap. the last part
+* runs the frame of the software rasterizer without the rasterizer, with a parallel cull on top, until 256 frames in a
+* row make no heap allocation that HeapCounter sees, then compares the cost of an allocation against new and delete.
+*/
+INT RunFrameArenaBenchmark(JobSystem& jobs);
+
+/*
+* runs the instance stream of the renderer's frames against a RecordingInstanceUploader: the simulation is stepped,
+* culled at the interpolated scene rotation and the visible transforms blended between the two ticks are uploaded.
+* every frame has to upload once, exactly visible count times the instance stride, and every uploaded instance has to
+* be the blend of its transforms in the simulation state and carry the mesh center to its culling sphere. times the
+* frames and prints the bytes uploaded per frame.
+*/
+INT RunInstanceUploadBenchmark(JobSystem& jobs);
+
+// stand-ins for d3d objects, only compared and hashed by the recording context
+template <typename T>
+T* GetFakeObject(unsigned int kind, unsigned int index)
+{
+	return reinterpret_cast<T*>(static_cast<uintptr_t>((kind + 1) << 20 | (index + 1) << 4));
+}
+
+/*
+* drives the renderer's frame and a pass of random draws into RecordingRenderContexts, once with every bind, once
+* through a StateCache and once through a sorted DrawQueue and a StateCache. the draws have to see the same state
+* every way, in the same order for the first two and as the same set for the sorted queue. prints how many binds
+* reach the context each way.
+*/
+INT RunStateCacheBenchmark();
+
+/*
+* checks the constant ring on a FakeConstantBuffer: that its blocks are what VSSetConstantBuffers1 binds, that writing
+* a frame leaves the constants of the frames in flight alone over thousands of wraps, that a frame that does not fit
+* fails without harm, and that draws binding ranges of it reach a RecordingRenderContext the same way directly, through
+* a command buffer and its capture, and through the state cache. times a frame of many objects written in one block
+* against a map for every object.
+*/
+INT RunConstantRingBenchmark();
+
+INT RunShaderBuildBenchmark();
+
+/*
+* checks the shader cache on a stub compiler: readers get every permutation while a writer compiles the missing ones
+* and saves after each, and every Get has to return the right bytecode that stays valid until Close. then truncated
+* packs and packs with a damaged blob or entry table have to be recompiled as far as they are damaged and rewritten.
+*/
+INT RunShaderCacheBenchmark();
+
+/*
+* records chunks of random draws into command buffers in parallel and checks that replaying them in order reaches a
+* RecordingRenderContext exactly as issuing them on one thread does, before and after a round trip through a capture
+* file. times the recording against issuing directly and the replay into a NullRenderContext.
+*/
+INT RunCommandBufferBenchmark(JobSystem& jobs);
+
+// replays a capture written by -capture-frame into a NullRenderContext, and once through a StateCache, and times it
+INT RunCaptureReplay(const char* path, unsigned int repeats);
+
+/*
+* times Write on 1 to 8 threads against formatting and writing on the calling thread, with the log going to a file.
+* checks that the file holds every record that was not dropped, that the records of a thread are in order, and that
+* the drops the log reports are the ones that were counted.
+*/
+INT RunLoggerBenchmark();
+
+/*
+* times an empty PROFILE_SCOPE with the profiler disabled and enabled, on the compiler this was built with. the loop
+* without a scope is timed as well and taken off both.
+*/
+INT RunProfilerBenchmark();
@@ -0,0 +1,69 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Data.h"
+#include "VertexPacking.h"
+
+INT RunVertexPackingBenchmark()
+{
+	const size_t VERTEX_COUNT = 1 << 20;
+	const unsigned int REPEAT_COUNT = 5;
+
+	INT status = STATUS_SUCCESS;
+
+	std::default_random_engine generator;
+	std::uniform_real_distribution<float> position(-10.0f, 10.0f);
+	std::uniform_real_distribution<float> color(0.0f, 1.0f);
+
+	std::vector<Data::Vertex> vertices(VERTEX_COUNT);
+	for (size_t i = 0; i < VERTEX_COUNT; i++)
+	{
+		for (unsigned int k = 0; k < 3; k++)
+		{
+			vertices[i].position[k] = position(generator);
+			vertices[i].color[k] = color(generator);
+		}
+	}
+
+	for (unsigned int f = 0; (f < VertexPacking::FORMAT_COUNT) && SUCCEEDED(status); f++)
+	{
+		const VertexPacking::Format format = static_cast<VertexPacking::Format>(f);
+
+		Data::MeshBuffer meshBuffer;
+		std::vector<BYTE> packed;
+		std::vector<Data::Vertex> unpacked;
+
+		VertexPacking::ComputeDequantization(format, vertices.data(), VERTEX_COUNT, meshBuffer);
+
+		// the best of a few runs, the first one also pays for the page faults
+		double pack_seconds = DBL_MAX;
+		double unpack_seconds = DBL_MAX;
+
+		for (unsigned int r = 0; r < REPEAT_COUNT; r++)
+		{
+			const std::chrono::steady_clock::time_point t0 = std::chrono::steady_clock::now();
+			VertexPacking::Pack(format, vertices.data(), VERTEX_COUNT, meshBuffer, packed);
+			const std::chrono::steady_clock::time_point t1 = std::chrono::steady_clock::now();
+			VertexPacking::Unpack(format, packed.data(), VERTEX_COUNT, meshBuffer, unpacked);
+			const std::chrono::steady_clock::time_point t2 = std::chrono::steady_clock::now();
+
+			pack_seconds = std::min(pack_seconds, std::chrono::duration<double>(t1 - t0).count());
+			unpack_seconds = std::min(unpack_seconds, std::chrono::duration<double>(t2 - t1).count());
+		}
+
+		float position_error, color_error, position_bound, color_bound;
+		VertexPacking::MeasureError(vertices.data(), unpacked.data(), VERTEX_COUNT, &position_error, &color_error);
+		VertexPacking::GetErrorBound(format, vertices.data(), VERTEX_COUNT, meshBuffer, &position_bound, &color_bound);
+
+		WriteToConsole("%s: %2u bytes per vertex, pack %.2f ns/vertex, unpack %.2f ns/vertex, position error %.3g (bound %.3g), color error %.3g (bound %.3g)\n",
+			VertexPacking::Layouts[format].name, VertexPacking::Layouts[format].stride, pack_seconds * 1e9 / VERTEX_COUNT, unpack_seconds * 1e9 / VERTEX_COUNT,
+			position_error, position_bound, color_error, color_bound);
+
+		if ((position_error > position_bound) || (color_error > color_bound))
+		{
+			status = STATUS_DATA_ERROR;
+			WriteToConsole("error 0x%X: %s vertices exceed their error bound\n", status, VertexPacking::Layouts[format].name);
+		}
+	}
+
+	return status;
+}
@@ -0,0 +1,352 @@
+#include "Tests.h"
+#include "Log.h"
+#include "Matrix.h"
+#include "JobSystem.h"
+
+// checks and times the subsystems of the app, one per run, selected by the flags below
+INT main(INT argc, CHAR* argv[])
+{
+	INT status = STATUS_SUCCESS;
+
+	JobSystem jobs;
+
+	unsigned int stress_seconds = 0;
+	bool benchmark_vertex_packing = false;
+	bool benchmark_jobs = false;
+	bool benchmark_rotations = false;
+	uint64_t benchmark_rotation_drift = 0;
+	size_t benchmark_animation = 0;
+	size_t benchmark_hierarchy = 0;
+	bool benchmark_matrix = false;
+	bool benchmark_affine = false;
+	bool benchmark_culling = false;
+	bool benchmark_rasterizer = false;
+	unsigned int rasterizer_width = 3840;
+	unsigned int rasterizer_height = 2160;
+	size_t benchmark_bvh = 0;
+	unsigned int benchmark_mesh_pack = 0;
+	uint64_t benchmark_mesh_generator = 0;
+	uint64_t benchmark_mesh_optimize = 0;
+	bool benchmark_frame_arena = false;
+	bool benchmark_instance_upload = false;
+	bool benchmark_state_cache = false;
+	bool benchmark_constant_ring = false;
+	bool benchmark_shader_build = false;
+	bool benchmark_shader_cache = false;
+	bool benchmark_command_buffers = false;
+	bool benchmark_logger = false;
+	bool benchmark_profiler = false;
+	const char* log_path = NULL;
+	const char* replay_path = NULL;
+	unsigned int replay_repeats = 100;
+
+	// -stress-simulation [seconds] checks the handoff between the simulation thread and a fake renderer
+	// -benchmark-vertex-packing measures and checks the vertex packers
+	// -benchmark-jobs measures how the simulation scales over 1 to 64 job threads
+	// -benchmark-rotations checks the batched sincos and compares the batched rotation builders against libm
+	// -benchmark-rotation-drift [frames] checks that the quaternion rotation does not drift and times it against matrices
+	// -benchmark-animation [tracks] checks the keyframe tracks against the exact slerp and times their playback
+	// -benchmark-hierarchy [nodes] checks the flattened scene hierarchy against a recursive one and times both
+	// -benchmark-matrix checks every matrix kernel set the cpu supports against the scalar one and times them
+	// -benchmark-affine checks the affine matrix products against the full ones and times both
+	// -benchmark-culling checks the simd frustum culling against the scalar one on a million instances and times both
+	// -benchmark-rasterizer [width height] checks the software rasterizer on known frames and times it at WIDTH x HEIGHT and at width x height
+	// -benchmark-bvh [instances] checks and times the bvh from 10 thousand up to 10 million instances
+	// -benchmark-mesh-pack [gigabytes] writes a mesh pack of that size and measures how it loads
+	// -benchmark-mesh-generator [triangles] checks and times the generator on every shape of about that many triangles
+	// -benchmark-mesh-optimize [triangles] checks the vertex cache and fetch optimizations and times them up to that many triangles
+	// -benchmark-frame-arena checks the frame arena, that a steady frame does not allocate, and times it against new
+	// -benchmark-instance-upload checks the bytes and transforms the frames upload to a recording instance uploader
+	// -benchmark-state-cache counts the binds the state cache and the sorted draw queue save on a recording context
+	// -benchmark-constant-ring checks the constant ring's blocks against a fake buffer and times a frame's upload
+	// -benchmark-shader-build checks the parallel shader build on a stub compiler and times it over 1 to 8 threads
+	// -benchmark-shader-cache checks concurrent shader cache readers and the recovery of truncated and damaged packs
+	// -benchmark-command-buffers checks the parallel recording and ordered replay of command buffers and times them
+	// -benchmark-logger checks that the log keeps or counts every record and times a call against a synchronous write
+	// -benchmark-profiler times a profiler scope while the profiler is disabled and while it records
+	// -log-file path writes the log to path instead of the console
+	// -replay-capture path [repeats] loads a capture of -capture-frame and times its replay
+	for (INT i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "-benchmark-vertex-packing") == 0)
+		{
+			benchmark_vertex_packing = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-jobs") == 0)
+		{
+			benchmark_jobs = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-rotations") == 0)
+		{
+			benchmark_rotations = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-rotation-drift") == 0)
+		{
+			benchmark_rotation_drift = 100000000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_rotation_drift = static_cast<uint64_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-animation") == 0)
+		{
+			benchmark_animation = 100000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_animation = static_cast<size_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-hierarchy") == 0)
+		{
+			benchmark_hierarchy = 1000000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_hierarchy = static_cast<size_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-matrix") == 0)
+		{
+			benchmark_matrix = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-affine") == 0)
+		{
+			benchmark_affine = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-culling") == 0)
+		{
+			benchmark_culling = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-rasterizer") == 0)
+		{
+			benchmark_rasterizer = true;
+
+			if ((i + 2 < argc) && isdigit(argv[i + 1][0]) && isdigit(argv[i + 2][0]))
+			{
+				rasterizer_width = static_cast<unsigned int>(atoi(argv[i + 1]));
+				rasterizer_height = static_cast<unsigned int>(atoi(argv[i + 2]));
+				i += 2;
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-bvh") == 0)
+		{
+			benchmark_bvh = 10000000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_bvh = static_cast<size_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-mesh-pack") == 0)
+		{
+			benchmark_mesh_pack = 2;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_mesh_pack = static_cast<unsigned int>(atoi(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-mesh-generator") == 0)
+		{
+			benchmark_mesh_generator = 16000000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_mesh_generator = static_cast<uint64_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-mesh-optimize") == 0)
+		{
+			benchmark_mesh_optimize = 4000000;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				benchmark_mesh_optimize = static_cast<uint64_t>(atoll(argv[++i]));
+			}
+		}
+		else if (strcmp(argv[i], "-benchmark-frame-arena") == 0)
+		{
+			benchmark_frame_arena = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-instance-upload") == 0)
+		{
+			benchmark_instance_upload = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-state-cache") == 0)
+		{
+			benchmark_state_cache = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-constant-ring") == 0)
+		{
+			benchmark_constant_ring = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-shader-build") == 0)
+		{
+			benchmark_shader_build = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-shader-cache") == 0)
+		{
+			benchmark_shader_cache = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-command-buffers") == 0)
+		{
+			benchmark_command_buffers = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-logger") == 0)
+		{
+			benchmark_logger = true;
+		}
+		else if (strcmp(argv[i], "-benchmark-profiler") == 0)
+		{
+			benchmark_profiler = true;
+		}
+		else if (strcmp(argv[i], "-stress-simulation") == 0)
+		{
+			stress_seconds = 10;
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				stress_seconds = static_cast<unsigned int>(atoi(argv[i + 1]));
+				i += 1;
+			}
+		}
+		else if ((strcmp(argv[i], "-replay-capture") == 0) && (i + 1 < argc))
+		{
+			replay_path = argv[++i];
+
+			if ((i + 1 < argc) && isdigit(argv[i + 1][0]))
+			{
+				replay_repeats = static_cast<unsigned int>(atoi(argv[++i]));
+			}
+		}
+		else if ((strcmp(argv[i], "-log-file") == 0) && (i + 1 < argc))
+		{
+			log_path = argv[++i];
+		}
+	}
+
+	// from here on the log thread writes, to the console if the file cannot be created
+	if (FAILED(Log::Start(log_path)))
+	{
+		Log::Start(NULL);
+	}
+
+	Matrix::Initialize();
+
+	// one thread per core, clamped to what the job system supports so that this cannot fail
+	jobs.Initialize(std::min(std::max(std::thread::hardware_concurrency(), 1u), static_cast<unsigned int>(JobSystem::MAX_THREADS)));
+
+	if (benchmark_vertex_packing)
+	{
+		status = RunVertexPackingBenchmark();
+	}
+	else if (benchmark_jobs)
+	{
+		status = RunJobBenchmark();
+	}
+	else if (benchmark_rotations)
+	{
+		status = RunRotationBenchmark();
+	}
+	else if (benchmark_rotation_drift != 0)
+	{
+		status = RunRotationDriftBenchmark(benchmark_rotation_drift);
+	}
+	else if (benchmark_animation != 0)
+	{
+		status = RunAnimationBenchmark(benchmark_animation);
+	}
+	else if (benchmark_hierarchy != 0)
+	{
+		status = RunHierarchyBenchmark(benchmark_hierarchy, jobs);
+	}
+	else if (benchmark_matrix)
+	{
+		status = RunMatrixBenchmark();
+	}
+	else if (benchmark_affine)
+	{
+		status = RunAffineBenchmark();
+	}
+	else if (benchmark_culling)
+	{
+		status = RunCullingBenchmark(jobs);
+	}
+	else if (benchmark_rasterizer)
+	{
+		status = RunRasterizerBenchmark(rasterizer_width, rasterizer_height, jobs);
+	}
+	else if (benchmark_bvh != 0)
+	{
+		status = RunBvhBenchmark(benchmark_bvh, jobs);
+	}
+	else if (benchmark_mesh_pack != 0)
+	{
+		status = RunMeshPackBenchmark(benchmark_mesh_pack);
+	}
+	else if (benchmark_mesh_generator != 0)
+	{
+		status = RunMeshGeneratorBenchmark(benchmark_mesh_generator, jobs);
+	}
+	else if (benchmark_mesh_optimize != 0)
+	{
+		status = RunMeshOptimizeBenchmark(benchmark_mesh_optimize, jobs);
+	}
+	else if (benchmark_frame_arena)
+	{
+		status = RunFrameArenaBenchmark(jobs);
+	}
+	else if (benchmark_instance_upload)
+	{
+		status = RunInstanceUploadBenchmark(jobs);
+	}
+	else if (benchmark_state_cache)
+	{
+		status = RunStateCacheBenchmark();
+	}
+	else if (benchmark_constant_ring)
+	{
+		status = RunConstantRingBenchmark();
+	}
+	else if (benchmark_shader_build)
+	{
+		status = RunShaderBuildBenchmark();
+	}
+	else if (benchmark_shader_cache)
+	{
+		status = RunShaderCacheBenchmark();
+	}
+	else if (benchmark_command_buffers)
+	{
+		status = RunCommandBufferBenchmark(jobs);
+	}
+	else if (benchmark_logger)
+	{
+		status = RunLoggerBenchmark();
+	}
+	else if (benchmark_profiler)
+	{
+		status = RunProfilerBenchmark();
+	}
+	else if (replay_path != NULL)
+	{
+		status = RunCaptureReplay(replay_path, replay_repeats);
+	}
+	else if (stress_seconds != 0)
+	{
+		status = RunSimulationStress(stress_seconds, jobs);
+	}
+	else
+	{
+		WriteToConsole("nothing to run, pass one of the flags at the top of main\n");
+		status = STATUS_INVALID_PARAMETER;
+	}
+
+	jobs.Uninitialize();
+
+	Log::Stop();
+
+	return status;
+}